@@ -2,6 +2,24 @@
 
 #include <pulchritude-math/math.h>
 
+#include <stdbool.h>
+#include <stdint.h>
+
 typedef struct { // node-unit
   PuleF32v2 position;
+  PuleF32v2 goal;
+  PuleF32v2 velocity; // written by map-movement steering
+  float speed; // world units per second
+  bool hasGoal;
+  // bumped by whoever sets goal or hasGoal, so a repeated order isn't taken
+  //   for the one the unit just finished
+  uint32_t order;
+  // 1 + slot in the simulation, 0 until map-movement hands the unit over
+  uint32_t simulationSlot;
+  uint32_t meshType; // node-unit-render mesh registry id, 0 by default
+  uint8_t team; // fog of war is shared within a team
+  float visionRadius; // world units, 0 for the default
+  // 1 + simulation slot of the nearest enemy unit in sight, 0 for none;
+  //   written by map-movement
+  uint32_t target;
 } PulcComponentNodeUnit;
@@ -6,12 +6,142 @@
 #include "components/node-unit.h"
 
 #include "graph.h"
+#include "influence/influence-map.h"
+#include "jobs/job-system.h"
+#include "memory/frame-arena.h"
+#include "profile/profiler.h"
+#include "registry/handle-registry.h"
+#include "schedule/system-schedule.h"
+#include "simulation/simulation.h"
+#include "visibility/fog-of-war.h"
+
+#include <string>
+#include <vector>
 
 namespace {
 PuleEngineLayer pul;
 PuleEcsWorld world;
 PulePlatform platform;
 PulePluginPayload payload;
+JobPool * jobPool = nullptr;
+PulcJobSystem jobSystem;
+FrameArena * frameArena = nullptr;
+PulcFrameArena frameArenaShared;
+Profiler * profiler = nullptr;
+PulcProfiler profilerShared;
+PulcInfluenceMaps influenceMapsShared;
+PulcFogOfWar fogOfWarShared;
+HandleRegistry handles;
+HandlePayloadU64 handleTestEntity;
+HandleComponent handleNodeUnit;
+Simulation simulation;
+
+// systems declared with callback-frequency "none" are left alone by the
+//   engine and advanced from pulcComponentUpdate in dependency order
+float constexpr scheduleTimestep = 1.0f/60.0f;
+SystemSchedule systemSchedule;
+std::vector<PuleEcsSystem> scheduledSystems;
+
+std::string dsString(PuleDsValue const value) {
+  if (!pul.dsIsString(value)) { return {}; }
+  PuleStringView const view = pul.dsAsString(value);
+  return std::string(view.contents, view.len);
+}
+
+void scheduleAccess(
+  size_t const node, PuleDsValue const components, SystemAccess const access
+) {
+  if (!pul.dsIsArray(components)) { return; }
+  PuleDsValueArray const array = pul.dsAsArray(components);
+  for (size_t it = 0; it < array.length; ++ it) {
+    systemScheduleAccess(
+      systemSchedule, node, dsString(array.values[it]), access
+    );
+  }
+}
+
+SimulationSettings settingsLoad(PuleDsValue const graph) {
+  std::string const determinism = dsString(
+    pul.dsObjectMember(graph, "determinism")
+  );
+  SimulationSettings settings = {
+    .determinism = SimulationDeterminism_none,
+  };
+  if (determinism == "replay") {
+    settings.determinism = SimulationDeterminism_replay;
+  } else if (determinism == "lockstep") {
+    settings.determinism = SimulationDeterminism_lockstep;
+  } else if (!determinism.empty() && determinism != "none") {
+    pul.log(
+      "unknown determinism '%s', expected none, replay or lockstep",
+      determinism.c_str()
+    );
+  }
+  return settings;
+}
+
+void scheduleLoad(PuleDsValue const graph) {
+  systemScheduleClear(systemSchedule);
+  scheduledSystems.clear();
+
+  PuleDsValue const systems = pul.dsObjectMember(graph, "systems");
+  PuleDsValueArray const declarations = pul.dsAsArray(systems);
+  // run callbacks point into this, so no reallocation past here
+  scheduledSystems.reserve(declarations.length);
+  for (size_t it = 0; it < declarations.length; ++ it) {
+    PuleDsValue const declaration = declarations.values[it];
+    std::string const frequency = (
+      dsString(pul.dsObjectMember(declaration, "callback-frequency"))
+    );
+    if (frequency != "none") { continue; }
+    std::string const label = (
+      dsString(pul.dsObjectMember(declaration, "name"))
+    );
+    scheduledSystems.emplace_back(
+      pul.ecsSystemFetchByLabel(world, pul.cStr(label.c_str()))
+    );
+    size_t const node = systemScheduleAdd(
+      systemSchedule, label,
+      [](void * const userdata) {
+        pul.ecsSystemAdvance(
+          world, *reinterpret_cast<PuleEcsSystem *>(userdata),
+          scheduleTimestep, nullptr
+        );
+      },
+      &scheduledSystems.back()
+    );
+    scheduleAccess(
+      node, pul.dsObjectMember(declaration, "reads"), SystemAccess_read
+    );
+    scheduleAccess(
+      node, pul.dsObjectMember(declaration, "writes"), SystemAccess_write
+    );
+  }
+
+  systemScheduleBuild(systemSchedule);
+  for (auto const & node : systemSchedule.nodes) {
+    pul.log("system '%s' scheduled in wave %zu", node.label.c_str(), node.wave);
+  }
+}
+} // namespace
+
+// first guess at a frame's scratch memory, grown to what frames need
+size_t constexpr frameArenaBlockCapacity = size_t(1) << 20;
+
+JobPool & graphJobPool() {
+  return *::jobPool;
+}
+
+Simulation & graphSimulation() {
+  return ::simulation;
+}
+
+HandleRegistry & graphHandles() {
+  return ::handles;
+}
+
+PulcFrameArena const & graphFrameArena() {
+  return ::frameArenaShared;
 }
 
 extern "C" {
@@ -36,6 +166,48 @@ void pulcComponentLoad(PulePluginPayload const newPayload) {
 
   pul.log("graph plugin loaded");
 
+  // created once and reused every frame by the systems and other plugins
+  ::jobPool = jobPoolCreate(0);
+  ::jobSystem = jobPoolInterface(::jobPool);
+  pul.pluginPayloadStore(::payload, pul.cStr("pulc-job-system"), &::jobSystem);
+  ::frameArena = (
+    frameArenaCreate(pul.allocateDefault(), frameArenaBlockCapacity)
+  );
+  ::frameArenaShared = frameArenaInterface(::frameArena);
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-frame-arena"), &::frameArenaShared
+  );
+  ::profiler = profilerCreate();
+  ::profilerShared = profilerInterface(::profiler);
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-profiler"), &::profilerShared
+  );
+
+  // the graph plugin's settings and systems
+  PuleError err = pul.error();
+  PuleDsValue const ecs = pul.assetPdsLoadFromFile(
+    pul.allocateDefault(), pul.cStr("puldata/ecs.pds"), &err
+  );
+  bool const ecsLoaded = !pul.errorConsume(&err);
+  PuleDsValue const graph = (
+      ecsLoaded
+    ? pul.dsObjectMember(pul.dsObjectMember(ecs, "plugins"), "graph")
+    : PuleDsValue {}
+  );
+
+  simulationStart(
+    ::simulation, *::jobPool, &::profilerShared,
+    ecsLoaded ? settingsLoad(graph) : SimulationSettings {}
+  );
+  ::influenceMapsShared = simulationInfluenceInterface(::simulation);
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-influence-maps"), &::influenceMapsShared
+  );
+  ::fogOfWarShared = simulationFogInterface(::simulation);
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-fog-of-war"), &::fogOfWarShared
+  );
+
   ::world = PuleEcsWorld {
     pulePluginPayloadFetchU64(::payload, puleCStr("pule-ecs-world"))
   };
@@ -54,25 +226,59 @@ void pulcComponentLoad(PulePluginPayload const newPayload) {
     &unit
   );
 
+  handleRegistryCreate(::handles, pul, ::payload, ::world);
+  ::handleTestEntity = handlePayloadU64(::handles, "test-entity");
+  ::handleNodeUnit = handleComponent(::handles, "PulcComponentNodeUnit");
+  systemMapMovementInitialize();
   systemNodeUnitRenderInitialize();
+  if (ecsLoaded) {
+    scheduleLoad(graph);
+    pul.dsDestroy(ecs);
+  }
+  // other plugins' registries drop what they resolved from the last load
+  handleRevisionBump(pul, ::payload);
 }
 
 void pulcComponentUpdate(PulePluginPayload const) {
+  // other plugins allocate after the graph plugin, so this is the boundary
+  frameArenaFrame(*::frameArena);
+  handleRegistryRefresh(::handles);
+  // statistics are per graph update, close the last one before timing this
+  #if PULC_PROFILER
+    profilerFrame(*::profiler);
+  #endif
+  PULC_PROFILE_ZONE(&::profilerShared, "graph pulcComponentUpdate");
   PuleEcsEntity const testEntity = {
-    .id = pul.pluginPayloadFetchU64(payload, pul.cStr("test-entity")),
+    .id = handleFetch(::handles, ::handleTestEntity),
   };
   assert(testEntity.id);
   auto & nodeUnit = *reinterpret_cast<PulcComponentNodeUnit const *>(
     pul.ecsEntityComponentData(
-      world, testEntity,
-      pul.ecsComponentFetchByLabel(world, pul.cStr("PulcComponentNodeUnit"))
+      world, testEntity, handleFetch(::handles, ::handleNodeUnit)
     )
   );
   assert(nodeUnit.position.x == 1.0f);
+
+  systemScheduleRun(systemSchedule, *::jobPool, &::profilerShared);
 }
 
 void pulcComponentUnload(PulePluginPayload const) {
   pul.pluginPayloadRemove(payload, pul.cStr("test-entity"));
+  pul.pluginPayloadRemove(payload, pul.cStr("pulc-fog-of-war"));
+  pul.pluginPayloadRemove(payload, pul.cStr("pulc-influence-maps"));
+  pul.pluginPayloadRemove(payload, pul.cStr("pulc-profiler"));
+  pul.pluginPayloadRemove(payload, pul.cStr("pulc-frame-arena"));
+  pul.pluginPayloadRemove(payload, pul.cStr("pulc-job-system"));
+  // waits for other plugins' threads still using the pool
+  handleRevisionBump(pul, payload);
+  systemNodeUnitRenderShutdown();
+  simulationStop(::simulation);
+  profilerDestroy(::profiler);
+  ::profiler = nullptr;
+  frameArenaDestroy(::frameArena);
+  ::frameArena = nullptr;
+  jobPoolDestroy(::jobPool);
+  ::jobPool = nullptr;
 }
 
 } // extern C
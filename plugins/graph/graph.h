@@ -2,6 +2,12 @@
 
 #include <pulchritude-plugin/plugin.h>
 
+#include "memory/frame-arena.h"
+#include "registry/handle-registry.h"
+
+struct JobPool;
+struct Simulation;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,4 +19,23 @@ PuleEngineLayer * pulcEngineLayer();
 } // C
 #endif
 
+void systemMapMovementInitialize();
 void systemNodeUnitRenderInitialize();
+// releases the GPU resources, once the frames in flight are done with them
+void systemNodeUnitRenderShutdown();
+
+// worker pool shared by the graph systems, alive between component load and
+//   unload; other plugins reach it through "pulc-job-system"
+JobPool & graphJobPool();
+
+// scratch memory valid until the end of the next update, alive between
+//   component load and unload; other plugins reach it through
+//   "pulc-frame-arena"
+PulcFrameArena const & graphFrameArena();
+
+// lookups resolved at load, refreshed once a graph update before the
+//   systems run; main thread
+HandleRegistry & graphHandles();
+
+// fixed-rate movement simulation, running between component load and unload
+Simulation & graphSimulation();
@@ -0,0 +1,417 @@
+#include "influence-map.h"
+
+#include "../jobs/job-system.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define INFLUENCE_X86 1
+#include <immintrin.h>
+#else
+#define INFLUENCE_X86 0
+#endif
+
+namespace {
+
+// rows per job, a vectorized row of a few hundred cells is well under a
+//   microsecond
+size_t constexpr influenceRowGrain = 32;
+
+// out = keep*row + spread*(left + right + up + down) + stamps, over the
+//   cells [begin, end) of a row; neighbours past the edge are the cell
+//   itself, so nothing flows off the map. Every kernel sums in this order,
+//   so they agree to the bit
+struct DiffuseRow {
+  float const * up;
+  float const * row;
+  float const * down;
+  float const * stamps;
+  float * out;
+  size_t width;
+  float keep, spread;
+};
+
+// -- scalar -------------------------------------------------------------------
+
+void diffuseScalar(DiffuseRow const & d, size_t const begin, size_t const end) {
+  for (size_t x = begin; x < end; ++ x) {
+    float const left = d.row[x > 0 ? x-1 : x];
+    float const right = d.row[x+1 < d.width ? x+1 : x];
+    d.out[x] = (
+        d.keep*d.row[x]
+      + d.spread*(((left + right) + d.up[x]) + d.down[x])
+      + d.stamps[x]
+    );
+  }
+}
+
+void accumulateScalar(
+  float * const out, float const * const layer, float const weight,
+  size_t const count
+) {
+  for (size_t it = 0; it < count; ++ it) {
+    out[it] += weight*layer[it];
+  }
+}
+
+#if INFLUENCE_X86
+
+// -- sse ----------------------------------------------------------------------
+
+void diffuseSse(DiffuseRow const & d) {
+  __m128 const vKeep = _mm_set1_ps(d.keep);
+  __m128 const vSpread = _mm_set1_ps(d.spread);
+  // the first and last cells clamp their neighbours, the rest are interior
+  size_t x = 1;
+  for (; x + 4 < d.width; x += 4) {
+    __m128 const neighbours = _mm_add_ps(
+      _mm_add_ps(
+        _mm_add_ps(_mm_loadu_ps(d.row + x - 1), _mm_loadu_ps(d.row + x + 1)),
+        _mm_loadu_ps(d.up + x)
+      ),
+      _mm_loadu_ps(d.down + x)
+    );
+    _mm_storeu_ps(
+      d.out + x,
+      _mm_add_ps(
+        _mm_add_ps(
+          _mm_mul_ps(vKeep, _mm_loadu_ps(d.row + x)),
+          _mm_mul_ps(vSpread, neighbours)
+        ),
+        _mm_loadu_ps(d.stamps + x)
+      )
+    );
+  }
+  diffuseScalar(d, 0, std::min<size_t>(1, d.width));
+  diffuseScalar(d, std::max<size_t>(x, 1), d.width);
+}
+
+void accumulateSse(
+  float * const out, float const * const layer, float const weight,
+  size_t const count
+) {
+  __m128 const vWeight = _mm_set1_ps(weight);
+  size_t it = 0;
+  for (; it + 4 <= count; it += 4) {
+    _mm_storeu_ps(
+      out + it,
+      _mm_add_ps(
+        _mm_loadu_ps(out + it),
+        _mm_mul_ps(vWeight, _mm_loadu_ps(layer + it))
+      )
+    );
+  }
+  accumulateScalar(out + it, layer + it, weight, count - it);
+}
+
+// -- avx2 ---------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+void diffuseAvx2(DiffuseRow const & d) {
+  __m256 const vKeep = _mm256_set1_ps(d.keep);
+  __m256 const vSpread = _mm256_set1_ps(d.spread);
+  size_t x = 1;
+  for (; x + 8 < d.width; x += 8) {
+    __m256 const neighbours = _mm256_add_ps(
+      _mm256_add_ps(
+        _mm256_add_ps(
+          _mm256_loadu_ps(d.row + x - 1), _mm256_loadu_ps(d.row + x + 1)
+        ),
+        _mm256_loadu_ps(d.up + x)
+      ),
+      _mm256_loadu_ps(d.down + x)
+    );
+    // no fused multiply-add, it would round differently from the others
+    _mm256_storeu_ps(
+      d.out + x,
+      _mm256_add_ps(
+        _mm256_add_ps(
+          _mm256_mul_ps(vKeep, _mm256_loadu_ps(d.row + x)),
+          _mm256_mul_ps(vSpread, neighbours)
+        ),
+        _mm256_loadu_ps(d.stamps + x)
+      )
+    );
+  }
+  diffuseScalar(d, 0, std::min<size_t>(1, d.width));
+  diffuseScalar(d, std::max<size_t>(x, 1), d.width);
+}
+
+__attribute__((target("avx2")))
+void accumulateAvx2(
+  float * const out, float const * const layer, float const weight,
+  size_t const count
+) {
+  __m256 const vWeight = _mm256_set1_ps(weight);
+  size_t it = 0;
+  for (; it + 8 <= count; it += 8) {
+    _mm256_storeu_ps(
+      out + it,
+      _mm256_add_ps(
+        _mm256_loadu_ps(out + it),
+        _mm256_mul_ps(vWeight, _mm256_loadu_ps(layer + it))
+      )
+    );
+  }
+  accumulateScalar(out + it, layer + it, weight, count - it);
+}
+
+#endif // INFLUENCE_X86
+
+void diffuse(InfluenceKernel const kernel, DiffuseRow const & d) {
+  switch (kernel) {
+    #if INFLUENCE_X86
+      case InfluenceKernel_avx2: diffuseAvx2(d); return;
+      case InfluenceKernel_sse: diffuseSse(d); return;
+    #endif
+    default: diffuseScalar(d, 0, d.width); return;
+  }
+}
+
+void accumulate(
+  InfluenceKernel const kernel,
+  float * const out, float const * const layer, float const weight,
+  size_t const count
+) {
+  switch (kernel) {
+    #if INFLUENCE_X86
+      case InfluenceKernel_avx2:
+        accumulateAvx2(out, layer, weight, count);
+      return;
+      case InfluenceKernel_sse:
+        accumulateSse(out, layer, weight, count);
+      return;
+    #endif
+    default:
+      accumulateScalar(out, layer, weight, count);
+    return;
+  }
+}
+
+// -- update -------------------------------------------------------------------
+
+// cell coordinate of a world position, relative to cell centres and clamped
+//   to the grid
+float cellCoordinate(
+  float const position, float const origin, float const cellDim,
+  size_t const cells
+) {
+  float const coordinate = (position - origin)/cellDim - 0.5f;
+  return std::clamp(coordinate, 0.0f, static_cast<float>(cells - 1));
+}
+
+// splits each unit's strength over the four cell centres around it; the
+//   stamps are zero, the last update cleared each row it diffused
+void unitsStamp(
+  InfluenceMaps & maps,
+  float const * const positionX, float const * const positionY,
+  uint8_t const * const teams, size_t const count
+) {
+  for (size_t it = 0; it < count; ++ it) {
+    if (teams[it] >= influenceLayerCount) { continue; }
+    maps.layersUsed = std::max(maps.layersUsed, uint32_t(teams[it]) + 1);
+  }
+  for (size_t it = 0; it < count; ++ it) {
+    if (teams[it] >= influenceLayerCount) { continue; }
+    float const fx = cellCoordinate(
+      positionX[it], maps.origin.x, maps.cellDim, maps.width
+    );
+    float const fy = cellCoordinate(
+      positionY[it], maps.origin.y, maps.cellDim, maps.height
+    );
+    size_t const x0 = static_cast<size_t>(fx);
+    size_t const y0 = static_cast<size_t>(fy);
+    size_t const x1 = std::min(x0+1, maps.width-1);
+    size_t const y1 = std::min(y0+1, maps.height-1);
+    float const tx = fx - x0, ty = fy - y0;
+    float * const stamps = maps.layers[teams[it]].stamps.data();
+    float const s = influenceUnitStrength;
+    stamps[y0*maps.stride + x0] += s*(1.0f-tx)*(1.0f-ty);
+    stamps[y0*maps.stride + x1] += s*tx*(1.0f-ty);
+    stamps[y1*maps.stride + x0] += s*(1.0f-tx)*ty;
+    stamps[y1*maps.stride + x1] += s*tx*ty;
+  }
+}
+
+// rows are layer-major, layer*height + y
+void rowsDiffuse(InfluenceMaps & maps, size_t const begin, size_t const end) {
+  float const keep = influenceDecay*(1.0f - influenceDiffusion);
+  float const spread = influenceDecay*influenceDiffusion*0.25f;
+  for (size_t it = begin; it < end; ++ it) {
+    InfluenceLayer & layer = maps.layers[it / maps.height];
+    size_t const y = it % maps.height;
+    float const * const row = layer.current.data() + y*maps.stride;
+    diffuse(
+      maps.kernel,
+      DiffuseRow {
+        .up = y > 0 ? row - maps.stride : row,
+        .row = row,
+        .down = y+1 < maps.height ? row + maps.stride : row,
+        .stamps = layer.stamps.data() + y*maps.stride,
+        .out = layer.next.data() + y*maps.stride,
+        .width = maps.width,
+        .keep = keep, .spread = spread,
+      }
+    );
+    float * const stamps = layer.stamps.data() + y*maps.stride;
+    std::fill(stamps, stamps + maps.width, 0.0f);
+  }
+}
+
+} // namespace
+
+InfluenceKernel influenceKernelDetect() {
+  #if INFLUENCE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { return InfluenceKernel_avx2; }
+    if (__builtin_cpu_supports("sse2")) { return InfluenceKernel_sse; }
+  #endif
+  return InfluenceKernel_scalar;
+}
+
+char const * influenceKernelLabel(InfluenceKernel const kernel) {
+  switch (kernel) {
+    case InfluenceKernel_scalar: return "scalar";
+    case InfluenceKernel_sse: return "sse";
+    case InfluenceKernel_avx2: return "avx2";
+  }
+  return "unknown";
+}
+
+void influenceMapsConfigure(
+  InfluenceMaps & maps, PuleF32v2 const origin, PuleF32v2 const extent,
+  float const cellDim
+) {
+  size_t const width = std::max<size_t>(
+    1, static_cast<size_t>(std::ceil(extent.x / cellDim))
+  );
+  size_t const height = std::max<size_t>(
+    1, static_cast<size_t>(std::ceil(extent.y / cellDim))
+  );
+  if (
+       maps.width == width && maps.height == height
+    && maps.origin.x == origin.x && maps.origin.y == origin.y
+    && maps.cellDim == cellDim
+  ) {
+    return;
+  }
+  maps.width = width;
+  maps.height = height;
+  maps.stride = (
+    (width + influenceLaneWidth - 1) / influenceLaneWidth * influenceLaneWidth
+  );
+  maps.origin = origin;
+  maps.cellDim = cellDim;
+  // padding columns are never written, so they stay zero
+  for (InfluenceLayer & layer : maps.layers) {
+    layer.current.assign(maps.stride*height, 0.0f);
+    layer.next.assign(maps.stride*height, 0.0f);
+    layer.stamps.assign(maps.stride*height, 0.0f);
+  }
+  maps.layersUsed = 0;
+  maps.rowCursor = 0;
+  maps.revision = 0;
+}
+
+void influenceMapsStep(
+  InfluenceMaps & maps, JobPool & jobs,
+  float const * const positionX, float const * const positionY,
+  uint8_t const * const teams, size_t const count
+) {
+  if (maps.width == 0) { return; }
+  // units are captured once per update, so every band diffuses the same
+  //   stamps even as the units move on
+  if (maps.rowCursor == 0) {
+    unitsStamp(maps, positionX, positionY, teams, count);
+  }
+  size_t const rowCount = maps.layersUsed*maps.height;
+  if (rowCount == 0) { return; }
+  size_t const band = (
+    (rowCount + influenceUpdateTicks - 1) / influenceUpdateTicks
+  );
+  size_t const begin = maps.rowCursor;
+  size_t const end = std::min(begin + band, rowCount);
+  auto const work = [&](size_t const bandBegin, size_t const bandEnd) {
+    rowsDiffuse(maps, begin + bandBegin, begin + bandEnd);
+  };
+  jobParallelFor(jobs, end - begin, influenceRowGrain, work);
+  maps.rowCursor = end;
+  if (maps.rowCursor < rowCount) { return; }
+
+  for (uint32_t layer = 0; layer < maps.layersUsed; ++ layer) {
+    std::swap(maps.layers[layer].current, maps.layers[layer].next);
+  }
+  maps.rowCursor = 0;
+  ++ maps.revision;
+}
+
+void influenceMapsCombine(
+  InfluenceMaps const & maps, float const (&weights)[influenceLayerCount],
+  std::vector<float> & out
+) {
+  size_t const count = maps.stride*maps.height;
+  out.assign(count, 0.0f);
+  for (uint32_t layer = 0; layer < maps.layersUsed; ++ layer) {
+    if (weights[layer] == 0.0f) { continue; }
+    accumulate(
+      maps.kernel, out.data(), maps.layers[layer].current.data(),
+      weights[layer], count
+    );
+  }
+}
+
+float influenceMapsAt(
+  InfluenceMaps const & maps, std::vector<float> const & values,
+  PuleF32v2 const position
+) {
+  if (maps.width == 0 || values.size() < maps.stride*maps.height) {
+    return 0.0f;
+  }
+  float const fx = cellCoordinate(
+    position.x, maps.origin.x, maps.cellDim, maps.width
+  );
+  float const fy = cellCoordinate(
+    position.y, maps.origin.y, maps.cellDim, maps.height
+  );
+  size_t const x0 = static_cast<size_t>(fx);
+  size_t const y0 = static_cast<size_t>(fy);
+  size_t const x1 = std::min(x0+1, maps.width-1);
+  size_t const y1 = std::min(y0+1, maps.height-1);
+  float const tx = fx - x0, ty = fy - y0;
+  float const top = (
+      values[y0*maps.stride + x0]*(1.0f-tx)
+    + values[y0*maps.stride + x1]*tx
+  );
+  float const bottom = (
+      values[y1*maps.stride + x0]*(1.0f-tx)
+    + values[y1*maps.stride + x1]*tx
+  );
+  return top*(1.0f-ty) + bottom*ty;
+}
+
+void influenceMapsCopyFinished(
+  InfluenceMaps & out, InfluenceMaps const & maps
+) {
+  if (
+       out.revision == maps.revision && out.width == maps.width
+    && out.height == maps.height && out.origin.x == maps.origin.x
+    && out.origin.y == maps.origin.y && out.cellDim == maps.cellDim
+  ) {
+    return;
+  }
+  out.kernel = maps.kernel;
+  out.width = maps.width;
+  out.height = maps.height;
+  out.stride = maps.stride;
+  out.origin = maps.origin;
+  out.cellDim = maps.cellDim;
+  out.layersUsed = maps.layersUsed;
+  for (uint32_t layer = 0; layer < maps.layersUsed; ++ layer) {
+    out.layers[layer].current.assign(
+      maps.layers[layer].current.begin(), maps.layers[layer].current.end()
+    );
+  }
+  out.rowCursor = 0;
+  out.revision = maps.revision;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <pulchritude-math/math.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -- shared C interface -------------------------------------------------------
+
+// the graph plugin stores a PulcInfluenceMaps under "pulc-influence-maps" so
+//   AI plugins can read the last finished update the simulation published.
+//   Main thread only; it moves on when map-movement takes a new snapshot
+
+#define pulcInfluenceLayerCount 8 // one per team
+
+typedef struct {
+  void * simulation;
+  // cells across and down, floats per row, world position of the first
+  //   cell's corner and a cell's side; width is 0 until there is a map
+  void (* grid)(
+    void * simulation, size_t * width, size_t * height, size_t * stride,
+    PuleF32v2 * origin, float * cellDim
+  );
+  // finished updates so far, unchanged maps need not be combined again
+  uint64_t (* revision)(void * simulation);
+  // out = sum of weights[layer] * layer, stride*height floats; weights holds
+  //   pulcInfluenceLayerCount, e.g. a team's threat is every other team's
+  //   layer weighted 1
+  void (* combine)(void * simulation, float const * weights, float * out);
+  // the same sum at a world position, bilinear between cell centres
+  float (* at)(void * simulation, float const * weights, PuleF32v2 position);
+} PulcInfluenceMaps;
+
+#ifdef __cplusplus
+
+#include <vector>
+
+// -- graph plugin -------------------------------------------------------------
+
+struct JobPool;
+
+// per-team influence over a coarse grid for AI threat and control queries.
+//   Every update each team's units stamp their strength into its layer, and
+//   what the layer held decays and diffuses into the 4-neighbours. Updates
+//   are spread over influenceUpdateTicks ticks a band of rows at a time, each
+//   band split over the job pool; layers are double buffered, so readers
+//   always see the last finished update whole
+
+uint32_t constexpr influenceLayerCount = pulcInfluenceLayerCount;
+float constexpr influenceCellDimDefault = 4.0f; // world units
+uint32_t constexpr influenceUpdateTicks = 4;
+float constexpr influenceDecay = 0.9f; // kept per update
+float constexpr influenceDiffusion = 0.5f; // taken from the neighbour mean
+float constexpr influenceUnitStrength = 1.0f;
+
+// rows are padded to a multiple of this
+size_t constexpr influenceLaneWidth = 8;
+
+enum InfluenceKernel {
+  InfluenceKernel_scalar,
+  InfluenceKernel_sse,
+  InfluenceKernel_avx2,
+};
+
+// widest kernel the running CPU supports
+InfluenceKernel influenceKernelDetect();
+char const * influenceKernelLabel(InfluenceKernel const kernel);
+
+struct InfluenceLayer {
+  std::vector<float> current; // last finished update
+  std::vector<float> next; // written band by band
+  std::vector<float> stamps; // unit strength of the update in progress
+};
+
+struct InfluenceMaps {
+  InfluenceKernel kernel;
+  size_t width, height; // cells
+  size_t stride; // floats per row
+  PuleF32v2 origin;
+  float cellDim;
+
+  InfluenceLayer layers[influenceLayerCount];
+  uint32_t layersUsed; // teams seen so far, higher layers stay zero
+  // the update in progress over layersUsed*height rows, layer-major
+  size_t rowCursor;
+  uint64_t revision; // finished updates
+};
+
+// covers [origin, origin+extent]; clears every layer unless nothing changed
+void influenceMapsConfigure(
+  InfluenceMaps & maps, PuleF32v2 const origin, PuleF32v2 const extent,
+  float const cellDim
+);
+
+// advances the update in progress by one tick's band of rows; the first band
+//   of an update stamps the units given to it, later ones ignore theirs
+void influenceMapsStep(
+  InfluenceMaps & maps, JobPool & jobs,
+  float const * const positionX, float const * const positionY,
+  uint8_t const * const teams, size_t const count
+);
+
+// out = sum of weights[layer] * layer over the last finished update, sized
+//   stride*height; e.g. a team's control is its own layer weighted 1 and
+//   every other -1, its threat the others weighted 1
+void influenceMapsCombine(
+  InfluenceMaps const & maps, float const (&weights)[influenceLayerCount],
+  std::vector<float> & out
+);
+
+// bilinear between cell centres of a stride*height map, clamped to the edge
+float influenceMapsAt(
+  InfluenceMaps const & maps, std::vector<float> const & values,
+  PuleF32v2 const position
+);
+
+// out holds maps' last finished update for readers on another thread, left
+//   as is when it already does; out's update in progress stays empty
+void influenceMapsCopyFinished(InfluenceMaps & out, InfluenceMaps const & maps);
+
+#endif
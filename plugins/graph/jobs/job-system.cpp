@@ -0,0 +1,278 @@
+#include "job-system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// -- deque --------------------------------------------------------------------
+
+// everything a parallelFor call shares with the chunks it spawns; lives on
+//   the calling thread's stack until remaining reaches zero
+struct JobBatch {
+  PulcJobRangeFn fn;
+  void * userdata;
+  size_t grain;
+  std::atomic<size_t> remaining; // indices not yet processed
+};
+
+struct JobRange {
+  JobBatch * batch;
+  size_t begin, end;
+};
+
+size_t constexpr jobDequeCapacity = 1024;
+
+inline void spinPause() {
+  #if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+  #else
+    std::this_thread::yield();
+  #endif
+}
+
+// fixed-capacity ring; the owner pushes and pops at the bottom (newest,
+//   smallest ranges), thieves take from the top (oldest, largest ranges).
+//   Ranges are split lazily so a deque rarely holds more than a few dozen
+//   entries, a short spin lock is cheaper than getting a lock-free deque of
+//   multi-word entries right
+struct alignas(64) JobDeque {
+  std::atomic<bool> locked { false };
+  size_t top = 0, bottom = 0;
+  JobRange ranges[jobDequeCapacity];
+
+  void lock() {
+    while (locked.exchange(true, std::memory_order_acquire)) {
+      while (locked.load(std::memory_order_relaxed)) { spinPause(); }
+    }
+  }
+  void unlock() { locked.store(false, std::memory_order_release); }
+
+  bool push(JobRange const & range) {
+    lock();
+    bool const fits = bottom - top < jobDequeCapacity;
+    if (fits) {
+      ranges[bottom % jobDequeCapacity] = range;
+      ++ bottom;
+    }
+    unlock();
+    return fits;
+  }
+
+  bool pop(JobRange & range) {
+    lock();
+    bool const found = bottom != top;
+    if (found) {
+      -- bottom;
+      range = ranges[bottom % jobDequeCapacity];
+    }
+    unlock();
+    return found;
+  }
+
+  bool steal(JobRange & range) {
+    lock();
+    bool const found = bottom != top;
+    if (found) {
+      range = ranges[top % jobDequeCapacity];
+      ++ top;
+    }
+    unlock();
+    return found;
+  }
+};
+
+// -- pool ---------------------------------------------------------------------
+
+// slot of the current thread in JobPool::deques; threads the pool didn't
+//   spawn all share slot 0, which is safe as every deque operation is locked
+thread_local size_t jobWorkerSlot = 0;
+
+uint32_t constexpr jobIdleSpins = 256;
+
+} // namespace
+
+struct JobPool {
+  std::unique_ptr<JobDeque[]> deques; // slot 0 plus one per worker
+  size_t slotCount;
+  std::vector<std::thread> workers;
+
+  std::atomic<bool> running;
+  // bumped whenever a range is pushed; sleeping workers wait on it changing
+  std::atomic<uint64_t> workEpoch;
+  std::atomic<uint32_t> sleepers;
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+};
+
+namespace {
+
+void jobNotify(JobPool & pool) {
+  pool.workEpoch.fetch_add(1);
+  if (pool.sleepers.load() > 0) {
+    std::lock_guard<std::mutex> lock(pool.sleepMutex);
+    pool.wake.notify_all();
+  }
+}
+
+// own deque first, then every other deque starting from a rotating victim
+bool jobFind(JobPool & pool, size_t const slot, uint32_t & seed, JobRange & r) {
+  if (pool.deques[slot].pop(r)) { return true; }
+  seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+  size_t const start = seed % pool.slotCount;
+  for (size_t it = 0; it < pool.slotCount; ++ it) {
+    size_t const victim = (start + it) % pool.slotCount;
+    if (victim != slot && pool.deques[victim].steal(r)) { return true; }
+  }
+  return false;
+}
+
+// splits off upper halves for thieves until the range is down to grain, then
+//   runs what is left
+void jobRun(JobPool & pool, size_t const slot, JobRange range) {
+  JobBatch & batch = *range.batch;
+  bool pushed = false;
+  while (range.end - range.begin > batch.grain) {
+    size_t const mid = range.begin + (range.end - range.begin)/2;
+    if (!pool.deques[slot].push(JobRange { &batch, mid, range.end })) {
+      break; // deque is full, just do the whole thing here
+    }
+    pushed = true;
+    range.end = mid;
+  }
+  if (pushed) { jobNotify(pool); }
+  batch.fn(batch.userdata, range.begin, range.end);
+  batch.remaining.fetch_sub(
+    range.end - range.begin, std::memory_order_acq_rel
+  );
+}
+
+void jobWorkerLoop(JobPool * const poolPtr, size_t const slot) {
+  JobPool & pool = *poolPtr;
+  jobWorkerSlot = slot;
+  uint32_t seed = static_cast<uint32_t>(slot*2654435761u) | 1u;
+  JobRange range;
+  while (pool.running.load(std::memory_order_acquire)) {
+    uint64_t const epoch = pool.workEpoch.load();
+    bool found = false;
+    for (uint32_t spin = 0; spin < jobIdleSpins && !found; ++ spin) {
+      found = jobFind(pool, slot, seed, range);
+      if (!found) { spinPause(); }
+    }
+    if (found) {
+      jobRun(pool, slot, range);
+      continue;
+    }
+    // nothing anywhere, sleep until something is pushed after `epoch`
+    std::unique_lock<std::mutex> lock(pool.sleepMutex);
+    pool.sleepers.fetch_add(1);
+    pool.wake.wait(lock, [&]() {
+      return (
+           pool.workEpoch.load() != epoch
+        || !pool.running.load(std::memory_order_acquire)
+      );
+    });
+    pool.sleepers.fetch_sub(1);
+  }
+}
+
+// -- C interface --------------------------------------------------------------
+
+void jobInterfaceParallelFor(
+  void * const pool, size_t const count, size_t const grain,
+  PulcJobRangeFn const fn, void * const userdata
+) {
+  jobPoolParallelFor(
+    *reinterpret_cast<JobPool *>(pool), count, grain, fn, userdata
+  );
+}
+
+size_t jobInterfaceConcurrency(void * const pool) {
+  return jobPoolConcurrency(*reinterpret_cast<JobPool const *>(pool));
+}
+
+} // namespace
+
+JobPool * jobPoolCreate(size_t workerCount) {
+  if (workerCount == 0) {
+    size_t const hardware = std::thread::hardware_concurrency();
+    workerCount = hardware > 1 ? hardware-1 : 0;
+  }
+  auto * const pool = new JobPool;
+  pool->slotCount = workerCount + 1;
+  pool->deques = std::make_unique<JobDeque[]>(pool->slotCount);
+  pool->running.store(true);
+  pool->workEpoch.store(0);
+  pool->sleepers.store(0);
+  pool->workers.reserve(workerCount);
+  for (size_t it = 0; it < workerCount; ++ it) {
+    pool->workers.emplace_back(jobWorkerLoop, pool, it+1);
+  }
+  return pool;
+}
+
+void jobPoolDestroy(JobPool * const pool) {
+  if (!pool) { return; }
+  {
+    std::lock_guard<std::mutex> lock(pool->sleepMutex);
+    pool->running.store(false, std::memory_order_release);
+    pool->wake.notify_all();
+  }
+  for (auto & worker : pool->workers) {
+    worker.join();
+  }
+  delete pool;
+}
+
+PulcJobSystem jobPoolInterface(JobPool * const pool) {
+  return PulcJobSystem {
+    .pool = pool,
+    .parallelFor = jobInterfaceParallelFor,
+    .concurrency = jobInterfaceConcurrency,
+  };
+}
+
+void jobPoolParallelFor(
+  JobPool & pool, size_t const count, size_t const grain,
+  PulcJobRangeFn const fn, void * const userdata
+) {
+  if (count == 0) { return; }
+  JobBatch batch;
+  batch.fn = fn;
+  batch.userdata = userdata;
+  batch.grain = std::max<size_t>(1, grain);
+  batch.remaining.store(count, std::memory_order_relaxed);
+  if (count <= batch.grain || pool.workers.empty()) {
+    fn(userdata, 0, count);
+    return;
+  }
+
+  // the caller joins in; while it waits it may also pick up unrelated ranges,
+  //   which is what lets a chunk call parallelFor itself without deadlocking
+  size_t const slot = jobWorkerSlot;
+  uint32_t seed = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&batch));
+  seed |= 1u;
+  jobRun(pool, slot, JobRange { &batch, 0, count });
+  JobRange range;
+  while (batch.remaining.load(std::memory_order_acquire) != 0) {
+    if (jobFind(pool, slot, seed, range)) {
+      jobRun(pool, slot, range);
+    } else {
+      spinPause();
+    }
+  }
+}
+
+size_t jobPoolConcurrency(JobPool const & pool) {
+  return pool.workers.size() + 1;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+
+// -- shared C interface -------------------------------------------------------
+
+// the graph plugin owns the pool and stores a PulcJobSystem under
+//   "pulc-job-system" in the plugin payload so other plugins can split work
+//   over the same workers instead of spinning up their own
+
+typedef void (* PulcJobRangeFn)(void * userdata, size_t begin, size_t end);
+
+typedef struct {
+  void * pool;
+  // runs fn over [0, count) in chunks of at most grain indices and returns
+  //   once every chunk finished; the calling thread works on chunks as well,
+  //   and it may be called from inside a chunk
+  void (* parallelFor)(
+    void * pool, size_t count, size_t grain,
+    PulcJobRangeFn fn, void * userdata
+  );
+  // worker threads plus the calling thread
+  size_t (* concurrency)(void * pool);
+} PulcJobSystem;
+
+#ifdef __cplusplus
+
+#include <type_traits>
+
+// -- graph plugin -------------------------------------------------------------
+
+struct JobPool;
+
+// workerCount of 0 uses every hardware thread besides the caller's
+JobPool * jobPoolCreate(size_t const workerCount);
+void jobPoolDestroy(JobPool * const pool);
+
+PulcJobSystem jobPoolInterface(JobPool * const pool);
+
+void jobPoolParallelFor(
+  JobPool & pool, size_t const count, size_t const grain,
+  PulcJobRangeFn const fn, void * const userdata
+);
+size_t jobPoolConcurrency(JobPool const & pool);
+
+// fn(begin, end); the callable stays on the caller's stack, nothing is
+//   allocated per call
+template <typename Fn>
+void jobParallelFor(
+  JobPool & pool, size_t const count, size_t const grain, Fn && fn
+) {
+  using Callable = std::remove_reference_t<Fn>;
+  auto const trampoline = [](void * userdata, size_t begin, size_t end) {
+    (*reinterpret_cast<Callable *>(userdata))(begin, end);
+  };
+  jobPoolParallelFor(
+    pool, count, grain, trampoline,
+    const_cast<void *>(static_cast<void const *>(&fn))
+  );
+}
+
+#endif
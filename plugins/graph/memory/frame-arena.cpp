@@ -0,0 +1,217 @@
+#include "frame-arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace {
+
+// lives at the start of its own backing allocation
+struct FrameArenaBlock {
+  FrameArenaBlock * previous;
+  size_t capacity; // bytes following the header
+  std::atomic<size_t> used;
+
+  uint8_t * data() { return reinterpret_cast<uint8_t *>(this + 1); }
+};
+
+struct FrameArenaBuffer {
+  std::atomic<FrameArenaBlock *> current;
+};
+
+// right before every allocation, so reallocate knows how much to copy
+struct FrameArenaHeader {
+  size_t bytes;
+};
+
+} // namespace
+
+struct FrameArena {
+  PuleAllocator backing;
+  // only taken to chain another block
+  std::mutex growMutex;
+  FrameArenaBuffer buffers[2];
+  size_t active; // buffer handed out this update
+};
+
+namespace {
+
+FrameArenaBlock * frameArenaBlockCreate(
+  FrameArena & arena, size_t const capacity,
+  FrameArenaBlock * const previous
+) {
+  void * const memory = (
+    puleAllocate(
+      arena.backing,
+      PuleAllocateInfo {
+        .zeroOut = false,
+        .numBytes = sizeof(FrameArenaBlock) + capacity,
+        .alignment = alignof(std::max_align_t),
+      }
+    )
+  );
+  auto * const block = new (memory) FrameArenaBlock;
+  block->previous = previous;
+  block->capacity = capacity;
+  block->used.store(0, std::memory_order_relaxed);
+  return block;
+}
+
+void frameArenaBlocksDestroy(FrameArena & arena, FrameArenaBlock * block) {
+  while (block) {
+    FrameArenaBlock * const previous = block->previous;
+    block->~FrameArenaBlock();
+    puleDeallocate(arena.backing, block);
+    block = previous;
+  }
+}
+
+void frameArenaGrow(
+  FrameArena & arena, FrameArenaBuffer & buffer, FrameArenaBlock * const full,
+  size_t const bytes
+) {
+  std::lock_guard<std::mutex> lock(arena.growMutex);
+  // another thread may have chained one since
+  if (buffer.current.load(std::memory_order_acquire) != full) { return; }
+  FrameArenaBlock * const block = frameArenaBlockCreate(
+    arena, std::max(full->capacity*2, bytes), full
+  );
+  buffer.current.store(block, std::memory_order_release);
+}
+
+// -- C interface --------------------------------------------------------------
+
+void * frameArenaInterfaceAllocate(
+  void * const arenaPtr, PuleAllocateInfo const info
+) {
+  FrameArena & arena = *reinterpret_cast<FrameArena *>(arenaPtr);
+  FrameArenaBuffer & buffer = arena.buffers[arena.active];
+  size_t const alignment = (
+    std::max<size_t>(info.alignment, alignof(FrameArenaHeader))
+  );
+  for (;;) {
+    FrameArenaBlock * const block = (
+      buffer.current.load(std::memory_order_acquire)
+    );
+    uintptr_t const base = reinterpret_cast<uintptr_t>(block->data());
+    size_t used = block->used.load(std::memory_order_relaxed);
+    for (;;) {
+      uintptr_t const address = (
+        (base + used + sizeof(FrameArenaHeader) + alignment - 1)
+        / alignment * alignment
+      );
+      size_t const end = address - base + info.numBytes;
+      if (end > block->capacity) { break; }
+      if (
+        block->used.compare_exchange_weak(
+          used, end, std::memory_order_relaxed
+        )
+      ) {
+        reinterpret_cast<FrameArenaHeader *>(address)[-1].bytes = (
+          info.numBytes
+        );
+        auto * const allocation = reinterpret_cast<void *>(address);
+        if (info.zeroOut) { memset(allocation, 0, info.numBytes); }
+        return allocation;
+      }
+    }
+    frameArenaGrow(
+      arena, buffer, block,
+      sizeof(FrameArenaHeader) + alignment + info.numBytes
+    );
+  }
+}
+
+// always a fresh allocation, so the copy never overlaps the old one
+void * frameArenaInterfaceReallocate(
+  void * const arenaPtr, PuleReallocateInfo const info
+) {
+  void * const allocation = (
+    frameArenaInterfaceAllocate(
+      arenaPtr,
+      PuleAllocateInfo {
+        .zeroOut = false,
+        .numBytes = info.numBytes,
+        .alignment = info.alignment,
+      }
+    )
+  );
+  if (!info.allocation) { return allocation; }
+  size_t const oldBytes = (
+    reinterpret_cast<FrameArenaHeader const *>(info.allocation)[-1].bytes
+  );
+  memcpy(allocation, info.allocation, std::min(oldBytes, info.numBytes));
+  return allocation;
+}
+
+void frameArenaInterfaceDeallocate(void * const, void * const) {}
+
+} // namespace
+
+FrameArena * frameArenaCreate(
+  PuleAllocator const backing, size_t const blockCapacity
+) {
+  auto * const arena = new FrameArena;
+  arena->backing = backing;
+  arena->active = 0;
+  for (FrameArenaBuffer & buffer : arena->buffers) {
+    buffer.current.store(
+      frameArenaBlockCreate(*arena, blockCapacity, nullptr),
+      std::memory_order_relaxed
+    );
+  }
+  return arena;
+}
+
+void frameArenaDestroy(FrameArena * const arena) {
+  for (FrameArenaBuffer & buffer : arena->buffers) {
+    frameArenaBlocksDestroy(*arena, buffer.current.load());
+  }
+  delete arena;
+}
+
+PulcFrameArena frameArenaInterface(FrameArena * const arena) {
+  return PulcFrameArena {
+    .allocator = PuleAllocator {
+      .implementation = arena,
+      .allocate = frameArenaInterfaceAllocate,
+      .reallocate = frameArenaInterfaceReallocate,
+      .deallocate = frameArenaInterfaceDeallocate,
+    },
+  };
+}
+
+void frameArenaFrame(FrameArena & arena) {
+  arena.active ^= 1;
+  FrameArenaBuffer & buffer = arena.buffers[arena.active];
+  FrameArenaBlock * const block = (
+    buffer.current.load(std::memory_order_relaxed)
+  );
+  if (block->previous) {
+    size_t capacity = 0;
+    for (FrameArenaBlock * it = block; it; it = it->previous) {
+      capacity += it->capacity;
+    }
+    frameArenaBlocksDestroy(arena, block);
+    buffer.current.store(
+      frameArenaBlockCreate(arena, capacity, nullptr),
+      std::memory_order_relaxed
+    );
+    return;
+  }
+  block->used.store(0, std::memory_order_relaxed);
+}
+
+size_t frameArenaCapacity(FrameArena const & arena) {
+  size_t capacity = 0;
+  for (FrameArenaBuffer const & buffer : arena.buffers) {
+    FrameArenaBlock const * block = (
+      buffer.current.load(std::memory_order_relaxed)
+    );
+    for (; block; block = block->previous) { capacity += block->capacity; }
+  }
+  return capacity;
+}
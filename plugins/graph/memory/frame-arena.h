@@ -0,0 +1,105 @@
+#pragma once
+
+#include <pulchritude-allocator/allocator.h>
+
+#include <stddef.h>
+
+// -- shared C interface -------------------------------------------------------
+
+// scratch memory for a graph update, bumped out of a few large blocks rather
+//   than the heap. Allocations stay valid through the update after the one
+//   they were made in, so data a command recorder still points at outlives
+//   the frame that recorded it; then their memory is reused. Nothing is
+//   freed individually. The graph plugin stores a PulcFrameArena under
+//   "pulc-frame-arena" for other plugins.
+// Any thread may allocate while the graph plugin and other plugins update,
+//   the simulation thread keeps its own storage as its ticks don't line up
+//   with frames
+
+typedef struct {
+  // deallocate does nothing; reallocate moves into a fresh allocation
+  PuleAllocator allocator;
+} PulcFrameArena;
+
+#ifdef __cplusplus
+
+#include <cstdint>
+#include <vector>
+
+inline void * pulcFrameArenaAllocate(
+  PulcFrameArena const & arena, size_t const bytes, size_t const alignment
+) {
+  return (
+    arena.allocator.allocate(
+      arena.allocator.implementation,
+      PuleAllocateInfo {
+        .zeroOut = false, .numBytes = bytes, .alignment = alignment,
+      }
+    )
+  );
+}
+
+// uninitialized storage for count Ts, T has to be trivially destructible
+template <typename T>
+T * frameArenaAllocate(PulcFrameArena const & arena, size_t const count) {
+  return (
+    static_cast<T *>(
+      pulcFrameArenaAllocate(arena, sizeof(T)*count, alignof(T))
+    )
+  );
+}
+
+// for standard containers; a container has to be gone, or at least not grow
+//   any more, by the end of the next update. Frees go to the allocator, so a
+//   PulcFrameArena wrapping a heap allocator stands in when there's no arena
+template <typename T>
+struct FrameArenaAllocator {
+  using value_type = T;
+
+  PulcFrameArena const * arena;
+
+  FrameArenaAllocator(PulcFrameArena const & a) : arena(&a) {}
+  template <typename U>
+  FrameArenaAllocator(FrameArenaAllocator<U> const & other)
+    : arena(other.arena)
+  {}
+
+  T * allocate(size_t const count) {
+    return frameArenaAllocate<T>(*arena, count);
+  }
+  void deallocate(T * const memory, size_t) {
+    arena->allocator.deallocate(arena->allocator.implementation, memory);
+  }
+
+  template <typename U>
+  bool operator==(FrameArenaAllocator<U> const & other) const {
+    return (
+      arena->allocator.implementation == other.arena->allocator.implementation
+    );
+  }
+};
+
+template <typename T>
+using FrameArenaVector = std::vector<T, FrameArenaAllocator<T>>;
+
+// -- graph plugin -------------------------------------------------------------
+
+struct FrameArena;
+
+// blocks come from backing, and start out blockCapacity bytes large
+FrameArena * frameArenaCreate(
+  PuleAllocator const backing, size_t const blockCapacity
+);
+void frameArenaDestroy(FrameArena * const arena);
+
+PulcFrameArena frameArenaInterface(FrameArena * const arena);
+
+// start of a graph update, nothing may be allocating; hands out the memory of
+//   the update before last again. A buffer that needed more than one block is
+//   merged into a single one, so allocations settle after a few frames
+void frameArenaFrame(FrameArena & arena);
+
+// bytes reserved from backing over both buffers
+size_t frameArenaCapacity(FrameArena const & arena);
+
+#endif
@@ -0,0 +1,347 @@
+#include "avoidance.h"
+
+#include "../spatial/unit-grid.h"
+
+#include <pulchritude-math/math.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float constexpr lineParallelEpsilon = 1e-5f;
+
+// velocities on the left of direction, through point, are allowed
+struct AvoidanceLine {
+  PuleF32v2 point;
+  PuleF32v2 direction; // unit length
+};
+
+// neighbour candidates, ordered by distance then grid order so the nearest
+//   set and the order lines are added in never depend on anything else
+struct AvoidanceNeighbour {
+  float distSqr;
+  uint32_t sorted; // index into the grid's sorted arrays
+};
+
+inline PuleF32v2 add(PuleF32v2 const a, PuleF32v2 const b) {
+  return PuleF32v2 { a.x + b.x, a.y + b.y };
+}
+
+inline PuleF32v2 sub(PuleF32v2 const a, PuleF32v2 const b) {
+  return PuleF32v2 { a.x - b.x, a.y - b.y };
+}
+
+inline PuleF32v2 scale(PuleF32v2 const a, float const s) {
+  return PuleF32v2 { a.x*s, a.y*s };
+}
+
+inline float dot(PuleF32v2 const a, PuleF32v2 const b) {
+  return a.x*b.x + a.y*b.y;
+}
+
+inline float det(PuleF32v2 const a, PuleF32v2 const b) {
+  return a.x*b.y - a.y*b.x;
+}
+
+inline PuleF32v2 normalize(PuleF32v2 const a) {
+  return scale(a, 1.0f/std::sqrt(dot(a, a)));
+}
+
+// -- linear program -----------------------------------------------------------
+
+// optimum on line lineIt, subject to the lines before it and the speed
+//   circle; false if they leave nothing of it
+bool solveOnLine(
+  AvoidanceLine const * const lines, size_t const lineIt, float const speed,
+  PuleF32v2 const optimum, bool const optimizeDirection, PuleF32v2 & result
+) {
+  AvoidanceLine const & line = lines[lineIt];
+  float const along = dot(line.point, line.direction);
+  float const discriminant = (
+    along*along + speed*speed - dot(line.point, line.point)
+  );
+  if (discriminant < 0.0f) { return false; }
+  float const root = std::sqrt(discriminant);
+  float tLeft = -along - root;
+  float tRight = -along + root;
+  for (size_t it = 0; it < lineIt; ++ it) {
+    float const denominator = det(line.direction, lines[it].direction);
+    float const numerator = det(
+      lines[it].direction, sub(line.point, lines[it].point)
+    );
+    if (std::fabs(denominator) <= lineParallelEpsilon) {
+      if (numerator < 0.0f) { return false; }
+      continue;
+    }
+    float const t = numerator / denominator;
+    if (denominator >= 0.0f) { tRight = std::min(tRight, t); }
+    else { tLeft = std::max(tLeft, t); }
+    if (tLeft > tRight) { return false; }
+  }
+  float t;
+  if (optimizeDirection) {
+    t = dot(optimum, line.direction) > 0.0f ? tRight : tLeft;
+  } else {
+    t = std::clamp(
+      dot(line.direction, sub(optimum, line.point)), tLeft, tRight
+    );
+  }
+  result = add(line.point, scale(line.direction, t));
+  return true;
+}
+
+// closest velocity to optimum (or furthest along it when optimizing the
+//   direction) inside every line and the speed circle; returns the line it
+//   failed on, lineCount on success
+size_t solve(
+  AvoidanceLine const * const lines, size_t const lineCount, float const speed,
+  PuleF32v2 const optimum, bool const optimizeDirection, PuleF32v2 & result
+) {
+  if (optimizeDirection) {
+    result = scale(optimum, speed);
+  } else if (dot(optimum, optimum) > speed*speed) {
+    result = scale(normalize(optimum), speed);
+  } else {
+    result = optimum;
+  }
+  for (size_t it = 0; it < lineCount; ++ it) {
+    if (det(lines[it].direction, sub(lines[it].point, result)) <= 0.0f) {
+      continue;
+    }
+    PuleF32v2 const previous = result;
+    if (!solveOnLine(lines, it, speed, optimum, optimizeDirection, result)) {
+      result = previous;
+      return it;
+    }
+  }
+  return lineCount;
+}
+
+// infeasible from failedLine on; minimizes the largest violation instead,
+//   a line at a time, by solving in the space projected onto each line
+void solveLeastViolation(
+  AvoidanceLine const * const lines, size_t const lineCount,
+  size_t const failedLine, float const speed, PuleF32v2 & result
+) {
+  AvoidanceLine projected[avoidanceNeighboursMax];
+  float violation = 0.0f;
+  for (size_t it = failedLine; it < lineCount; ++ it) {
+    AvoidanceLine const & line = lines[it];
+    if (det(line.direction, sub(line.point, result)) <= violation) {
+      continue;
+    }
+    size_t projectedCount = 0;
+    for (size_t jt = 0; jt < it; ++ jt) {
+      AvoidanceLine const & other = lines[jt];
+      AvoidanceLine & out = projected[projectedCount];
+      float const determinant = det(line.direction, other.direction);
+      if (std::fabs(determinant) <= lineParallelEpsilon) {
+        // same direction constrains nothing more than line itself
+        if (dot(line.direction, other.direction) > 0.0f) { continue; }
+        out.point = scale(add(line.point, other.point), 0.5f);
+      } else {
+        out.point = add(
+          line.point,
+          scale(
+            line.direction,
+            det(other.direction, sub(line.point, other.point)) / determinant
+          )
+        );
+      }
+      out.direction = normalize(sub(other.direction, line.direction));
+      ++ projectedCount;
+    }
+    PuleF32v2 const previous = result;
+    PuleF32v2 const outward = { -line.direction.y, line.direction.x };
+    // can only fail to rounding, the previous result is then still the best
+    size_t const failed = solve(
+      projected, projectedCount, speed, outward, true, result
+    );
+    if (failed < projectedCount) { result = previous; }
+    violation = det(line.direction, sub(line.point, result));
+  }
+}
+
+// -- constraints --------------------------------------------------------------
+
+// half-plane of velocities for which the neighbour at relativePosition,
+//   moving at relativeVelocity relative to the unit, stays clear
+AvoidanceLine avoidanceLine(
+  PuleF32v2 const velocity, PuleF32v2 const relativePosition,
+  PuleF32v2 const relativeVelocity, float const timestep
+) {
+  float const combinedRadius = 2.0f*avoidanceRadius;
+  float const combinedRadiusSqr = combinedRadius*combinedRadius;
+  float const distSqr = dot(relativePosition, relativePosition);
+  float const invHorizon = 1.0f/avoidanceTimeHorizon;
+
+  PuleF32v2 direction, push;
+  if (distSqr > combinedRadiusSqr) {
+    // from the cutoff circle's centre to the relative velocity
+    PuleF32v2 const w = sub(
+      relativeVelocity, scale(relativePosition, invHorizon)
+    );
+    float const wLengthSqr = dot(w, w);
+    float const along = dot(w, relativePosition);
+    if (along < 0.0f && along*along > combinedRadiusSqr*wLengthSqr) {
+      // nearest the cutoff circle
+      float const wLength = std::sqrt(wLengthSqr);
+      PuleF32v2 const unitW = scale(w, 1.0f/wLength);
+      direction = PuleF32v2 { unitW.y, -unitW.x };
+      push = scale(unitW, combinedRadius*invHorizon - wLength);
+    } else {
+      // nearest one of the cone's legs
+      float const leg = std::sqrt(distSqr - combinedRadiusSqr);
+      PuleF32v2 const p = relativePosition;
+      if (det(p, w) > 0.0f) {
+        direction = scale(
+          PuleF32v2 {
+            p.x*leg - p.y*combinedRadius, p.x*combinedRadius + p.y*leg,
+          },
+          1.0f/distSqr
+        );
+      } else {
+        direction = scale(
+          PuleF32v2 {
+            p.x*leg + p.y*combinedRadius, -p.x*combinedRadius + p.y*leg,
+          },
+          -1.0f/distSqr
+        );
+      }
+      push = sub(
+        scale(direction, dot(relativeVelocity, direction)), relativeVelocity
+      );
+    }
+  } else {
+    // already overlapping, separate within the tick
+    float const invTimestep = 1.0f/timestep;
+    PuleF32v2 const w = sub(
+      relativeVelocity, scale(relativePosition, invTimestep)
+    );
+    float const wLength = std::sqrt(dot(w, w));
+    PuleF32v2 const unitW = (
+      wLength > 0.0f ? scale(w, 1.0f/wLength) : PuleF32v2 { 0.0f, 1.0f }
+    );
+    direction = PuleF32v2 { unitW.y, -unitW.x };
+    push = scale(unitW, combinedRadius*invTimestep - wLength);
+  }
+  // the unit covers half, the neighbour the other half
+  return AvoidanceLine {
+    .point = add(velocity, scale(push, 0.5f)),
+    .direction = direction,
+  };
+}
+
+// up to avoidanceNeighboursMax nearest units within the radius, nearest
+//   first; returns how many
+size_t neighboursGather(
+  UnitGrid const & grid, size_t const self, PuleF32v2 const position,
+  AvoidanceNeighbour (&neighbours)[avoidanceNeighboursMax]
+) {
+  float const radiusSqr = avoidanceNeighbourRadius*avoidanceNeighbourRadius;
+  size_t count = 0;
+  auto const precedes = [](
+    AvoidanceNeighbour const & a, AvoidanceNeighbour const & b
+  ) {
+    return (
+         a.distSqr < b.distSqr
+      || (a.distSqr == b.distSqr && a.sorted < b.sorted)
+    );
+  };
+  auto const visitRun = [&](uint32_t const runBegin, uint32_t const runEnd) {
+    for (uint32_t jt = runBegin; jt < runEnd; ++ jt) {
+      if (grid.unitIndices[jt] == self) { continue; }
+      float const dx = grid.positionsX[jt] - position.x;
+      float const dy = grid.positionsY[jt] - position.y;
+      auto const candidate = AvoidanceNeighbour { dx*dx + dy*dy, jt };
+      if (candidate.distSqr >= radiusSqr) { continue; }
+      if (count == avoidanceNeighboursMax) {
+        if (!precedes(candidate, neighbours[count-1])) { continue; }
+        -- count;
+      }
+      // insertion, the list is short
+      size_t at = count;
+      for (; at > 0 && precedes(candidate, neighbours[at-1]); -- at) {
+        neighbours[at] = neighbours[at-1];
+      }
+      neighbours[at] = candidate;
+      ++ count;
+    }
+  };
+  unitGridForEachRun(grid, position, avoidanceNeighbourRadius, visitRun);
+  return count;
+}
+
+} // namespace
+
+void avoidanceBatchResize(AvoidanceBatch & batch, size_t const count) {
+  batch.count = count;
+  for (
+    auto * array : {
+      &batch.positionX, &batch.positionY,
+      &batch.velocityX, &batch.velocityY,
+      &batch.preferredX, &batch.preferredY,
+      &batch.maxSpeed,
+      &batch.resultX, &batch.resultY,
+    }
+  ) {
+    array->resize(count);
+  }
+}
+
+void avoidanceSolve(
+  AvoidanceBatch & batch, UnitGrid const & grid, float const timestep,
+  AvoidanceMode const mode, size_t const begin, size_t const end
+) {
+  AvoidanceNeighbour neighbours[avoidanceNeighboursMax];
+  AvoidanceLine lines[avoidanceNeighboursMax];
+  for (size_t it = begin; it < end; ++ it) {
+    auto const position = PuleF32v2 {
+      batch.positionX[it], batch.positionY[it]
+    };
+    auto const velocity = PuleF32v2 {
+      batch.velocityX[it], batch.velocityY[it]
+    };
+    auto const preferred = PuleF32v2 {
+      batch.preferredX[it], batch.preferredY[it]
+    };
+    float const speed = batch.maxSpeed[it];
+
+    size_t const neighbourCount = (
+      neighboursGather(grid, it, position, neighbours)
+    );
+    for (size_t jt = 0; jt < neighbourCount; ++ jt) {
+      uint32_t const sorted = neighbours[jt].sorted;
+      size_t const other = grid.unitIndices[sorted];
+      // fast mode sees the units of this range solved before this one
+      bool const solved = (
+        mode == AvoidanceMode_fast && other >= begin && other < it
+      );
+      auto const otherVelocity = (
+        solved
+        ? PuleF32v2 { batch.resultX[other], batch.resultY[other] }
+        : PuleF32v2 { batch.velocityX[other], batch.velocityY[other] }
+      );
+      lines[jt] = avoidanceLine(
+        velocity,
+        PuleF32v2 {
+          grid.positionsX[sorted] - position.x,
+          grid.positionsY[sorted] - position.y,
+        },
+        sub(velocity, otherVelocity),
+        timestep
+      );
+    }
+
+    PuleF32v2 result;
+    size_t const failedLine = solve(
+      lines, neighbourCount, speed, preferred, false, result
+    );
+    if (failedLine < neighbourCount) {
+      solveLeastViolation(lines, neighbourCount, failedLine, speed, result);
+    }
+    batch.resultX[it] = result.x;
+    batch.resultY[it] = result.y;
+  }
+}
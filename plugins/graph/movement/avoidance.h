@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct UnitGrid;
+
+// reciprocal collision avoidance (ORCA): each unit takes half the work of
+//   avoiding every neighbour, assuming the neighbour keeps the velocity it
+//   had at the start of the tick, and each neighbour leaves a half-plane of
+//   velocities that stay clear of it for avoidanceTimeHorizon seconds. The
+//   unit then picks the velocity closest to its preferred one within those
+//   and its max speed, a 2D linear program; when crowded enough that none
+//   is left, the one violating them the least
+
+// AvoidanceMode_deterministic reads every neighbour as it was at the start
+//   of the tick, so a unit's result doesn't depend on how units were split
+//   over jobs, and so neither on thread count nor timing.
+//   AvoidanceMode_fast lets a unit see the new velocities of units solved
+//   before it in the same range, which settles dense crowds in fewer ticks
+//   but makes results depend on the split
+enum AvoidanceMode {
+  AvoidanceMode_deterministic,
+  AvoidanceMode_fast,
+};
+
+float constexpr avoidanceRadius = 0.5f; // per unit
+float constexpr avoidanceTimeHorizon = 2.0f; // seconds
+float constexpr avoidanceNeighbourRadius = 4.0f;
+size_t constexpr avoidanceNeighboursMax = 10; // nearest within the radius
+
+// per live unit, in the order the unit grid was rebuilt from
+struct AvoidanceBatch {
+  size_t count;
+  // at the start of the tick
+  std::vector<float> positionX, positionY;
+  std::vector<float> velocityX, velocityY;
+  std::vector<float> preferredX, preferredY; // what steering asked for
+  std::vector<float> maxSpeed;
+  std::vector<float> resultX, resultY;
+};
+
+void avoidanceBatchResize(AvoidanceBatch & batch, size_t const count);
+
+// solves the units [begin, end) into result; neighbours are found through
+//   the grid, which has to have been rebuilt from the same positions in the
+//   same order
+void avoidanceSolve(
+  AvoidanceBatch & batch, UnitGrid const & grid, float const timestep,
+  AvoidanceMode const mode, size_t const begin, size_t const end
+);
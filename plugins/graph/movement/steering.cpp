@@ -0,0 +1,422 @@
+#include "steering.h"
+
+#include "../spatial/unit-grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STEERING_X86 1
+#include <immintrin.h>
+#else
+#define STEERING_X86 0
+#endif
+
+namespace {
+
+float constexpr separationEpsilonSqr = 1e-8f;
+
+// -- scalar -------------------------------------------------------------------
+
+void separationScalar(
+  SteeringBatch & batch, UnitGrid const & grid,
+  float const radius, float const strength,
+  size_t const begin, size_t const end
+) {
+  float const radiusSqr = radius*radius;
+  float const invRadius = 1.0f/radius;
+  for (size_t it = begin; it < end; ++ it) {
+    float const px = batch.positionX[it];
+    float const py = batch.positionY[it];
+    float sumX = 0.0f, sumY = 0.0f;
+    auto const visitRun = [&](uint32_t const runBegin, uint32_t const runEnd) {
+      for (uint32_t jt = runBegin; jt < runEnd; ++ jt) {
+        float const dx = px - grid.positionsX[jt];
+        float const dy = py - grid.positionsY[jt];
+        float const distSqr = dx*dx + dy*dy;
+        if (distSqr >= radiusSqr || distSqr <= separationEpsilonSqr) {
+          continue;
+        }
+        // (d/|d|) * (1 - |d|/r) == d * (1/|d| - 1/r)
+        float const weight = 1.0f/std::sqrt(distSqr) - invRadius;
+        sumX += dx*weight;
+        sumY += dy*weight;
+      }
+    };
+    unitGridForEachRun(grid, PuleF32v2 { px, py }, radius, visitRun);
+    batch.separationX[it] = sumX*strength;
+    batch.separationY[it] = sumY*strength;
+  }
+}
+
+void integrateScalar(
+  SteeringBatch & batch, float const timestep, float const blend,
+  size_t const begin, size_t const end
+) {
+  for (size_t it = begin; it < end; ++ it) {
+    float vx = batch.velocityX[it];
+    float vy = batch.velocityY[it];
+    vx += (batch.desiredX[it] + batch.separationX[it] - vx) * blend;
+    vy += (batch.desiredY[it] + batch.separationY[it] - vy) * blend;
+    float const speedSqr = vx*vx + vy*vy;
+    float const maxSpeed = batch.maxSpeed[it];
+    if (speedSqr > maxSpeed*maxSpeed) {
+      float const scale = maxSpeed / std::sqrt(speedSqr);
+      vx *= scale;
+      vy *= scale;
+    }
+    batch.velocityX[it] = vx;
+    batch.velocityY[it] = vy;
+    batch.positionX[it] += vx*timestep;
+    batch.positionY[it] += vy*timestep;
+  }
+}
+
+#if STEERING_X86
+
+// -- sse ----------------------------------------------------------------------
+
+inline float horizontalSumSse(__m128 const v) {
+  __m128 const high = _mm_movehl_ps(v, v);
+  __m128 const pair = _mm_add_ps(v, high);
+  __m128 const odd = _mm_shuffle_ps(pair, pair, 0x1);
+  return _mm_cvtss_f32(_mm_add_ss(pair, odd));
+}
+
+void separationSse(
+  SteeringBatch & batch, UnitGrid const & grid,
+  float const radius, float const strength,
+  size_t const begin, size_t const end
+) {
+  float const radiusSqr = radius*radius;
+  float const invRadius = 1.0f/radius;
+  __m128 const vRadiusSqr = _mm_set1_ps(radiusSqr);
+  __m128 const vInvRadius = _mm_set1_ps(invRadius);
+  __m128 const vEpsilon = _mm_set1_ps(separationEpsilonSqr);
+  __m128 const vOne = _mm_set1_ps(1.0f);
+  for (size_t it = begin; it < end; ++ it) {
+    float const px = batch.positionX[it];
+    float const py = batch.positionY[it];
+    __m128 const vpx = _mm_set1_ps(px);
+    __m128 const vpy = _mm_set1_ps(py);
+    __m128 sumX = _mm_setzero_ps(), sumY = _mm_setzero_ps();
+    float tailX = 0.0f, tailY = 0.0f;
+    size_t const x0 = unitGridCellX(grid, px - radius);
+    size_t const x1 = unitGridCellX(grid, px + radius);
+    size_t const y0 = unitGridCellY(grid, py - radius);
+    size_t const y1 = unitGridCellY(grid, py + radius);
+    for (size_t cy = y0; cy <= y1; ++ cy) {
+      uint32_t jt = grid.cellStarts[cy*grid.cellsX + x0];
+      uint32_t const end = grid.cellStarts[cy*grid.cellsX + x1 + 1];
+      for (; jt + 4 <= end; jt += 4) {
+        __m128 const dx = (
+          _mm_sub_ps(vpx, _mm_loadu_ps(&grid.positionsX[jt]))
+        );
+        __m128 const dy = (
+          _mm_sub_ps(vpy, _mm_loadu_ps(&grid.positionsY[jt]))
+        );
+        __m128 const distSqr = (
+          _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))
+        );
+        __m128 const mask = _mm_and_ps(
+          _mm_cmplt_ps(distSqr, vRadiusSqr), _mm_cmpgt_ps(distSqr, vEpsilon)
+        );
+        __m128 const weight = _mm_and_ps(
+          mask,
+          _mm_sub_ps(_mm_div_ps(vOne, _mm_sqrt_ps(distSqr)), vInvRadius)
+        );
+        sumX = _mm_add_ps(sumX, _mm_mul_ps(dx, weight));
+        sumY = _mm_add_ps(sumY, _mm_mul_ps(dy, weight));
+      }
+      for (; jt < end; ++ jt) {
+        float const dx = px - grid.positionsX[jt];
+        float const dy = py - grid.positionsY[jt];
+        float const distSqr = dx*dx + dy*dy;
+        if (distSqr >= radiusSqr || distSqr <= separationEpsilonSqr) {
+          continue;
+        }
+        float const weight = 1.0f/std::sqrt(distSqr) - invRadius;
+        tailX += dx*weight;
+        tailY += dy*weight;
+      }
+    }
+    batch.separationX[it] = (horizontalSumSse(sumX) + tailX)*strength;
+    batch.separationY[it] = (horizontalSumSse(sumY) + tailY)*strength;
+  }
+}
+
+void integrateSse(
+  SteeringBatch & batch, float const timestep, float const blend,
+  size_t const begin, size_t const end
+) {
+  __m128 const vTimestep = _mm_set1_ps(timestep);
+  __m128 const vBlend = _mm_set1_ps(blend);
+  __m128 const vOne = _mm_set1_ps(1.0f);
+  for (size_t it = begin; it < end; it += 4) {
+    __m128 vx = _mm_loadu_ps(&batch.velocityX[it]);
+    __m128 vy = _mm_loadu_ps(&batch.velocityY[it]);
+    __m128 const targetX = _mm_add_ps(
+      _mm_loadu_ps(&batch.desiredX[it]), _mm_loadu_ps(&batch.separationX[it])
+    );
+    __m128 const targetY = _mm_add_ps(
+      _mm_loadu_ps(&batch.desiredY[it]), _mm_loadu_ps(&batch.separationY[it])
+    );
+    vx = _mm_add_ps(vx, _mm_mul_ps(_mm_sub_ps(targetX, vx), vBlend));
+    vy = _mm_add_ps(vy, _mm_mul_ps(_mm_sub_ps(targetY, vy), vBlend));
+
+    __m128 const maxSpeed = _mm_loadu_ps(&batch.maxSpeed[it]);
+    __m128 const speedSqr = (
+      _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy))
+    );
+    __m128 const over = (
+      _mm_cmpgt_ps(speedSqr, _mm_mul_ps(maxSpeed, maxSpeed))
+    );
+    // lanes under the limit may have zero speed, keep them out of the
+    //   division
+    __m128 const speed = _mm_sqrt_ps(
+      _mm_or_ps(_mm_and_ps(over, speedSqr), _mm_andnot_ps(over, vOne))
+    );
+    __m128 const scale = _mm_or_ps(
+      _mm_and_ps(over, _mm_div_ps(maxSpeed, speed)),
+      _mm_andnot_ps(over, vOne)
+    );
+    vx = _mm_mul_ps(vx, scale);
+    vy = _mm_mul_ps(vy, scale);
+
+    _mm_storeu_ps(&batch.velocityX[it], vx);
+    _mm_storeu_ps(&batch.velocityY[it], vy);
+    _mm_storeu_ps(
+      &batch.positionX[it],
+      _mm_add_ps(
+        _mm_loadu_ps(&batch.positionX[it]), _mm_mul_ps(vx, vTimestep)
+      )
+    );
+    _mm_storeu_ps(
+      &batch.positionY[it],
+      _mm_add_ps(
+        _mm_loadu_ps(&batch.positionY[it]), _mm_mul_ps(vy, vTimestep)
+      )
+    );
+  }
+}
+
+// -- avx2 ---------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+inline float horizontalSumAvx(__m256 const v) {
+  __m128 const low = _mm256_castps256_ps128(v);
+  __m128 const high = _mm256_extractf128_ps(v, 1);
+  return horizontalSumSse(_mm_add_ps(low, high));
+}
+
+__attribute__((target("avx2")))
+void separationAvx2(
+  SteeringBatch & batch, UnitGrid const & grid,
+  float const radius, float const strength,
+  size_t const begin, size_t const end
+) {
+  float const radiusSqr = radius*radius;
+  float const invRadius = 1.0f/radius;
+  __m256 const vRadiusSqr = _mm256_set1_ps(radiusSqr);
+  __m256 const vInvRadius = _mm256_set1_ps(invRadius);
+  __m256 const vEpsilon = _mm256_set1_ps(separationEpsilonSqr);
+  __m256 const vOne = _mm256_set1_ps(1.0f);
+  for (size_t it = begin; it < end; ++ it) {
+    float const px = batch.positionX[it];
+    float const py = batch.positionY[it];
+    __m256 const vpx = _mm256_set1_ps(px);
+    __m256 const vpy = _mm256_set1_ps(py);
+    __m256 sumX = _mm256_setzero_ps(), sumY = _mm256_setzero_ps();
+    float tailX = 0.0f, tailY = 0.0f;
+    // spelled out rather than through unitGridForEachRun, a lambda wouldn't
+    //   inherit this function's target
+    size_t const x0 = unitGridCellX(grid, px - radius);
+    size_t const x1 = unitGridCellX(grid, px + radius);
+    size_t const y0 = unitGridCellY(grid, py - radius);
+    size_t const y1 = unitGridCellY(grid, py + radius);
+    for (size_t cy = y0; cy <= y1; ++ cy) {
+      uint32_t jt = grid.cellStarts[cy*grid.cellsX + x0];
+      uint32_t const end = grid.cellStarts[cy*grid.cellsX + x1 + 1];
+      for (; jt + 8 <= end; jt += 8) {
+        __m256 const dx = (
+          _mm256_sub_ps(vpx, _mm256_loadu_ps(&grid.positionsX[jt]))
+        );
+        __m256 const dy = (
+          _mm256_sub_ps(vpy, _mm256_loadu_ps(&grid.positionsY[jt]))
+        );
+        __m256 const distSqr = (
+          _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy))
+        );
+        __m256 const mask = _mm256_and_ps(
+          _mm256_cmp_ps(distSqr, vRadiusSqr, _CMP_LT_OQ),
+          _mm256_cmp_ps(distSqr, vEpsilon, _CMP_GT_OQ)
+        );
+        __m256 const weight = _mm256_and_ps(
+          mask,
+          _mm256_sub_ps(
+            _mm256_div_ps(vOne, _mm256_sqrt_ps(distSqr)), vInvRadius
+          )
+        );
+        sumX = _mm256_add_ps(sumX, _mm256_mul_ps(dx, weight));
+        sumY = _mm256_add_ps(sumY, _mm256_mul_ps(dy, weight));
+      }
+      for (; jt < end; ++ jt) {
+        float const dx = px - grid.positionsX[jt];
+        float const dy = py - grid.positionsY[jt];
+        float const distSqr = dx*dx + dy*dy;
+        if (distSqr >= radiusSqr || distSqr <= separationEpsilonSqr) {
+          continue;
+        }
+        float const weight = 1.0f/std::sqrt(distSqr) - invRadius;
+        tailX += dx*weight;
+        tailY += dy*weight;
+      }
+    }
+    batch.separationX[it] = (horizontalSumAvx(sumX) + tailX)*strength;
+    batch.separationY[it] = (horizontalSumAvx(sumY) + tailY)*strength;
+  }
+}
+
+__attribute__((target("avx2")))
+void integrateAvx2(
+  SteeringBatch & batch, float const timestep, float const blend,
+  size_t const begin, size_t const end
+) {
+  __m256 const vTimestep = _mm256_set1_ps(timestep);
+  __m256 const vBlend = _mm256_set1_ps(blend);
+  __m256 const vOne = _mm256_set1_ps(1.0f);
+  for (size_t it = begin; it < end; it += 8) {
+    __m256 vx = _mm256_loadu_ps(&batch.velocityX[it]);
+    __m256 vy = _mm256_loadu_ps(&batch.velocityY[it]);
+    __m256 const targetX = _mm256_add_ps(
+      _mm256_loadu_ps(&batch.desiredX[it]),
+      _mm256_loadu_ps(&batch.separationX[it])
+    );
+    __m256 const targetY = _mm256_add_ps(
+      _mm256_loadu_ps(&batch.desiredY[it]),
+      _mm256_loadu_ps(&batch.separationY[it])
+    );
+    vx = _mm256_add_ps(vx, _mm256_mul_ps(_mm256_sub_ps(targetX, vx), vBlend));
+    vy = _mm256_add_ps(vy, _mm256_mul_ps(_mm256_sub_ps(targetY, vy), vBlend));
+
+    __m256 const maxSpeed = _mm256_loadu_ps(&batch.maxSpeed[it]);
+    __m256 const speedSqr = (
+      _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy))
+    );
+    __m256 const over = _mm256_cmp_ps(
+      speedSqr, _mm256_mul_ps(maxSpeed, maxSpeed), _CMP_GT_OQ
+    );
+    __m256 const speed = _mm256_sqrt_ps(
+      _mm256_blendv_ps(vOne, speedSqr, over)
+    );
+    __m256 const scale = _mm256_blendv_ps(
+      vOne, _mm256_div_ps(maxSpeed, speed), over
+    );
+    vx = _mm256_mul_ps(vx, scale);
+    vy = _mm256_mul_ps(vy, scale);
+
+    _mm256_storeu_ps(&batch.velocityX[it], vx);
+    _mm256_storeu_ps(&batch.velocityY[it], vy);
+    _mm256_storeu_ps(
+      &batch.positionX[it],
+      _mm256_add_ps(
+        _mm256_loadu_ps(&batch.positionX[it]), _mm256_mul_ps(vx, vTimestep)
+      )
+    );
+    _mm256_storeu_ps(
+      &batch.positionY[it],
+      _mm256_add_ps(
+        _mm256_loadu_ps(&batch.positionY[it]), _mm256_mul_ps(vy, vTimestep)
+      )
+    );
+  }
+}
+
+#endif // STEERING_X86
+
+} // namespace
+
+SteeringKernel steeringKernelDetect() {
+  #if STEERING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { return SteeringKernel_avx2; }
+    if (__builtin_cpu_supports("sse2")) { return SteeringKernel_sse; }
+  #endif
+  return SteeringKernel_scalar;
+}
+
+char const * steeringKernelLabel(SteeringKernel const kernel) {
+  switch (kernel) {
+    case SteeringKernel_scalar: return "scalar";
+    case SteeringKernel_sse: return "sse";
+    case SteeringKernel_avx2: return "avx2";
+  }
+  return "unknown";
+}
+
+void steeringBatchResize(SteeringBatch & batch, size_t const count) {
+  size_t const paddedCount = (
+    (count + steeringLaneWidth - 1) / steeringLaneWidth * steeringLaneWidth
+  );
+  batch.count = count;
+  for (
+    auto * array : {
+      &batch.positionX, &batch.positionY,
+      &batch.velocityX, &batch.velocityY,
+      &batch.desiredX, &batch.desiredY,
+      &batch.separationX, &batch.separationY,
+      &batch.maxSpeed,
+    }
+  ) {
+    array->resize(paddedCount);
+    // padding lanes stay inert, zero speed and nothing to steer towards
+    std::fill(array->begin() + count, array->end(), 0.0f);
+  }
+}
+
+void steeringSeparation(
+  SteeringBatch & batch, UnitGrid const & grid,
+  float const radius, float const strength,
+  SteeringKernel const kernel,
+  size_t const begin, size_t const end
+) {
+  switch (kernel) {
+    #if STEERING_X86
+      case SteeringKernel_avx2:
+        separationAvx2(batch, grid, radius, strength, begin, end);
+      return;
+      case SteeringKernel_sse:
+        separationSse(batch, grid, radius, strength, begin, end);
+      return;
+    #endif
+    default:
+      separationScalar(batch, grid, radius, strength, begin, end);
+    return;
+  }
+}
+
+void steeringIntegrate(
+  SteeringBatch & batch, float const timestep, float const responsiveness,
+  SteeringKernel const kernel,
+  size_t const begin, size_t const unitEnd
+) {
+  float const blend = std::min(1.0f, responsiveness*timestep);
+  // whole lanes only, the range ending at count takes its padding along
+  size_t const end = std::min(
+    batch.positionX.size(),
+    (unitEnd + steeringLaneWidth - 1) / steeringLaneWidth * steeringLaneWidth
+  );
+  switch (kernel) {
+    #if STEERING_X86
+      case SteeringKernel_avx2:
+        integrateAvx2(batch, timestep, blend, begin, end);
+      return;
+      case SteeringKernel_sse:
+        integrateSse(batch, timestep, blend, begin, end);
+      return;
+    #endif
+    default:
+      integrateScalar(batch, timestep, blend, begin, end);
+    return;
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct UnitGrid;
+
+// structure-of-arrays movement state for one tick; gathered from the
+//   node-unit component array, run through the kernels, scattered back.
+//   Arrays are padded to a multiple of steeringLaneWidth with inert units
+//   (zero max speed) so kernels never need a remainder loop
+struct SteeringBatch {
+  size_t count;
+  std::vector<float> positionX, positionY;
+  std::vector<float> velocityX, velocityY;
+  std::vector<float> desiredX, desiredY;
+  std::vector<float> separationX, separationY;
+  std::vector<float> maxSpeed;
+};
+
+size_t constexpr steeringLaneWidth = 8;
+
+enum SteeringKernel {
+  SteeringKernel_scalar,
+  SteeringKernel_sse,
+  SteeringKernel_avx2,
+};
+
+// widest kernel the running CPU supports
+SteeringKernel steeringKernelDetect();
+char const * steeringKernelLabel(SteeringKernel const kernel);
+
+void steeringBatchResize(SteeringBatch & batch, size_t const count);
+
+// both kernels work on the unit range [begin, end) so it can be split over
+//   jobs; begin has to be a multiple of steeringLaneWidth
+
+// separation push away from every unit within radius, falling off linearly
+//   to zero at radius; reads positions from the grid, which has to have been
+//   rebuilt from the same positions in the same order
+void steeringSeparation(
+  SteeringBatch & batch, UnitGrid const & grid,
+  float const radius, float const strength,
+  SteeringKernel const kernel,
+  size_t const begin, size_t const end
+);
+
+// velocity eases towards desired + separation at `responsiveness` per
+//   second, is clamped to max speed and then integrated into position
+void steeringIntegrate(
+  SteeringBatch & batch, float const timestep, float const responsiveness,
+  SteeringKernel const kernel,
+  size_t const begin, size_t const end
+);
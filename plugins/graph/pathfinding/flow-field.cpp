@@ -0,0 +1,114 @@
+#include "flow-field.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace {
+
+void integrate(
+  FlowField & field, PathGrid const & grid, std::vector<uint64_t> & heap
+) {
+  size_t const cellCount = grid.width * grid.height;
+  field.integration.assign(cellCount, flowIntegrationUnreachable);
+  field.directions.assign(cellCount, flowDirectionNone);
+  if (!pathGridPassable(grid, field.goalCell)) { return; }
+
+  // dijkstra outwards from the goal; moving from a neighbour into `cell`
+  //   costs the cost of entering `cell`
+  PathGridRect const bounds = pathGridBounds(grid);
+  heap.clear();
+  field.integration[field.goalCell] = 0;
+  heap.emplace_back(static_cast<uint64_t>(field.goalCell));
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), std::greater<uint64_t>{});
+    uint64_t const top = heap.back();
+    heap.pop_back();
+    uint32_t const cost = static_cast<uint32_t>(top >> 32);
+    size_t const cell = static_cast<size_t>(top & 0xFFFFFFFF);
+    if (cost > field.integration[cell]) { continue; }
+    uint32_t const enterCost = pathGridCost(grid, cell);
+    auto const relax = [&](uint8_t const n, size_t const ncell) {
+      uint32_t const ncost = cost + enterCost * pathGridNeighbours[n].weight;
+      if (ncost >= field.integration[ncell]) { return; }
+      field.integration[ncell] = ncost;
+      heap.emplace_back((static_cast<uint64_t>(ncost) << 32) | ncell);
+      std::push_heap(heap.begin(), heap.end(), std::greater<uint64_t>{});
+    };
+    pathGridForEachNeighbour(grid, bounds, cell, relax);
+  }
+
+  // each reachable cell points at its cheapest neighbour
+  for (size_t cell = 0; cell < cellCount; ++ cell) {
+    if (
+         cell == field.goalCell
+      || field.integration[cell] == flowIntegrationUnreachable
+    ) {
+      continue;
+    }
+    uint32_t best = field.integration[cell];
+    auto const pick = [&](uint8_t const n, size_t const ncell) {
+      if (field.integration[ncell] < best) {
+        best = field.integration[ncell];
+        field.directions[cell] = n;
+      }
+    };
+    pathGridForEachNeighbour(grid, bounds, cell, pick);
+  }
+}
+
+} // namespace
+
+FlowFieldCache flowFieldCacheCreate(size_t const capacity) {
+  FlowFieldCache cache = {};
+  cache.capacity = capacity;
+  cache.fields.reserve(capacity);
+  return cache;
+}
+
+void flowFieldCacheInvalidate(FlowFieldCache & cache) {
+  // keep the allocations around, evicted slots are reused in place
+  for (auto & field : cache.fields) {
+    field.lastUsed = 0;
+    field.goalCell = SIZE_MAX;
+  }
+}
+
+FlowField const & flowFieldCacheFetch(
+  FlowFieldCache & cache, PathGrid const & grid, size_t const goalCell
+) {
+  if (cache.gridRevision != grid.terrainRevision) {
+    flowFieldCacheInvalidate(cache);
+    cache.gridRevision = grid.terrainRevision;
+  }
+  cache.clock += 1;
+
+  // capacity is small, a linear scan beats hashing here
+  FlowField * victim = nullptr;
+  for (auto & field : cache.fields) {
+    if (field.goalCell == goalCell) {
+      field.lastUsed = cache.clock;
+      return field;
+    }
+    if (!victim || field.lastUsed < victim->lastUsed) {
+      victim = &field;
+    }
+  }
+  if (cache.fields.size() < cache.capacity) {
+    victim = &cache.fields.emplace_back();
+  }
+
+  victim->goalCell = goalCell;
+  victim->lastUsed = cache.clock;
+  integrate(*victim, grid, cache.openHeap);
+  return *victim;
+}
+
+PuleF32v2 flowFieldDirection(FlowField const & field, size_t const cell) {
+  uint8_t const direction = field.directions[cell];
+  if (direction == flowDirectionNone) { return PuleF32v2 { 0.0f, 0.0f }; }
+  float const dx = static_cast<float>(pathGridNeighbours[direction].dx);
+  float const dy = static_cast<float>(pathGridNeighbours[direction].dy);
+  float const invLength = 1.0f / std::sqrt(dx*dx + dy*dy);
+  return PuleF32v2 { dx*invLength, dy*invLength };
+}
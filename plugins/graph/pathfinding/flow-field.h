@@ -0,0 +1,40 @@
+#pragma once
+
+#include "grid.h"
+
+#include <cstdint>
+#include <vector>
+
+// integration + direction field towards a single goal cell; every unit
+//   ordered to the same goal samples the same field, so per-unit cost is a
+//   lookup and the per-goal cost only depends on the map size
+struct FlowField {
+  size_t goalCell;
+  std::vector<uint32_t> integration; // cost to reach goal, see flowIntegration*
+  std::vector<uint8_t> directions; // neighbour index, see flowDirection*
+  uint64_t lastUsed;
+};
+
+uint32_t constexpr flowIntegrationUnreachable = UINT32_MAX;
+uint8_t constexpr flowDirectionNone = 0xFF;
+
+// LRU of flow fields keyed by goal cell, dropped whenever the grid they were
+//   integrated over changes
+struct FlowFieldCache {
+  size_t capacity;
+  std::vector<FlowField> fields;
+  std::vector<uint64_t> openHeap; // scratch for integration, (cost<<32)|cell
+  uint64_t gridRevision;
+  uint64_t clock;
+};
+
+FlowFieldCache flowFieldCacheCreate(size_t const capacity);
+void flowFieldCacheInvalidate(FlowFieldCache & cache);
+
+FlowField const & flowFieldCacheFetch(
+  FlowFieldCache & cache, PathGrid const & grid, size_t const goalCell
+);
+
+// unit-length world direction to follow from cell, zero at the goal or when
+//   the goal is unreachable
+PuleF32v2 flowFieldDirection(FlowField const & field, size_t const cell);
@@ -0,0 +1,197 @@
+#include "grid-search.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+void scratchBegin(GridSearchScratch & scratch, PathGridRect const & bounds) {
+  size_t const area = (bounds.x1-bounds.x0+1) * (bounds.y1-bounds.y0+1);
+  if (scratch.stamps.size() < area) {
+    scratch.costs.resize(area);
+    scratch.parents.resize(area);
+    scratch.stamps.resize(area, 0);
+  }
+  scratch.bounds = bounds;
+  scratch.open.clear();
+  scratch.stamp += 1;
+  if (scratch.stamp == 0) { // wrapped, every stale stamp is ambiguous now
+    std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+    scratch.stamp = 1;
+  }
+}
+
+inline uint32_t localCell(
+  GridSearchScratch const & scratch, PathGrid const & grid, size_t const cell
+) {
+  size_t const x = cell % grid.width - scratch.bounds.x0;
+  size_t const y = cell / grid.width - scratch.bounds.y0;
+  return static_cast<uint32_t>(
+    y*(scratch.bounds.x1-scratch.bounds.x0+1) + x
+  );
+}
+
+inline size_t globalCell(
+  GridSearchScratch const & scratch, PathGrid const & grid, uint32_t const local
+) {
+  size_t const boundsWidth = scratch.bounds.x1-scratch.bounds.x0+1;
+  size_t const x = local % boundsWidth + scratch.bounds.x0;
+  size_t const y = local / boundsWidth + scratch.bounds.y0;
+  return y*grid.width + x;
+}
+
+inline uint32_t scratchCost(
+  GridSearchScratch const & scratch, uint32_t const local
+) {
+  return (
+    scratch.stamps[local] == scratch.stamp
+    ? scratch.costs[local] : gridSearchUnreachable
+  );
+}
+
+inline void openPush(
+  GridSearchScratch & scratch, uint32_t const priority, uint32_t const local
+) {
+  scratch.open.emplace_back((static_cast<uint64_t>(priority) << 32) | local);
+  std::push_heap(
+    scratch.open.begin(), scratch.open.end(), std::greater<uint64_t>{}
+  );
+}
+
+inline uint64_t openPop(GridSearchScratch & scratch) {
+  std::pop_heap(
+    scratch.open.begin(), scratch.open.end(), std::greater<uint64_t>{}
+  );
+  uint64_t const top = scratch.open.back();
+  scratch.open.pop_back();
+  return top;
+}
+
+bool inside(PathGridRect const & bounds, PathGrid const & grid, size_t cell) {
+  size_t const x = cell % grid.width;
+  size_t const y = cell / grid.width;
+  return x >= bounds.x0 && x <= bounds.x1 && y >= bounds.y0 && y <= bounds.y1;
+}
+
+} // namespace
+
+uint32_t gridSearchHeuristic(
+  PathGrid const & grid, size_t const cellA, size_t const cellB
+) {
+  int64_t const dx = std::abs(
+    static_cast<int64_t>(cellA % grid.width)
+    - static_cast<int64_t>(cellB % grid.width)
+  );
+  int64_t const dy = std::abs(
+    static_cast<int64_t>(cellA / grid.width)
+    - static_cast<int64_t>(cellB / grid.width)
+  );
+  // cheapest cell costs 1, straight steps weigh 10 and diagonals 14
+  return static_cast<uint32_t>(
+    10*std::max(dx, dy) + 4*std::min(dx, dy)
+  );
+}
+
+bool gridSearchPath(
+  GridSearchScratch & scratch, PathGrid const & grid,
+  PathGridRect const & bounds,
+  size_t const start, size_t const goal,
+  std::vector<size_t> & path
+) {
+  path.clear();
+  if (
+       !inside(bounds, grid, start) || !inside(bounds, grid, goal)
+    || !pathGridPassable(grid, start) || !pathGridPassable(grid, goal)
+  ) {
+    return false;
+  }
+
+  scratchBegin(scratch, bounds);
+  uint32_t const startLocal = localCell(scratch, grid, start);
+  uint32_t const goalLocal = localCell(scratch, grid, goal);
+  scratch.stamps[startLocal] = scratch.stamp;
+  scratch.costs[startLocal] = 0;
+  scratch.parents[startLocal] = startLocal;
+  openPush(scratch, gridSearchHeuristic(grid, start, goal), startLocal);
+
+  bool found = false;
+  while (!scratch.open.empty()) {
+    uint64_t const top = openPop(scratch);
+    uint32_t const local = static_cast<uint32_t>(top & 0xFFFFFFFF);
+    size_t const cell = globalCell(scratch, grid, local);
+    uint32_t const g = scratch.costs[local];
+    uint32_t const h = gridSearchHeuristic(grid, cell, goal);
+    if (static_cast<uint32_t>(top >> 32) != g + h) {
+      continue; // stale entry
+    }
+    if (local == goalLocal) {
+      found = true;
+      break;
+    }
+    auto const relax = [&](uint8_t const n, size_t const ncell) {
+      uint32_t const nlocal = localCell(scratch, grid, ncell);
+      uint32_t const ng = (
+        g + pathGridCost(grid, ncell) * pathGridNeighbours[n].weight
+      );
+      if (ng >= scratchCost(scratch, nlocal)) { return; }
+      scratch.stamps[nlocal] = scratch.stamp;
+      scratch.costs[nlocal] = ng;
+      scratch.parents[nlocal] = local;
+      openPush(scratch, ng + gridSearchHeuristic(grid, ncell, goal), nlocal);
+    };
+    pathGridForEachNeighbour(grid, bounds, cell, relax);
+  }
+  if (!found) { return false; }
+
+  for (uint32_t local = goalLocal;; local = scratch.parents[local]) {
+    path.emplace_back(globalCell(scratch, grid, local));
+    if (local == startLocal) { break; }
+  }
+  std::reverse(path.begin(), path.end());
+  return true;
+}
+
+void gridSearchFlood(
+  GridSearchScratch & scratch, PathGrid const & grid,
+  PathGridRect const & bounds,
+  size_t const origin, bool const towardsOrigin
+) {
+  scratchBegin(scratch, bounds);
+  if (!inside(bounds, grid, origin) || !pathGridPassable(grid, origin)) {
+    return;
+  }
+  uint32_t const originLocal = localCell(scratch, grid, origin);
+  scratch.stamps[originLocal] = scratch.stamp;
+  scratch.costs[originLocal] = 0;
+  openPush(scratch, 0, originLocal);
+
+  while (!scratch.open.empty()) {
+    uint64_t const top = openPop(scratch);
+    uint32_t const local = static_cast<uint32_t>(top & 0xFFFFFFFF);
+    uint32_t const g = scratch.costs[local];
+    if (static_cast<uint32_t>(top >> 32) != g) { continue; }
+    size_t const cell = globalCell(scratch, grid, local);
+    // moving a -> b costs entering b, so walking backwards towards the origin
+    //   pays for the cell being left instead
+    uint32_t const leaveCost = pathGridCost(grid, cell);
+    auto const relax = [&](uint8_t const n, size_t const ncell) {
+      uint32_t const nlocal = localCell(scratch, grid, ncell);
+      uint32_t const stepCost = (
+        towardsOrigin ? leaveCost : pathGridCost(grid, ncell)
+      );
+      uint32_t const ng = g + stepCost * pathGridNeighbours[n].weight;
+      if (ng >= scratchCost(scratch, nlocal)) { return; }
+      scratch.stamps[nlocal] = scratch.stamp;
+      scratch.costs[nlocal] = ng;
+      openPush(scratch, ng, nlocal);
+    };
+    pathGridForEachNeighbour(grid, bounds, cell, relax);
+  }
+}
+
+uint32_t gridSearchFloodCost(
+  GridSearchScratch const & scratch, PathGrid const & grid, size_t const cell
+) {
+  if (!inside(scratch.bounds, grid, cell)) { return gridSearchUnreachable; }
+  return scratchCost(scratch, localCell(scratch, grid, cell));
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "grid.h"
+
+#include <cstdint>
+#include <vector>
+
+// reusable per-search state for searches restricted to a rectangle of the
+//   grid; sized to the rectangle, so cluster-local searches stay small, and
+//   stamped so nothing is cleared between searches
+struct GridSearchScratch {
+  std::vector<uint32_t> costs;
+  std::vector<uint32_t> parents;
+  std::vector<uint32_t> stamps;
+  std::vector<uint64_t> open; // (priority<<32)|local cell
+  uint32_t stamp;
+  PathGridRect bounds;
+};
+
+uint32_t constexpr gridSearchUnreachable = UINT32_MAX;
+
+// A* from start to goal within bounds, replaces path with the cells from start
+//   to goal inclusive; false if goal can't be reached inside bounds
+bool gridSearchPath(
+  GridSearchScratch & scratch, PathGrid const & grid,
+  PathGridRect const & bounds,
+  size_t const start, size_t const goal,
+  std::vector<size_t> & path
+);
+
+// dijkstra from origin within bounds, query with gridSearchFloodCost
+//   afterwards; towardsOrigin gives the cost of reaching origin from each cell
+//   rather than of reaching each cell from origin
+void gridSearchFlood(
+  GridSearchScratch & scratch, PathGrid const & grid,
+  PathGridRect const & bounds,
+  size_t const origin, bool const towardsOrigin
+);
+
+uint32_t gridSearchFloodCost(
+  GridSearchScratch const & scratch, PathGrid const & grid, size_t const cell
+);
+
+// admissible octile estimate between two cells
+uint32_t gridSearchHeuristic(
+  PathGrid const & grid, size_t const cellA, size_t const cellB
+);
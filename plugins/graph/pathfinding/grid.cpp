@@ -0,0 +1,73 @@
+#include "grid.h"
+
+#include <algorithm>
+
+bool pathGridSync(
+  PathGrid & grid, PulcTerrainHeightfield const & heightfield,
+  PulcTerrainCostMap const & costMap
+) {
+  grid.dirtyRects.clear();
+  if (
+       grid.terrainRevision == heightfield.revision
+    && grid.costMap.costs == costMap.costs
+  ) {
+    return false;
+  }
+
+  // a different cost map is a different heightmap altogether
+  bool rebuildAll = (
+       grid.costMap.costs != costMap.costs
+    || grid.width != heightfield.width || grid.height != heightfield.height
+    || grid.terrainRevision == 0
+  );
+  for (
+    uint64_t revision = grid.terrainRevision + 1;
+    !rebuildAll && revision <= heightfield.revision;
+    ++ revision
+  ) {
+    auto const edit = pulcTerrainHeightfieldEditFetch(&heightfield, revision);
+    if (!edit) {
+      rebuildAll = true;
+      break;
+    }
+    // the cost map's slope looks one sample out, so neighbours of the edit
+    //   change too
+    grid.dirtyRects.emplace_back(PathGridRect {
+      .x0 = edit->x0 > 0 ? edit->x0-1 : 0,
+      .y0 = edit->y0 > 0 ? edit->y0-1 : 0,
+      .x1 = std::min(edit->x1+1, grid.width-1),
+      .y1 = std::min(edit->y1+1, grid.height-1),
+    });
+  }
+
+  grid.terrainRevision = heightfield.revision;
+  grid.costMap = costMap;
+  if (rebuildAll) {
+    grid.width = heightfield.width;
+    grid.height = heightfield.height;
+    grid.dirtyRects.clear();
+    grid.dirtyRects.emplace_back(PathGridRect {
+      .x0 = 0, .y0 = 0, .x1 = grid.width-1, .y1 = grid.height-1,
+    });
+  }
+  grid.origin = heightfield.origin;
+  grid.spacing = heightfield.spacing;
+  return true;
+}
+
+int64_t pathGridCell(PathGrid const & grid, PuleF32v2 const position) {
+  float const fx = (position.x - grid.origin.x) / grid.spacing.x + 0.5f;
+  float const fy = (position.y - grid.origin.y) / grid.spacing.y + 0.5f;
+  if (fx < 0.0f || fy < 0.0f) { return pathCellInvalid; }
+  size_t const x = static_cast<size_t>(fx);
+  size_t const y = static_cast<size_t>(fy);
+  if (x >= grid.width || y >= grid.height) { return pathCellInvalid; }
+  return static_cast<int64_t>(y*grid.width + x);
+}
+
+PuleF32v2 pathGridCellCenter(PathGrid const & grid, size_t const cell) {
+  return PuleF32v2 {
+    grid.origin.x + (cell % grid.width) * grid.spacing.x,
+    grid.origin.y + (cell / grid.width) * grid.spacing.y,
+  };
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../../terrain/terrain.h"
+
+#include <cstdint>
+#include <vector>
+
+// inclusive cell rectangle
+struct PathGridRect {
+  size_t x0, y0;
+  size_t x1, y1;
+};
+
+// one path cell per heightfield sample, cell centres sit on the samples.
+//   Costs, passability and regions of one movement class are read in place
+//   from the terrain plugin's cost map
+struct PathGrid {
+  size_t width;
+  size_t height;
+  PuleF32v2 origin;
+  PuleF32v2 spacing;
+  PulcTerrainCostMap costMap; // view, the arrays stay the terrain plugin's
+  PulcTerrainMovementClass movementClass;
+  uint64_t terrainRevision;
+  // cells whose cost was recomputed by the last sync
+  std::vector<PathGridRect> dirtyRects;
+};
+
+int64_t constexpr pathCellInvalid = -1;
+
+// takes over the cost map and collects the rectangles that changed since the
+//   last sync (everything if the edit log can't tell), returns true if any
+//   did
+bool pathGridSync(
+  PathGrid & grid, PulcTerrainHeightfield const & heightfield,
+  PulcTerrainCostMap const & costMap
+);
+
+int64_t pathGridCell(PathGrid const & grid, PuleF32v2 const position);
+PuleF32v2 pathGridCellCenter(PathGrid const & grid, size_t const cell);
+
+// cost to enter a cell
+inline uint8_t pathGridCost(PathGrid const & grid, size_t const cell) {
+  return pulcTerrainCostMapCost(&grid.costMap, cell);
+}
+
+inline bool pathGridPassable(PathGrid const & grid, size_t const cell) {
+  return pulcTerrainCostMapPassable(&grid.costMap, grid.movementClass, cell);
+}
+
+// whether b can be reached from a at all, without searching
+inline bool pathGridConnected(
+  PathGrid const & grid, size_t const a, size_t const b
+) {
+  uint32_t const regionA = pulcTerrainCostMapRegion(
+    &grid.costMap, grid.movementClass, a % grid.width, a / grid.width
+  );
+  return (
+       regionA != 0
+    && regionA == pulcTerrainCostMapRegion(
+         &grid.costMap, grid.movementClass, b % grid.width, b / grid.width
+       )
+  );
+}
+
+struct PathGridNeighbour {
+  int32_t dx, dy;
+  uint32_t weight; // straight 10, diagonal ~10*sqrt(2)
+};
+
+inline constexpr PathGridNeighbour pathGridNeighbours[8] = {
+  { +1,  0, 10, }, { -1,  0, 10, }, {  0, +1, 10, }, {  0, -1, 10, },
+  { +1, +1, 14, }, { -1, +1, 14, }, { +1, -1, 14, }, { -1, -1, 14, },
+};
+
+// calls fn(neighbourIndex, neighbourCell) for every neighbour of cell inside
+//   bounds that can be moved to, diagonals may not cut past an impassable
+//   corner
+template <typename Fn>
+void pathGridForEachNeighbour(
+  PathGrid const & grid, PathGridRect const & bounds, size_t const cell,
+  Fn && fn
+) {
+  int64_t const x = cell % grid.width;
+  int64_t const y = cell / grid.width;
+  int64_t const w = grid.width;
+  for (uint8_t it = 0; it < 8; ++ it) {
+    int64_t const nx = x + pathGridNeighbours[it].dx;
+    int64_t const ny = y + pathGridNeighbours[it].dy;
+    if (
+         nx < static_cast<int64_t>(bounds.x0)
+      || ny < static_cast<int64_t>(bounds.y0)
+      || nx > static_cast<int64_t>(bounds.x1)
+      || ny > static_cast<int64_t>(bounds.y1)
+    ) {
+      continue;
+    }
+    size_t const ncell = ny*w + nx;
+    if (!pathGridPassable(grid, ncell)) { continue; }
+    if (pathGridNeighbours[it].dx != 0 && pathGridNeighbours[it].dy != 0) {
+      if (
+           !pathGridPassable(grid, y*w + nx)
+        || !pathGridPassable(grid, ny*w + x)
+      ) {
+        continue;
+      }
+    }
+    fn(it, ncell);
+  }
+}
+
+inline PathGridRect pathGridBounds(PathGrid const & grid) {
+  return PathGridRect { 0, 0, grid.width-1, grid.height-1, };
+}
@@ -0,0 +1,427 @@
+#include "hierarchy.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// entrances narrower than this get a single transition in their middle,
+//   wider ones get one at each end
+size_t constexpr entranceSplitWidth = 6;
+uint32_t constexpr parentNone = UINT32_MAX;
+
+size_t clusterOfCell(
+  PathHierarchy const & hierarchy, PathGrid const & grid, size_t const cell
+) {
+  size_t const cx = (cell % grid.width) / hierarchy.clusterDim;
+  size_t const cy = (cell / grid.width) / hierarchy.clusterDim;
+  return cy*hierarchy.clustersX + cx;
+}
+
+PathGridRect clusterBounds(
+  PathHierarchy const & hierarchy, PathGrid const & grid, size_t const cluster
+) {
+  size_t const x0 = (cluster % hierarchy.clustersX) * hierarchy.clusterDim;
+  size_t const y0 = (cluster / hierarchy.clustersX) * hierarchy.clusterDim;
+  return PathGridRect {
+    .x0 = x0,
+    .y0 = y0,
+    .x1 = std::min(x0 + hierarchy.clusterDim - 1, grid.width - 1),
+    .y1 = std::min(y0 + hierarchy.clusterDim - 1, grid.height - 1),
+  };
+}
+
+uint32_t nodeAllocate(
+  PathHierarchy & hierarchy, size_t const cell, size_t const cluster
+) {
+  uint32_t id;
+  if (!hierarchy.freeNodes.empty()) {
+    id = hierarchy.freeNodes.back();
+    hierarchy.freeNodes.pop_back();
+  } else {
+    id = static_cast<uint32_t>(hierarchy.nodes.size());
+    hierarchy.nodes.emplace_back();
+  }
+  auto & node = hierarchy.nodes[id];
+  node.cell = cell;
+  node.cluster = static_cast<uint32_t>(cluster);
+  node.alive = true;
+  node.edges.clear();
+  return id;
+}
+
+void nodeFree(PathHierarchy & hierarchy, uint32_t const id) {
+  hierarchy.nodes[id].alive = false;
+  hierarchy.nodes[id].edges.clear();
+  hierarchy.freeNodes.emplace_back(id);
+}
+
+// (re)creates the entrances between cluster and its east (or south)
+//   neighbour; the clusters on both sides need their intra edges rebuilt
+//   afterwards
+void borderRebuild(
+  PathHierarchy & hierarchy, PathGrid const & grid,
+  size_t const cluster, bool const east
+) {
+  auto & border = (
+    east ? hierarchy.bordersEast[cluster] : hierarchy.bordersSouth[cluster]
+  );
+  for (uint32_t const id : border) { nodeFree(hierarchy, id); }
+  border.clear();
+
+  size_t const cx = cluster % hierarchy.clustersX;
+  size_t const cy = cluster / hierarchy.clustersX;
+  if (east && cx+1 >= hierarchy.clustersX) { return; }
+  if (!east && cy+1 >= hierarchy.clustersY) { return; }
+  size_t const neighbour = (
+    east ? cluster + 1 : cluster + hierarchy.clustersX
+  );
+
+  PathGridRect const bounds = clusterBounds(hierarchy, grid, cluster);
+  // walk along the border, a is the cell on this side, b across it
+  size_t const length = (
+    east ? bounds.y1 - bounds.y0 + 1 : bounds.x1 - bounds.x0 + 1
+  );
+  auto const cellPair = [&](size_t const it) {
+    size_t const a = (
+      east
+      ? (bounds.y0 + it)*grid.width + bounds.x1
+      : bounds.y1*grid.width + bounds.x0 + it
+    );
+    return std::pair<size_t, size_t>(a, east ? a+1 : a+grid.width);
+  };
+  auto const addTransition = [&](size_t const it) {
+    auto const [a, b] = cellPair(it);
+    uint32_t const nodeA = nodeAllocate(hierarchy, a, cluster);
+    uint32_t const nodeB = nodeAllocate(hierarchy, b, neighbour);
+    hierarchy.nodes[nodeA].across = PathHierarchyEdge {
+      .node = nodeB,
+      .cost = pathGridCost(grid, b) * pathGridNeighbours[0].weight,
+    };
+    hierarchy.nodes[nodeB].across = PathHierarchyEdge {
+      .node = nodeA,
+      .cost = pathGridCost(grid, a) * pathGridNeighbours[0].weight,
+    };
+    border.emplace_back(nodeA);
+    border.emplace_back(nodeB);
+  };
+
+  size_t runStart = SIZE_MAX;
+  for (size_t it = 0; it <= length; ++ it) {
+    bool open = false;
+    if (it < length) {
+      auto const [a, b] = cellPair(it);
+      open = pathGridPassable(grid, a) && pathGridPassable(grid, b);
+    }
+    if (open && runStart == SIZE_MAX) { runStart = it; }
+    if (open || runStart == SIZE_MAX) { continue; }
+    size_t const runEnd = it - 1;
+    if (runEnd - runStart + 1 < entranceSplitWidth) {
+      addTransition((runStart + runEnd) / 2);
+    } else {
+      addTransition(runStart);
+      addTransition(runEnd);
+    }
+    runStart = SIZE_MAX;
+  }
+}
+
+void clusterRebuild(
+  PathHierarchy & hierarchy, PathGrid const & grid, size_t const cluster
+) {
+  size_t const cx = cluster % hierarchy.clustersX;
+  size_t const cy = cluster / hierarchy.clustersX;
+
+  auto & clusterNodes = hierarchy.clusterNodes[cluster];
+  clusterNodes.clear();
+  auto const gather = [&](std::vector<uint32_t> const & border) {
+    for (uint32_t const id : border) {
+      if (hierarchy.nodes[id].cluster == cluster) {
+        clusterNodes.emplace_back(id);
+      }
+    }
+  };
+  gather(hierarchy.bordersEast[cluster]);
+  gather(hierarchy.bordersSouth[cluster]);
+  if (cx > 0) { gather(hierarchy.bordersEast[cluster-1]); }
+  if (cy > 0) { gather(hierarchy.bordersSouth[cluster-hierarchy.clustersX]); }
+
+  PathGridRect const bounds = clusterBounds(hierarchy, grid, cluster);
+  for (uint32_t const id : clusterNodes) {
+    hierarchy.nodes[id].edges.clear();
+    gridSearchFlood(
+      hierarchy.localScratch, grid, bounds, hierarchy.nodes[id].cell, false
+    );
+    for (uint32_t const other : clusterNodes) {
+      if (other == id) { continue; }
+      uint32_t const cost = (
+        gridSearchFloodCost(
+          hierarchy.localScratch, grid, hierarchy.nodes[other].cell
+        )
+      );
+      if (cost == gridSearchUnreachable) { continue; }
+      hierarchy.nodes[id].edges.emplace_back(PathHierarchyEdge {
+        .node = other, .cost = cost,
+      });
+    }
+  }
+}
+
+void rebuildAll(PathHierarchy & hierarchy, PathGrid const & grid) {
+  hierarchy.gridWidth = grid.width;
+  hierarchy.gridHeight = grid.height;
+  hierarchy.clustersX = (
+    (grid.width + hierarchy.clusterDim - 1) / hierarchy.clusterDim
+  );
+  hierarchy.clustersY = (
+    (grid.height + hierarchy.clusterDim - 1) / hierarchy.clusterDim
+  );
+  size_t const clusterCount = hierarchy.clustersX * hierarchy.clustersY;
+  hierarchy.nodes.clear();
+  hierarchy.freeNodes.clear();
+  hierarchy.bordersEast.assign(clusterCount, {});
+  hierarchy.bordersSouth.assign(clusterCount, {});
+  hierarchy.clusterNodes.assign(clusterCount, {});
+  for (size_t cluster = 0; cluster < clusterCount; ++ cluster) {
+    borderRebuild(hierarchy, grid, cluster, true);
+    borderRebuild(hierarchy, grid, cluster, false);
+  }
+  for (size_t cluster = 0; cluster < clusterCount; ++ cluster) {
+    clusterRebuild(hierarchy, grid, cluster);
+  }
+}
+
+void abstractPush(
+  PathHierarchy & hierarchy, uint32_t const priority, uint32_t const node
+) {
+  hierarchy.abstractOpen.emplace_back(
+    (static_cast<uint64_t>(priority) << 32) | node
+  );
+  std::push_heap(
+    hierarchy.abstractOpen.begin(), hierarchy.abstractOpen.end(),
+    std::greater<uint64_t>{}
+  );
+}
+
+} // namespace
+
+PathHierarchy pathHierarchyCreate(size_t const clusterDim) {
+  PathHierarchy hierarchy = {};
+  hierarchy.clusterDim = clusterDim;
+  return hierarchy;
+}
+
+void pathHierarchySync(PathHierarchy & hierarchy, PathGrid const & grid) {
+  if (
+       hierarchy.gridWidth != grid.width || hierarchy.gridHeight != grid.height
+    || hierarchy.clusterNodes.empty()
+  ) {
+    rebuildAll(hierarchy, grid);
+    return;
+  }
+
+  size_t const clusterCount = hierarchy.clustersX * hierarchy.clustersY;
+  std::vector<bool> dirtyClusters(clusterCount, false);
+  size_t const dim = hierarchy.clusterDim;
+  for (auto const & rect : grid.dirtyRects) {
+    for (size_t cy = rect.y0/dim; cy <= rect.y1/dim; ++ cy)
+    for (size_t cx = rect.x0/dim; cx <= rect.x1/dim; ++ cx) {
+      dirtyClusters[cy*hierarchy.clustersX + cx] = true;
+    }
+  }
+
+  // every border of a dirty cluster may have gained or lost entrances, and
+  //   the cluster across each of those borders loses its nodes on it
+  std::vector<bool> dirtyEast(clusterCount, false);
+  std::vector<bool> dirtySouth(clusterCount, false);
+  std::vector<bool> rebuildClusters(clusterCount, false);
+  for (size_t cluster = 0; cluster < clusterCount; ++ cluster) {
+    if (!dirtyClusters[cluster]) { continue; }
+    size_t const cx = cluster % hierarchy.clustersX;
+    size_t const cy = cluster / hierarchy.clustersX;
+    dirtyEast[cluster] = true;
+    dirtySouth[cluster] = true;
+    rebuildClusters[cluster] = true;
+    if (cx > 0) { dirtyEast[cluster-1] = true; }
+    if (cy > 0) { dirtySouth[cluster-hierarchy.clustersX] = true; }
+    if (cx > 0) { rebuildClusters[cluster-1] = true; }
+    if (cy > 0) { rebuildClusters[cluster-hierarchy.clustersX] = true; }
+    if (cx+1 < hierarchy.clustersX) { rebuildClusters[cluster+1] = true; }
+    if (cy+1 < hierarchy.clustersY) {
+      rebuildClusters[cluster+hierarchy.clustersX] = true;
+    }
+  }
+
+  for (size_t cluster = 0; cluster < clusterCount; ++ cluster) {
+    if (dirtyEast[cluster]) { borderRebuild(hierarchy, grid, cluster, true); }
+    if (dirtySouth[cluster]) {
+      borderRebuild(hierarchy, grid, cluster, false);
+    }
+  }
+  for (size_t cluster = 0; cluster < clusterCount; ++ cluster) {
+    if (rebuildClusters[cluster]) { clusterRebuild(hierarchy, grid, cluster); }
+  }
+}
+
+bool pathHierarchyFind(
+  PathHierarchy & hierarchy, PathGrid const & grid,
+  size_t const start, size_t const goal,
+  std::vector<size_t> & path
+) {
+  path.clear();
+  // also rejects goals in another region before any search
+  if (!pathGridConnected(grid, start, goal)) { return false; }
+  size_t const startCluster = clusterOfCell(hierarchy, grid, start);
+  size_t const goalCluster = clusterOfCell(hierarchy, grid, goal);
+  if (
+       startCluster == goalCluster
+    && gridSearchPath(
+         hierarchy.localScratch, grid,
+         clusterBounds(hierarchy, grid, startCluster), start, goal, path
+       )
+  ) {
+    return true;
+  }
+
+  // the goal joins the abstract graph as an extra node past the real ones
+  uint32_t const goalNode = static_cast<uint32_t>(hierarchy.nodes.size());
+  size_t const abstractCount = hierarchy.nodes.size() + 1;
+  if (hierarchy.abstractStamps.size() < abstractCount) {
+    hierarchy.abstractCosts.resize(abstractCount);
+    hierarchy.abstractParents.resize(abstractCount);
+    hierarchy.abstractStamps.resize(abstractCount, 0);
+  }
+  hierarchy.abstractStamp += 1;
+  if (hierarchy.abstractStamp == 0) {
+    std::fill(
+      hierarchy.abstractStamps.begin(), hierarchy.abstractStamps.end(), 0
+    );
+    hierarchy.abstractStamp = 1;
+  }
+  hierarchy.abstractOpen.clear();
+  auto const abstractCost = [&](uint32_t const node) {
+    return (
+      hierarchy.abstractStamps[node] == hierarchy.abstractStamp
+      ? hierarchy.abstractCosts[node] : gridSearchUnreachable
+    );
+  };
+  auto const relax = [&](
+    uint32_t const node, uint32_t const cost, uint32_t const parent
+  ) {
+    if (cost >= abstractCost(node)) { return; }
+    hierarchy.abstractStamps[node] = hierarchy.abstractStamp;
+    hierarchy.abstractCosts[node] = cost;
+    hierarchy.abstractParents[node] = parent;
+    uint32_t const h = (
+      node == goalNode
+      ? 0 : gridSearchHeuristic(grid, hierarchy.nodes[node].cell, goal)
+    );
+    abstractPush(hierarchy, cost + h, node);
+  };
+
+  // cost from each goal-cluster node to the goal
+  hierarchy.goalCosts.clear();
+  gridSearchFlood(
+    hierarchy.localScratch, grid, clusterBounds(hierarchy, grid, goalCluster),
+    goal, true
+  );
+  for (uint32_t const id : hierarchy.clusterNodes[goalCluster]) {
+    hierarchy.goalCosts.emplace_back(
+      gridSearchFloodCost(
+        hierarchy.localScratch, grid, hierarchy.nodes[id].cell
+      )
+    );
+  }
+
+  // seed with every node the start can reach inside its cluster
+  gridSearchFlood(
+    hierarchy.localScratch, grid, clusterBounds(hierarchy, grid, startCluster),
+    start, false
+  );
+  for (uint32_t const id : hierarchy.clusterNodes[startCluster]) {
+    uint32_t const cost = (
+      gridSearchFloodCost(
+        hierarchy.localScratch, grid, hierarchy.nodes[id].cell
+      )
+    );
+    if (cost != gridSearchUnreachable) { relax(id, cost, parentNone); }
+  }
+
+  bool found = false;
+  while (!hierarchy.abstractOpen.empty()) {
+    std::pop_heap(
+      hierarchy.abstractOpen.begin(), hierarchy.abstractOpen.end(),
+      std::greater<uint64_t>{}
+    );
+    uint64_t const top = hierarchy.abstractOpen.back();
+    hierarchy.abstractOpen.pop_back();
+    uint32_t const node = static_cast<uint32_t>(top & 0xFFFFFFFF);
+    if (node == goalNode) {
+      found = true;
+      break;
+    }
+    uint32_t const cost = hierarchy.abstractCosts[node];
+    uint32_t const h = (
+      gridSearchHeuristic(grid, hierarchy.nodes[node].cell, goal)
+    );
+    if (static_cast<uint32_t>(top >> 32) != cost + h) { continue; }
+
+    auto const & across = hierarchy.nodes[node].across;
+    relax(across.node, cost + across.cost, node);
+    for (auto const & edge : hierarchy.nodes[node].edges) {
+      relax(edge.node, cost + edge.cost, node);
+    }
+    if (hierarchy.nodes[node].cluster == goalCluster) {
+      auto const & goalNodes = hierarchy.clusterNodes[goalCluster];
+      for (size_t it = 0; it < goalNodes.size(); ++ it) {
+        if (goalNodes[it] != node) { continue; }
+        if (hierarchy.goalCosts[it] == gridSearchUnreachable) { break; }
+        relax(goalNode, cost + hierarchy.goalCosts[it], node);
+        break;
+      }
+    }
+  }
+  if (!found) { return false; }
+
+  hierarchy.abstractPath.clear();
+  for (
+    uint32_t node = hierarchy.abstractParents[goalNode];
+    node != parentNone;
+    node = hierarchy.abstractParents[node]
+  ) {
+    hierarchy.abstractPath.emplace_back(node);
+  }
+  std::reverse(hierarchy.abstractPath.begin(), hierarchy.abstractPath.end());
+
+  // refine, consecutive waypoints either share a cluster or are neighbours
+  //   across a border
+  path.emplace_back(start);
+  auto const refineTo = [&](size_t const cell) {
+    size_t const from = path.back();
+    if (from == cell) { return; }
+    size_t const fromCluster = clusterOfCell(hierarchy, grid, from);
+    if (fromCluster != clusterOfCell(hierarchy, grid, cell)) {
+      path.emplace_back(cell);
+      return;
+    }
+    bool const refined = (
+      gridSearchPath(
+        hierarchy.localScratch, grid,
+        clusterBounds(hierarchy, grid, fromCluster), from, cell,
+        hierarchy.segment
+      )
+    );
+    if (!refined) { // edges only exist between locally connected nodes
+      path.emplace_back(cell);
+      return;
+    }
+    path.insert(
+      path.end(), hierarchy.segment.begin()+1, hierarchy.segment.end()
+    );
+  };
+  for (uint32_t const node : hierarchy.abstractPath) {
+    refineTo(hierarchy.nodes[node].cell);
+  }
+  refineTo(goal);
+  return true;
+}
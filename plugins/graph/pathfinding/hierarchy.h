@@ -0,0 +1,66 @@
+#pragma once
+
+#include "grid-search.h"
+#include "grid.h"
+
+#include <cstdint>
+#include <vector>
+
+// cluster/portal abstraction of a path grid (HPA*); the grid is split into
+//   fixed-size square clusters, every passable stretch of a cluster border
+//   gets one or two entrance nodes on each side, and nodes inside a cluster
+//   are linked by their cluster-local path cost. Long searches run over this
+//   graph first and are refined cluster by cluster afterwards
+
+struct PathHierarchyEdge {
+  uint32_t node;
+  uint32_t cost;
+};
+
+struct PathHierarchyNode {
+  size_t cell;
+  uint32_t cluster;
+  bool alive;
+  PathHierarchyEdge across; // to the paired node on the other side
+  std::vector<PathHierarchyEdge> edges; // to nodes of the same cluster
+};
+
+struct PathHierarchy {
+  size_t clusterDim;
+  size_t clustersX, clustersY;
+  size_t gridWidth, gridHeight;
+
+  std::vector<PathHierarchyNode> nodes;
+  std::vector<uint32_t> freeNodes;
+  // entrance nodes owned by the border between cluster (cx, cy) and its
+  //   east/south neighbour, indexed cy*clustersX + cx
+  std::vector<std::vector<uint32_t>> bordersEast;
+  std::vector<std::vector<uint32_t>> bordersSouth;
+  std::vector<std::vector<uint32_t>> clusterNodes;
+
+  // search state, reused between queries
+  GridSearchScratch localScratch;
+  std::vector<uint32_t> abstractCosts;
+  std::vector<uint32_t> abstractParents;
+  std::vector<uint32_t> abstractStamps;
+  std::vector<uint64_t> abstractOpen;
+  std::vector<uint32_t> goalCosts; // per node cost to the goal, or unreachable
+  std::vector<uint32_t> abstractPath;
+  std::vector<size_t> segment;
+  uint32_t abstractStamp;
+};
+
+PathHierarchy pathHierarchyCreate(size_t const clusterDim);
+
+// brings the abstraction up to date with the grid; call right after a
+//   pathGridSync that returned true, only clusters touching the grid's dirty
+//   rectangles (and their neighbours across a changed border) are rebuilt
+void pathHierarchySync(PathHierarchy & hierarchy, PathGrid const & grid);
+
+// replaces path with the cells from start to goal inclusive, false if the
+//   goal can't be reached
+bool pathHierarchyFind(
+  PathHierarchy & hierarchy, PathGrid const & grid,
+  size_t const start, size_t const goal,
+  std::vector<size_t> & path
+);
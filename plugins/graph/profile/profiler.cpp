@@ -0,0 +1,292 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// zones per thread between drains; a frame rarely has more than a few
+//   hundred per thread
+size_t constexpr profilerRingCapacity = size_t(1) << 14;
+// zones kept by a capture before further ones are dropped, a few seconds of
+//   a busy frame
+size_t constexpr profilerCaptureMax = size_t(1) << 22;
+
+struct ProfilerZone {
+  char const * label;
+  uint64_t beginNs, endNs;
+};
+
+// single producer, the owning thread, and single consumer, the drain
+struct ProfilerRing {
+  alignas(64) std::atomic<uint64_t> head { 0 };
+  alignas(64) std::atomic<uint64_t> tail { 0 };
+  std::atomic<uint64_t> dropped { 0 };
+  uint32_t thread;
+  ProfilerZone zones[profilerRingCapacity];
+};
+
+struct ProfilerLabel {
+  std::string name;
+  // this frame, then per frame over the window
+  uint32_t calls;
+  uint64_t ns;
+  uint32_t callsWindow[pulcProfilerWindowFrames];
+  float msWindow[pulcProfilerWindowFrames];
+};
+
+struct ProfilerCaptured {
+  uint32_t label;
+  uint32_t thread;
+  uint64_t beginNs, endNs;
+};
+
+// told apart by generation rather than address, a profiler created after
+//   another was destroyed may reuse its address
+std::atomic<uint64_t> profilerGenerations { 0 };
+
+thread_local ProfilerRing * threadRing = nullptr;
+thread_local uint64_t threadRingGeneration = 0;
+
+} // namespace
+
+struct Profiler {
+  uint64_t generation;
+
+  // only taken by a thread recording its first zone and by the drain
+  std::mutex ringsMutex;
+  std::vector<std::unique_ptr<ProfilerRing>> rings;
+
+  // drain side, main thread
+  std::unordered_map<char const *, uint32_t> labelIndices;
+  std::vector<ProfilerLabel> labels;
+  size_t frame;
+
+  std::atomic<bool> capturing;
+  uint64_t captureBeginNs;
+  std::vector<ProfilerCaptured> captured;
+};
+
+namespace {
+
+ProfilerRing & profilerThreadRing(Profiler & profiler) {
+  if (threadRing && threadRingGeneration == profiler.generation) {
+    return *threadRing;
+  }
+  std::lock_guard<std::mutex> lock(profiler.ringsMutex);
+  auto ring = std::make_unique<ProfilerRing>();
+  ring->thread = static_cast<uint32_t>(profiler.rings.size());
+  threadRing = ring.get();
+  threadRingGeneration = profiler.generation;
+  profiler.rings.emplace_back(std::move(ring));
+  return *threadRing;
+}
+
+uint32_t profilerLabelIndex(Profiler & profiler, char const * const label) {
+  auto const found = profiler.labelIndices.find(label);
+  if (found != profiler.labelIndices.end()) { return found->second; }
+  // labels with the same text from different call sites share statistics
+  uint32_t index = 0;
+  for (; index < profiler.labels.size(); ++ index) {
+    if (profiler.labels[index].name == label) { break; }
+  }
+  if (index == profiler.labels.size()) {
+    profiler.labels.emplace_back(ProfilerLabel { .name = label, });
+  }
+  profiler.labelIndices.emplace(label, index);
+  return index;
+}
+
+void profilerDrain(Profiler & profiler, ProfilerRing & ring) {
+  uint64_t const head = ring.head.load(std::memory_order_acquire);
+  uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+  bool const capturing = profiler.capturing.load(std::memory_order_relaxed);
+  for (; tail != head; ++ tail) {
+    ProfilerZone const & zone = ring.zones[tail % profilerRingCapacity];
+    uint32_t const index = profilerLabelIndex(profiler, zone.label);
+    ProfilerLabel & label = profiler.labels[index];
+    label.calls += 1;
+    label.ns += zone.endNs - zone.beginNs;
+    if (
+         capturing && zone.beginNs >= profiler.captureBeginNs
+      && profiler.captured.size() < profilerCaptureMax
+    ) {
+      profiler.captured.emplace_back(
+        ProfilerCaptured { index, ring.thread, zone.beginNs, zone.endNs }
+      );
+    }
+  }
+  ring.tail.store(tail, std::memory_order_release);
+}
+
+void profilerDrainAll(Profiler & profiler) {
+  std::lock_guard<std::mutex> lock(profiler.ringsMutex);
+  for (auto const & ring : profiler.rings) {
+    profilerDrain(profiler, *ring);
+  }
+}
+
+void jsonString(FILE * const file, std::string const & value) {
+  std::fputc('"', file);
+  for (char const c : value) {
+    if (c == '"' || c == '\\') { std::fputc('\\', file); }
+    if (static_cast<unsigned char>(c) < 0x20) { continue; }
+    std::fputc(c, file);
+  }
+  std::fputc('"', file);
+}
+
+// -- C interface --------------------------------------------------------------
+
+void profilerInterfaceZoneRecord(
+  void * const profilerPtr, char const * const label,
+  uint64_t const beginNs, uint64_t const endNs
+) {
+  ProfilerRing & ring = (
+    profilerThreadRing(*reinterpret_cast<Profiler *>(profilerPtr))
+  );
+  uint64_t const head = ring.head.load(std::memory_order_relaxed);
+  uint64_t const tail = ring.tail.load(std::memory_order_acquire);
+  if (head - tail == profilerRingCapacity) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring.zones[head % profilerRingCapacity] = (
+    ProfilerZone { label, beginNs, endNs }
+  );
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+size_t profilerInterfaceZoneCount(void * const profilerPtr) {
+  return reinterpret_cast<Profiler *>(profilerPtr)->labels.size();
+}
+
+PulcProfilerZoneStats profilerInterfaceZoneStats(
+  void * const profilerPtr, size_t const index
+) {
+  Profiler const & profiler = *reinterpret_cast<Profiler *>(profilerPtr);
+  ProfilerLabel const & label = profiler.labels[index];
+  size_t const frames = std::min<size_t>(
+    profiler.frame, pulcProfilerWindowFrames
+  );
+  PulcProfilerZoneStats stats = {
+    .label = label.name.c_str(),
+    .callsPerFrame = 0.0f,
+    .msPerFrame = 0.0f,
+    .msPerFrameMax = 0.0f,
+  };
+  if (frames == 0) { return stats; }
+  for (size_t it = 0; it < frames; ++ it) {
+    stats.callsPerFrame += static_cast<float>(label.callsWindow[it]);
+    stats.msPerFrame += label.msWindow[it];
+    stats.msPerFrameMax = std::max(stats.msPerFrameMax, label.msWindow[it]);
+  }
+  stats.callsPerFrame /= static_cast<float>(frames);
+  stats.msPerFrame /= static_cast<float>(frames);
+  return stats;
+}
+
+bool profilerInterfaceZoneLastFrame(
+  void * const profilerPtr, size_t const index, float * const ms
+) {
+  Profiler const & profiler = *reinterpret_cast<Profiler *>(profilerPtr);
+  if (profiler.frame == 0) { return false; }
+  size_t const slot = (profiler.frame - 1) % pulcProfilerWindowFrames;
+  ProfilerLabel const & label = profiler.labels[index];
+  *ms = label.msWindow[slot];
+  return label.callsWindow[slot] > 0;
+}
+
+void profilerInterfaceCaptureBegin(void * const profilerPtr) {
+  Profiler & profiler = *reinterpret_cast<Profiler *>(profilerPtr);
+  profiler.captured.clear();
+  profiler.captureBeginNs = pulcProfilerNowNs();
+  profiler.capturing.store(true, std::memory_order_relaxed);
+}
+
+bool profilerInterfaceCaptureEnd(
+  void * const profilerPtr, char const * const path
+) {
+  Profiler & profiler = *reinterpret_cast<Profiler *>(profilerPtr);
+  if (!profiler.capturing.load(std::memory_order_relaxed)) { return false; }
+  // zones still in the rings belong to the capture too
+  profilerDrainAll(profiler);
+  profiler.capturing.store(false, std::memory_order_relaxed);
+
+  FILE * const file = std::fopen(path, "wb");
+  if (!file) { return false; }
+  std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+  bool first = true;
+  for (ProfilerCaptured const & zone : profiler.captured) {
+    std::fputs(first ? "{\"name\":" : ",\n{\"name\":", file);
+    first = false;
+    jsonString(file, profiler.labels[zone.label].name);
+    // complete events, microseconds since the capture began
+    std::fprintf(
+      file, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+      zone.thread,
+      static_cast<double>(zone.beginNs - profiler.captureBeginNs) * 1e-3,
+      static_cast<double>(zone.endNs - zone.beginNs) * 1e-3
+    );
+  }
+  std::fputs("\n]}\n", file);
+  bool const written = std::ferror(file) == 0;
+  std::fclose(file);
+  profiler.captured.clear();
+  profiler.captured.shrink_to_fit();
+  return written;
+}
+
+bool profilerInterfaceCapturing(void * const profilerPtr) {
+  return (
+    reinterpret_cast<Profiler *>(profilerPtr)->capturing.load(
+      std::memory_order_relaxed
+    )
+  );
+}
+
+} // namespace
+
+Profiler * profilerCreate() {
+  auto * const profiler = new Profiler;
+  profiler->generation = profilerGenerations.fetch_add(1) + 1;
+  profiler->frame = 0;
+  profiler->capturing.store(false);
+  profiler->captureBeginNs = 0;
+  return profiler;
+}
+
+void profilerDestroy(Profiler * const profiler) {
+  delete profiler;
+}
+
+PulcProfiler profilerInterface(Profiler * const profiler) {
+  return PulcProfiler {
+    .profiler = profiler,
+    .zoneRecord = profilerInterfaceZoneRecord,
+    .zoneCount = profilerInterfaceZoneCount,
+    .zoneStats = profilerInterfaceZoneStats,
+    .zoneLastFrame = profilerInterfaceZoneLastFrame,
+    .captureBegin = profilerInterfaceCaptureBegin,
+    .captureEnd = profilerInterfaceCaptureEnd,
+    .capturing = profilerInterfaceCapturing,
+  };
+}
+
+void profilerFrame(Profiler & profiler) {
+  profilerDrainAll(profiler);
+  size_t const slot = profiler.frame % pulcProfilerWindowFrames;
+  for (ProfilerLabel & label : profiler.labels) {
+    label.callsWindow[slot] = label.calls;
+    label.msWindow[slot] = static_cast<float>(label.ns) * 1e-6f;
+    label.calls = 0;
+    label.ns = 0;
+  }
+  ++ profiler.frame;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// -- shared C interface -------------------------------------------------------
+
+// scoped zones for finding out where a frame goes. A zone is recorded when
+//   it closes, label and start and end time, into a ring owned by the
+//   recording thread, so recording never takes a lock. The graph plugin
+//   drains every ring once a frame into rolling per-label statistics and,
+//   while a capture runs, into a Chrome trace. It stores a PulcProfiler under
+//   "pulc-profiler" for other plugins.
+// Build with PULC_PROFILER defined to 0 and every zone compiles out
+
+#ifndef PULC_PROFILER
+#define PULC_PROFILER 1
+#endif
+
+// frames the rolling statistics cover
+#define pulcProfilerWindowFrames 120
+
+typedef struct {
+  char const * label;
+  float callsPerFrame;
+  float msPerFrame; // average over the window, nested zones included
+  float msPerFrameMax;
+} PulcProfilerZoneStats;
+
+typedef struct {
+  void * profiler;
+  // labels have to stay valid until the next drain, a frame at most; a zone
+  //   is dropped when its thread's ring is full
+  void (* zoneRecord)(
+    void * profiler, char const * label, uint64_t beginNs, uint64_t endNs
+  );
+  // labels seen so far, in the order they were first seen
+  size_t (* zoneCount)(void * profiler);
+  PulcProfilerZoneStats (* zoneStats)(void * profiler, size_t index);
+  // time the zone took in the frame closed last, false if it didn't run
+  bool (* zoneLastFrame)(void * profiler, size_t index, float * ms);
+  void (* captureBegin)(void * profiler);
+  // writes the zones since captureBegin as Chrome trace JSON, false if the
+  //   file couldn't be written
+  bool (* captureEnd)(void * profiler, char const * path);
+  bool (* capturing)(void * profiler);
+} PulcProfiler;
+
+#ifdef __cplusplus
+
+#include <chrono>
+
+inline uint64_t pulcProfilerNowNs() {
+  return static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()
+    ).count()
+  );
+}
+
+// records the enclosing scope; profiler may be null, e.g. while the graph
+//   plugin isn't loaded
+struct PulcProfileScope {
+  PulcProfiler const * const profiler;
+  char const * const label;
+  uint64_t const beginNs;
+
+  PulcProfileScope(PulcProfiler const * const p, char const * const l)
+    : profiler(p), label(l), beginNs(p ? pulcProfilerNowNs() : 0)
+  {}
+  ~PulcProfileScope() {
+    if (!profiler) { return; }
+    profiler->zoneRecord(
+      profiler->profiler, label, beginNs, pulcProfilerNowNs()
+    );
+  }
+  PulcProfileScope(PulcProfileScope const &) = delete;
+  PulcProfileScope & operator=(PulcProfileScope const &) = delete;
+};
+
+#if PULC_PROFILER
+#define PULC_PROFILE_CONCAT_(a, b) a##b
+#define PULC_PROFILE_CONCAT(a, b) PULC_PROFILE_CONCAT_(a, b)
+#define PULC_PROFILE_ZONE(profiler, label) \
+  PulcProfileScope const PULC_PROFILE_CONCAT(pulcProfileScope, __LINE__) { \
+    (profiler), (label) \
+  }
+#else
+#define PULC_PROFILE_ZONE(profiler, label) do {} while (false)
+#endif
+
+// -- graph plugin -------------------------------------------------------------
+
+struct Profiler;
+
+Profiler * profilerCreate();
+void profilerDestroy(Profiler * const profiler);
+
+PulcProfiler profilerInterface(Profiler * const profiler);
+
+// drains every thread's ring and closes the frame's statistics; main thread,
+//   once a frame
+void profilerFrame(Profiler & profiler);
+
+#endif
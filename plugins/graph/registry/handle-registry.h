@@ -0,0 +1,224 @@
+#pragma once
+
+#include <pulchritude-plugin/engine.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// payload entries, ECS components and render task graph lookups resolved
+//   from their string keys at load time into typed handles, which read back
+//   as an array index; per-frame code never hashes a string. Keys are
+//   interned, asking twice for one gives the same handle.
+// A plugin reloading stores new payload pointers, so every plugin bumps the
+//   revision under "pulc-handle-revision" after storing or removing payload
+//   entries, and registries resolve everything again once they see it move.
+//   Entries that didn't resolve yet, e.g. a plugin loading later, are
+//   retried each refresh. Values that change without a reload, like a task
+//   graph node's per-frame command recorder, aren't noticed, so they aren't
+//   registered; fetch them through a node handle every frame. Header only,
+//   the terrain plugin uses it as well.
+// A thread besides the main one that keeps using a fetched value, like a
+//   job system, holds the revision's gate shared around each use and checks
+//   the revision it fetched at still stands; a bump takes the gate, so an
+//   unloading plugin waits for those uses before destroying what it removed
+
+enum HandleKind {
+  HandleKind_payload,
+  HandleKind_payloadU64,
+  HandleKind_component,
+  HandleKind_taskGraphNode, // parent is the task graph's payloadU64
+};
+
+struct HandleEntry {
+  HandleKind kind;
+  uint32_t parent;
+  std::string key;
+  uint64_t value; // 0 while unresolved
+};
+
+struct HandleRevision {
+  std::atomic<uint64_t> value;
+  std::shared_mutex gate;
+};
+
+struct HandleRegistry {
+  PuleEngineLayer const * pul;
+  PulePluginPayload payload;
+  PuleEcsWorld world;
+  HandleRevision * revisionShared;
+  uint64_t revision;
+  size_t unresolved;
+  std::vector<HandleEntry> entries;
+};
+
+template <typename T> struct HandlePayload { uint32_t index; };
+struct HandlePayloadU64 { uint32_t index; };
+struct HandleComponent { uint32_t index; };
+struct HandleTaskGraphNode { uint32_t index; };
+
+// shared by every plugin and never freed, so it outlives any of them
+inline HandleRevision & handleRevision(
+  PuleEngineLayer const & pul, PulePluginPayload const payload
+) {
+  auto * revision = reinterpret_cast<HandleRevision *>(
+    pul.pluginPayloadFetch(payload, pul.cStr("pulc-handle-revision"))
+  );
+  if (!revision) {
+    revision = new HandleRevision { .value = 1, };
+    pul.pluginPayloadStore(
+      payload, pul.cStr("pulc-handle-revision"), revision
+    );
+  }
+  return *revision;
+}
+
+// after a plugin stored or removed payload entries, and before it destroys
+//   what it removed
+inline void handleRevisionBump(
+  PuleEngineLayer const & pul, PulePluginPayload const payload
+) {
+  HandleRevision & revision = handleRevision(pul, payload);
+  std::unique_lock<std::shared_mutex> const gate(revision.gate);
+  revision.value.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void handleRegistryCreate(
+  HandleRegistry & registry, PuleEngineLayer const & pul,
+  PulePluginPayload const payload, PuleEcsWorld const world
+) {
+  registry.pul = &pul;
+  registry.payload = payload;
+  registry.world = world;
+  registry.revisionShared = &handleRevision(pul, payload);
+  registry.revision = (
+    registry.revisionShared->value.load(std::memory_order_relaxed)
+  );
+  registry.unresolved = 0;
+  registry.entries.clear();
+}
+
+inline uint64_t handleRegistryResolve(
+  HandleRegistry const & registry, HandleEntry const & entry
+) {
+  PuleEngineLayer const & pul = *registry.pul;
+  PuleStringView const key = pul.cStr(entry.key.c_str());
+  uint64_t const parent = (
+    entry.kind == HandleKind_taskGraphNode
+    ? registry.entries[entry.parent].value : 0
+  );
+  switch (entry.kind) {
+    case HandleKind_payload:
+      return reinterpret_cast<uint64_t>(
+        pul.pluginPayloadFetch(registry.payload, key)
+      );
+    case HandleKind_payloadU64:
+      return pul.pluginPayloadFetchU64(registry.payload, key);
+    case HandleKind_component:
+      return pul.ecsComponentFetchByLabel(registry.world, key).id;
+    case HandleKind_taskGraphNode:
+      if (!parent) { return 0; }
+      return pul.taskGraphNodeFetch(PuleTaskGraph { parent }, key).id;
+  }
+  return 0;
+}
+
+inline uint32_t handleRegistryIntern(
+  HandleRegistry & registry, HandleKind const kind, uint32_t const parent,
+  char const * const key
+) {
+  for (size_t it = 0; it < registry.entries.size(); ++ it) {
+    HandleEntry const & entry = registry.entries[it];
+    if (entry.kind == kind && entry.parent == parent && entry.key == key) {
+      return static_cast<uint32_t>(it);
+    }
+  }
+  HandleEntry entry = {
+    .kind = kind, .parent = parent, .key = key, .value = 0,
+  };
+  entry.value = handleRegistryResolve(registry, entry);
+  registry.unresolved += entry.value == 0;
+  registry.entries.emplace_back(std::move(entry));
+  return static_cast<uint32_t>(registry.entries.size() - 1);
+}
+
+// once a frame before reading handles; an atomic load unless something
+//   reloaded or is still unresolved
+inline void handleRegistryRefresh(HandleRegistry & registry) {
+  uint64_t const revision = (
+    registry.revisionShared->value.load(std::memory_order_relaxed)
+  );
+  bool const reloaded = revision != registry.revision;
+  if (!reloaded && registry.unresolved == 0) { return; }
+  registry.revision = revision;
+  registry.unresolved = 0;
+  // parents come before their children
+  for (HandleEntry & entry : registry.entries) {
+    if (reloaded || entry.value == 0) {
+      entry.value = handleRegistryResolve(registry, entry);
+    }
+    registry.unresolved += entry.value == 0;
+  }
+}
+
+// -- registering, at load -----------------------------------------------------
+
+template <typename T>
+HandlePayload<T> handlePayload(
+  HandleRegistry & registry, char const * const key
+) {
+  return { handleRegistryIntern(registry, HandleKind_payload, 0, key) };
+}
+
+inline HandlePayloadU64 handlePayloadU64(
+  HandleRegistry & registry, char const * const key
+) {
+  return { handleRegistryIntern(registry, HandleKind_payloadU64, 0, key) };
+}
+
+inline HandleComponent handleComponent(
+  HandleRegistry & registry, char const * const label
+) {
+  return { handleRegistryIntern(registry, HandleKind_component, 0, label) };
+}
+
+inline HandleTaskGraphNode handleTaskGraphNode(
+  HandleRegistry & registry, HandlePayloadU64 const taskGraph,
+  char const * const label
+) {
+  return {
+    handleRegistryIntern(
+      registry, HandleKind_taskGraphNode, taskGraph.index, label
+    )
+  };
+}
+
+// -- reading, per frame -------------------------------------------------------
+
+// null while unresolved
+template <typename T>
+T * handleFetch(HandleRegistry const & registry, HandlePayload<T> const h) {
+  return reinterpret_cast<T *>(registry.entries[h.index].value);
+}
+
+inline uint64_t handleFetch(
+  HandleRegistry const & registry, HandlePayloadU64 const h
+) {
+  return registry.entries[h.index].value;
+}
+
+inline PuleEcsComponent handleFetch(
+  HandleRegistry const & registry, HandleComponent const h
+) {
+  return PuleEcsComponent { registry.entries[h.index].value };
+}
+
+inline PuleTaskGraphNode handleFetch(
+  HandleRegistry const & registry, HandleTaskGraphNode const h
+) {
+  return PuleTaskGraphNode { registry.entries[h.index].value };
+}
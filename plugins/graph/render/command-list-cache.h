@@ -0,0 +1,57 @@
+#pragma once
+
+#include <pulchritude-plugin/engine.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+// a static command sequence recorded once and replayed every frame, through
+//   dispatchCommandList from another list or by submitting it again. Values
+//   that change per frame go through buffers the list binds rather than into
+//   the list, so it only has to be recorded again once something it was
+//   recorded against is replaced: a pipeline, a buffer, or whatever else the
+//   caller keys it on. Header only, the terrain plugin uses it as well
+
+size_t constexpr commandListCacheKeyMax = 8;
+
+struct CommandListCache {
+  PuleGfxCommandList commandList;
+  uint64_t key[commandListCacheKeyMax];
+  size_t keyLength; // 0 until recorded the first time
+};
+
+inline void commandListCacheCreate(
+  CommandListCache & cache, PuleEngineLayer & pul, char const * const label
+) {
+  cache.commandList = (
+    pul.gfxCommandListCreate(pul.allocateDefault(), pul.cStr(label))
+  );
+  cache.keyLength = 0;
+}
+
+inline void commandListCacheDestroy(
+  CommandListCache & cache, PuleEngineLayer & pul
+) {
+  if (cache.commandList.id == 0) { return; }
+  pul.gfxCommandListDestroy(cache.commandList);
+  cache.commandList = PuleGfxCommandList { 0 };
+  cache.keyLength = 0;
+}
+
+// true if the list has to be recorded again for key, which is remembered;
+//   record it into a reset recorder and finish that before replaying
+inline bool commandListCacheStale(
+  CommandListCache & cache, std::initializer_list<uint64_t> const key
+) {
+  assert(key.size() <= commandListCacheKeyMax);
+  bool stale = cache.keyLength != key.size();
+  size_t it = 0;
+  for (uint64_t const value : key) {
+    stale = stale || cache.key[it] != value;
+    cache.key[it ++] = value;
+  }
+  cache.keyLength = key.size();
+  return stale;
+}
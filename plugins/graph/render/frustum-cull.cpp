@@ -0,0 +1,197 @@
+#include "frustum-cull.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULL_X86 1
+#include <immintrin.h>
+#else
+#define FRUSTUM_CULL_X86 0
+#endif
+
+namespace {
+
+// -- scalar -------------------------------------------------------------------
+
+void cullScalar(
+  FrustumPlanes const & planes, FrustumCullSpheres & spheres,
+  size_t const begin, size_t const end
+) {
+  for (size_t it = begin; it < end; ++ it) {
+    float const x = spheres.centerX[it];
+    float const y = spheres.centerY[it];
+    float const z = spheres.centerZ[it];
+    float const negRadius = -spheres.radius[it];
+    bool visible = true;
+    for (size_t plane = 0; plane < 6; ++ plane) {
+      float const dist = (
+          planes.a[plane]*x + planes.b[plane]*y + planes.c[plane]*z
+        + planes.d[plane]
+      );
+      visible = visible && dist >= negRadius;
+    }
+    spheres.visible[it] = visible;
+  }
+}
+
+#if FRUSTUM_CULL_X86
+
+// -- sse ----------------------------------------------------------------------
+
+void cullSse(
+  FrustumPlanes const & planes, FrustumCullSpheres & spheres,
+  size_t const begin, size_t const end
+) {
+  for (size_t it = begin; it < end; it += 4) {
+    __m128 const x = _mm_loadu_ps(&spheres.centerX[it]);
+    __m128 const y = _mm_loadu_ps(&spheres.centerY[it]);
+    __m128 const z = _mm_loadu_ps(&spheres.centerZ[it]);
+    __m128 const negRadius = (
+      _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[it]))
+    );
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (size_t plane = 0; plane < 6; ++ plane) {
+      __m128 dist = _mm_set1_ps(planes.d[plane]);
+      dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(planes.a[plane]), x));
+      dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(planes.b[plane]), y));
+      dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(planes.c[plane]), z));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negRadius));
+    }
+    int const mask = _mm_movemask_ps(inside);
+    for (size_t lane = 0; lane < 4; ++ lane) {
+      spheres.visible[it + lane] = (mask >> lane) & 1;
+    }
+  }
+}
+
+// -- avx2 ---------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+void cullAvx2(
+  FrustumPlanes const & planes, FrustumCullSpheres & spheres,
+  size_t const begin, size_t const end
+) {
+  for (size_t it = begin; it < end; it += 8) {
+    __m256 const x = _mm256_loadu_ps(&spheres.centerX[it]);
+    __m256 const y = _mm256_loadu_ps(&spheres.centerY[it]);
+    __m256 const z = _mm256_loadu_ps(&spheres.centerZ[it]);
+    __m256 const negRadius = (
+      _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[it]))
+    );
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (size_t plane = 0; plane < 6; ++ plane) {
+      __m256 dist = _mm256_set1_ps(planes.d[plane]);
+      dist = _mm256_fmadd_ps(_mm256_set1_ps(planes.a[plane]), x, dist);
+      dist = _mm256_fmadd_ps(_mm256_set1_ps(planes.b[plane]), y, dist);
+      dist = _mm256_fmadd_ps(_mm256_set1_ps(planes.c[plane]), z, dist);
+      inside = (
+        _mm256_and_ps(inside, _mm256_cmp_ps(dist, negRadius, _CMP_GE_OQ))
+      );
+    }
+    int const mask = _mm256_movemask_ps(inside);
+    for (size_t lane = 0; lane < 8; ++ lane) {
+      spheres.visible[it + lane] = (mask >> lane) & 1;
+    }
+  }
+}
+
+#endif // FRUSTUM_CULL_X86
+
+} // namespace
+
+FrustumCullKernel frustumCullKernelDetect() {
+  #if FRUSTUM_CULL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return FrustumCullKernel_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) { return FrustumCullKernel_sse; }
+  #endif
+  return FrustumCullKernel_scalar;
+}
+
+FrustumPlanes frustumPlanesFromViewProjection(
+  PuleF32m44 const & view, PuleF32m44 const & proj
+) {
+  // clip = proj*view, elem[column*4 + row]
+  float clip[16];
+  for (size_t column = 0; column < 4; ++ column) {
+    for (size_t row = 0; row < 4; ++ row) {
+      float sum = 0.0f;
+      for (size_t k = 0; k < 4; ++ k) {
+        sum += proj.elem[k*4 + row] * view.elem[column*4 + k];
+      }
+      clip[column*4 + row] = sum;
+    }
+  }
+  auto const clipRow = [&](size_t const row, size_t const column) {
+    return clip[column*4 + row];
+  };
+
+  // -w <= x,y,z <= w; a [0, w] depth range would make the near plane
+  //   tighter, so this only ever keeps slightly more than needed
+  FrustumPlanes planes;
+  for (size_t plane = 0; plane < 6; ++ plane) {
+    size_t const axis = plane / 2;
+    float const sign = (plane % 2 == 0) ? 1.0f : -1.0f;
+    float coefficients[4];
+    for (size_t column = 0; column < 4; ++ column) {
+      coefficients[column] = (
+        clipRow(3, column) + sign*clipRow(axis, column)
+      );
+    }
+    float const length = std::sqrt(
+        coefficients[0]*coefficients[0]
+      + coefficients[1]*coefficients[1]
+      + coefficients[2]*coefficients[2]
+    );
+    float const invLength = length > 0.0f ? 1.0f/length : 0.0f;
+    planes.a[plane] = coefficients[0] * invLength;
+    planes.b[plane] = coefficients[1] * invLength;
+    planes.c[plane] = coefficients[2] * invLength;
+    planes.d[plane] = coefficients[3] * invLength;
+  }
+  return planes;
+}
+
+void frustumCullSpheresResize(
+  FrustumCullSpheres & spheres, size_t const count
+) {
+  size_t const paddedCount = (
+      (count + frustumCullLaneWidth - 1) / frustumCullLaneWidth
+    * frustumCullLaneWidth
+  );
+  spheres.count = count;
+  for (
+    auto * array : { &spheres.centerX, &spheres.centerY, &spheres.centerZ }
+  ) {
+    array->resize(paddedCount);
+    std::fill(array->begin() + count, array->end(), 0.0f);
+  }
+  // padding would need its center FLT_MAX inside every plane to pass
+  spheres.radius.resize(paddedCount);
+  std::fill(spheres.radius.begin() + count, spheres.radius.end(), -FLT_MAX);
+  spheres.visible.resize(paddedCount);
+}
+
+void frustumCull(
+  FrustumPlanes const & planes, FrustumCullSpheres & spheres,
+  FrustumCullKernel const kernel,
+  size_t const begin, size_t const end
+) {
+  switch (kernel) {
+    #if FRUSTUM_CULL_X86
+      case FrustumCullKernel_avx2:
+        cullAvx2(planes, spheres, begin, end);
+      return;
+      case FrustumCullKernel_sse:
+        cullSse(planes, spheres, begin, end);
+      return;
+    #endif
+    default:
+      cullScalar(planes, spheres, begin, end);
+    return;
+  }
+}
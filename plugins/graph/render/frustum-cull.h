@@ -0,0 +1,51 @@
+#pragma once
+
+#include <pulchritude-math/math.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// bounding spheres tested against the camera frustum a lane group at a time.
+//   Spheres are structure-of-arrays and padded to a multiple of
+//   frustumCullLaneWidth, padding lanes come out invisible
+
+size_t constexpr frustumCullLaneWidth = 8;
+
+// normalized planes, inside is a*x + b*y + c*z + d >= 0
+struct FrustumPlanes {
+  float a[6], b[6], c[6], d[6];
+};
+
+struct FrustumCullSpheres {
+  size_t count;
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> radius;
+  std::vector<uint8_t> visible; // 1 if the sphere touches the frustum
+};
+
+enum FrustumCullKernel {
+  FrustumCullKernel_scalar,
+  FrustumCullKernel_sse,
+  FrustumCullKernel_avx2,
+};
+
+// widest kernel the running CPU supports
+FrustumCullKernel frustumCullKernelDetect();
+
+// matrices as handed to the shader, column-major with clip = proj*view
+FrustumPlanes frustumPlanesFromViewProjection(
+  PuleF32m44 const & view, PuleF32m44 const & proj
+);
+
+void frustumCullSpheresResize(
+  FrustumCullSpheres & spheres, size_t const count
+);
+
+// fills visible for spheres [begin, end), both multiples of
+//   frustumCullLaneWidth, so ranges can be split over jobs
+void frustumCull(
+  FrustumPlanes const & planes, FrustumCullSpheres & spheres,
+  FrustumCullKernel const kernel,
+  size_t const begin, size_t const end
+);
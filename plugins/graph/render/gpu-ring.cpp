@@ -0,0 +1,116 @@
+#include "gpu-ring.h"
+
+#include <algorithm>
+
+namespace {
+
+// a frame slot only comes back around after gpuFramesInFlight-1 newer
+//   frames, so this is a backstop rather than something that's hit
+uint64_t constexpr fenceWaitNs = 1'000'000;
+
+GpuRingFrame gpuRingFrameCreate(
+  GpuRing const & ring, PuleEngineLayer & pul, size_t const capacity
+) {
+  size_t const byteLength = ring.stride * capacity;
+  PuleGfxGpuBuffer const buffer = pul.gfxGpuBufferCreate(
+    nullptr, byteLength, ring.usage,
+    PuleGfxGpuBufferVisibilityFlag_hostWritable
+  );
+  void * const mapped = pul.gfxGpuBufferMap({
+    .buffer = buffer,
+    .access = PuleGfxGpuBufferMapAccess_hostWritable,
+    .byteOffset = 0,
+    .byteLength = byteLength,
+  });
+  PULE_assert(mapped);
+  return GpuRingFrame {
+    .buffer = buffer, .mapped = mapped, .capacity = capacity,
+  };
+}
+
+void gpuRingFrameDestroy(GpuRingFrame & frame, PuleEngineLayer & pul) {
+  if (frame.buffer.id == 0) { return; }
+  pul.gfxGpuBufferUnmap(frame.buffer);
+  pul.gfxGpuBufferDestroy(frame.buffer);
+  frame = GpuRingFrame { .buffer = { 0 }, .mapped = nullptr, .capacity = 0, };
+}
+
+} // namespace
+
+// -- fences -------------------------------------------------------------------
+
+void gpuFrameFencesCreate(GpuFrameFences & fences) {
+  for (auto & fence : fences.fences) {
+    fence = PuleGfxFence { 0 };
+  }
+  fences.frame = 0;
+}
+
+void gpuFrameFencesDestroy(GpuFrameFences & fences, PuleEngineLayer & pul) {
+  for (auto & fence : fences.fences) {
+    if (fence.id == 0) { continue; }
+    while (!pul.gfxFenceCheckSignal(fence, PuleNanosecond { fenceWaitNs })) {}
+    pul.gfxFenceDestroy(fence);
+    fence = PuleGfxFence { 0 };
+  }
+}
+
+size_t gpuFrameFencesAdvance(GpuFrameFences & fences, PuleEngineLayer & pul) {
+  fences.frame = (fences.frame + 1) % gpuFramesInFlight;
+  PuleGfxFence & fence = fences.fences[fences.frame];
+  // no fence yet means the slot hasn't been submitted, or the submission
+  //   didn't produce one; either way nothing can be reading it
+  if (fence.id != 0) {
+    while (!pul.gfxFenceCheckSignal(fence, PuleNanosecond { fenceWaitNs })) {}
+    pul.gfxFenceDestroy(fence);
+    fence = PuleGfxFence { 0 };
+  }
+  return fences.frame;
+}
+
+// -- ring ---------------------------------------------------------------------
+
+void gpuRingCreate(
+  GpuRing & ring, PuleEngineLayer & pul,
+  PuleGfxGpuBufferUsage const usage, size_t const stride,
+  size_t const capacity
+) {
+  ring.usage = usage;
+  ring.stride = stride;
+  for (auto & frame : ring.frames) {
+    frame = gpuRingFrameCreate(ring, pul, std::max<size_t>(1, capacity));
+  }
+}
+
+void gpuRingDestroy(GpuRing & ring, PuleEngineLayer & pul) {
+  for (auto & frame : ring.frames) {
+    gpuRingFrameDestroy(frame, pul);
+  }
+}
+
+void * gpuRingMap(
+  GpuRing & ring, PuleEngineLayer & pul, size_t const frame,
+  size_t const count
+) {
+  GpuRingFrame & slot = ring.frames[frame];
+  if (count > slot.capacity) {
+    // the fence for this slot already passed, so only this slot is replaced;
+    //   the others grow when their turn comes instead of stalling on them
+    size_t const capacity = std::max(count, slot.capacity*2);
+    gpuRingFrameDestroy(slot, pul);
+    slot = gpuRingFrameCreate(ring, pul, capacity);
+  }
+  return slot.mapped;
+}
+
+void gpuRingFlush(
+  GpuRing & ring, PuleEngineLayer & pul, size_t const frame,
+  size_t const count
+) {
+  if (count == 0) { return; }
+  pul.gfxGpuBufferMappedFlush({
+    .buffer = ring.frames[frame].buffer,
+    .byteOffset = 0,
+    .byteLength = ring.stride * count,
+  });
+}
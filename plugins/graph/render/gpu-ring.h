@@ -0,0 +1,72 @@
+#pragma once
+
+#include <pulchritude-plugin/engine.h>
+
+#include <cstddef>
+
+// per-frame GPU data is written into one of gpuFramesInFlight persistently
+//   mapped buffers, so the CPU fills the next frame while the GPU still reads
+//   the last ones. Everything goes through the engine layer, which can be
+//   filled with stubs to exercise the bookkeeping without a GPU
+
+size_t constexpr gpuFramesInFlight = 3;
+
+// one fence per frame slot, signalled once the GPU is done with everything
+//   submitted in that slot
+struct GpuFrameFences {
+  PuleGfxFence fences[gpuFramesInFlight];
+  size_t frame;
+};
+
+void gpuFrameFencesCreate(GpuFrameFences & fences);
+// waits for the GPU to finish every slot still in flight, after which their
+//   buffers can be destroyed
+void gpuFrameFencesDestroy(GpuFrameFences & fences, PuleEngineLayer & pul);
+
+// moves to the next frame slot and waits until the GPU released it; returns
+//   the slot to write this frame's ring buffers at
+size_t gpuFrameFencesAdvance(GpuFrameFences & fences, PuleEngineLayer & pul);
+
+// handed to the submission reading this frame's buffers as its finish fence
+inline PuleGfxFence * gpuFrameFencesTarget(GpuFrameFences & fences) {
+  return &fences.fences[fences.frame];
+}
+
+struct GpuRingFrame {
+  PuleGfxGpuBuffer buffer;
+  void * mapped;
+  size_t capacity; // elements
+};
+
+struct GpuRing {
+  PuleGfxGpuBufferUsage usage;
+  size_t stride;
+  GpuRingFrame frames[gpuFramesInFlight];
+};
+
+void gpuRingCreate(
+  GpuRing & ring, PuleEngineLayer & pul,
+  PuleGfxGpuBufferUsage const usage, size_t const stride,
+  size_t const capacity
+);
+void gpuRingDestroy(GpuRing & ring, PuleEngineLayer & pul);
+
+// mapped storage for count elements in a slot gpuFrameFencesAdvance released;
+//   a slot too small is replaced with one at least twice its size, which
+//   also changes gpuRingBuffer for that slot
+void * gpuRingMap(
+  GpuRing & ring, PuleEngineLayer & pul, size_t const frame,
+  size_t const count
+);
+
+// flushes the first count elements written this frame
+void gpuRingFlush(
+  GpuRing & ring, PuleEngineLayer & pul, size_t const frame,
+  size_t const count
+);
+
+inline PuleGfxGpuBuffer gpuRingBuffer(
+  GpuRing const & ring, size_t const frame
+) {
+  return ring.frames[frame].buffer;
+}
@@ -0,0 +1,56 @@
+#include "mesh-registry.h"
+
+#include <algorithm>
+#include <cmath>
+
+uint32_t meshRegistryAdd(
+  MeshRegistry & registry, std::string const & label,
+  MeshVertex const * const vertices, size_t const vertexCount
+) {
+  float radiusSqr = 0.0f;
+  for (size_t it = 0; it < vertexCount; ++ it) {
+    PuleF32v3 const origin = vertices[it].origin;
+    radiusSqr = std::max(
+      radiusSqr, origin.x*origin.x + origin.y*origin.y + origin.z*origin.z
+    );
+  }
+  registry.meshes.emplace_back(
+    MeshRegistryEntry {
+      .label = label,
+      .vertexOffset = static_cast<uint32_t>(registry.vertices.size()),
+      .vertexCount = static_cast<uint32_t>(vertexCount),
+      .radius = std::sqrt(radiusSqr),
+    }
+  );
+  registry.vertices.insert(
+    registry.vertices.end(), vertices, vertices + vertexCount
+  );
+  return static_cast<uint32_t>(registry.meshes.size()-1);
+}
+
+uint32_t meshRegistryFind(
+  MeshRegistry const & registry, std::string const & label
+) {
+  for (size_t it = 0; it < registry.meshes.size(); ++ it) {
+    if (registry.meshes[it].label == label) {
+      return static_cast<uint32_t>(it);
+    }
+  }
+  return meshTypeInvalid;
+}
+
+void meshRegistryUpload(MeshRegistry & registry, PuleEngineLayer & pul) {
+  meshRegistryDestroy(registry, pul);
+  registry.buffer = pul.gfxGpuBufferCreate(
+    registry.vertices.data(),
+    sizeof(MeshVertex) * registry.vertices.size(),
+    PuleGfxGpuBufferUsage_bufferAttribute,
+    PuleGfxGpuBufferVisibilityFlag_deviceOnly
+  );
+}
+
+void meshRegistryDestroy(MeshRegistry & registry, PuleEngineLayer & pul) {
+  if (registry.buffer.id == 0) { return; }
+  pul.gfxGpuBufferDestroy(registry.buffer);
+  registry.buffer = PuleGfxGpuBuffer { 0 };
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <pulchritude-plugin/engine.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// every unit-type mesh lives once in a single merged vertex buffer; a unit's
+//   type picks its range, and instances of one type are drawn together
+
+struct MeshVertex {
+  PuleF32v3 origin;
+};
+
+struct MeshRegistryEntry {
+  std::string label;
+  uint32_t vertexOffset;
+  uint32_t vertexCount;
+  float radius; // bounding sphere around the mesh origin
+};
+
+struct MeshRegistry {
+  std::vector<MeshVertex> vertices;
+  std::vector<MeshRegistryEntry> meshes;
+  PuleGfxGpuBuffer buffer; // 0 until uploaded
+};
+
+// returns the mesh's type id, its index in meshes
+uint32_t meshRegistryAdd(
+  MeshRegistry & registry, std::string const & label,
+  MeshVertex const * const vertices, size_t const vertexCount
+);
+
+// type id for label, or meshTypeInvalid
+uint32_t meshRegistryFind(
+  MeshRegistry const & registry, std::string const & label
+);
+uint32_t constexpr meshTypeInvalid = UINT32_MAX;
+
+// (re)creates the merged vertex buffer; pipelines binding the previous one
+//   have to be updated by the caller
+void meshRegistryUpload(MeshRegistry & registry, PuleEngineLayer & pul);
+void meshRegistryDestroy(MeshRegistry & registry, PuleEngineLayer & pul);
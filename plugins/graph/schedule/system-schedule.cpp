@@ -0,0 +1,124 @@
+#include "system-schedule.h"
+
+#include "../jobs/job-system.h"
+
+#include <algorithm>
+
+namespace {
+
+size_t scheduleInternComponent(
+  SystemSchedule & schedule, std::string const & component
+) {
+  auto const found = (
+    std::find(schedule.components.begin(), schedule.components.end(), component)
+  );
+  if (found != schedule.components.end()) {
+    return static_cast<size_t>(found - schedule.components.begin());
+  }
+  schedule.components.emplace_back(component);
+  return schedule.components.size()-1;
+}
+
+bool scheduleContains(std::vector<size_t> const & ids, size_t const id) {
+  return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+bool scheduleConflicts(
+  SystemScheduleNode const & a, SystemScheduleNode const & b
+) {
+  for (size_t const component : a.writes) {
+    if (scheduleContains(b.reads, component)) { return true; }
+    if (scheduleContains(b.writes, component)) { return true; }
+  }
+  for (size_t const component : a.reads) {
+    if (scheduleContains(b.writes, component)) { return true; }
+  }
+  return false;
+}
+
+} // namespace
+
+void systemScheduleClear(SystemSchedule & schedule) {
+  schedule.components.clear();
+  schedule.nodes.clear();
+  schedule.waveNodes.clear();
+  schedule.waveStarts.clear();
+}
+
+size_t systemScheduleAdd(
+  SystemSchedule & schedule, std::string const & label,
+  void (* const run)(void * userdata), void * const userdata
+) {
+  schedule.nodes.emplace_back(
+    SystemScheduleNode {
+      .label = label,
+      .reads = {}, .writes = {},
+      .wave = 0,
+      .run = run, .userdata = userdata,
+    }
+  );
+  return schedule.nodes.size()-1;
+}
+
+void systemScheduleAccess(
+  SystemSchedule & schedule, size_t const node,
+  std::string const & component, SystemAccess const access
+) {
+  size_t const id = scheduleInternComponent(schedule, component);
+  auto & ids = (
+    access == SystemAccess_write
+    ? schedule.nodes[node].writes : schedule.nodes[node].reads
+  );
+  if (!scheduleContains(ids, id)) { ids.emplace_back(id); }
+}
+
+void systemScheduleBuild(SystemSchedule & schedule) {
+  size_t waveCount = 0;
+  for (size_t it = 0; it < schedule.nodes.size(); ++ it) {
+    SystemScheduleNode & node = schedule.nodes[it];
+    node.wave = 0;
+    for (size_t prior = 0; prior < it; ++ prior) {
+      SystemScheduleNode const & priorNode = schedule.nodes[prior];
+      if (!scheduleConflicts(node, priorNode)) { continue; }
+      node.wave = std::max(node.wave, priorNode.wave + 1);
+    }
+    waveCount = std::max(waveCount, node.wave + 1);
+  }
+
+  // counting sort by wave, declaration order within a wave
+  schedule.waveStarts.assign(waveCount + 1, 0);
+  for (auto const & node : schedule.nodes) {
+    schedule.waveStarts[node.wave + 1] += 1;
+  }
+  for (size_t it = 1; it < schedule.waveStarts.size(); ++ it) {
+    schedule.waveStarts[it] += schedule.waveStarts[it-1];
+  }
+  schedule.waveNodes.resize(schedule.nodes.size());
+  std::vector<size_t> cursors(
+    schedule.waveStarts.begin(), schedule.waveStarts.end()-1
+  );
+  for (size_t it = 0; it < schedule.nodes.size(); ++ it) {
+    schedule.waveNodes[cursors[schedule.nodes[it].wave] ++] = it;
+  }
+}
+
+void systemScheduleRun(
+  SystemSchedule const & schedule, JobPool & jobs,
+  [[maybe_unused]] PulcProfiler const * const profiler
+) {
+  for (size_t wave = 0; wave+1 < schedule.waveStarts.size(); ++ wave) {
+    size_t const begin = schedule.waveStarts[wave];
+    size_t const end = schedule.waveStarts[wave+1];
+    auto const runNodes = [&](size_t const nodeBegin, size_t const nodeEnd) {
+      for (size_t it = nodeBegin; it < nodeEnd; ++ it) {
+        SystemScheduleNode const & node = (
+          schedule.nodes[schedule.waveNodes[begin + it]]
+        );
+        PULC_PROFILE_ZONE(profiler, node.label.c_str());
+        node.run(node.userdata);
+      }
+    };
+    // one system per job; systems split their own work further
+    jobParallelFor(jobs, end - begin, 1, runNodes);
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../profile/profiler.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct JobPool;
+
+// orders ECS systems from their declared per-component access; two systems
+//   conflict when either writes a component the other touches. Conflicting
+//   systems keep their declaration order, everything else is free to run at
+//   the same time
+
+enum SystemAccess {
+  SystemAccess_read,
+  SystemAccess_write,
+};
+
+struct SystemScheduleNode {
+  std::string label;
+  std::vector<size_t> reads, writes; // interned component ids
+  size_t wave;
+  void (* run)(void * userdata);
+  void * userdata;
+};
+
+// nodes are grouped into waves, a node's wave is one past the latest wave it
+//   depends on; a wave runs in parallel and is joined before the next.
+//   waveNodes lists node indices wave by wave, waveStarts has one offset per
+//   wave plus the total
+struct SystemSchedule {
+  std::vector<std::string> components;
+  std::vector<SystemScheduleNode> nodes;
+  std::vector<size_t> waveNodes;
+  std::vector<size_t> waveStarts;
+};
+
+void systemScheduleClear(SystemSchedule & schedule);
+
+// returns the node index; nodes must be added in declaration order
+size_t systemScheduleAdd(
+  SystemSchedule & schedule, std::string const & label,
+  void (* const run)(void * userdata), void * const userdata
+);
+void systemScheduleAccess(
+  SystemSchedule & schedule, size_t const node,
+  std::string const & component, SystemAccess const access
+);
+
+// builds dependencies and waves after every node and access was added
+void systemScheduleBuild(SystemSchedule & schedule);
+
+// every system runs inside a profiler zone labelled after it; profiler may
+//   be null
+void systemScheduleRun(
+  SystemSchedule const & schedule, JobPool & jobs,
+  PulcProfiler const * const profiler
+);
@@ -0,0 +1,865 @@
+#include "simulation.h"
+
+#include <pulchritude-plugin/engine.h>
+
+#include "../influence/influence-map.h"
+#include "../jobs/job-system.h"
+#include "../movement/avoidance.h"
+#include "../movement/steering.h"
+#include "../pathfinding/flow-field.h"
+#include "../pathfinding/grid.h"
+#include "../pathfinding/hierarchy.h"
+#include "../spatial/unit-grid.h"
+#include "../visibility/fog-of-war.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// cells through the path hierarchy towards a slot's goal
+struct SimulationRoute {
+  uint32_t order; // of the slot it was found for
+  uint64_t revision; // SimulationUnits::routesRevision it was found at
+  int64_t goalCell;
+  std::vector<size_t> cells; // start to goal, empty if unreachable
+  size_t next; // cell being headed for
+};
+
+struct SimulationUnits {
+  uint64_t tick;
+
+  PulcTerrainHeightfield heightfield;
+  // copy of the tile table, the samples stay with the terrain plugin
+  std::vector<PulcTerrainHeightfieldTile> tiles;
+  PulcTerrainCostMap costMap; // view of the terrain plugin's
+  PulcTerrainSampler const * terrainSampler;
+  PulcTerrainRaycaster const * terrainRaycaster;
+  std::vector<SimulationIntent> intents; // latest orders, one per live unit
+
+  // per slot
+  std::vector<PuleF32v2> position, velocity, goal;
+  std::vector<float> speed;
+  std::vector<float> height;
+  std::vector<uint8_t> hasGoal;
+  std::vector<uint32_t> order;
+  std::vector<uint8_t> seen;
+  std::vector<uint32_t> target;
+
+  // per live unit, in intent order
+  std::vector<PuleF32v2> livePositions;
+  std::vector<float> liveHeights;
+  std::vector<uint8_t> liveTeams;
+  // targetCandidateCount per unit, 1 + live index nearest first, 0 unused
+  std::vector<uint32_t> targetCandidates;
+  // sight lines of every candidate, in candidate order
+  std::vector<PuleF32v3> sightFrom, sightTo;
+  std::vector<uint8_t> sightVisible;
+
+  PathGrid pathGrid;
+  FlowFieldCache flowFields;
+  PathHierarchy pathHierarchy;
+  // per slot, of units whose goal too few share for a flow field
+  std::vector<SimulationRoute> routes;
+  uint64_t routesRevision; // bumped whenever the path grid changes
+  std::vector<int64_t> goalCells; // scratch, sorted
+  UnitGrid unitGrid;
+  SteeringBatch steering;
+  SteeringKernel steeringKernel;
+  AvoidanceBatch avoidance;
+  AvoidanceMode avoidanceMode;
+  FogOfWar fog;
+  InfluenceMaps influence;
+};
+
+namespace {
+
+float constexpr unitGridCellDim = 2.0f;
+float constexpr steeringSeparationRadius = 1.0f;
+float constexpr steeringSeparationStrength = 2.0f;
+float constexpr steeringResponsiveness = 8.0f; // per second
+float constexpr steeringArrivalRadius = 0.25f;
+// a flow field costs the whole map, so a goal fewer units are ordered to is
+//   routed through the path hierarchy for each of them instead
+size_t constexpr flowFieldUnitsMin = 8;
+// a unit pushed this many cells off its route finds a new one
+int64_t constexpr routeStrayCells = 2;
+// units per job; separation dominates and is a few hundred ns per unit
+size_t constexpr movementGrain = 256;
+// enemies in vision whose sight lines are traced, nearest first
+size_t constexpr targetCandidateCount = 4;
+// a unit looks for a target every this many ticks, slots spread over them
+uint32_t constexpr targetUpdateTicks = 4;
+// segments per job, a trace is a few dozen pyramid nodes
+size_t constexpr lineOfSightGrain = 64;
+// after falling this many ticks behind, drop them instead of catching up
+int64_t constexpr simulationMaxLagTicks = 5;
+
+int64_t steadyNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+}
+
+// -- orders -------------------------------------------------------------------
+
+void simulationReceive(Simulation & simulation) {
+  PULC_PROFILE_ZONE(simulation.profiler, "simulationReceive");
+  SimulationUnits & units = *simulation.units;
+  {
+    std::lock_guard<std::mutex> lock(simulation.mailbox);
+    if (simulation.intentsPosted) {
+      std::swap(units.intents, simulation.intentsMailbox);
+      simulation.intentsPosted = false;
+    }
+    if (simulation.terrainPosted) {
+      std::swap(units.tiles, simulation.terrainTilesMailbox);
+      units.heightfield = simulation.terrainMailbox;
+      units.heightfield.tiles = units.tiles.data();
+      units.costMap = simulation.terrainCostMapMailbox;
+      simulation.terrainPosted = false;
+    }
+    units.terrainSampler = simulation.terrainSamplerMailbox;
+    units.terrainRaycaster = simulation.terrainRaycasterMailbox;
+  }
+
+  units.livePositions.resize(units.intents.size());
+  for (size_t it = 0; it < units.intents.size(); ++ it) {
+    SimulationIntent const & intent = units.intents[it];
+    if (intent.slot >= units.seen.size()) {
+      size_t const slotCount = intent.slot + 1;
+      units.position.resize(slotCount);
+      units.velocity.resize(slotCount);
+      units.goal.resize(slotCount);
+      units.speed.resize(slotCount);
+      units.height.resize(slotCount);
+      units.hasGoal.resize(slotCount);
+      units.order.resize(slotCount);
+      units.seen.resize(slotCount);
+      units.target.resize(slotCount);
+      units.routes.resize(slotCount);
+    }
+    // the bridge keeps sending an order until it sees it finished, so only
+    //   a new one may set the goal again
+    if (!units.seen[intent.slot] || units.order[intent.slot] != intent.order) {
+      units.goal[intent.slot] = intent.goal;
+      units.hasGoal[intent.slot] = intent.hasGoal;
+      units.order[intent.slot] = intent.order;
+    }
+    if (!units.seen[intent.slot]) {
+      units.seen[intent.slot] = true;
+      units.position[intent.slot] = intent.position;
+      units.velocity[intent.slot] = PuleF32v2 { 0.0f, 0.0f };
+    }
+    units.speed[intent.slot] = intent.speed;
+    units.livePositions[it] = units.position[intent.slot];
+  }
+}
+
+// -- movement -----------------------------------------------------------------
+
+// direction to follow along the slot's route, found again when its order,
+//   goal or the grid changed or the unit strayed from it; false if the goal
+//   can't be reached
+bool simulationRouteDirection(
+  SimulationUnits & units, uint32_t const slot,
+  int64_t const cell, int64_t const goalCell, PuleF32v2 & direction
+) {
+  PathGrid const & pathGrid = units.pathGrid;
+  SimulationRoute & route = units.routes[slot];
+  auto const stray = [&]() {
+    if (route.cells.empty()) { return false; }
+    int64_t const next = route.cells[route.next];
+    int64_t const w = pathGrid.width;
+    return (
+         std::abs(next % w - cell % w) > routeStrayCells
+      || std::abs(next / w - cell / w) > routeStrayCells
+    );
+  };
+  if (
+       route.order != units.order[slot]
+    || route.revision != units.routesRevision
+    || route.goalCell != goalCell
+    || stray()
+  ) {
+    route.order = units.order[slot];
+    route.revision = units.routesRevision;
+    route.goalCell = goalCell;
+    route.next = 1;
+    bool const found = pathHierarchyFind(
+      units.pathHierarchy, pathGrid, cell, goalCell, route.cells
+    );
+    if (!found || route.cells.size() < 2) { route.cells.clear(); }
+  }
+  if (route.cells.empty()) { return false; }
+
+  // cells reached, also ones a unit was pushed along to
+  size_t const lookahead = std::min(route.next + 4, route.cells.size());
+  for (size_t it = route.next; it < lookahead; ++ it) {
+    if (static_cast<int64_t>(route.cells[it]) == cell) {
+      route.next = std::min(it + 1, route.cells.size() - 1);
+    }
+  }
+  PuleF32v2 const target = (
+    pathGridCellCenter(pathGrid, route.cells[route.next])
+  );
+  PuleF32v2 const position = units.position[slot];
+  float const dx = target.x - position.x;
+  float const dy = target.y - position.y;
+  float const distance = std::sqrt(dx*dx + dy*dy);
+  direction = (
+      distance > 0.0f
+    ? PuleF32v2 { dx/distance, dy/distance }
+    : PuleF32v2 { 0.0f, 0.0f }
+  );
+  return true;
+}
+
+void simulationMove(Simulation & simulation) {
+  PULC_PROFILE_ZONE(simulation.profiler, "simulationMove");
+  SimulationUnits & units = *simulation.units;
+  if (!units.heightfield.tiles || !units.costMap.costs) { return; }
+
+  if (pathGridSync(units.pathGrid, units.heightfield, units.costMap)) {
+    PathGrid const & pathGrid = units.pathGrid;
+    flowFieldCacheInvalidate(units.flowFields);
+    pathHierarchySync(units.pathHierarchy, pathGrid);
+    ++ units.routesRevision;
+    auto const origin = PuleF32v2 {
+      pathGrid.origin.x - pathGrid.spacing.x*0.5f,
+      pathGrid.origin.y - pathGrid.spacing.y*0.5f,
+    };
+    auto const extent = PuleF32v2 {
+      pathGrid.width * pathGrid.spacing.x,
+      pathGrid.height * pathGrid.spacing.y,
+    };
+    unitGridConfigure(units.unitGrid, origin, extent, unitGridCellDim);
+    influenceMapsConfigure(
+      units.influence, origin, extent, influenceCellDimDefault
+    );
+  }
+
+  size_t const liveCount = units.intents.size();
+  unitGridRebuild(
+    units.unitGrid, units.livePositions.data(), sizeof(PuleF32v2), liveCount
+  );
+
+  SteeringBatch & steering = units.steering;
+  AvoidanceBatch & avoidance = units.avoidance;
+  steeringBatchResize(steering, liveCount);
+  avoidanceBatchResize(avoidance, liveCount);
+  auto const gather = [&](size_t const begin, size_t const end) {
+    for (size_t it = begin; it < end; ++ it) {
+      uint32_t const slot = units.intents[it].slot;
+      steering.positionX[it] = units.position[slot].x;
+      steering.positionY[it] = units.position[slot].y;
+      steering.velocityX[it] = units.velocity[slot].x;
+      steering.velocityY[it] = units.velocity[slot].y;
+      steering.desiredX[it] = 0.0f;
+      steering.desiredY[it] = 0.0f;
+      steering.maxSpeed[it] = units.speed[slot];
+      avoidance.positionX[it] = units.position[slot].x;
+      avoidance.positionY[it] = units.position[slot].y;
+      avoidance.velocityX[it] = units.velocity[slot].x;
+      avoidance.velocityY[it] = units.velocity[slot].y;
+      avoidance.maxSpeed[it] = units.speed[slot];
+    }
+  };
+  jobParallelFor(*simulation.jobs, liveCount, movementGrain, gather);
+
+  // stays on this thread, fetching a field can evict from the shared cache.
+  //   Units ordered together tend to be adjacent, so remember the last field
+  PathGrid const & pathGrid = units.pathGrid;
+  units.goalCells.clear();
+  for (size_t it = 0; it < liveCount; ++ it) {
+    uint32_t const slot = units.intents[it].slot;
+    if (!units.hasGoal[slot]) { continue; }
+    units.goalCells.emplace_back(pathGridCell(pathGrid, units.goal[slot]));
+  }
+  std::sort(units.goalCells.begin(), units.goalCells.end());
+  int64_t lastGoalCell = pathCellInvalid;
+  bool lastGoalShared = false;
+  FlowField const * field = nullptr;
+
+  for (size_t it = 0; it < liveCount; ++ it) {
+    uint32_t const slot = units.intents[it].slot;
+    if (!units.hasGoal[slot]) { continue; }
+    PuleF32v2 const position = units.position[slot];
+    PuleF32v2 const goal = units.goal[slot];
+
+    int64_t const goalCell = pathGridCell(pathGrid, goal);
+    int64_t const cell = pathGridCell(pathGrid, position);
+    // goals in another region are dropped without integrating a field
+    if (
+         goalCell == pathCellInvalid || cell == pathCellInvalid
+      || !pathGridConnected(pathGrid, cell, goalCell)
+    ) {
+      units.hasGoal[slot] = false;
+      continue;
+    }
+
+    PuleF32v2 direction;
+    if (cell == goalCell) {
+      // final approach, head for the exact goal point
+      float const dx = goal.x - position.x;
+      float const dy = goal.y - position.y;
+      float const distance = std::sqrt(dx*dx + dy*dy);
+      if (distance <= steeringArrivalRadius) {
+        units.hasGoal[slot] = false;
+        continue;
+      }
+      direction = PuleF32v2 { dx/distance, dy/distance };
+    } else {
+      if (goalCell != lastGoalCell) {
+        auto const [first, last] = std::equal_range(
+          units.goalCells.begin(), units.goalCells.end(), goalCell
+        );
+        lastGoalShared = (
+          static_cast<size_t>(last - first) >= flowFieldUnitsMin
+        );
+        field = (
+            lastGoalShared
+          ? &flowFieldCacheFetch(units.flowFields, pathGrid, goalCell)
+          : nullptr
+        );
+        lastGoalCell = goalCell;
+      }
+      bool const reachable = (
+          lastGoalShared
+        ? field->integration[cell] != flowIntegrationUnreachable
+        : simulationRouteDirection(units, slot, cell, goalCell, direction)
+      );
+      if (!reachable) {
+        units.hasGoal[slot] = false;
+        continue;
+      }
+      if (lastGoalShared) { direction = flowFieldDirection(*field, cell); }
+    }
+
+    steering.desiredX[it] = direction.x * units.speed[slot];
+    steering.desiredY[it] = direction.y * units.speed[slot];
+  }
+
+  // each job takes whole lanes; separation and avoidance only read other
+  //   units through the grid and the start of tick state, so a range can be
+  //   integrated as soon as it's steered
+  size_t const laneCount = (
+    (liveCount + steeringLaneWidth - 1) / steeringLaneWidth
+  );
+  units.liveHeights.resize(liveCount);
+  auto const steer = [&](size_t const laneBegin, size_t const laneEnd) {
+    size_t const begin = laneBegin*steeringLaneWidth;
+    size_t const end = std::min(laneEnd*steeringLaneWidth, liveCount);
+    steeringSeparation(
+      steering, units.unitGrid,
+      steeringSeparationRadius, steeringSeparationStrength,
+      units.steeringKernel, begin, end
+    );
+    steeringIntegrate(
+      steering, simulationTimestep, steeringResponsiveness,
+      units.steeringKernel, begin, end
+    );
+    // steering's velocity is only preferred, avoidance has the last word and
+    //   the position is integrated again from where the tick started
+    for (size_t it = begin; it < end; ++ it) {
+      avoidance.preferredX[it] = steering.velocityX[it];
+      avoidance.preferredY[it] = steering.velocityY[it];
+    }
+    avoidanceSolve(
+      avoidance, units.unitGrid, simulationTimestep, units.avoidanceMode,
+      begin, end
+    );
+    for (size_t it = begin; it < end; ++ it) {
+      steering.velocityX[it] = avoidance.resultX[it];
+      steering.velocityY[it] = avoidance.resultY[it];
+      steering.positionX[it] = (
+        avoidance.positionX[it] + avoidance.resultX[it]*simulationTimestep
+      );
+      steering.positionY[it] = (
+        avoidance.positionY[it] + avoidance.resultY[it]*simulationTimestep
+      );
+    }
+    // settled positions onto the ground, while they're still in cache
+    if (units.terrainSampler && begin < end) {
+      units.terrainSampler->sample(
+        &units.heightfield,
+        &steering.positionX[begin], &steering.positionY[begin], end - begin,
+        &units.liveHeights[begin], nullptr, nullptr, nullptr
+      );
+    }
+    for (size_t it = begin; it < end; ++ it) {
+      uint32_t const slot = units.intents[it].slot;
+      units.position[slot].x = steering.positionX[it];
+      units.position[slot].y = steering.positionY[it];
+      units.velocity[slot].x = steering.velocityX[it];
+      units.velocity[slot].y = steering.velocityY[it];
+      if (units.terrainSampler) {
+        units.height[slot] = units.liveHeights[it];
+      }
+    }
+  };
+  jobParallelFor(
+    *simulation.jobs, laneCount, movementGrain/steeringLaneWidth, steer
+  );
+}
+
+// -- visibility ---------------------------------------------------------------
+
+void simulationSee(Simulation & simulation) {
+  PULC_PROFILE_ZONE(simulation.profiler, "simulationSee");
+  SimulationUnits & units = *simulation.units;
+  if (!units.heightfield.tiles) { return; }
+  fogOfWarSync(units.fog, units.heightfield);
+  for (SimulationIntent const & intent : units.intents) {
+    fogOfWarUnit(
+      units.fog, intent.slot, units.tick, intent.team, intent.visionRadius,
+      units.position[intent.slot]
+    );
+  }
+  fogOfWarUpdate(units.fog, *simulation.jobs, units.tick);
+}
+
+// -- targets ------------------------------------------------------------------
+
+// nearest enemy in sight of the units due this tick. Candidates come off the
+//   grid of the tick's start positions, their sight lines run eye to target
+//   between the settled positions and are traced through the terrain in one
+//   batch
+void simulationTarget(Simulation & simulation) {
+  PULC_PROFILE_ZONE(simulation.profiler, "simulationTarget");
+  SimulationUnits & units = *simulation.units;
+  size_t const liveCount = units.intents.size();
+  if (units.steering.count != liveCount) { return; }
+  UnitGrid const & grid = units.unitGrid;
+  auto const due = [&](size_t const it) {
+    return units.intents[it].slot % targetUpdateTicks
+        == units.tick % targetUpdateTicks;
+  };
+
+  units.targetCandidates.assign(liveCount*targetCandidateCount, 0);
+  auto const gather = [&](size_t const begin, size_t const end) {
+    for (size_t it = begin; it < end; ++ it) {
+      if (!due(it)) { continue; }
+      SimulationIntent const & intent = units.intents[it];
+      float const radius = (
+        intent.visionRadius > 0.0f ? intent.visionRadius
+                                   : fogVisionRadiusDefault
+      );
+      PuleF32v2 const center = units.livePositions[it];
+      uint32_t * const candidates = (
+        &units.targetCandidates[it*targetCandidateCount]
+      );
+      float distances[targetCandidateCount];
+      size_t found = 0;
+      auto const run = [&](uint32_t const runBegin, uint32_t const runEnd) {
+        for (uint32_t sorted = runBegin; sorted < runEnd; ++ sorted) {
+          uint32_t const other = grid.unitIndices[sorted];
+          if (units.intents[other].team == intent.team) { continue; }
+          float const dx = grid.positionsX[sorted] - center.x;
+          float const dy = grid.positionsY[sorted] - center.y;
+          float const distance = dx*dx + dy*dy;
+          if (distance > radius*radius) { continue; }
+          // insertion into the few nearest so far
+          if (
+               found == targetCandidateCount
+            && distance >= distances[targetCandidateCount - 1]
+          ) {
+            continue;
+          }
+          size_t at = std::min(found, targetCandidateCount - 1);
+          for (; at > 0 && distances[at - 1] > distance; -- at) {
+            distances[at] = distances[at - 1];
+            candidates[at] = candidates[at - 1];
+          }
+          distances[at] = distance;
+          candidates[at] = other + 1;
+          found = std::min(found + 1, targetCandidateCount);
+        }
+      };
+      unitGridForEachRun(grid, center, radius, run);
+    }
+  };
+  jobParallelFor(*simulation.jobs, liveCount, movementGrain, gather);
+
+  units.sightFrom.clear();
+  units.sightTo.clear();
+  for (size_t it = 0; it < liveCount; ++ it) {
+    uint32_t const slot = units.intents[it].slot;
+    uint32_t const * const candidates = (
+      &units.targetCandidates[it*targetCandidateCount]
+    );
+    for (size_t c = 0; c < targetCandidateCount; ++ c) {
+      uint32_t const candidate = candidates[c];
+      if (!candidate) { break; }
+      uint32_t const other = units.intents[candidate - 1].slot;
+      units.sightFrom.emplace_back(PuleF32v3 {
+        units.position[slot].x, units.height[slot] + fogEyeHeight,
+        units.position[slot].y,
+      });
+      units.sightTo.emplace_back(PuleF32v3 {
+        units.position[other].x, units.height[other] + fogTargetHeight,
+        units.position[other].y,
+      });
+    }
+  }
+
+  size_t const segmentCount = units.sightFrom.size();
+  units.sightVisible.resize(segmentCount);
+  PulcTerrainRaycaster const * const raycaster = units.terrainRaycaster;
+  if (raycaster) {
+    auto const trace = [&](size_t const begin, size_t const end) {
+      raycaster->lineOfSight(
+        &units.sightFrom[begin], &units.sightTo[begin], end - begin,
+        &units.sightVisible[begin]
+      );
+    };
+    jobParallelFor(*simulation.jobs, segmentCount, lineOfSightGrain, trace);
+  } else {
+    std::fill(
+      units.sightVisible.begin(), units.sightVisible.end(), uint8_t(1)
+    );
+  }
+
+  size_t segment = 0;
+  for (size_t it = 0; it < liveCount; ++ it) {
+    if (!due(it)) { continue; }
+    uint32_t target = 0;
+    uint32_t const * const candidates = (
+      &units.targetCandidates[it*targetCandidateCount]
+    );
+    for (size_t c = 0; c < targetCandidateCount; ++ c) {
+      uint32_t const candidate = candidates[c];
+      if (!candidate) { break; }
+      if (!target && units.sightVisible[segment]) {
+        target = units.intents[candidate - 1].slot + 1;
+      }
+      ++ segment;
+    }
+    units.target[units.intents[it].slot] = target;
+  }
+}
+
+// -- influence ----------------------------------------------------------------
+
+// a band of each update per tick, from this tick's settled positions
+void simulationInfluence(Simulation & simulation) {
+  PULC_PROFILE_ZONE(simulation.profiler, "simulationInfluence");
+  SimulationUnits & units = *simulation.units;
+  size_t const liveCount = units.intents.size();
+  if (units.steering.count != liveCount) { return; }
+  units.liveTeams.resize(liveCount);
+  for (size_t it = 0; it < liveCount; ++ it) {
+    units.liveTeams[it] = units.intents[it].team;
+  }
+  influenceMapsStep(
+    units.influence, *simulation.jobs,
+    units.steering.positionX.data(), units.steering.positionY.data(),
+    units.liveTeams.data(), liveCount
+  );
+}
+
+// -- snapshots ----------------------------------------------------------------
+
+void simulationPublish(Simulation & simulation) {
+  PULC_PROFILE_ZONE(simulation.profiler, "simulationPublish");
+  SimulationUnits const & units = *simulation.units;
+  SimulationSnapshot & snapshot = (
+    simulation.snapshots[simulation.snapshotWriting]
+  );
+  size_t const slotCount = units.position.size();
+  snapshot.tick = units.tick;
+  snapshot.positionX.resize(slotCount);
+  snapshot.positionY.resize(slotCount);
+  snapshot.velocityX.resize(slotCount);
+  snapshot.velocityY.resize(slotCount);
+  snapshot.height.assign(units.height.begin(), units.height.end());
+  for (size_t slot = 0; slot < slotCount; ++ slot) {
+    snapshot.positionX[slot] = units.position[slot].x;
+    snapshot.positionY[slot] = units.position[slot].y;
+    snapshot.velocityX[slot] = units.velocity[slot].x;
+    snapshot.velocityY[slot] = units.velocity[slot].y;
+  }
+  snapshot.goal.assign(units.goal.begin(), units.goal.end());
+  snapshot.hasGoal.assign(units.hasGoal.begin(), units.hasGoal.end());
+  snapshot.order.assign(units.order.begin(), units.order.end());
+  snapshot.target.assign(units.target.begin(), units.target.end());
+  if (snapshot.fogRevision != units.fog.revision) {
+    snapshot.fogRevision = units.fog.revision;
+    snapshot.fogWidth = units.fog.width;
+    snapshot.fogHeight = units.fog.height;
+    snapshot.fogOrigin = units.fog.origin;
+    snapshot.fogTeams = units.fog.teamsUsed;
+    snapshot.fogTexels.assign(
+      units.fog.texels.begin(), units.fog.texels.end()
+    );
+  }
+  influenceMapsCopyFinished(snapshot.influence, units.influence);
+  snapshot.publishedNs = steadyNs();
+
+  simulation.snapshotWriting = (
+      simulation.snapshotReady.exchange(
+        simulation.snapshotWriting | simulationSnapshotFresh,
+        std::memory_order_acq_rel
+      )
+    & ~simulationSnapshotFresh
+  );
+}
+
+void simulationLoop(Simulation * const simulationPtr) {
+  Simulation & simulation = *simulationPtr;
+  int64_t const periodNs = static_cast<int64_t>(1e9f / simulationTickRate);
+  int64_t next = steadyNs();
+  while (simulation.running.load(std::memory_order_acquire)) {
+    simulationReceive(simulation);
+    simulationMove(simulation);
+    simulationSee(simulation);
+    simulationTarget(simulation);
+    simulationInfluence(simulation);
+    ++ simulation.units->tick;
+    simulationPublish(simulation);
+
+    next += periodNs;
+    int64_t const now = steadyNs();
+    if (now - next > periodNs*simulationMaxLagTicks) { next = now; }
+    std::this_thread::sleep_for(std::chrono::nanoseconds(next - now));
+  }
+}
+
+} // namespace
+
+void simulationStart(
+  Simulation & simulation, JobPool & jobs,
+  PulcProfiler const * const profiler, SimulationSettings const & settings
+) {
+  simulation.jobs = &jobs;
+  simulation.profiler = profiler;
+  simulation.units = new SimulationUnits {};
+  simulation.units->flowFields = flowFieldCacheCreate(16);
+  simulation.units->pathHierarchy = pathHierarchyCreate(16);
+  simulation.units->steeringKernel = (
+      settings.determinism == SimulationDeterminism_lockstep
+    ? SteeringKernel_scalar : steeringKernelDetect()
+  );
+  simulation.units->avoidanceMode = (
+      settings.determinism == SimulationDeterminism_none
+    ? AvoidanceMode_fast : AvoidanceMode_deterministic
+  );
+  simulation.units->influence.kernel = influenceKernelDetect();
+
+  simulation.intentsPosted = false;
+  simulation.terrainPosted = false;
+  simulation.terrainSamplerMailbox = nullptr;
+  simulation.terrainRaycasterMailbox = nullptr;
+  simulation.terrainRevisionPosted = 0;
+  simulation.slotCount = 0;
+
+  simulation.snapshotWriting = 0;
+  simulation.snapshotReady.store(1);
+  simulation.snapshotCurrent = 2;
+  simulation.snapshotPrevious = 3;
+  simulation.snapshotAlpha = 1.0f;
+
+  simulation.running.store(true);
+  simulation.thread = std::thread(simulationLoop, &simulation);
+}
+
+void simulationStop(Simulation & simulation) {
+  if (!simulation.thread.joinable()) { return; }
+  simulation.running.store(false, std::memory_order_release);
+  simulation.thread.join();
+  delete simulation.units;
+  simulation.units = nullptr;
+}
+
+uint32_t simulationSlotAcquire(Simulation & simulation) {
+  // not recycled, there's no hook yet for a destroyed entity to give its
+  //   slot back
+  return simulation.slotCount ++;
+}
+
+void simulationPost(
+  Simulation & simulation, PulcTerrainHeightfield const & heightfield,
+  PulcTerrainCostMap const * const costMap,
+  PulcTerrainSampler const * const sampler,
+  PulcTerrainRaycaster const * const raycaster
+) {
+  bool const terrainChanged = (
+       heightfield.tiles && costMap
+    && heightfield.revision != simulation.terrainRevisionPosted
+  );
+  // tile samples are never written once published, so copying the table is
+  //   enough to keep reading this revision while the terrain moves on
+  if (terrainChanged) {
+    simulation.terrainTiles.assign(
+      heightfield.tiles,
+      heightfield.tiles + heightfield.tilesX*heightfield.tilesY
+    );
+  }
+
+  // the simulation only holds the lock to swap buffers; if it has it right
+  //   now just try again next frame rather than wait
+  std::unique_lock<std::mutex> lock(simulation.mailbox, std::try_to_lock);
+  if (!lock.owns_lock()) { return; }
+  std::swap(simulation.intents, simulation.intentsMailbox);
+  simulation.intentsPosted = true;
+  simulation.terrainSamplerMailbox = sampler;
+  simulation.terrainRaycasterMailbox = raycaster;
+  if (terrainChanged) {
+    simulation.terrainMailbox = heightfield;
+    simulation.terrainCostMapMailbox = *costMap;
+    std::swap(simulation.terrainTiles, simulation.terrainTilesMailbox);
+    simulation.terrainPosted = true;
+    simulation.terrainRevisionPosted = heightfield.revision;
+  }
+}
+
+void simulationRefresh(Simulation & simulation) {
+  uint32_t const ready = (
+    simulation.snapshotReady.load(std::memory_order_acquire)
+  );
+  if (ready & simulationSnapshotFresh) {
+    // only the simulation can have published in between, which leaves a
+    //   fresh snapshot all the same
+    uint32_t const taken = simulation.snapshotReady.exchange(
+      simulation.snapshotPrevious, std::memory_order_acq_rel
+    );
+    simulation.snapshotPrevious = simulation.snapshotCurrent;
+    simulation.snapshotCurrent = taken & ~simulationSnapshotFresh;
+  }
+
+  // rendering runs a tick behind so there is always a snapshot to move to
+  SimulationSnapshot const & current = simulationCurrent(simulation);
+  float const elapsed = (steadyNs() - current.publishedNs) * 1e-9f;
+  simulation.snapshotAlpha = (
+    std::clamp(elapsed / simulationTimestep, 0.0f, 1.0f)
+  );
+}
+
+bool simulationPosition(
+  Simulation const & simulation, uint32_t const slot, PuleF32v2 & position
+) {
+  SimulationSnapshot const & current = simulationCurrent(simulation);
+  SimulationSnapshot const & previous = simulationPrevious(simulation);
+  if (slot >= current.positionX.size()) { return false; }
+  position = PuleF32v2 { current.positionX[slot], current.positionY[slot] };
+  if (slot >= previous.positionX.size()) { return true; }
+  float const alpha = simulation.snapshotAlpha;
+  position.x = (
+    previous.positionX[slot] + (position.x - previous.positionX[slot])*alpha
+  );
+  position.y = (
+    previous.positionY[slot] + (position.y - previous.positionY[slot])*alpha
+  );
+  return true;
+}
+
+bool simulationHeight(
+  Simulation const & simulation, uint32_t const slot, float & height
+) {
+  SimulationSnapshot const & current = simulationCurrent(simulation);
+  SimulationSnapshot const & previous = simulationPrevious(simulation);
+  if (slot >= current.height.size()) { return false; }
+  height = current.height[slot];
+  if (slot >= previous.height.size()) { return true; }
+  float const alpha = simulation.snapshotAlpha;
+  height = previous.height[slot] + (height - previous.height[slot])*alpha;
+  return true;
+}
+
+uint8_t const * simulationFogTexels(
+  Simulation const & simulation, uint8_t const team,
+  size_t & width, size_t & height, PuleF32v2 & origin
+) {
+  SimulationSnapshot const & current = simulationCurrent(simulation);
+  if (team >= current.fogTeams) { return nullptr; }
+  width = current.fogWidth;
+  height = current.fogHeight;
+  origin = current.fogOrigin;
+  return current.fogTexels.data() + team*width*height;
+}
+
+// -- shared interfaces --------------------------------------------------------
+
+namespace {
+
+void simulationInfluenceGrid(
+  void * const simulationPtr, size_t * const width, size_t * const height,
+  size_t * const stride, PuleF32v2 * const origin, float * const cellDim
+) {
+  InfluenceMaps const & maps = simulationCurrent(
+    *reinterpret_cast<Simulation *>(simulationPtr)
+  ).influence;
+  *width = maps.width;
+  *height = maps.height;
+  *stride = maps.stride;
+  *origin = maps.origin;
+  *cellDim = maps.cellDim;
+}
+
+uint64_t simulationInfluenceRevision(void * const simulationPtr) {
+  return simulationCurrent(
+    *reinterpret_cast<Simulation *>(simulationPtr)
+  ).influence.revision;
+}
+
+void simulationInfluenceCombine(
+  void * const simulationPtr, float const * const weights, float * const out
+) {
+  Simulation & simulation = *reinterpret_cast<Simulation *>(simulationPtr);
+  InfluenceMaps const & maps = simulationCurrent(simulation).influence;
+  float layerWeights[influenceLayerCount];
+  std::copy(weights, weights + influenceLayerCount, layerWeights);
+  influenceMapsCombine(maps, layerWeights, simulation.influenceCombined);
+  std::copy(
+    simulation.influenceCombined.begin(), simulation.influenceCombined.end(),
+    out
+  );
+}
+
+float simulationInfluenceAt(
+  void * const simulationPtr, float const * const weights,
+  PuleF32v2 const position
+) {
+  InfluenceMaps const & maps = simulationCurrent(
+    *reinterpret_cast<Simulation *>(simulationPtr)
+  ).influence;
+  float value = 0.0f;
+  for (uint32_t layer = 0; layer < maps.layersUsed; ++ layer) {
+    if (weights[layer] == 0.0f) { continue; }
+    value += (
+      weights[layer]*influenceMapsAt(maps, maps.layers[layer].current, position)
+    );
+  }
+  return value;
+}
+
+uint8_t const * simulationFogInterfaceTexels(
+  void * const simulationPtr, uint8_t const team,
+  size_t * const width, size_t * const height,
+  PuleF32v2 * const origin, float * const cellDim, uint64_t * const revision
+) {
+  Simulation const & simulation = (
+    *reinterpret_cast<Simulation *>(simulationPtr)
+  );
+  *cellDim = fogCellDim;
+  *revision = simulationCurrent(simulation).fogRevision;
+  return simulationFogTexels(simulation, team, *width, *height, *origin);
+}
+
+} // namespace
+
+PulcInfluenceMaps simulationInfluenceInterface(Simulation & simulation) {
+  return PulcInfluenceMaps {
+    .simulation = &simulation,
+    .grid = simulationInfluenceGrid,
+    .revision = simulationInfluenceRevision,
+    .combine = simulationInfluenceCombine,
+    .at = simulationInfluenceAt,
+  };
+}
+
+PulcFogOfWar simulationFogInterface(Simulation & simulation) {
+  return PulcFogOfWar {
+    .simulation = &simulation,
+    .texels = simulationFogInterfaceTexels,
+  };
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <pulchritude-math/math.h>
+
+#include "../../terrain/terrain.h"
+#include "../influence/influence-map.h"
+#include "../profile/profiler.h"
+#include "../visibility/fog-of-war.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobPool;
+
+// unit movement runs on its own thread at a fixed rate, independent of the
+//   frame rate. The main thread hands it orders through a mailbox, and it
+//   hands back snapshots of unit state which the main thread interpolates.
+//   Units are addressed by slot, which map-movement assigns and keeps in the
+//   node-unit component
+
+float constexpr simulationTickRate = 20.0f;
+float constexpr simulationTimestep = 1.0f/simulationTickRate;
+
+struct SimulationIntent {
+  uint32_t slot;
+  PuleF32v2 position; // only used the first time a slot shows up
+  PuleF32v2 goal;
+  float speed;
+  bool hasGoal;
+  uint32_t order; // goal and hasGoal are only taken when it changes
+  uint8_t team;
+  float visionRadius; // 0 for the default
+};
+
+// unit state after a tick, indexed by slot; slots that haven't been seen yet
+//   are zero
+struct SimulationSnapshot {
+  uint64_t tick;
+  int64_t publishedNs; // steady clock
+  std::vector<float> positionX, positionY;
+  std::vector<float> velocityX, velocityY;
+  std::vector<float> height; // ground under the position
+  std::vector<PuleF32v2> goal;
+  std::vector<uint8_t> hasGoal;
+  std::vector<uint32_t> order; // that goal and hasGoal belong to
+  // 1 + slot of the nearest enemy in sight within vision, 0 for none
+  std::vector<uint32_t> target;
+  // R8 fog of war, a fogWidth*fogHeight layer per team below fogTeams;
+  //   only copied over when it changed since the snapshot last held it
+  uint64_t fogRevision;
+  size_t fogWidth, fogHeight;
+  PuleF32v2 fogOrigin; // world XZ of cell (0, 0)'s corner
+  uint32_t fogTeams;
+  std::vector<uint8_t> fogTexels;
+  // last finished influence update, only the layers' current values; also
+  //   only copied over when it changed
+  InfluenceMaps influence;
+};
+
+// how closely movement has to repeat between runs of the same build, the
+//   "determinism" setting of the graph plugin in puldata/ecs.pds
+enum SimulationDeterminism {
+  // "none", fast avoidance and the widest steering kernel the CPU has
+  SimulationDeterminism_none,
+  // "replay", avoidance independent of the job split, so the same on any
+  //   thread count of the machine that recorded it
+  SimulationDeterminism_replay,
+  // "lockstep", also scalar steering, the wide kernels round differently;
+  //   the same on every machine
+  SimulationDeterminism_lockstep,
+};
+
+struct SimulationSettings {
+  SimulationDeterminism determinism;
+};
+
+// four snapshots rotate between the simulation (writing one), the hand-off
+//   slot, and the main thread (holding the previous and current one to
+//   interpolate between), so neither side ever waits on the other
+uint32_t constexpr simulationSnapshotCount = 4;
+uint32_t constexpr simulationSnapshotFresh = 0x80000000u;
+
+struct SimulationUnits; // simulation thread state, simulation.cpp
+
+struct Simulation {
+  std::thread thread;
+  std::atomic<bool> running;
+  JobPool * jobs;
+  PulcProfiler const * profiler; // may be null
+
+  // main thread -> simulation, swapped under the lock so it's held only for
+  //   a couple of pointer exchanges
+  std::mutex mailbox;
+  std::vector<SimulationIntent> intentsMailbox;
+  bool intentsPosted;
+  PulcTerrainHeightfield terrainMailbox;
+  std::vector<PulcTerrainHeightfieldTile> terrainTilesMailbox;
+  PulcTerrainCostMap terrainCostMapMailbox;
+  bool terrainPosted;
+  PulcTerrainSampler const * terrainSamplerMailbox;
+  PulcTerrainRaycaster const * terrainRaycasterMailbox;
+
+  // main thread side of the mailbox
+  std::vector<SimulationIntent> intents;
+  std::vector<PulcTerrainHeightfieldTile> terrainTiles;
+  uint64_t terrainRevisionPosted;
+  uint32_t slotCount;
+
+  // simulation -> main thread
+  SimulationSnapshot snapshots[simulationSnapshotCount];
+  uint32_t snapshotWriting; // simulation thread only
+  std::atomic<uint32_t> snapshotReady; // index, | fresh when not yet taken
+  uint32_t snapshotCurrent, snapshotPrevious; // main thread only
+  float snapshotAlpha; // main thread only, previous -> current
+  std::vector<float> influenceCombined; // main thread scratch
+
+  SimulationUnits * units;
+};
+
+void simulationStart(
+  Simulation & simulation, JobPool & jobs,
+  PulcProfiler const * const profiler, SimulationSettings const & settings
+);
+void simulationStop(Simulation & simulation);
+
+// -- main thread --------------------------------------------------------------
+
+uint32_t simulationSlotAcquire(Simulation & simulation);
+
+// intents are collected into simulation.intents and posted together; the
+//   heightfield and its cost map are only handed over when the revision
+//   changed. Without a cost map units don't move, without a sampler they
+//   stay at height zero, without a raycaster every enemy in vision is in
+//   line of sight
+void simulationPost(
+  Simulation & simulation, PulcTerrainHeightfield const & heightfield,
+  PulcTerrainCostMap const * const costMap,
+  PulcTerrainSampler const * const sampler,
+  PulcTerrainRaycaster const * const raycaster
+);
+
+// takes the newest snapshot if there is one and updates the interpolation
+//   factor; call once per frame before reading snapshots
+void simulationRefresh(Simulation & simulation);
+
+inline SimulationSnapshot const & simulationCurrent(
+  Simulation const & simulation
+) {
+  return simulation.snapshots[simulation.snapshotCurrent];
+}
+
+inline SimulationSnapshot const & simulationPrevious(
+  Simulation const & simulation
+) {
+  return simulation.snapshots[simulation.snapshotPrevious];
+}
+
+// interpolated position of a slot, false if no snapshot has it yet
+bool simulationPosition(
+  Simulation const & simulation, uint32_t const slot, PuleF32v2 & position
+);
+
+// interpolated ground height under a slot, false if no snapshot has it yet
+bool simulationHeight(
+  Simulation const & simulation, uint32_t const slot, float & height
+);
+
+// "pulc-influence-maps" over the current snapshot
+PulcInfluenceMaps simulationInfluenceInterface(Simulation & simulation);
+
+// a team's fog of war layer from the current snapshot, ready to upload as an
+//   R8 texture, see fogTexel*; nullptr until the team has had a unit
+uint8_t const * simulationFogTexels(
+  Simulation const & simulation, uint8_t const team,
+  size_t & width, size_t & height, PuleF32v2 & origin
+);
+
+// "pulc-fog-of-war" over the current snapshot
+PulcFogOfWar simulationFogInterface(Simulation & simulation);
@@ -0,0 +1,191 @@
+#include "unit-grid.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+inline float distanceSqr(
+  UnitGrid const & grid, uint32_t const sorted, PuleF32v2 const point
+) {
+  float const dx = grid.positionsX[sorted] - point.x;
+  float const dy = grid.positionsY[sorted] - point.y;
+  return dx*dx + dy*dy;
+}
+
+// non-negative floats order the same as their bit patterns
+inline uint64_t nearestKey(float const distSqr, uint32_t const sorted) {
+  uint32_t bits;
+  std::memcpy(&bits, &distSqr, sizeof(bits));
+  return (static_cast<uint64_t>(bits) << 32) | sorted;
+}
+
+inline float nearestKeyDistanceSqr(uint64_t const key) {
+  uint32_t const bits = static_cast<uint32_t>(key >> 32);
+  float distSqr;
+  std::memcpy(&distSqr, &bits, sizeof(distSqr));
+  return distSqr;
+}
+
+} // namespace
+
+void unitGridConfigure(
+  UnitGrid & grid, PuleF32v2 const origin, PuleF32v2 const extent,
+  float const cellDim
+) {
+  grid.origin = origin;
+  grid.cellDim = cellDim;
+  grid.cellsX = std::max<size_t>(1, static_cast<size_t>(extent.x/cellDim) + 1);
+  grid.cellsY = std::max<size_t>(1, static_cast<size_t>(extent.y/cellDim) + 1);
+  grid.cellStarts.assign(grid.cellsX*grid.cellsY + 1, 0);
+}
+
+void unitGridRebuild(
+  UnitGrid & grid,
+  PuleF32v2 const * const positions, size_t const strideBytes,
+  size_t const count
+) {
+  auto const position = [&](size_t const it) -> PuleF32v2 const & {
+    return *reinterpret_cast<PuleF32v2 const *>(
+      reinterpret_cast<uint8_t const *>(positions) + it*strideBytes
+    );
+  };
+
+  // counting sort, histogram -> exclusive prefix sum -> scatter
+  grid.unitCells.resize(count);
+  grid.unitIndices.resize(count);
+  grid.positionsX.resize(count);
+  grid.positionsY.resize(count);
+  std::fill(grid.cellStarts.begin(), grid.cellStarts.end(), 0);
+  for (size_t it = 0; it < count; ++ it) {
+    PuleF32v2 const & p = position(it);
+    uint32_t const cell = static_cast<uint32_t>(
+      unitGridCellY(grid, p.y)*grid.cellsX + unitGridCellX(grid, p.x)
+    );
+    grid.unitCells[it] = cell;
+    grid.cellStarts[cell+1] += 1;
+  }
+  for (size_t it = 1; it < grid.cellStarts.size(); ++ it) {
+    grid.cellStarts[it] += grid.cellStarts[it-1];
+  }
+  // the last offset is the total, so reuse cellStarts[cell] as the write
+  //   cursor and shift it back afterwards
+  for (size_t it = 0; it < count; ++ it) {
+    uint32_t const slot = grid.cellStarts[grid.unitCells[it]] ++;
+    grid.unitIndices[slot] = static_cast<uint32_t>(it);
+    grid.positionsX[slot] = position(it).x;
+    grid.positionsY[slot] = position(it).y;
+  }
+  for (size_t it = grid.cellStarts.size()-1; it > 0; -- it) {
+    grid.cellStarts[it] = grid.cellStarts[it-1];
+  }
+  grid.cellStarts[0] = 0;
+}
+
+void unitGridQueryRadius(
+  UnitGrid const & grid, PuleF32v2 const center, float const radius,
+  std::vector<uint32_t> & out
+) {
+  out.clear();
+  float const radiusSqr = radius*radius;
+  auto const visitRun = [&](uint32_t const begin, uint32_t const end) {
+    for (uint32_t it = begin; it < end; ++ it) {
+      if (distanceSqr(grid, it, center) <= radiusSqr) {
+        out.emplace_back(grid.unitIndices[it]);
+      }
+    }
+  };
+  unitGridForEachRun(grid, center, radius, visitRun);
+}
+
+void unitGridQueryAabb(
+  UnitGrid const & grid, PuleF32v2 const min, PuleF32v2 const max,
+  std::vector<uint32_t> & out
+) {
+  out.clear();
+  size_t const x0 = unitGridCellX(grid, min.x);
+  size_t const x1 = unitGridCellX(grid, max.x);
+  size_t const y0 = unitGridCellY(grid, min.y);
+  size_t const y1 = unitGridCellY(grid, max.y);
+  for (size_t cy = y0; cy <= y1; ++ cy) {
+    uint32_t const begin = grid.cellStarts[cy*grid.cellsX + x0];
+    uint32_t const end = grid.cellStarts[cy*grid.cellsX + x1 + 1];
+    for (uint32_t it = begin; it < end; ++ it) {
+      float const x = grid.positionsX[it];
+      float const y = grid.positionsY[it];
+      if (x >= min.x && x <= max.x && y >= min.y && y <= max.y) {
+        out.emplace_back(grid.unitIndices[it]);
+      }
+    }
+  }
+}
+
+void unitGridQueryNearest(
+  UnitGrid & grid, PuleF32v2 const center, size_t const k,
+  float const maxRadius, std::vector<uint32_t> & out
+) {
+  out.clear();
+  if (k == 0) { return; }
+  auto & heap = grid.nearest; // max-heap of the k best so far
+  heap.clear();
+  float const maxRadiusSqr = maxRadius*maxRadius;
+
+  int64_t const cx = static_cast<int64_t>(unitGridCellX(grid, center.x));
+  int64_t const cy = static_cast<int64_t>(unitGridCellY(grid, center.y));
+  int64_t const cellsX = static_cast<int64_t>(grid.cellsX);
+  int64_t const cellsY = static_cast<int64_t>(grid.cellsY);
+  int64_t const ringLimit = std::max(
+    std::max(cx, cellsX-1-cx), std::max(cy, cellsY-1-cy)
+  );
+
+  auto const visitCell = [&](int64_t const x, int64_t const y) {
+    if (x < 0 || y < 0 || x >= cellsX || y >= cellsY) { return; }
+    size_t const cell = y*grid.cellsX + x;
+    for (
+      uint32_t it = grid.cellStarts[cell]; it < grid.cellStarts[cell+1]; ++ it
+    ) {
+      float const distSqr = distanceSqr(grid, it, center);
+      if (distSqr > maxRadiusSqr) { continue; }
+      uint64_t const key = nearestKey(distSqr, it);
+      if (heap.size() < k) {
+        heap.emplace_back(key);
+        std::push_heap(heap.begin(), heap.end());
+      } else if (key < heap.front()) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = key;
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+  };
+
+  for (int64_t ring = 0; ring <= ringLimit; ++ ring) {
+    // nothing in this ring can be closer than its inner edge
+    float const ringDistance = (ring-1) * grid.cellDim;
+    if (ring > 1) {
+      if (ringDistance > maxRadius) { break; }
+      if (
+           heap.size() == k
+        && ringDistance*ringDistance > nearestKeyDistanceSqr(heap.front())
+      ) {
+        break;
+      }
+    }
+    if (ring == 0) {
+      visitCell(cx, cy);
+      continue;
+    }
+    for (int64_t x = cx-ring; x <= cx+ring; ++ x) {
+      visitCell(x, cy-ring);
+      visitCell(x, cy+ring);
+    }
+    for (int64_t y = cy-ring+1; y <= cy+ring-1; ++ y) {
+      visitCell(cx-ring, y);
+      visitCell(cx+ring, y);
+    }
+  }
+
+  std::sort_heap(heap.begin(), heap.end());
+  for (uint64_t const key : heap) {
+    out.emplace_back(grid.unitIndices[static_cast<uint32_t>(key)]);
+  }
+}
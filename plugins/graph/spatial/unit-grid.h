@@ -0,0 +1,89 @@
+#pragma once
+
+#include <pulchritude-math/math.h>
+
+#include <cstdint>
+#include <vector>
+
+// uniform grid over node-unit positions, rebuilt from scratch once per tick
+//   with a counting sort so every cell's units sit contiguously; query
+//   results are indices into the position array the grid was built from
+struct UnitGrid {
+  PuleF32v2 origin;
+  float cellDim;
+  size_t cellsX, cellsY;
+
+  std::vector<uint32_t> cellStarts; // cellsX*cellsY + 1 offsets
+  std::vector<uint32_t> unitIndices; // sorted by cell
+  // sorted by cell in the same order as indices, split per axis so kernels
+  //   can stream them
+  std::vector<float> positionsX;
+  std::vector<float> positionsY;
+  std::vector<uint32_t> unitCells; // scratch, cell of each unit
+  std::vector<uint64_t> nearest; // scratch heap for k-nearest
+};
+
+// covers [origin, origin+extent]; units outside are clamped to border cells
+void unitGridConfigure(
+  UnitGrid & grid, PuleF32v2 const origin, PuleF32v2 const extent,
+  float const cellDim
+);
+
+// positions are read with a byte stride so the grid can be built straight
+//   from component arrays
+void unitGridRebuild(
+  UnitGrid & grid,
+  PuleF32v2 const * const positions, size_t const strideBytes,
+  size_t const count
+);
+
+// the query functions replace out
+void unitGridQueryRadius(
+  UnitGrid const & grid, PuleF32v2 const center, float const radius,
+  std::vector<uint32_t> & out
+);
+void unitGridQueryAabb(
+  UnitGrid const & grid, PuleF32v2 const min, PuleF32v2 const max,
+  std::vector<uint32_t> & out
+);
+// up to k units closest to center within maxRadius, nearest first
+void unitGridQueryNearest(
+  UnitGrid & grid, PuleF32v2 const center, size_t const k,
+  float const maxRadius, std::vector<uint32_t> & out
+);
+
+inline size_t unitGridCellCoord(
+  float const v, float const cellDim, size_t const cells
+) {
+  float const f = v / cellDim;
+  if (f <= 0.0f) { return 0; }
+  size_t const c = static_cast<size_t>(f);
+  return c < cells ? c : cells-1;
+}
+
+inline size_t unitGridCellX(UnitGrid const & grid, float const x) {
+  return unitGridCellCoord(x - grid.origin.x, grid.cellDim, grid.cellsX);
+}
+
+inline size_t unitGridCellY(UnitGrid const & grid, float const y) {
+  return unitGridCellCoord(y - grid.origin.y, grid.cellDim, grid.cellsY);
+}
+
+// calls fn(begin, end) with the sorted range of every cell row overlapping
+//   the square of half-size radius around center; a row's cells are
+//   adjacent in the sorted arrays, so each row is a single run
+template <typename Fn>
+void unitGridForEachRun(
+  UnitGrid const & grid, PuleF32v2 const center, float const radius, Fn && fn
+) {
+  size_t const x0 = unitGridCellX(grid, center.x - radius);
+  size_t const x1 = unitGridCellX(grid, center.x + radius);
+  size_t const y0 = unitGridCellY(grid, center.y - radius);
+  size_t const y1 = unitGridCellY(grid, center.y + radius);
+  for (size_t cy = y0; cy <= y1; ++ cy) {
+    fn(
+      grid.cellStarts[cy*grid.cellsX + x0],
+      grid.cellStarts[cy*grid.cellsX + x1 + 1]
+    );
+  }
+}
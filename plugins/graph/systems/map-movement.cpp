@@ -1,11 +1,110 @@
 #include "module.h"
 
 #include <pulchritude-log/log.h>
+#include <pulchritude-math/math.h>
+
+#include "../components/node-unit.h"
+#include "../graph.h"
+#include "../jobs/job-system.h"
+#include "../simulation/simulation.h"
+
+// movement itself runs on the simulation thread; this system is the bridge,
+//   handing the simulation this frame's orders and copying its latest state
+//   back into the components
+
+namespace { // -----------------------------------------------------------------
+
+size_t constexpr bridgeGrain = 1024;
+
+// the terrain plugin's tables, valid for as long as it's loaded
+HandlePayload<PulcTerrainHeightfield const> handleHeightfield;
+HandlePayload<PulcTerrainSampler const> handleSampler;
+HandlePayload<PulcTerrainRaycaster const> handleRaycaster;
+HandlePayload<PulcTerrainCostMap const> handleCostMap;
+
+} // namespace -----------------------------------------------------------------
+
+void systemMapMovementInitialize() {
+  HandleRegistry & handles = graphHandles();
+  handleHeightfield = handlePayload<PulcTerrainHeightfield const>(
+    handles, "pulc-terrain-heightfield"
+  );
+  handleSampler = handlePayload<PulcTerrainSampler const>(
+    handles, "pulc-terrain-sampler"
+  );
+  handleRaycaster = handlePayload<PulcTerrainRaycaster const>(
+    handles, "pulc-terrain-raycaster"
+  );
+  handleCostMap = handlePayload<PulcTerrainCostMap const>(
+    handles, "pulc-terrain-costmap"
+  );
+}
 
 extern "C" {
 
 void pulcSystemCallbackMapMovement(PuleEcsIterator const iter) {
-  (void)iter;
+  PuleEngineLayer & pul = *pulcEngineLayer();
+  Simulation & simulation = graphSimulation();
+
+  HandleRegistry const & handles = graphHandles();
+  auto const heightfield = handleFetch(handles, handleHeightfield);
+  if (!heightfield) { return; }
+
+  PulcComponentNodeUnit * nodeUnits = (
+    reinterpret_cast<PulcComponentNodeUnit *>(
+      pul.ecsIteratorQueryComponents(iter, 0, sizeof(PulcComponentNodeUnit))
+    )
+  );
+  size_t const entityCount = pul.ecsIteratorEntityCount(iter);
+
+  simulationRefresh(simulation);
+  SimulationSnapshot const & snapshot = simulationCurrent(simulation);
+
+  for (size_t it = 0; it < entityCount; ++ it) {
+    PulcComponentNodeUnit & unit = nodeUnits[it];
+    if (unit.simulationSlot == 0) {
+      unit.simulationSlot = simulationSlotAcquire(simulation) + 1;
+    }
+  }
+
+  simulation.intents.resize(entityCount);
+  auto const bridge = [&](size_t const begin, size_t const end) {
+    for (size_t it = begin; it < end; ++ it) {
+      PulcComponentNodeUnit & unit = nodeUnits[it];
+      uint32_t const slot = unit.simulationSlot - 1;
+      if (slot < snapshot.positionX.size()) {
+        unit.position.x = snapshot.positionX[slot];
+        unit.position.y = snapshot.positionY[slot];
+        unit.velocity.x = snapshot.velocityX[slot];
+        unit.velocity.y = snapshot.velocityY[slot];
+        unit.target = snapshot.target[slot];
+        // arrived at, or gave up on, the order it was last given; a goal
+        //   repeated since is a new order and still stands
+        if (
+             unit.hasGoal && !snapshot.hasGoal[slot]
+          && snapshot.order[slot] == unit.order
+        ) {
+          unit.hasGoal = false;
+        }
+      }
+      simulation.intents[it] = SimulationIntent {
+        .slot = slot,
+        .position = unit.position,
+        .goal = unit.goal,
+        .speed = unit.speed,
+        .hasGoal = unit.hasGoal,
+        .order = unit.order,
+        .team = unit.team,
+        .visionRadius = unit.visionRadius,
+      };
+    }
+  };
+  jobParallelFor(graphJobPool(), entityCount, bridgeGrain, bridge);
+
+  simulationPost(
+    simulation, *heightfield, handleFetch(handles, handleCostMap),
+    handleFetch(handles, handleSampler), handleFetch(handles, handleRaycaster)
+  );
 }
 
 } // C
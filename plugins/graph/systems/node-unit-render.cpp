@@ -6,49 +6,79 @@
 
 #include "../components/node-unit.h"
 #include "../graph.h"
-
+#include "../jobs/job-system.h"
+#include "../memory/frame-arena.h"
+#include "../render/command-list-cache.h"
+#include "../render/frustum-cull.h"
+#include "../render/gpu-ring.h"
+#include "../render/mesh-registry.h"
+#include "../simulation/simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <vector>
 
 namespace { // -----------------------------------------------------------------
 
-struct EntityAttributeStatic {
-  PuleF32v3 origin;
-  /* PuleF32v2 uv; */
-  /* PuleF32v4 normal; */
-};
-
 struct EntityAttributeDynamic {
   PuleF32m44 transform;
 };
 
+// std140, two column-major matrices need no padding
+struct CameraUniform {
+  PuleF32m44 view;
+  PuleF32m44 projection;
+};
+
 struct Context {
-  PuleGfxCommandList commandList;
   PuleGfxShaderModule shaderModule;
-  PuleGfxGpuBuffer bufferAttributesDynamic;
-  PuleGfxGpuBuffer bufferAttributesStatic;
-  PuleGfxGpuBuffer bufferIndirect;
+  MeshRegistry meshes;
   PuleGfxPipeline pipeline;
 
-  EntityAttributeDynamic * mappedAttributesDynamic;
-  PuleGfxDrawIndirectArrays * mappedDrawIndirect;
-
-  size_t entityCount;
-  size_t entityCapacity;
+  // per-frame data rotates through gpuFramesInFlight buffers, and each frame
+  //   slot has its own command list as the buffers it binds differ; the
+  //   lists hold everything but the data, so a frame only writes buffers
+  GpuFrameFences fences;
+  GpuRing ringCamera;
+  GpuRing ringAttributesDynamic;
+  GpuRing ringIndirect;
+  CommandListCache commandLists[gpuFramesInFlight];
+
+  // units outside the camera are dropped, the rest are grouped by mesh
+  //   type in scratch from the frame arena
+  FrustumCullKernel cullKernel;
+  FrustumCullSpheres cullSpheres; // per entity, center is interpolated
+
+  std::chrono::steady_clock::time_point startTime;
 };
 
 Context ctx;
 
+size_t constexpr initialEntityCapacity = 128;
+// entities per job when interpolating and culling
+size_t constexpr cullGrain = 1024;
+
+HandleTaskGraphNode handleRenderGeometry;
+
 } // namespace -----------------------------------------------------------------
 
 void systemNodeUnitRenderInitialize() {
   PuleEngineLayer & pul = *pulcEngineLayer();
   PuleError err = pul.error();
 
-  ctx.entityCount = 0;
-  ctx.entityCapacity = 128;
+  { // resolved once, the render task graph outlives the plugin
+    HandleRegistry & handles = graphHandles();
+    handleRenderGeometry = handleTaskGraphNode(
+      handles, handlePayloadU64(handles, "pule-render-task-graph"),
+      "render-geometry"
+    );
+  }
 
-  std::vector<EntityAttributeStatic> meshAttributes;
+  ctx.startTime = std::chrono::steady_clock::now();
+  ctx.cullKernel = frustumCullKernelDetect();
 
+  { // register meshes
     float const a = 1.0f / 3.0f;
     float const b = sqrtf(8.0f / 9.0f);
     float const c = sqrtf(2.0f / 9.0f);
@@ -58,75 +88,39 @@ void systemNodeUnitRenderInitialize() {
     auto v1 = PuleF32v3{-c, d, -a};
     auto v2 = PuleF32v3{-c, -d, -a};
     auto v3 = PuleF32v3{b, 0, -a};
-  for (size_t it = 0; it < ctx.entityCapacity; ++ it) {
+    std::vector<MeshVertex> tetrahedron;
     for (auto orig : std::vector<PuleF32v3> {
       v0, v1, v2,
       v0, v2, v3,
       v0, v3, v1,
       v3, v2, v1,
     }) {
-      meshAttributes.emplace_back(
-        EntityAttributeStatic {
-          .origin = orig,
-          /* .uv = PuleF32v2 { 1.0f, 1.0f, }, */
-          /* .normal = PuleF32v4 { 1.0f, 1.0f, 1.0f, 1.0f, }, */
-        }
-      );
+      tetrahedron.emplace_back(MeshVertex { .origin = orig, });
     }
+    meshRegistryAdd(
+      ctx.meshes, "tetrahedron", tetrahedron.data(), tetrahedron.size()
+    );
+    meshRegistryUpload(ctx.meshes, pul);
   }
 
   { // create buffers
-    ctx.bufferAttributesStatic = (
-      pul.gfxGpuBufferCreate(
-        meshAttributes.data(),
-        sizeof(EntityAttributeStatic) * meshAttributes.size(),
-        PuleGfxGpuBufferUsage_bufferAttribute,
-        PuleGfxGpuBufferVisibilityFlag_deviceOnly
-      )
+    gpuRingCreate(
+      ctx.ringCamera, pul,
+      PuleGfxGpuBufferUsage_bufferUniform, sizeof(CameraUniform), 1
     );
-    ctx.bufferAttributesDynamic = (
-      pul.gfxGpuBufferCreate(
-        nullptr,
-        sizeof(EntityAttributeDynamic) * ctx.entityCapacity,
-        PuleGfxGpuBufferUsage_bufferAttribute,
-        PuleGfxGpuBufferVisibilityFlag_hostWritable
-      )
+    gpuRingCreate(
+      ctx.ringAttributesDynamic, pul,
+      PuleGfxGpuBufferUsage_bufferStorage, sizeof(EntityAttributeDynamic),
+      initialEntityCapacity
     );
-    ctx.bufferIndirect = (
-      pul.gfxGpuBufferCreate(
-        nullptr,
-        sizeof(PuleGfxDrawIndirectArrays),
-        PuleGfxGpuBufferUsage_bufferIndirect,
-        PuleGfxGpuBufferVisibilityFlag_hostWritable
-      )
+    gpuRingCreate(
+      ctx.ringIndirect, pul,
+      PuleGfxGpuBufferUsage_bufferIndirect, sizeof(PuleGfxDrawIndirectArrays),
+      ctx.meshes.meshes.size()
     );
+    gpuFrameFencesCreate(ctx.fences);
   }
 
-  ctx.mappedAttributesDynamic = (
-    reinterpret_cast<EntityAttributeDynamic *>(
-      pul.gfxGpuBufferMap({
-        .buffer = ctx.bufferAttributesDynamic,
-        .access = PuleGfxGpuBufferMapAccess_hostWritable,
-        .byteOffset = 0,
-        .byteLength = sizeof(EntityAttributeDynamic) * ctx.entityCapacity,
-      })
-    )
-  );
-
-  ctx.mappedDrawIndirect = (
-    reinterpret_cast<PuleGfxDrawIndirectArrays *>(
-      pul.gfxGpuBufferMap({
-        .buffer = ctx.bufferIndirect,
-        .access = PuleGfxGpuBufferMapAccess_hostWritable,
-        .byteOffset = 0,
-        .byteLength = sizeof(PuleGfxDrawIndirectArrays),
-      })
-    )
-  );
-
-  PULE_assert(ctx.mappedAttributesDynamic);
-  PULE_assert(ctx.mappedDrawIndirect);
-
   #define SHADER(...) \
     pul.cStr( \
     "#version 460 core\n" \
@@ -141,14 +135,22 @@ void systemNodeUnitRenderInitialize() {
         /* in layout(location = 1) vec2 inUv; */
         /* in layout(location = 2) vec4 inNormal; */
 
-        uniform layout(location = 0) mat4 view;
-        uniform layout(location = 1) mat4 projection;
+        layout(std140, binding = 0) uniform Camera {
+          mat4 view;
+          mat4 projection;
+        };
+
+        // grouped by mesh type, each draw's base instance is where its
+        //   type's run starts
+        readonly layout(std430, binding = 0) buffer Instances {
+          mat4 transforms[];
+        };
 
         out layout(location = 0) vec3 outUv;
 
         void main() {
-          vec3 origin = inOrigin + vec3(gl_InstanceID*2.0f, 0.0f, 1.0f);
-          gl_Position = (projection * view) * vec4(origin, 1.0f);
+          mat4 model = transforms[gl_BaseInstance + gl_InstanceID];
+          gl_Position = (projection * view * model) * vec4(inOrigin, 1.0f);
           outUv = vec3(gl_VertexID/3 + 24);
         }
       ),
@@ -169,29 +171,13 @@ void systemNodeUnitRenderInitialize() {
   { // create pipeline
     auto descriptorSetLayout = pul.gfxPipelineDescriptorSetLayout();
     descriptorSetLayout.bufferAttributeBindings[0] = {
-      .buffer = ctx.bufferAttributesStatic,
+      .buffer = ctx.meshes.buffer,
       .numComponents = 3,
       .dataType = PuleGfxAttributeDataType_float,
       .convertFixedDataTypeToNormalizedFloating = false,
-      .stridePerElement = sizeof(EntityAttributeStatic),
-      .offsetIntoBuffer = offsetof(EntityAttributeStatic, origin),
+      .stridePerElement = sizeof(MeshVertex),
+      .offsetIntoBuffer = offsetof(MeshVertex, origin),
     };
-    /* descriptorSetLayout.bufferAttributeBindings[1] = { */
-    /*   .buffer = ctx.bufferAttributesStatic, */
-    /*   .numComponents = 2, */
-    /*   .dataType = PuleGfxAttributeDataType_float, */
-    /*   .convertFixedDataTypeToNormalizedFloating = false, */
-    /*   .stridePerElement = sizeof(EntityAttributeStatic), */
-    /*   .offsetIntoBuffer = offsetof(EntityAttributeStatic, uv), */
-    /* }; */
-    /* descriptorSetLayout.bufferAttributeBindings[2] = { */
-    /*   .buffer = ctx.bufferAttributesStatic, */
-    /*   .numComponents = 4, */
-    /*   .dataType = PuleGfxAttributeDataType_float, */
-    /*   .convertFixedDataTypeToNormalizedFloating = false, */
-    /*   .stridePerElement = sizeof(EntityAttributeStatic), */
-    /*   .offsetIntoBuffer = offsetof(EntityAttributeStatic, normal), */
-    /* }; */
 
     auto pipelineInfo = PuleGfxPipelineCreateInfo {
       .shaderModule = ctx.shaderModule,
@@ -213,31 +199,107 @@ void systemNodeUnitRenderInitialize() {
     }
   }
 
-  // create command list
-  ctx.commandList = (
-    pul.gfxCommandListCreate(
-      pul.allocateDefault(), pul.cStr("node-unit-render")
-    )
+  // command lists are recorded on first use of each frame slot
+  for (CommandListCache & commandList : ctx.commandLists) {
+    commandListCacheCreate(commandList, pul, "node-unit-render");
+  }
+}
+
+void systemNodeUnitRenderShutdown() {
+  PuleEngineLayer & pul = *pulcEngineLayer();
+  gpuFrameFencesDestroy(ctx.fences, pul);
+  for (CommandListCache & commandList : ctx.commandLists) {
+    commandListCacheDestroy(commandList, pul);
+  }
+  gpuRingDestroy(ctx.ringCamera, pul);
+  gpuRingDestroy(ctx.ringAttributesDynamic, pul);
+  gpuRingDestroy(ctx.ringIndirect, pul);
+  // initialize returns early if the shaders or pipeline failed
+  if (ctx.pipeline.id) { pul.gfxPipelineDestroy(ctx.pipeline); }
+  if (ctx.shaderModule.id) { pul.gfxShaderModuleDestroy(ctx.shaderModule); }
+  meshRegistryDestroy(ctx.meshes, pul);
+  ctx = Context {};
+}
+
+namespace {
+
+// binds the pipeline and the slot's buffers and draws every mesh type from
+//   its indirect buffer; only needs redoing when growing a ring replaced one
+void recordFrameCommandList(PuleEngineLayer & pul, size_t const frame) {
+  PuleGfxGpuBuffer const instances = (
+    gpuRingBuffer(ctx.ringAttributesDynamic, frame)
   );
-  {
-    auto commandListRecorder = pul.gfxCommandListRecorder(ctx.commandList);
+  PuleGfxGpuBuffer const indirect = gpuRingBuffer(ctx.ringIndirect, frame);
+  PuleGfxGpuBuffer const camera = gpuRingBuffer(ctx.ringCamera, frame);
+  CommandListCache & commandList = ctx.commandLists[frame];
+  if (
+    !commandListCacheStale(
+      commandList, { ctx.pipeline.id, instances.id, indirect.id, camera.id, }
+    )
+  ) {
+    return;
+  }
 
+  auto const recorder = pul.gfxCommandListRecorder(commandList.commandList);
+  pul.gfxCommandListRecorderReset(recorder);
+  pul.gfxCommandListAppendAction(
+    recorder,
+    PuleGfxCommand {
+      .bindPipeline = {
+        .action = PuleGfxAction_bindPipeline,
+        .pipeline = ctx.pipeline,
+      },
+    }
+  );
+  pul.gfxCommandListAppendAction(
+    recorder,
+    PuleGfxCommand {
+      .bindBuffer = {
+        .action = PuleGfxAction_bindBuffer,
+        .usage = PuleGfxGpuBufferUsage_bufferUniform,
+        .bindingIndex = 0,
+        .buffer = camera,
+        .offset = 0,
+        .byteLen = sizeof(CameraUniform),
+      },
+    }
+  );
+  pul.gfxCommandListAppendAction(
+    recorder,
+    PuleGfxCommand {
+      .bindBuffer = {
+        .action = PuleGfxAction_bindBuffer,
+        .usage = PuleGfxGpuBufferUsage_bufferStorage,
+        .bindingIndex = 0,
+        .buffer = instances,
+        .offset = 0,
+        .byteLen = (
+            ctx.ringAttributesDynamic.frames[frame].capacity
+          * sizeof(EntityAttributeDynamic)
+        ),
+      },
+    }
+  );
+  // one record per mesh type in the indirect buffer; types without visible
+  //   units have zero instances, so the list stays valid frame to frame
+  for (size_t type = 0; type < ctx.meshes.meshes.size(); ++ type) {
     pul.gfxCommandListAppendAction(
-      commandListRecorder,
+      recorder,
       PuleGfxCommand {
         .dispatchRenderIndirect = {
           .action = PuleGfxAction_dispatchRenderIndirect,
           .drawPrimitive = PuleGfxDrawPrimitive_triangle,
-          .bufferIndirect = ctx.bufferIndirect,
-          .byteOffset = 0,
+          .bufferIndirect = indirect,
+          .byteOffset = type * sizeof(PuleGfxDrawIndirectArrays),
         },
       }
     );
-
-    pul.gfxCommandListRecorderFinish(commandListRecorder);
   }
+  pul.gfxCommandListRecorderFinish(recorder);
 }
 
+} // namespace
+
 extern "C" {
 
 void pulcSystemCallbackNodeUnitRender(
@@ -251,109 +313,146 @@ void pulcSystemCallbackNodeUnitRender(
     )
   );
 
-  PuleGfxDrawIndirectArrays indirectCommand = {
-    .vertexCount = 12, .instanceCount = 2,
-    .vertexOffset = 0, .instanceOffset = 0,
+  size_t const entityCount = pul.ecsIteratorEntityCount(iter);
+  size_t const meshCount = ctx.meshes.meshes.size();
+  auto const meshType = [&](PulcComponentNodeUnit const & unit) {
+    return unit.meshType < meshCount ? unit.meshType : 0u;
   };
 
-  size_t const entityCount = pul.ecsIteratorEntityCount(iter);
+  // wall-clock, so the camera keeps its pace whatever the frame rate
+  float const time = std::chrono::duration<float>(
+    std::chrono::steady_clock::now() - ctx.startTime
+  ).count();
+  PuleF32m44 const view = (
+    puleViewLookAt(
+      PuleF32v3{sinf(time)*3.0f, 1.0f + 0.5f*cosf(time*0.5f), cosf(time)*3.0f},
+      puleF32v3(0.0),
+      PuleF32v3{0.0f, 1.0f, 0.0f}
+    )
+  );
+  PuleF32m44 const proj = (
+    puleProjectionPerspective(90.0f, 1.0f, 0.001f, 1000.0f)
+  );
+
+  // units are drawn between the last two simulation ticks, map-movement
+  //   already took the newest snapshot this frame
+  Simulation const & simulation = graphSimulation();
+  FrustumPlanes const planes = frustumPlanesFromViewProjection(view, proj);
+  FrustumCullSpheres & spheres = ctx.cullSpheres;
+  frustumCullSpheresResize(spheres, entityCount);
+  auto const cull = [&](size_t const laneBegin, size_t const laneEnd) {
+    size_t const begin = laneBegin*frustumCullLaneWidth;
+    size_t const end = laneEnd*frustumCullLaneWidth;
+    for (size_t it = begin; it < std::min(end, entityCount); ++ it) {
+      PulcComponentNodeUnit const & unit = nodeUnits[it];
+      PuleF32v2 position = unit.position;
+      float height = 0.0f;
+      if (unit.simulationSlot != 0) {
+        simulationPosition(simulation, unit.simulationSlot - 1, position);
+        simulationHeight(simulation, unit.simulationSlot - 1, height);
+      }
+      spheres.centerX[it] = position.x;
+      spheres.centerY[it] = height;
+      spheres.centerZ[it] = position.y;
+      spheres.radius[it] = ctx.meshes.meshes[meshType(unit)].radius;
+    }
+    frustumCull(planes, spheres, ctx.cullKernel, begin, end);
+  };
+  size_t const laneCount = (
+    (entityCount + frustumCullLaneWidth - 1) / frustumCullLaneWidth
+  );
+  jobParallelFor(
+    graphJobPool(), laneCount, cullGrain/frustumCullLaneWidth, cull
+  );
+
+  // counting sort of the survivors by mesh type, so each type's instances
+  //   are contiguous; unknown types fall back to the first mesh
+  PulcFrameArena const & arena = graphFrameArena();
+  // mesh count + 1, then per visible entity
+  uint32_t * const typeStarts = (
+    frameArenaAllocate<uint32_t>(arena, meshCount + 1)
+  );
+  uint32_t * const instanceSlots = (
+    frameArenaAllocate<uint32_t>(arena, entityCount)
+  );
+  std::fill_n(typeStarts, meshCount + 1, 0);
+  for (size_t it = 0; it < entityCount; ++ it) {
+    typeStarts[meshType(nodeUnits[it]) + 1] += spheres.visible[it];
+  }
+  for (size_t type = 1; type <= meshCount; ++ type) {
+    typeStarts[type] += typeStarts[type-1];
+  }
+  size_t const instanceCount = typeStarts[meshCount];
+  auto * const draws = (
+    frameArenaAllocate<PuleGfxDrawIndirectArrays>(arena, meshCount)
+  );
+  for (size_t type = 0; type < meshCount; ++ type) {
+    MeshRegistryEntry const & mesh = ctx.meshes.meshes[type];
+    draws[type] = PuleGfxDrawIndirectArrays {
+      .vertexCount = mesh.vertexCount,
+      .instanceCount = typeStarts[type+1] - typeStarts[type],
+      .vertexOffset = mesh.vertexOffset,
+      .instanceOffset = typeStarts[type],
+    };
+  }
   for (size_t it = 0; it < entityCount; ++ it) {
-    [[maybe_unused]] PulcComponentNodeUnit & unit = nodeUnits[it];
-    indirectCommand.instanceCount += 2;
-    ctx.mappedAttributesDynamic[it].transform = pul.f32m44(1.0f);
+    if (!spheres.visible[it]) { continue; }
+    instanceSlots[it] = typeStarts[meshType(nodeUnits[it])] ++;
   }
 
-  memcpy(
-    ctx.mappedDrawIndirect,
-    &indirectCommand,
-    sizeof(PuleGfxDrawIndirectArrays)
+  size_t const frame = gpuFrameFencesAdvance(ctx.fences, pul);
+  auto * const instances = reinterpret_cast<EntityAttributeDynamic *>(
+    gpuRingMap(ctx.ringAttributesDynamic, pul, frame, instanceCount)
   );
-  pul.gfxGpuBufferMappedFlush({
-    .buffer = ctx.bufferIndirect,
-    .byteOffset = 0, .byteLength = sizeof(PuleGfxDrawIndirectArrays)
-  });
-  pul.gfxGpuBufferMappedFlush({
-    .buffer = ctx.bufferAttributesDynamic,
-    .byteOffset = 0,
-    .byteLength = sizeof(EntityAttributeDynamic) * ctx.entityCount,
-  });
-
-  auto const taskGraph = PuleTaskGraph {
-    .id = pul.pluginPayloadFetchU64(
-      pulcPluginPayload(),
-      pul.cStr("pule-render-task-graph")
-    ),
+  auto const writeInstances = [&](size_t const begin, size_t const end) {
+    for (size_t it = begin; it < end; ++ it) {
+      if (!spheres.visible[it]) { continue; }
+      PuleF32m44 transform = pul.f32m44(1.0f);
+      transform.elem[12] = spheres.centerX[it];
+      transform.elem[13] = spheres.centerY[it];
+      transform.elem[14] = spheres.centerZ[it];
+      instances[instanceSlots[it]].transform = transform;
+    }
   };
-  PuleTaskGraphNode const renderGeometryNode = (
-    pul.taskGraphNodeFetch(taskGraph, pul.cStr("render-geometry"))
+  jobParallelFor(graphJobPool(), entityCount, cullGrain, writeInstances);
+  gpuRingFlush(ctx.ringAttributesDynamic, pul, frame, instanceCount);
+
+  memcpy(
+    gpuRingMap(ctx.ringIndirect, pul, frame, meshCount),
+    draws,
+    sizeof(PuleGfxDrawIndirectArrays) * meshCount
   );
+  gpuRingFlush(ctx.ringIndirect, pul, frame, meshCount);
 
+  *reinterpret_cast<CameraUniform *>(
+    gpuRingMap(ctx.ringCamera, pul, frame, 1)
+  ) = CameraUniform { .view = view, .projection = proj, };
+  gpuRingFlush(ctx.ringCamera, pul, frame, 1);
+
+  recordFrameCommandList(pul, frame);
+
+  // the engine hands the node a new recorder every frame
   auto const recorder = PuleGfxCommandListRecorder {
     pul.taskGraphNodeAttributeFetchU64(
-      renderGeometryNode,
+      handleFetch(graphHandles(), handleRenderGeometry),
       pul.cStr("command-list-primary-recorder")
-    )
+    ),
   };
 
-  static float time = 0.0f;
-  time += 1.0f/60.0f;
-
+  // the finish fence tells gpuFrameFencesAdvance when this slot is free
   pul.gfxCommandListAppendAction(
     recorder,
     PuleGfxCommand {
-      .bindPipeline = {
-        .action = PuleGfxAction_bindPipeline,
-        .pipeline = ctx.pipeline,
+      .dispatchCommandList = {
+        .action = PuleGfxAction_dispatchCommandList,
+        .submitInfo = PuleGfxCommandListSubmitInfo {
+          .commandList = ctx.commandLists[frame].commandList,
+          .fenceTargetStart = nullptr,
+          .fenceTargetFinish = gpuFrameFencesTarget(ctx.fences),
+        },
       },
     }
   );
-  { // push constant
-    PuleF32m44 const view = (
-      puleViewLookAt(
-        PuleF32v3{sinf(time)*3.0f, 1.0f + 0.5f*cosf(time*0.5f), cosf(time)*3.0f},
-        puleF32v3(0.0),
-        PuleF32v3{0.0f, 1.0f, 0.0f}
-      )
-    );
-    PuleF32m44 const proj = (
-      puleProjectionPerspective(90.0f, 1.0f, 0.001f, 1000.0f)
-    );
-    std::vector<PuleGfxConstant> pushConstants = {
-      {
-        .value = { .constantF32m44 = view, },
-        .typeTag = PuleGfxConstantTypeTag_f32m44,
-        .bindingSlot = 0,
-      },
-      {
-        .value = { .constantF32m44 = proj, },
-        .typeTag = PuleGfxConstantTypeTag_f32m44,
-        .bindingSlot = 1,
-      },
-    };
-    pul.gfxCommandListAppendAction(
-      recorder,
-      PuleGfxCommand {
-        .pushConstants = {
-          .action = PuleGfxAction_pushConstants,
-          .constants = pushConstants.data(),
-          .constantsLength = pushConstants.size(),
-        },
-      }
-    );
-  }
-  /* pul.gfxCommandListAppendAction( */
-  /*   recorder, */
-  /*   PuleGfxCommand { */
-  /*     .dispatchCommandList = { */
-  /*       .action = PuleGfxAction_dispatchCommandList, */
-  /*       .submitInfo = PuleGfxCommandListSubmitInfo { */
-  /*         .commandList = ctx.commandList, */
-  /*         .fenceTargetStart = nullptr, // TODO maybe needs fence? MT tho...? */
-  /*         .fenceTargetFinish = nullptr, */
-  /*       }, */
-  /*     }, */
-  /*   } */
-  /* ); */
 }
 
 } // C
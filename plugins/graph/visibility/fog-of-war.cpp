@@ -0,0 +1,335 @@
+#include "fog-of-war.h"
+
+#include "../jobs/job-system.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// stamps per job, one is a few hundred cells with a short walk each
+size_t constexpr fogStampGrain = 16;
+
+// height of the sample nearest each cell's centre, over an inclusive rect
+void groundRecompute(
+  FogOfWar & fog, PulcTerrainHeightfield const & heightfield,
+  size_t const x0, size_t const y0, size_t const x1, size_t const y1
+) {
+  for (size_t y = y0; y <= y1; ++ y)
+  for (size_t x = x0; x <= x1; ++ x) {
+    float const sampleX = std::round(
+      (x + 0.5f)*fogCellDim / heightfield.spacing.x
+    );
+    float const sampleY = std::round(
+      (y + 0.5f)*fogCellDim / heightfield.spacing.y
+    );
+    fog.ground[y*fog.width + x] = pulcTerrainHeightfieldAt(
+      &heightfield,
+      std::min(static_cast<size_t>(sampleX), heightfield.width - 1),
+      std::min(static_cast<size_t>(sampleY), heightfield.height - 1)
+    );
+  }
+}
+
+int64_t stampRadiusCells(float const visionRadius) {
+  return static_cast<int64_t>(visionRadius / fogCellDim);
+}
+
+void unitsDirty(
+  FogOfWar & fog,
+  size_t const x0, size_t const y0, size_t const x1, size_t const y1
+) {
+  for (FogUnit & unit : fog.units) {
+    if (unit.cellX < 0) { continue; }
+    int64_t const radius = stampRadiusCells(unit.visionRadius);
+    if (
+         unit.cellX + radius >= static_cast<int64_t>(x0)
+      && unit.cellX - radius <= static_cast<int64_t>(x1)
+      && unit.cellY + radius >= static_cast<int64_t>(y0)
+      && unit.cellY - radius <= static_cast<int64_t>(y1)
+    ) {
+      unit.dirty = true;
+    }
+  }
+}
+
+void teamsAllocate(FogOfWar & fog, uint32_t const team) {
+  size_t const cellCount = fog.width*fog.height;
+  while (fog.teamsUsed <= team) {
+    FogTeam & allocated = fog.teams[fog.teamsUsed];
+    allocated.stampCounts.assign(cellCount, 0);
+    allocated.visible.assign((cellCount + 63) / 64, 0);
+    allocated.explored.assign((cellCount + 63) / 64, 0);
+    ++ fog.teamsUsed;
+    fog.texels.resize(fog.teamsUsed*cellCount, fogTexelUnexplored);
+    ++ fog.revision;
+  }
+}
+
+// only the first stamp onto a cell and the last one off it change its bits
+void cellAcquire(FogOfWar & fog, uint8_t const team, uint32_t const cell) {
+  FogTeam & fogTeam = fog.teams[team];
+  if (fogTeam.stampCounts[cell] ++ != 0) { return; }
+  uint64_t const bit = uint64_t(1) << (cell & 63);
+  fogTeam.visible[cell >> 6] |= bit;
+  fogTeam.explored[cell >> 6] |= bit;
+  fog.texels[team*fog.width*fog.height + cell] = fogTexelVisible;
+  ++ fog.revision;
+}
+
+void cellRelease(FogOfWar & fog, uint8_t const team, uint32_t const cell) {
+  FogTeam & fogTeam = fog.teams[team];
+  if (-- fogTeam.stampCounts[cell] != 0) { return; }
+  fogTeam.visible[cell >> 6] &= ~(uint64_t(1) << (cell & 63));
+  fog.texels[team*fog.width*fog.height + cell] = fogTexelExplored;
+  ++ fog.revision;
+}
+
+// lines of sight walk one cell per step along their major axis
+size_t shapeFetch(FogOfWar & fog, float const visionRadius) {
+  for (size_t it = 0; it < fog.shapes.size(); ++ it) {
+    if (fog.shapes[it].visionRadius == visionRadius) { return it; }
+  }
+  FogShape & shape = fog.shapes.emplace_back();
+  shape.visionRadius = visionRadius;
+  int32_t const radius = static_cast<int32_t>(stampRadiusCells(visionRadius));
+  float const radiusCells = visionRadius / fogCellDim;
+  for (int32_t dy = -radius; dy <= radius; ++ dy)
+  for (int32_t dx = -radius; dx <= radius; ++ dx) {
+    if (static_cast<float>(dx*dx + dy*dy) > radiusCells*radiusCells) {
+      continue;
+    }
+    auto cell = FogShapeCell {
+      .dx = dx, .dy = dy,
+      .stepBegin = static_cast<uint32_t>(shape.steps.size()), .stepEnd = 0,
+    };
+    int32_t const steps = std::max(std::abs(dx), std::abs(dy));
+    for (int32_t step = 1; step < steps; ++ step) {
+      float const f = static_cast<float>(step) / static_cast<float>(steps);
+      shape.steps.emplace_back(FogShapeStep {
+        .dx = static_cast<int32_t>(std::lround(dx*f)),
+        .dy = static_cast<int32_t>(std::lround(dy*f)),
+        .fraction = f,
+      });
+    }
+    cell.stepEnd = static_cast<uint32_t>(shape.steps.size());
+    shape.cells.emplace_back(cell);
+  }
+  return fog.shapes.size() - 1;
+}
+
+// cells of the shape whose target height the eye can see; a walk stays
+//   inside the map whenever its target does
+void stampCompute(FogOfWar const & fog, FogStampRequest & request) {
+  request.cells.clear();
+  FogShape const & shape = fog.shapes[request.shape];
+  int64_t const width = fog.width, height = fog.height;
+  int64_t const cx = request.cellX, cy = request.cellY;
+  float const eye = fog.ground[cy*width + cx] + fogEyeHeight;
+  for (FogShapeCell const & cell : shape.cells) {
+    int64_t const x = cx + cell.dx, y = cy + cell.dy;
+    if (x < 0 || y < 0 || x >= width || y >= height) { continue; }
+    float const rise = fog.ground[y*width + x] + fogTargetHeight - eye;
+    bool seen = true;
+    for (uint32_t it = cell.stepBegin; it < cell.stepEnd; ++ it) {
+      FogShapeStep const & step = shape.steps[it];
+      float const ground = fog.ground[(cy + step.dy)*width + cx + step.dx];
+      if (ground > eye + rise*step.fraction) {
+        seen = false;
+        break;
+      }
+    }
+    if (seen) { request.cells.emplace_back(y*width + x); }
+  }
+}
+
+// both cell lists are ascending, so one merge finds what left and joined
+void stampApply(FogOfWar & fog, FogUnit & unit, FogStampRequest & request) {
+  if (unit.team != request.team) {
+    for (uint32_t const cell : unit.cells) {
+      cellRelease(fog, unit.team, cell);
+    }
+    unit.cells.clear();
+  }
+  std::vector<uint32_t> const & previous = unit.cells;
+  std::vector<uint32_t> const & next = request.cells;
+  size_t itPrevious = 0, itNext = 0;
+  while (itPrevious < previous.size() || itNext < next.size()) {
+    if (
+         itNext == next.size()
+      || (itPrevious < previous.size() && previous[itPrevious] < next[itNext])
+    ) {
+      cellRelease(fog, unit.team, previous[itPrevious ++]);
+    } else if (
+         itPrevious == previous.size() || next[itNext] < previous[itPrevious]
+    ) {
+      cellAcquire(fog, request.team, next[itNext ++]);
+    } else {
+      ++ itPrevious;
+      ++ itNext;
+    }
+  }
+  unit.team = request.team;
+  unit.visionRadius = request.visionRadius;
+  unit.cellX = request.cellX;
+  unit.cellY = request.cellY;
+  // the request keeps the old list's capacity for the next tick
+  std::swap(unit.cells, request.cells);
+}
+
+} // namespace
+
+void fogOfWarSync(FogOfWar & fog, PulcTerrainHeightfield const & heightfield) {
+  bool const extentChanged = (
+       fog.samplesX != heightfield.width || fog.samplesY != heightfield.height
+    || fog.origin.x != heightfield.origin.x
+    || fog.origin.y != heightfield.origin.y
+    || fog.sampleSpacing.x != heightfield.spacing.x
+    || fog.sampleSpacing.y != heightfield.spacing.y
+  );
+  if (extentChanged) {
+    // a different map, nothing seen on the old one carries over
+    fog.samplesX = heightfield.width;
+    fog.samplesY = heightfield.height;
+    fog.origin = heightfield.origin;
+    fog.sampleSpacing = heightfield.spacing;
+    fog.width = std::max<size_t>(1, static_cast<size_t>(std::ceil(
+      (heightfield.width - 1)*heightfield.spacing.x / fogCellDim
+    )));
+    fog.height = std::max<size_t>(1, static_cast<size_t>(std::ceil(
+      (heightfield.height - 1)*heightfield.spacing.y / fogCellDim
+    )));
+    for (FogTeam & team : fog.teams) { team = FogTeam {}; }
+    fog.teamsUsed = 0;
+    fog.texels.clear();
+    for (FogUnit & unit : fog.units) {
+      unit.cells.clear();
+      unit.cellX = unit.cellY = -1;
+      unit.dirty = false;
+    }
+    fog.ground.resize(fog.width*fog.height);
+    groundRecompute(fog, heightfield, 0, 0, fog.width-1, fog.height-1);
+    fog.terrainRevision = heightfield.revision;
+    ++ fog.revision;
+    return;
+  }
+
+  bool recomputeAll = false;
+  for (
+    uint64_t revision = fog.terrainRevision + 1;
+    revision <= heightfield.revision;
+    ++ revision
+  ) {
+    auto const edit = pulcTerrainHeightfieldEditFetch(&heightfield, revision);
+    if (!edit) {
+      recomputeAll = true;
+      break;
+    }
+    // cells whose nearest sample is inside the edit
+    auto const cellOf = [](float const sample, float const spacing) {
+      return static_cast<int64_t>(std::floor(sample*spacing / fogCellDim));
+    };
+    int64_t const maxX = fog.width - 1, maxY = fog.height - 1;
+    size_t const x0 = std::clamp<int64_t>(
+      cellOf(edit->x0 - 0.5f, heightfield.spacing.x), 0, maxX
+    );
+    size_t const y0 = std::clamp<int64_t>(
+      cellOf(edit->y0 - 0.5f, heightfield.spacing.y), 0, maxY
+    );
+    size_t const x1 = std::clamp<int64_t>(
+      cellOf(edit->x1 + 0.5f, heightfield.spacing.x), 0, maxX
+    );
+    size_t const y1 = std::clamp<int64_t>(
+      cellOf(edit->y1 + 0.5f, heightfield.spacing.y), 0, maxY
+    );
+    groundRecompute(fog, heightfield, x0, y0, x1, y1);
+    unitsDirty(fog, x0, y0, x1, y1);
+  }
+  if (recomputeAll) {
+    groundRecompute(fog, heightfield, 0, 0, fog.width-1, fog.height-1);
+    unitsDirty(fog, 0, 0, fog.width-1, fog.height-1);
+  }
+  fog.terrainRevision = heightfield.revision;
+}
+
+void fogOfWarUnit(
+  FogOfWar & fog, uint32_t const slot, uint64_t const tick,
+  uint8_t const team, float const visionRadius, PuleF32v2 const position
+) {
+  if (fog.ground.empty()) { return; }
+  if (slot >= fog.units.size()) {
+    fog.units.resize(slot + 1, FogUnit { .cellX = -1, .cellY = -1, });
+  }
+  FogUnit & unit = fog.units[slot];
+  unit.seenTick = tick;
+
+  uint8_t const stampTeam = std::min<uint8_t>(team, fogTeamCount - 1);
+  float const radius = (
+    visionRadius > 0.0f ? visionRadius : fogVisionRadiusDefault
+  );
+  int64_t const cellX = std::clamp<int64_t>(
+    static_cast<int64_t>(std::floor((position.x - fog.origin.x) / fogCellDim)),
+    0, fog.width - 1
+  );
+  int64_t const cellY = std::clamp<int64_t>(
+    static_cast<int64_t>(std::floor((position.y - fog.origin.y) / fogCellDim)),
+    0, fog.height - 1
+  );
+  if (
+       !unit.dirty && unit.cellX == cellX && unit.cellY == cellY
+    && unit.team == stampTeam && unit.visionRadius == radius
+  ) {
+    return;
+  }
+  unit.dirty = false;
+
+  if (fog.requestCount == fog.requests.size()) { fog.requests.emplace_back(); }
+  FogStampRequest & request = fog.requests[fog.requestCount ++];
+  request.slot = slot;
+  request.team = stampTeam;
+  request.visionRadius = radius;
+  request.cellX = cellX;
+  request.cellY = cellY;
+}
+
+void fogOfWarUpdate(FogOfWar & fog, JobPool & jobs, uint64_t const tick) {
+  for (size_t it = 0; it < fog.requestCount; ++ it) {
+    FogStampRequest & request = fog.requests[it];
+    teamsAllocate(fog, request.team);
+    request.shape = shapeFetch(fog, request.visionRadius);
+  }
+
+  // stamps only read the ground, the counts are applied in order after
+  auto const compute = [&](size_t const begin, size_t const end) {
+    for (size_t it = begin; it < end; ++ it) {
+      stampCompute(fog, fog.requests[it]);
+    }
+  };
+  jobParallelFor(jobs, fog.requestCount, fogStampGrain, compute);
+  for (size_t it = 0; it < fog.requestCount; ++ it) {
+    FogStampRequest & request = fog.requests[it];
+    stampApply(fog, fog.units[request.slot], request);
+  }
+  fog.requestCount = 0;
+
+  for (FogUnit & unit : fog.units) {
+    if (unit.seenTick == tick || unit.cellX < 0) { continue; }
+    for (uint32_t const cell : unit.cells) {
+      cellRelease(fog, unit.team, cell);
+    }
+    unit.cells.clear();
+    unit.cellX = unit.cellY = -1;
+  }
+}
+
+int64_t fogOfWarCell(FogOfWar const & fog, PuleF32v2 const position) {
+  float const x = std::floor((position.x - fog.origin.x) / fogCellDim);
+  float const y = std::floor((position.y - fog.origin.y) / fogCellDim);
+  if (
+       x < 0.0f || y < 0.0f
+    || x >= static_cast<float>(fog.width) || y >= static_cast<float>(fog.height)
+  ) {
+    return -1;
+  }
+  return static_cast<int64_t>(y)*fog.width + static_cast<int64_t>(x);
+}
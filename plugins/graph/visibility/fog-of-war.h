@@ -0,0 +1,159 @@
+#pragma once
+
+#include "../../terrain/terrain.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// -- shared C interface -------------------------------------------------------
+
+// the graph plugin stores a PulcFogOfWar under "pulc-fog-of-war" so the
+//   renderer or UI can upload a team's fog as an R8 texture. Main thread
+//   only; it moves on when map-movement takes a new snapshot
+
+// texels of the published layers
+#define pulcFogTexelUnexplored 0x00
+#define pulcFogTexelExplored 0x80
+#define pulcFogTexelVisible 0xFF
+
+typedef struct {
+  void * simulation;
+  // a team's layer of width*height texels, row-major from the cell whose
+  //   corner is at world XZ origin, cells cellDim world units a side; null
+  //   until the team has had a unit. revision changes with any texel of any
+  //   team, an upload can be skipped while it stays the same
+  uint8_t const * (* texels)(
+    void * simulation, uint8_t team, size_t * width, size_t * height,
+    PuleF32v2 * origin, float * cellDim, uint64_t * revision
+  );
+} PulcFogOfWar;
+
+#ifdef __cplusplus
+
+#include <vector>
+
+// -- graph plugin -------------------------------------------------------------
+
+struct JobPool;
+
+// per-team fog of war over a grid of square cells laid on the terrain. Each
+//   unit stamps the cells it sees into its team's per-cell counts; a cell is
+//   visible while any stamp covers it and explored once one ever has. A
+//   stamp only depends on the unit's cell, radius and the ground around it,
+//   so it's recomputed when one of those changes, and only the cells that
+//   left or joined it touch the counts.
+// Ground occludes along the straight line from the unit's eye to a cell's
+//   target height, walking the ground heights of the cells in between; the
+//   resolution of the occlusion is that of the fog itself
+
+float constexpr fogCellDim = 1.0f; // world units
+float constexpr fogEyeHeight = 1.5f; // above the ground of the unit's cell
+float constexpr fogTargetHeight = 0.5f; // above the ground of a seen cell
+float constexpr fogVisionRadiusDefault = 8.0f;
+uint32_t constexpr fogTeamCount = 8;
+
+// texels of the published R8 layers
+uint8_t constexpr fogTexelUnexplored = pulcFogTexelUnexplored;
+uint8_t constexpr fogTexelExplored = pulcFogTexelExplored;
+uint8_t constexpr fogTexelVisible = pulcFogTexelVisible;
+
+struct FogTeam {
+  std::vector<uint16_t> stampCounts; // per cell, stamps covering it
+  std::vector<uint64_t> visible, explored; // bit per cell, row-major
+};
+
+// stamp a slot last applied
+struct FogUnit {
+  uint8_t team;
+  float visionRadius;
+  int64_t cellX, cellY; // -1 while unstamped
+  std::vector<uint32_t> cells; // covered, ascending
+  uint64_t seenTick;
+  bool dirty; // the ground under the stamp changed
+};
+
+// disc of cell offsets a vision radius covers in row-major order, each with
+//   the cells its line of sight walks; shared by every stamp of that radius
+struct FogShapeStep {
+  int32_t dx, dy;
+  float fraction; // of the way from the eye to the target
+};
+
+struct FogShapeCell {
+  int32_t dx, dy;
+  uint32_t stepBegin, stepEnd;
+};
+
+struct FogShape {
+  float visionRadius;
+  std::vector<FogShapeCell> cells;
+  std::vector<FogShapeStep> steps;
+};
+
+// stamp recomputed this tick
+struct FogStampRequest {
+  uint32_t slot;
+  uint8_t team;
+  float visionRadius;
+  size_t shape;
+  int64_t cellX, cellY;
+  std::vector<uint32_t> cells;
+};
+
+struct FogOfWar {
+  size_t width, height;
+  PuleF32v2 origin; // world XZ of cell (0, 0)'s corner
+  // heightfield the grid was laid on
+  size_t samplesX, samplesY;
+  PuleF32v2 sampleSpacing;
+  uint64_t terrainRevision;
+  std::vector<float> ground; // per cell, height at its centre
+
+  FogTeam teams[fogTeamCount];
+  // R8 layer of width*height per team below teamsUsed, back to back
+  std::vector<uint8_t> texels;
+  uint32_t teamsUsed;
+  uint64_t revision; // bumped whenever a texel changes
+
+  std::vector<FogShape> shapes; // one per radius seen
+  std::vector<FogUnit> units; // by simulation slot
+  std::vector<FogStampRequest> requests; // reused, requestCount live
+  size_t requestCount;
+};
+
+// lays the grid on the heightfield, clearing everything if its extent
+//   changed, and marks the stamps any edit since the last sync reaches
+void fogOfWarSync(FogOfWar & fog, PulcTerrainHeightfield const & heightfield);
+
+// where a slot is this tick; it's only restamped if its cell, team or radius
+//   changed or the ground under it did. A visionRadius of 0 is the default
+void fogOfWarUnit(
+  FogOfWar & fog, uint32_t const slot, uint64_t const tick,
+  uint8_t const team, float const visionRadius, PuleF32v2 const position
+);
+
+// recomputes the stamps that changed over the pool and applies them, then
+//   lifts the stamps of slots not seen this tick
+void fogOfWarUpdate(FogOfWar & fog, JobPool & jobs, uint64_t const tick);
+
+int64_t fogOfWarCell(FogOfWar const & fog, PuleF32v2 const position);
+
+inline bool fogOfWarVisible(
+  FogOfWar const & fog, uint8_t const team, size_t const cell
+) {
+  if (team >= fogTeamCount || fog.teams[team].visible.empty()) {
+    return false;
+  }
+  return (fog.teams[team].visible[cell >> 6] >> (cell & 63)) & 1;
+}
+
+inline bool fogOfWarExplored(
+  FogOfWar const & fog, uint8_t const team, size_t const cell
+) {
+  if (team >= fogTeamCount || fog.teams[team].explored.empty()) {
+    return false;
+  }
+  return (fog.teams[team].explored[cell >> 6] >> (cell & 63)) & 1;
+}
+
+#endif
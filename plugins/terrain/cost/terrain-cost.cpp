@@ -0,0 +1,303 @@
+#include "terrain-cost.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+size_t constexpr blockShift = pulcTerrainRegionBlockShift;
+size_t constexpr blockDim = size_t(1) << blockShift;
+size_t constexpr blockLabels = pulcTerrainRegionBlockLabels;
+
+// inclusive cell rectangle
+struct CostRect {
+  size_t x0, y0;
+  size_t x1, y1;
+};
+
+template <typename T>
+void relaxedStore(T & destination, T const value) {
+  __atomic_store_n(&destination, value, __ATOMIC_RELAXED);
+}
+
+// points the arrays into bytes, returns their length; the region ids come
+//   first, keeping them aligned
+size_t costMapArrays(
+  TerrainCostMap & costMap, size_t const width, size_t const height,
+  uint8_t * const bytes
+) {
+  costMap.width = width;
+  costMap.height = height;
+  costMap.blocksX = (width + blockDim - 1) >> blockShift;
+  costMap.blocksY = (height + blockDim - 1) >> blockShift;
+  size_t const cellCount = width*height;
+  size_t const blockCount = costMap.blocksX*costMap.blocksY;
+  size_t offset = 0;
+  auto const take = [&](size_t const byteLength) {
+    uint8_t * const array = bytes ? bytes + offset : nullptr;
+    offset += byteLength;
+    return array;
+  };
+  for (auto & ids : costMap.regionIds) {
+    ids = reinterpret_cast<uint32_t *>(
+      take(blockCount*blockLabels*sizeof(uint32_t))
+    );
+  }
+  costMap.costs = take(cellCount);
+  costMap.passable = take(cellCount);
+  for (auto & labels : costMap.regionLabels) { labels = take(cellCount); }
+  for (auto & counts : costMap.blockLabelCounts) { counts = take(blockCount); }
+  return offset;
+}
+
+// the cheapest cell costs 1, the steepest one foot can still climb 254
+uint8_t slopeCost(float const slope) {
+  float const slopeMax = terrainCostClassSlopes[PulcTerrainMovementClass_foot];
+  if (slope >= slopeMax) { return pulcTerrainCostImpassable; }
+  return static_cast<uint8_t>(1.0f + (slope/slopeMax) * 253.0f);
+}
+
+// returns whether any passable mask changed
+bool costsRecompute(
+  TerrainCostMap & costMap, PulcTerrainHeightfield const & heightfield,
+  CostRect const & rect
+) {
+  bool passableChanged = false;
+  for (size_t y = rect.y0; y <= rect.y1; ++ y)
+  for (size_t x = rect.x0; x <= rect.x1; ++ x) {
+    float const h = pulcTerrainHeightfieldAt(&heightfield, x, y);
+    float slope = 0.0f;
+    auto const rise = [&](size_t const nx, size_t const ny, float const run) {
+      float const n = pulcTerrainHeightfieldAt(&heightfield, nx, ny);
+      slope = std::max(slope, std::fabs(h - n) / run);
+    };
+    if (x > 0) { rise(x-1, y, heightfield.spacing.x); }
+    if (x+1 < costMap.width) { rise(x+1, y, heightfield.spacing.x); }
+    if (y > 0) { rise(x, y-1, heightfield.spacing.y); }
+    if (y+1 < costMap.height) { rise(x, y+1, heightfield.spacing.y); }
+
+    uint8_t mask = 0;
+    for (uint8_t it = 0; it < pulcTerrainMovementClassCount; ++ it) {
+      if (slope < terrainCostClassSlopes[it]) { mask |= uint8_t(1) << it; }
+    }
+    size_t const cell = y*costMap.width + x;
+    relaxedStore(costMap.costs[cell], slopeCost(slope));
+    passableChanged = passableChanged || costMap.passable[cell] != mask;
+    relaxedStore(costMap.passable[cell], mask);
+  }
+  return passableChanged;
+}
+
+// flood fills the passable cells of one block into labels 1, 2, ...; a
+//   block of blockDim^2 cells has at most half that many 4-connected parts
+void blockLabel(
+  TerrainCostMap & costMap, size_t const movementClass,
+  size_t const bx, size_t const by
+) {
+  uint8_t * const labels = costMap.regionLabels[movementClass];
+  size_t const x0 = bx << blockShift, y0 = by << blockShift;
+  size_t const w = std::min(blockDim, costMap.width - x0);
+  size_t const h = std::min(blockDim, costMap.height - y0);
+  auto const cellOf = [&](size_t const local) {
+    return (y0 + local/blockDim)*costMap.width + x0 + local%blockDim;
+  };
+  auto const open = [&](size_t const cell) {
+    return (costMap.passable[cell] >> movementClass) & 1;
+  };
+
+  // labels are assigned in scan order, so an unchanged block relabels to
+  //   the same values and racing readers see them stay put
+  uint8_t scratch[blockDim*blockDim] = {};
+  uint8_t count = 0;
+  for (size_t ly = 0; ly < h; ++ ly)
+  for (size_t lx = 0; lx < w; ++ lx) {
+    size_t const seed = ly*blockDim + lx;
+    if (scratch[seed] != 0 || !open(cellOf(seed))) { continue; }
+    ++ count;
+    scratch[seed] = count;
+    costMap.fill.clear();
+    costMap.fill.emplace_back(static_cast<uint16_t>(seed));
+    while (!costMap.fill.empty()) {
+      size_t const local = costMap.fill.back();
+      costMap.fill.pop_back();
+      size_t const lx2 = local % blockDim, ly2 = local / blockDim;
+      auto const visit = [&](size_t const neighbour) {
+        if (scratch[neighbour] != 0 || !open(cellOf(neighbour))) { return; }
+        scratch[neighbour] = count;
+        costMap.fill.emplace_back(static_cast<uint16_t>(neighbour));
+      };
+      if (lx2 > 0) { visit(local - 1); }
+      if (lx2+1 < w) { visit(local + 1); }
+      if (ly2 > 0) { visit(local - blockDim); }
+      if (ly2+1 < h) { visit(local + blockDim); }
+    }
+  }
+  for (size_t ly = 0; ly < h; ++ ly)
+  for (size_t lx = 0; lx < w; ++ lx) {
+    relaxedStore(labels[cellOf(ly*blockDim + lx)], scratch[ly*blockDim + lx]);
+  }
+  costMap.blockLabelCounts[movementClass][by*costMap.blocksX + bx] = count;
+}
+
+uint32_t parentFind(std::vector<uint32_t> & parents, uint32_t key) {
+  while (parents[key] != key) {
+    parents[key] = parents[parents[key]];
+    key = parents[key];
+  }
+  return key;
+}
+
+// the smallest key of a region is its root, so ids only change for regions
+//   that gained or lost blocks
+void parentUnite(std::vector<uint32_t> & parents, uint32_t a, uint32_t b) {
+  a = parentFind(parents, a);
+  b = parentFind(parents, b);
+  if (a < b) { parents[b] = a; }
+  else if (b < a) { parents[a] = b; }
+}
+
+// joins block labels that touch across block borders into region ids
+void regionsJoin(TerrainCostMap & costMap, size_t const movementClass) {
+  uint8_t const * const labels = costMap.regionLabels[movementClass];
+  uint8_t const * const counts = costMap.blockLabelCounts[movementClass];
+  size_t const blockCount = costMap.blocksX*costMap.blocksY;
+  std::vector<uint32_t> & parents = costMap.parents;
+  // not before the first join, a mapped cost map may never need it
+  parents.resize(blockCount*blockLabels);
+  for (size_t block = 0; block < blockCount; ++ block)
+  for (size_t label = 0; label < counts[block]; ++ label) {
+    uint32_t const key = static_cast<uint32_t>(block*blockLabels + label);
+    parents[key] = key;
+  }
+
+  auto const keyOf = [&](size_t const x, size_t const y, uint8_t const label) {
+    size_t const block = (
+      (y >> blockShift)*costMap.blocksX + (x >> blockShift)
+    );
+    return static_cast<uint32_t>(block*blockLabels + label - 1);
+  };
+  auto const join = [&](
+    size_t const xa, size_t const ya, size_t const xb, size_t const yb
+  ) {
+    uint8_t const la = labels[ya*costMap.width + xa];
+    uint8_t const lb = labels[yb*costMap.width + xb];
+    if (la == 0 || lb == 0) { return; }
+    parentUnite(parents, keyOf(xa, ya, la), keyOf(xb, yb, lb));
+  };
+  for (size_t x = blockDim; x < costMap.width; x += blockDim)
+  for (size_t y = 0; y < costMap.height; ++ y) {
+    join(x-1, y, x, y);
+  }
+  for (size_t y = blockDim; y < costMap.height; y += blockDim)
+  for (size_t x = 0; x < costMap.width; ++ x) {
+    join(x, y-1, x, y);
+  }
+
+  uint32_t * const ids = costMap.regionIds[movementClass];
+  for (size_t block = 0; block < blockCount; ++ block)
+  for (size_t label = 0; label < counts[block]; ++ label) {
+    uint32_t const key = static_cast<uint32_t>(block*blockLabels + label);
+    uint32_t const id = parentFind(parents, key) + 1;
+    if (ids[key] != id) { relaxedStore(ids[key], id); }
+  }
+}
+
+} // namespace
+
+size_t terrainCostMapByteLength(size_t const width, size_t const height) {
+  TerrainCostMap measure;
+  return costMapArrays(measure, width, height, nullptr);
+}
+
+void terrainCostMapBuild(
+  TerrainCostMap & costMap, PulcTerrainHeightfield const & heightfield
+) {
+  size_t const byteLength = (
+    terrainCostMapByteLength(heightfield.width, heightfield.height)
+  );
+  // zeroed, so labels and counts start out empty
+  costMap.storage.assign(
+    (byteLength + sizeof(uint32_t) - 1) / sizeof(uint32_t), 0
+  );
+  costMapArrays(
+    costMap, heightfield.width, heightfield.height,
+    reinterpret_cast<uint8_t *>(costMap.storage.data())
+  );
+  costsRecompute(
+    costMap, heightfield,
+    CostRect { 0, 0, costMap.width-1, costMap.height-1, }
+  );
+  for (size_t it = 0; it < pulcTerrainMovementClassCount; ++ it) {
+    for (size_t by = 0; by < costMap.blocksY; ++ by)
+    for (size_t bx = 0; bx < costMap.blocksX; ++ bx) {
+      blockLabel(costMap, it, bx, by);
+    }
+    regionsJoin(costMap, it);
+  }
+}
+
+void terrainCostMapUpdate(
+  TerrainCostMap & costMap, PulcTerrainHeightfield const & heightfield,
+  PulcTerrainHeightfieldEdit const & edit
+) {
+  // slope looks one sample out, so neighbours of the edit change too
+  auto const rect = CostRect {
+    .x0 = edit.x0 > 0 ? edit.x0-1 : 0,
+    .y0 = edit.y0 > 0 ? edit.y0-1 : 0,
+    .x1 = std::min(edit.x1+1, costMap.width-1),
+    .y1 = std::min(edit.y1+1, costMap.height-1),
+  };
+  // costs alone never move region boundaries
+  if (!costsRecompute(costMap, heightfield, rect)) { return; }
+  size_t const bx0 = rect.x0 >> blockShift, bx1 = rect.x1 >> blockShift;
+  size_t const by0 = rect.y0 >> blockShift, by1 = rect.y1 >> blockShift;
+  for (size_t it = 0; it < pulcTerrainMovementClassCount; ++ it) {
+    for (size_t by = by0; by <= by1; ++ by)
+    for (size_t bx = bx0; bx <= bx1; ++ bx) {
+      blockLabel(costMap, it, bx, by);
+    }
+    regionsJoin(costMap, it);
+  }
+}
+
+bool terrainCostMapFromBytes(
+  TerrainCostMap & costMap, PulcTerrainHeightfield const & heightfield,
+  void * const bytes, size_t const byteLength
+) {
+  if (
+       byteLength
+    != terrainCostMapByteLength(heightfield.width, heightfield.height)
+  ) {
+    return false;
+  }
+  costMap.storage.clear();
+  costMapArrays(
+    costMap, heightfield.width, heightfield.height,
+    reinterpret_cast<uint8_t *>(bytes)
+  );
+  return true;
+}
+
+void const * terrainCostMapBytes(TerrainCostMap const & costMap) {
+  return costMap.regionIds[0];
+}
+
+PulcTerrainCostMap terrainCostMapShared(
+  TerrainCostMap const & costMap, uint64_t const revision
+) {
+  PulcTerrainCostMap shared = {
+    .width = costMap.width,
+    .height = costMap.height,
+    .costs = costMap.costs,
+    .passable = costMap.passable,
+    .regionLabels = {},
+    .regionIds = {},
+    .blocksX = costMap.blocksX,
+    .revision = revision,
+  };
+  for (size_t it = 0; it < pulcTerrainMovementClassCount; ++ it) {
+    shared.regionLabels[it] = costMap.regionLabels[it];
+    shared.regionIds[it] = costMap.regionIds[it];
+  }
+  return shared;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../terrain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// movement costs, passability and regions derived from a heightfield, see
+//   PulcTerrainCostMap. Slope is the steepest rise to a 4-neighbour, like the
+//   mesh normals see it. Regions are 4-connected components per class, which
+//   is also what 8-way movement reaches when diagonals may not cut corners.
+//   Edits relabel only the blocks they touch, then the block labels are
+//   joined again; that pass reads block borders only, an eighth of the map.
+// The arrays sit in one block of memory, laid out as a tiled heightmap file
+//   stores them, so a map saved with its cost map opens without reading a
+//   sample
+
+// rise over run, the steepest each class climbs
+inline constexpr float terrainCostClassSlopes[pulcTerrainMovementClassCount] = {
+  10.0f, // foot
+  5.0f, // tracked
+  2.5f, // wheeled
+};
+
+struct TerrainCostMap {
+  size_t width, height;
+  size_t blocksX, blocksY;
+  // in storage, or in a file mapping that outlives the cost map
+  uint32_t * regionIds[pulcTerrainMovementClassCount];
+  uint8_t * costs;
+  uint8_t * passable;
+  uint8_t * regionLabels[pulcTerrainMovementClassCount];
+  // per class and block, labels in use
+  uint8_t * blockLabelCounts[pulcTerrainMovementClassCount];
+  std::vector<uint32_t> storage;
+
+  // scratch
+  std::vector<uint32_t> parents; // union-find over block labels
+  std::vector<uint16_t> fill; // flood fill stack, block-local cells
+};
+
+// bytes the arrays take for a width*height heightfield
+size_t terrainCostMapByteLength(size_t const width, size_t const height);
+
+void terrainCostMapBuild(
+  TerrainCostMap & costMap, PulcTerrainHeightfield const & heightfield
+);
+
+// takes the arrays as they were built for the heightfield's dimensions from
+//   bytes, which have to stay valid and writable for as long as the cost
+//   map is used; false if the length doesn't match
+bool terrainCostMapFromBytes(
+  TerrainCostMap & costMap, PulcTerrainHeightfield const & heightfield,
+  void * const bytes, size_t const byteLength
+);
+
+// the arrays, to store them
+void const * terrainCostMapBytes(TerrainCostMap const & costMap);
+
+// rederives what the edit reaches, in place
+void terrainCostMapUpdate(
+  TerrainCostMap & costMap, PulcTerrainHeightfield const & heightfield,
+  PulcTerrainHeightfieldEdit const & edit
+);
+
+// view for other plugins, at the given heightfield revision
+PulcTerrainCostMap terrainCostMapShared(
+  TerrainCostMap const & costMap, uint64_t const revision
+);
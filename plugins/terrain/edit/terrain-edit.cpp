@@ -0,0 +1,356 @@
+#include "terrain-edit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+void rectInclude(TerrainEditRect & rect, size_t const x, size_t const y) {
+  rect.x0 = std::min(rect.x0, x);
+  rect.y0 = std::min(rect.y0, y);
+  rect.x1 = std::max(rect.x1, x);
+  rect.y1 = std::max(rect.y1, y);
+}
+
+void rectUnion(TerrainEditRect & rect, TerrainEditRect const & other) {
+  if (terrainEditRectIsEmpty(other)) { return; }
+  rectInclude(rect, other.x0, other.y0);
+  rectInclude(rect, other.x1, other.y1);
+}
+
+// -- delta coding -------------------------------------------------------------
+// a delta is a sequence of
+//   zero run length, literal count, literal count words
+//   with every number a little endian base 128 varint
+
+void varintAppend(std::vector<uint8_t> & bytes, uint32_t value) {
+  while (value >= 0x80) {
+    bytes.emplace_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  bytes.emplace_back(static_cast<uint8_t>(value));
+}
+
+uint32_t varintRead(uint8_t const * & cursor) {
+  uint32_t value = 0;
+  for (uint32_t shift = 0;; shift += 7) {
+    uint8_t const byte = *cursor++;
+    value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) { return value; }
+  }
+}
+
+uint32_t heightBits(float const height) {
+  uint32_t bits;
+  memcpy(&bits, &height, sizeof(bits));
+  return bits;
+}
+
+// false if before and after match over the rect, leaving bytes empty
+bool deltaEncode(
+  std::vector<uint8_t> & bytes, TerrainEditRect const & rect,
+  size_t const tileShift, float const * const before,
+  float const * const after
+) {
+  size_t const width = rect.x1 - rect.x0 + 1;
+  size_t const count = width * (rect.y1 - rect.y0 + 1);
+  auto const word = [&](size_t const it) {
+    size_t const index = (
+      ((rect.y0 + it/width) << tileShift) + rect.x0 + it%width
+    );
+    return heightBits(before[index]) ^ heightBits(after[index]);
+  };
+  bytes.clear();
+  bool changed = false;
+  for (size_t it = 0; it < count;) {
+    size_t zeros = 0;
+    while (it + zeros < count && word(it + zeros) == 0) { ++ zeros; }
+    it += zeros;
+    size_t literals = 0;
+    while (it + literals < count && word(it + literals) != 0) { ++ literals; }
+    changed = changed || literals > 0;
+    varintAppend(bytes, static_cast<uint32_t>(zeros));
+    varintAppend(bytes, static_cast<uint32_t>(literals));
+    for (; literals > 0; -- literals, ++ it) {
+      varintAppend(bytes, word(it));
+    }
+  }
+  if (!changed) { bytes.clear(); }
+  return changed;
+}
+
+// XOR is its own inverse, the same delta undoes and redoes
+void deltaApply(
+  TerrainEditTileDelta const & delta, size_t const tileShift,
+  float * const heights
+) {
+  TerrainEditRect const & rect = delta.rect;
+  size_t const width = rect.x1 - rect.x0 + 1;
+  uint8_t const * cursor = delta.bytes.data();
+  uint8_t const * const end = cursor + delta.bytes.size();
+  size_t it = 0;
+  while (cursor < end) {
+    it += varintRead(cursor);
+    for (size_t literals = varintRead(cursor); literals > 0; -- literals) {
+      size_t const index = (
+        ((rect.y0 + it/width) << tileShift) + rect.x0 + it%width
+      );
+      uint32_t const bits = heightBits(heights[index]) ^ varintRead(cursor);
+      float height;
+      memcpy(&height, &bits, sizeof(height));
+      tiledHeightmapHeightStore(heights, index, height);
+      ++ it;
+    }
+  }
+}
+
+TerrainEditRect stepApply(
+  TerrainEditStep const & step, TiledHeightmap & heightmap
+) {
+  for (TerrainEditTileDelta const & delta : step.tiles) {
+    deltaApply(
+      delta, heightmap.header.tileShift,
+      tiledHeightmapTileEdit(heightmap, delta.tile)
+    );
+  }
+  return step.rect;
+}
+
+// -- brush --------------------------------------------------------------------
+
+TerrainEditTileSnapshot & tileSnapshot(
+  TerrainEdit & edit, TiledHeightmap & heightmap, size_t const tile
+) {
+  // a stroke only ever covers a handful of tiles
+  for (TerrainEditTileSnapshot & snapshot : edit.snapshots) {
+    if (snapshot.tile == tile) { return snapshot; }
+  }
+  float const * const heights = tiledHeightmapTileEdit(heightmap, tile);
+  size_t const count = (
+    (size_t(1) << heightmap.header.tileShift) << heightmap.header.tileShift
+  );
+  edit.snapshots.emplace_back(TerrainEditTileSnapshot {
+    .tile = tile,
+    .rect = terrainEditRectEmpty(),
+    .heights = std::vector<float>(heights, heights + count),
+  });
+  return edit.snapshots.back();
+}
+
+// inclusive sample range within [0, count) covering center +- radius
+bool brushSampleRange(
+  float const center, float const radius,
+  float const origin, float const spacing, size_t const count,
+  size_t & begin, size_t & end
+) {
+  float const first = std::ceil((center - radius - origin) / spacing);
+  float const last = std::floor((center + radius - origin) / spacing);
+  if (last < 0.0f || first > static_cast<float>(count - 1) || first > last) {
+    return false;
+  }
+  begin = static_cast<size_t>(std::max(first, 0.0f));
+  end = static_cast<size_t>(std::min(last, static_cast<float>(count - 1)));
+  return true;
+}
+
+float brushHeight(
+  PulcTerrainHeightfield const & heightfield, PulcTerrainBrush const & brush,
+  float const weight, size_t const x, size_t const y
+) {
+  float const height = pulcTerrainHeightfieldAt(&heightfield, x, y);
+  float const blend = std::min(brush.strength*weight, 1.0f);
+  switch (brush.op) {
+    case PulcTerrainBrushOp_raise: return height + brush.strength*weight;
+    case PulcTerrainBrushOp_lower: return height - brush.strength*weight;
+    case PulcTerrainBrushOp_flatten:
+      return height + (brush.target - height)*blend;
+    case PulcTerrainBrushOp_smooth: {
+      size_t const x0 = x > 0 ? x-1 : x;
+      size_t const y0 = y > 0 ? y-1 : y;
+      size_t const x1 = std::min(x+1, heightfield.width - 1);
+      size_t const y1 = std::min(y+1, heightfield.height - 1);
+      float sum = 0.0f;
+      for (size_t sy = y0; sy <= y1; ++ sy)
+      for (size_t sx = x0; sx <= x1; ++ sx) {
+        sum += pulcTerrainHeightfieldAt(&heightfield, sx, sy);
+      }
+      float const average = sum / ((x1 - x0 + 1)*(y1 - y0 + 1));
+      return height + (average - height)*blend;
+    }
+  }
+  return height;
+}
+
+} // namespace
+
+TerrainEditRect terrainEditRectEmpty() {
+  return TerrainEditRect { SIZE_MAX, SIZE_MAX, 0, 0, };
+}
+
+bool terrainEditRectIsEmpty(TerrainEditRect const & rect) {
+  return rect.x0 > rect.x1 || rect.y0 > rect.y1;
+}
+
+void terrainEditStrokeBegin(TerrainEdit & edit) {
+  edit.stroking = true;
+  edit.snapshots.clear();
+}
+
+TerrainEditRect terrainEditBrushApply(
+  TerrainEdit & edit,
+  TiledHeightmap & heightmap, PulcTerrainHeightfield const & heightfield,
+  PulcTerrainBrush const & brush
+) {
+  TerrainEditRect changed = terrainEditRectEmpty();
+  size_t x0, y0, x1, y1;
+  if (
+       brush.radius <= 0.0f
+    || !brushSampleRange(
+      brush.center.x, brush.radius, heightfield.origin.x,
+      heightfield.spacing.x, heightfield.width, x0, x1
+    )
+    || !brushSampleRange(
+      brush.center.y, brush.radius, heightfield.origin.y,
+      heightfield.spacing.y, heightfield.height, y0, y1
+    )
+  ) {
+    return changed;
+  }
+  bool const single = !edit.stroking;
+  if (single) { terrainEditStrokeBegin(edit); }
+
+  // every new height first, smoothing reads neighbours the brush moves too
+  size_t const width = x1 - x0 + 1;
+  std::vector<float> heights((y1 - y0 + 1) * width);
+  float const invRadiusSqr = 1.0f / (brush.radius*brush.radius);
+  for (size_t y = y0; y <= y1; ++ y)
+  for (size_t x = x0; x <= x1; ++ x) {
+    float const dx = (
+      heightfield.origin.x + x*heightfield.spacing.x - brush.center.x
+    );
+    float const dy = (
+      heightfield.origin.y + y*heightfield.spacing.y - brush.center.y
+    );
+    float const falloff = std::max(1.0f - (dx*dx + dy*dy)*invRadiusSqr, 0.0f);
+    heights[(y - y0)*width + (x - x0)] = (
+      brushHeight(heightfield, brush, falloff*falloff, x, y)
+    );
+  }
+
+  // then tile by tile, snapshotting each before its first write
+  size_t const shift = heightmap.header.tileShift;
+  size_t const mask = (size_t(1) << shift) - 1;
+  for (size_t ty = y0 >> shift; ty <= y1 >> shift; ++ ty)
+  for (size_t tx = x0 >> shift; tx <= x1 >> shift; ++ tx) {
+    size_t const tile = ty*heightmap.header.tilesX + tx;
+    TerrainEditTileSnapshot * snapshot = nullptr;
+    float * tileHeights = nullptr;
+    size_t const sy0 = std::max(y0, ty << shift);
+    size_t const sy1 = std::min(y1, ((ty + 1) << shift) - 1);
+    size_t const sx0 = std::max(x0, tx << shift);
+    size_t const sx1 = std::min(x1, ((tx + 1) << shift) - 1);
+    for (size_t y = sy0; y <= sy1; ++ y)
+    for (size_t x = sx0; x <= sx1; ++ x) {
+      float const height = heights[(y - y0)*width + (x - x0)];
+      if (height == pulcTerrainHeightfieldAt(&heightfield, x, y)) {
+        continue;
+      }
+      if (!snapshot) {
+        snapshot = &tileSnapshot(edit, heightmap, tile);
+        tileHeights = tiledHeightmapTileEdit(heightmap, tile);
+      }
+      tiledHeightmapHeightStore(
+        tileHeights, ((y & mask) << shift) + (x & mask), height
+      );
+      rectInclude(snapshot->rect, x & mask, y & mask);
+      rectInclude(changed, x, y);
+    }
+  }
+
+  if (single) { terrainEditStrokeEnd(edit, heightmap); }
+  return changed;
+}
+
+void terrainEditStrokeEnd(TerrainEdit & edit, TiledHeightmap & heightmap) {
+  if (!edit.stroking) { return; }
+  edit.stroking = false;
+
+  size_t const shift = heightmap.header.tileShift;
+  auto step = TerrainEditStep {
+    .tiles = {}, .rect = terrainEditRectEmpty(), .byteLength = 0,
+  };
+  for (TerrainEditTileSnapshot const & snapshot : edit.snapshots) {
+    if (terrainEditRectIsEmpty(snapshot.rect)) { continue; }
+    auto delta = TerrainEditTileDelta {
+      .tile = snapshot.tile, .rect = snapshot.rect, .bytes = {},
+    };
+    // the brush may have put a sample back where it started
+    if (
+      !deltaEncode(
+        delta.bytes, delta.rect, shift, snapshot.heights.data(),
+        tiledHeightmapTileEdit(heightmap, snapshot.tile)
+      )
+    ) {
+      continue;
+    }
+    delta.bytes.shrink_to_fit();
+    size_t const tx = snapshot.tile % heightmap.header.tilesX;
+    size_t const ty = snapshot.tile / heightmap.header.tilesX;
+    rectUnion(step.rect, TerrainEditRect {
+      (tx << shift) + delta.rect.x0, (ty << shift) + delta.rect.y0,
+      (tx << shift) + delta.rect.x1, (ty << shift) + delta.rect.y1,
+    });
+    step.byteLength += sizeof(delta) + delta.bytes.size();
+    step.tiles.emplace_back(std::move(delta));
+  }
+  edit.snapshots.clear();
+  if (step.tiles.empty()) { return; }
+
+  for (size_t it = edit.historyCursor; it < edit.history.size(); ++ it) {
+    edit.historyByteLength -= edit.history[it].byteLength;
+  }
+  edit.history.resize(edit.historyCursor);
+  edit.historyByteLength += step.byteLength;
+  edit.history.emplace_back(std::move(step));
+  edit.historyCursor = edit.history.size();
+
+  size_t dropped = 0;
+  while (
+       edit.history.size() - dropped > 1
+    && edit.historyByteLength > terrainEditHistoryByteBudget
+  ) {
+    edit.historyByteLength -= edit.history[dropped].byteLength;
+    ++ dropped;
+  }
+  edit.history.erase(edit.history.begin(), edit.history.begin() + dropped);
+  edit.historyCursor -= dropped;
+}
+
+TerrainEditRect terrainEditUndo(
+  TerrainEdit & edit, TiledHeightmap & heightmap
+) {
+  terrainEditStrokeEnd(edit, heightmap);
+  if (edit.historyCursor == 0) { return terrainEditRectEmpty(); }
+  edit.historyCursor -= 1;
+  return stepApply(edit.history[edit.historyCursor], heightmap);
+}
+
+TerrainEditRect terrainEditRedo(
+  TerrainEdit & edit, TiledHeightmap & heightmap
+) {
+  terrainEditStrokeEnd(edit, heightmap);
+  if (edit.historyCursor == edit.history.size()) {
+    return terrainEditRectEmpty();
+  }
+  edit.historyCursor += 1;
+  return stepApply(edit.history[edit.historyCursor - 1], heightmap);
+}
+
+void terrainEditClear(TerrainEdit & edit) {
+  edit.stroking = false;
+  edit.snapshots.clear();
+  edit.history.clear();
+  edit.historyCursor = 0;
+  edit.historyByteLength = 0;
+}
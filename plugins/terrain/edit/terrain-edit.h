@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../heightmap/tiled-heightmap.h"
+#include "../terrain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// brush editing of a tiled heightmap with undo. Edits go to the heightmap's
+//   full precision tile heights in place; every change reports the sample
+//   rectangle it touched, so the mesh and anything else derived from the
+//   heights only redo that much.
+// Undo steps keep, per touched tile, the XOR of the heights before and
+//   after over the tile's dirty rectangle. Untouched samples XOR to zero and
+//   small changes leave the high bits zero, so the run-length/varint coded
+//   deltas stay proportional to the area edited, not to the map
+
+// inclusive sample rectangle, empty while x0 > x1
+struct TerrainEditRect {
+  size_t x0, y0;
+  size_t x1, y1;
+};
+
+TerrainEditRect terrainEditRectEmpty();
+bool terrainEditRectIsEmpty(TerrainEditRect const & rect);
+
+struct TerrainEditTileDelta {
+  size_t tile;
+  TerrainEditRect rect; // tile local
+  std::vector<uint8_t> bytes; // coded XOR of the rect's heights, row-major
+};
+
+struct TerrainEditStep {
+  std::vector<TerrainEditTileDelta> tiles;
+  TerrainEditRect rect; // union of the tiles', in samples
+  size_t byteLength;
+};
+
+// heights of a tile as the stroke found them
+struct TerrainEditTileSnapshot {
+  size_t tile;
+  TerrainEditRect rect; // tile local, what the stroke touched so far
+  std::vector<float> heights;
+};
+
+struct TerrainEdit {
+  bool stroking;
+  std::vector<TerrainEditTileSnapshot> snapshots;
+
+  // steps before the cursor are applied, the rest can be redone
+  std::vector<TerrainEditStep> history;
+  size_t historyCursor;
+  size_t historyByteLength;
+};
+
+// oldest steps are dropped past this, the newest is always kept
+size_t constexpr terrainEditHistoryByteBudget = size_t(64) << 20;
+
+void terrainEditStrokeBegin(TerrainEdit & edit);
+
+// applies the brush to the heightmap that heightfield points at, returns
+//   the samples that changed
+TerrainEditRect terrainEditBrushApply(
+  TerrainEdit & edit,
+  TiledHeightmap & heightmap, PulcTerrainHeightfield const & heightfield,
+  PulcTerrainBrush const & brush
+);
+
+// records the stroke as one undo step, dropping anything left to redo
+void terrainEditStrokeEnd(TerrainEdit & edit, TiledHeightmap & heightmap);
+
+// empty rectangles if there was nothing to undo/redo
+TerrainEditRect terrainEditUndo(TerrainEdit & edit, TiledHeightmap & heightmap);
+TerrainEditRect terrainEditRedo(TerrainEdit & edit, TiledHeightmap & heightmap);
+
+// forgets the stroke and history, for when the heightmap is replaced
+void terrainEditClear(TerrainEdit & edit);
@@ -0,0 +1,305 @@
+#include "tiled-heightmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+char constexpr tiledHeightmapMagic[4] = { 'P', 'T', 'H', 'M', };
+size_t constexpr tiledHeightmapPageAlign = 4096;
+// larger tiles would make single reads page in more than a query needs
+uint32_t constexpr tiledHeightmapTileShiftMax = 12;
+
+size_t tileSampleCount(TiledHeightmapHeader const & header) {
+  return (size_t(1) << header.tileShift) << header.tileShift;
+}
+
+size_t alignUp(size_t const value, size_t const alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t samplesOffset(TiledHeightmapHeader const & header) {
+  return alignUp(
+    sizeof(TiledHeightmapHeader)
+      + sizeof(TiledHeightmapTileEntry) * header.tilesX * header.tilesY,
+    tiledHeightmapPageAlign
+  );
+}
+
+bool headerValid(TiledHeightmapHeader const & header) {
+  if (memcmp(header.magic, tiledHeightmapMagic, 4) != 0) { return false; }
+  if (header.version != tiledHeightmapVersion) { return false; }
+  if (header.width < 2 || header.height < 2) { return false; }
+  if (header.tileShift > tiledHeightmapTileShiftMax) { return false; }
+  size_t const tileDim = size_t(1) << header.tileShift;
+  return (
+       header.tilesX == (header.width + tileDim - 1) / tileDim
+    && header.tilesY == (header.height + tileDim - 1) / tileDim
+  );
+}
+
+// quantizes heightAt(x, y) over one tile into samples
+template <typename HeightAt>
+PulcTerrainHeightfieldTile tileQuantize(
+  size_t const tileShift, uint16_t * const samples, HeightAt && heightAt
+) {
+  size_t const tileDim = size_t(1) << tileShift;
+  float heightMin = heightAt(0, 0), heightMax = heightMin;
+  for (size_t y = 0; y < tileDim; ++ y)
+  for (size_t x = 0; x < tileDim; ++ x) {
+    heightMin = std::min(heightMin, heightAt(x, y));
+    heightMax = std::max(heightMax, heightAt(x, y));
+  }
+  float const heightScale = (heightMax - heightMin) / 65535.0f;
+  float const invScale = heightScale > 0.0f ? 1.0f/heightScale : 0.0f;
+  for (size_t y = 0; y < tileDim; ++ y)
+  for (size_t x = 0; x < tileDim; ++ x) {
+    float const quantized = (heightAt(x, y) - heightMin) * invScale;
+    samples[(y << tileShift) + x] = static_cast<uint16_t>(
+      std::clamp(std::lround(quantized), 0l, 65535l)
+    );
+  }
+  return PulcTerrainHeightfieldTile {
+    .samples = samples,
+    .heightMin = heightMin,
+    .heightScale = heightScale,
+    .heights = nullptr,
+  };
+}
+
+} // namespace
+
+bool tiledHeightmapOpen(TiledHeightmap & heightmap, char const * const path) {
+  tiledHeightmapClose(heightmap);
+
+  int const fd = open(path, O_RDONLY);
+  if (fd < 0) { return false; }
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    close(fd);
+    return false;
+  }
+  size_t const length = static_cast<size_t>(status.st_size);
+  if (length < sizeof(TiledHeightmapHeader)) {
+    close(fd);
+    return false;
+  }
+  void * const mapping = mmap(
+    nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0
+  );
+  // the mapping keeps the file alive on its own
+  close(fd);
+  if (mapping == MAP_FAILED) { return false; }
+
+  auto * const bytes = reinterpret_cast<uint8_t *>(mapping);
+  TiledHeightmapHeader header;
+  memcpy(&header, bytes, sizeof(header));
+  size_t const tileCount = size_t(header.tilesX) * header.tilesY;
+  size_t const tileBytes = tileSampleCount(header) * sizeof(uint16_t);
+  bool valid = (
+       headerValid(header)
+    && (
+         sizeof(header) + sizeof(TiledHeightmapTileEntry)*tileCount
+      <= length
+    )
+    && header.costMapByteOffset % alignof(uint32_t) == 0
+    && header.costMapByteOffset <= length
+    && length - header.costMapByteOffset >= header.costMapByteLength
+  );
+
+  // directory only, no sample is touched until something reads it
+  heightmap.tiles.resize(valid ? tileCount : 0);
+  for (size_t it = 0; valid && it < tileCount; ++ it) {
+    TiledHeightmapTileEntry entry;
+    memcpy(
+      &entry,
+      bytes + sizeof(header) + it*sizeof(TiledHeightmapTileEntry),
+      sizeof(entry)
+    );
+    if (
+         entry.byteOffset % alignof(uint16_t) != 0
+      || entry.byteOffset > length || length - entry.byteOffset < tileBytes
+    ) {
+      valid = false;
+      break;
+    }
+    heightmap.tiles[it] = PulcTerrainHeightfieldTile {
+      .samples = reinterpret_cast<uint16_t const *>(bytes + entry.byteOffset),
+      .heightMin = entry.heightMin,
+      .heightScale = entry.heightScale,
+      .heights = nullptr,
+    };
+  }
+  if (!valid) {
+    munmap(mapping, length);
+    heightmap.tiles.clear();
+    return false;
+  }
+
+  heightmap.header = header;
+  heightmap.mapping = mapping;
+  heightmap.mappingLength = length;
+  heightmap.costMap = (
+    header.costMapByteLength > 0 ? bytes + header.costMapByteOffset : nullptr
+  );
+  heightmap.costMapLength = header.costMapByteLength;
+  return true;
+}
+
+void tiledHeightmapFromHeights(
+  TiledHeightmap & heightmap,
+  float const * const heights, size_t const width, size_t const height,
+  PuleF32v2 const origin, PuleF32v2 const spacing
+) {
+  tiledHeightmapClose(heightmap);
+
+  size_t const tileShift = tiledHeightmapTileShift;
+  size_t const tileDim = size_t(1) << tileShift;
+  TiledHeightmapHeader & header = heightmap.header;
+  memcpy(header.magic, tiledHeightmapMagic, 4);
+  header.version = tiledHeightmapVersion;
+  header.width = static_cast<uint32_t>(width);
+  header.height = static_cast<uint32_t>(height);
+  header.tileShift = static_cast<uint32_t>(tileShift);
+  header.tilesX = static_cast<uint32_t>((width + tileDim - 1) / tileDim);
+  header.tilesY = static_cast<uint32_t>((height + tileDim - 1) / tileDim);
+  header.originX = origin.x;
+  header.originY = origin.y;
+  header.spacingX = spacing.x;
+  header.spacingY = spacing.y;
+  header.reserved = 0;
+  header.costMapByteOffset = 0;
+  header.costMapByteLength = 0;
+
+  size_t const tileCount = size_t(header.tilesX) * header.tilesY;
+  size_t const tileSamples = tileSampleCount(header);
+  heightmap.samples.resize(tileCount * tileSamples);
+  heightmap.tiles.resize(tileCount);
+  for (size_t ty = 0; ty < header.tilesY; ++ ty)
+  for (size_t tx = 0; tx < header.tilesX; ++ tx) {
+    // padding repeats the edge, it also can't widen the quantized range
+    auto const heightAt = [&](size_t const x, size_t const y) {
+      size_t const sx = std::min(tx*tileDim + x, width - 1);
+      size_t const sy = std::min(ty*tileDim + y, height - 1);
+      return heights[sy*width + sx];
+    };
+    size_t const tile = ty*header.tilesX + tx;
+    uint16_t * const samples = &heightmap.samples[tile*tileSamples];
+    heightmap.tiles[tile] = tileQuantize(tileShift, samples, heightAt);
+  }
+}
+
+float * tiledHeightmapTileEdit(
+  TiledHeightmap & heightmap, size_t const tile
+) {
+  PulcTerrainHeightfieldTile & entry = heightmap.tiles[tile];
+  if (entry.heights) { return const_cast<float *>(entry.heights); }
+  size_t const tileSamples = tileSampleCount(heightmap.header);
+  auto heights = std::make_unique<float[]>(tileSamples);
+  for (size_t it = 0; it < tileSamples; ++ it) {
+    heights[it] = entry.heightMin + entry.samples[it]*entry.heightScale;
+  }
+  // readers switch over to the filled heights in one go
+  __atomic_store_n(&entry.heights, heights.get(), __ATOMIC_RELEASE);
+  heightmap.editedHeights.emplace_back(std::move(heights));
+  return const_cast<float *>(entry.heights);
+}
+
+bool tiledHeightmapWrite(
+  TiledHeightmap const & heightmap, char const * const path,
+  void const * const costMap, size_t const costMapLength
+) {
+  FILE * const file = fopen(path, "wb");
+  if (!file) { return false; }
+
+  TiledHeightmapHeader header = heightmap.header;
+  size_t const tileBytes = tileSampleCount(header) * sizeof(uint16_t);
+  // tile blocks stay page aligned as long as a tile is a page multiple
+  size_t const tileStride = alignUp(tileBytes, tiledHeightmapPageAlign);
+  header.costMapByteLength = costMap ? costMapLength : 0;
+  header.costMapByteOffset = (
+    costMap ? samplesOffset(header) + heightmap.tiles.size()*tileStride : 0
+  );
+  // edited tiles get a fresh range, edits may well have left the old one
+  std::vector<PulcTerrainHeightfieldTile> tiles = heightmap.tiles;
+  std::vector<uint16_t> editedSamples(
+    heightmap.editedHeights.size() * tileSampleCount(header)
+  );
+  size_t editedCount = 0;
+  for (auto & tile : tiles) {
+    if (!tile.heights) { continue; }
+    float const * const heights = tile.heights;
+    tile = tileQuantize(
+      header.tileShift,
+      &editedSamples[(editedCount ++) * tileSampleCount(header)],
+      [&](size_t const x, size_t const y) {
+        return heights[(y << header.tileShift) + x];
+      }
+    );
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (size_t it = 0; ok && it < tiles.size(); ++ it) {
+    TiledHeightmapTileEntry const entry = {
+      .byteOffset = samplesOffset(header) + it*tileStride,
+      .heightMin = tiles[it].heightMin,
+      .heightScale = tiles[it].heightScale,
+    };
+    ok = fwrite(&entry, sizeof(entry), 1, file) == 1;
+  }
+  std::vector<uint8_t> const padding(tiledHeightmapPageAlign, 0);
+  auto const pad = [&](size_t const written, size_t const target) {
+    return (
+         written == target
+      || fwrite(padding.data(), target - written, 1, file) == 1
+    );
+  };
+  ok = ok && pad(
+    sizeof(header) + sizeof(TiledHeightmapTileEntry)*heightmap.tiles.size(),
+    samplesOffset(header)
+  );
+  for (size_t it = 0; ok && it < tiles.size(); ++ it) {
+    ok = (
+         fwrite(tiles[it].samples, tileBytes, 1, file) == 1
+      && pad(tileBytes, tileStride)
+    );
+  }
+  if (ok && header.costMapByteLength > 0) {
+    ok = fwrite(costMap, header.costMapByteLength, 1, file) == 1;
+  }
+  return fclose(file) == 0 && ok;
+}
+
+void tiledHeightmapClose(TiledHeightmap & heightmap) {
+  if (heightmap.mapping) {
+    munmap(heightmap.mapping, heightmap.mappingLength);
+  }
+  heightmap.mapping = nullptr;
+  heightmap.mappingLength = 0;
+  heightmap.costMap = nullptr;
+  heightmap.costMapLength = 0;
+  heightmap.tiles.clear();
+  heightmap.samples.clear();
+  heightmap.editedHeights.clear();
+}
+
+void tiledHeightmapHeightfield(
+  TiledHeightmap const & heightmap, PulcTerrainHeightfield & heightfield
+) {
+  TiledHeightmapHeader const & header = heightmap.header;
+  heightfield.width = header.width;
+  heightfield.height = header.height;
+  heightfield.origin = PuleF32v2 { header.originX, header.originY, };
+  heightfield.spacing = PuleF32v2 { header.spacingX, header.spacingY, };
+  heightfield.tileShift = header.tileShift;
+  heightfield.tilesX = header.tilesX;
+  heightfield.tilesY = header.tilesY;
+  heightfield.tiles = heightmap.tiles.data();
+}
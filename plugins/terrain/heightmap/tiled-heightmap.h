@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../terrain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// tiled heightmap file, native (little) endian:
+//   TiledHeightmapHeader
+//   TiledHeightmapTileEntry[tilesX*tilesY], row-major
+//   tile samples, u16 (1 << tileShift)^2 per tile, page aligned
+//   cost map, optional, see terrainCostMapBytes, page aligned
+// Opening only reads the header and directory, the file is mapped and tiles
+//   are paged in by the OS as samples are read. Tiles past the map's last
+//   row/column are padded with its edge samples.
+// The mapping is private and writable, edits to the cost map copy the pages
+//   they touch and never reach the file
+
+uint32_t constexpr tiledHeightmapVersion = 2;
+size_t constexpr tiledHeightmapTileShift = 8;
+
+struct TiledHeightmapHeader {
+  char magic[4]; // "PTHM"
+  uint32_t version;
+  uint32_t width, height;
+  uint32_t tileShift;
+  uint32_t tilesX, tilesY;
+  float originX, originY;
+  float spacingX, spacingY;
+  uint32_t reserved;
+  uint64_t costMapByteOffset, costMapByteLength; // length 0 without one
+};
+
+struct TiledHeightmapTileEntry {
+  uint64_t byteOffset;
+  float heightMin;
+  float heightScale;
+};
+
+struct TiledHeightmap {
+  TiledHeightmapHeader header;
+  std::vector<PulcTerrainHeightfieldTile> tiles;
+  // samples are either in the file mapping or owned here
+  void * mapping;
+  size_t mappingLength;
+  // in the file mapping, null if the file has none
+  void * costMap;
+  size_t costMapLength;
+  std::vector<uint16_t> samples;
+  // full precision heights of edited tiles, see PulcTerrainHeightfieldTile
+  std::vector<std::unique_ptr<float[]>> editedHeights;
+};
+
+// false if the file is missing or not a valid tiled heightmap
+bool tiledHeightmapOpen(TiledHeightmap & heightmap, char const * const path);
+
+// quantizes row-major heights into tiles kept in memory
+void tiledHeightmapFromHeights(
+  TiledHeightmap & heightmap,
+  float const * const heights, size_t const width, size_t const height,
+  PuleF32v2 const origin, PuleF32v2 const spacing
+);
+
+// heights of the tile for editing, created from its samples the first
+//   time; writes have to go through tiledHeightmapHeightStore
+float * tiledHeightmapTileEdit(TiledHeightmap & heightmap, size_t const tile);
+
+inline void tiledHeightmapHeightStore(
+  float * const heights, size_t const index, float const height
+) {
+  __atomic_store(&heights[index], &height, __ATOMIC_RELAXED);
+}
+
+// edited tiles are quantized again on the way out; the cost map, if not
+//   null, has to have been built over the heightmap as it's written
+bool tiledHeightmapWrite(
+  TiledHeightmap const & heightmap, char const * const path,
+  void const * const costMap, size_t const costMapLength
+);
+
+void tiledHeightmapClose(TiledHeightmap & heightmap);
+
+// points the heightfield's dimensions and tiles at the heightmap, which has
+//   to stay open for as long as the heightfield is used
+void tiledHeightmapHeightfield(
+  TiledHeightmap const & heightmap, PulcTerrainHeightfield & heightfield
+);
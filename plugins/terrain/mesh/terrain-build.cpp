@@ -0,0 +1,130 @@
+#include "terrain-build.h"
+
+#include <algorithm>
+
+namespace {
+
+struct TerrainBuildBatch {
+  TerrainBuild * build;
+  PulcTerrainHeightfield const * heightfield;
+};
+
+void terrainBuildRange(void * const userdata, size_t begin, size_t end) {
+  auto & batch = *reinterpret_cast<TerrainBuildBatch *>(userdata);
+  TerrainBuild & build = *batch.build;
+  for (size_t it = begin; it < end; ++ it) {
+    TerrainBuildChunk & chunk = build.building[it];
+    terrainChunkBuild(chunk.chunk, *batch.heightfield, chunk.vertices);
+    chunk.chunk.state = TerrainChunkState_built;
+    std::lock_guard<std::mutex> lock(build.mutex);
+    build.finished.emplace_back(chunk);
+  }
+}
+
+void terrainBuildLoop(TerrainBuild & build) {
+  PulcTerrainHeightfield heightfield;
+  PulcJobSystem jobs;
+  HandleRevision * jobsRevisionShared = nullptr;
+  uint64_t jobsRevision = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(build.mutex);
+      build.busy = false;
+      build.idle.notify_all();
+      build.wake.wait(lock, [&]() {
+        return !build.running || !build.pending.empty();
+      });
+      if (!build.running) { return; }
+      std::swap(build.building, build.pending);
+      build.pending.clear();
+      build.busy = true;
+      heightfield = build.heightfield;
+      jobs = build.jobs;
+      jobsRevisionShared = build.jobsRevisionShared;
+      jobsRevision = build.jobsRevision;
+    }
+
+    auto batch = TerrainBuildBatch {
+      .build = &build, .heightfield = &heightfield,
+    };
+    bool built = false;
+    if (jobs.pool) {
+      // the pool is only destroyed after a revision bump, which waits for
+      //   the gate; once the revision moved it may be gone already
+      std::shared_lock<std::shared_mutex> const gate(jobsRevisionShared->gate);
+      if (
+           jobsRevisionShared->value.load(std::memory_order_relaxed)
+        == jobsRevision
+      ) {
+        // a chunk is a few hundred microseconds, one per job balances fine
+        jobs.parallelFor(
+          jobs.pool, build.building.size(), 1, terrainBuildRange, &batch
+        );
+        built = true;
+      }
+    }
+    if (!built) {
+      terrainBuildRange(&batch, 0, build.building.size());
+    }
+    build.building.clear();
+  }
+}
+
+} // namespace
+
+void terrainBuildStart(TerrainBuild & build) {
+  build.running = true;
+  build.busy = false;
+  build.jobs = PulcJobSystem { nullptr, nullptr, nullptr, };
+  build.jobsRevisionShared = nullptr;
+  build.jobsRevision = 0;
+  build.thread = std::thread(terrainBuildLoop, std::ref(build));
+}
+
+void terrainBuildStop(TerrainBuild & build) {
+  if (!build.thread.joinable()) { return; }
+  {
+    std::lock_guard<std::mutex> lock(build.mutex);
+    build.running = false;
+    build.pending.clear();
+  }
+  build.wake.notify_all();
+  build.thread.join();
+  build.finished.clear();
+}
+
+void terrainBuildRequest(
+  TerrainBuild & build,
+  PulcTerrainHeightfield const & heightfield,
+  HandleRegistry const & handles, PulcJobSystem const * const jobs,
+  FrameArenaVector<TerrainBuildChunk> & requests
+) {
+  if (requests.empty()) { return; }
+  {
+    std::lock_guard<std::mutex> lock(build.mutex);
+    build.heightfield = heightfield;
+    build.jobs = jobs ? *jobs : PulcJobSystem { nullptr, nullptr, nullptr, };
+    build.jobsRevisionShared = handles.revisionShared;
+    build.jobsRevision = handles.revision;
+    build.pending.insert(
+      build.pending.end(), requests.begin(), requests.end()
+    );
+  }
+  requests.clear();
+  build.wake.notify_one();
+}
+
+void terrainBuildCollect(
+  TerrainBuild & build, std::vector<TerrainBuildChunk> & finished
+) {
+  finished.clear();
+  std::lock_guard<std::mutex> lock(build.mutex);
+  std::swap(finished, build.finished);
+}
+
+void terrainBuildDrain(TerrainBuild & build) {
+  std::unique_lock<std::mutex> lock(build.mutex);
+  build.pending.clear();
+  build.idle.wait(lock, [&]() { return !build.busy; });
+  build.finished.clear();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "terrain-chunks.h"
+
+#include "../../graph/jobs/job-system.h"
+#include "../../graph/registry/handle-registry.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// builds terrain chunks off the render thread. The renderer requests chunks
+//   as they first become visible; a builder thread splits every batch over
+//   the shared job system (or builds serially without one) and hands each
+//   chunk back the moment it's done, so the map fills in progressively
+//   instead of stalling a frame on the whole batch. The job system belongs to
+//   the graph plugin, which may unload while a batch runs; the builder only
+//   splits a batch over it through the handle revision's gate
+
+struct TerrainBuildChunk {
+  size_t chunkIndex;
+  TerrainChunk chunk; // built copy, the renderer's stays untouched
+  TerrainMeshAttribute * vertices; // terrainChunkVertices, pre-sized
+};
+
+struct TerrainBuild {
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  bool running;
+
+  // under the lock
+  PulcTerrainHeightfield heightfield;
+  PulcJobSystem jobs; // pool is null to build on the builder thread alone
+  HandleRevision * jobsRevisionShared;
+  uint64_t jobsRevision; // jobs was fetched at
+  std::vector<TerrainBuildChunk> pending;
+  std::vector<TerrainBuildChunk> finished;
+  bool busy;
+
+  // builder thread only
+  std::vector<TerrainBuildChunk> building;
+};
+
+void terrainBuildStart(TerrainBuild & build);
+void terrainBuildStop(TerrainBuild & build);
+
+// queues the requests and empties them; a request's vertices are written
+//   to its `vertices`. The heightfield and job system, fetched from handles,
+//   replace whatever earlier requests passed
+void terrainBuildRequest(
+  TerrainBuild & build,
+  PulcTerrainHeightfield const & heightfield,
+  HandleRegistry const & handles, PulcJobSystem const * const jobs,
+  FrameArenaVector<TerrainBuildChunk> & requests
+);
+
+// hands out every chunk finished since the last call
+void terrainBuildCollect(
+  TerrainBuild & build, std::vector<TerrainBuildChunk> & finished
+);
+
+// blocks until nothing is pending or building, and drops what finished;
+//   needed before the vertex buffer or heightfield requests pointed at goes
+void terrainBuildDrain(TerrainBuild & build);
@@ -0,0 +1,449 @@
+#include "terrain-chunks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+
+size_t constexpr rowVertices = terrainChunkQuads + 1;
+
+// skirt vertex for an edge vertex, edges in the order top, bottom, left,
+//   right; along is x for top/bottom and y for left/right
+uint16_t skirtVertex(size_t const edge, size_t const along) {
+  return static_cast<uint16_t>(
+    terrainChunkGridVertices + edge*rowVertices + along
+  );
+}
+
+uint16_t gridVertex(size_t const x, size_t const y) {
+  return static_cast<uint16_t>(y*rowVertices + x);
+}
+
+void appendLodElements(
+  std::vector<uint16_t> & elements, size_t const step
+) {
+  // same winding as the original full-detail mesh
+  for (size_t y = 0; y < terrainChunkQuads; y += step)
+  for (size_t x = 0; x < terrainChunkQuads; x += step) {
+    uint16_t const ul = gridVertex(x, y);
+    uint16_t const ur = gridVertex(x+step, y);
+    uint16_t const ll = gridVertex(x, y+step);
+    uint16_t const lr = gridVertex(x+step, y+step);
+    elements.insert(elements.end(), { ul, ur, lr, lr, ll, ul, });
+  }
+  // a skirt quad under every LOD edge segment
+  size_t const last = terrainChunkQuads;
+  for (size_t it = 0; it < terrainChunkQuads; it += step) {
+    size_t const next = it + step;
+    uint16_t const edgeVertices[4][2] = {
+      { gridVertex(it, 0), gridVertex(next, 0), },
+      { gridVertex(it, last), gridVertex(next, last), },
+      { gridVertex(0, it), gridVertex(0, next), },
+      { gridVertex(last, it), gridVertex(last, next), },
+    };
+    for (size_t edge = 0; edge < 4; ++ edge) {
+      uint16_t const a = edgeVertices[edge][0];
+      uint16_t const b = edgeVertices[edge][1];
+      uint16_t const skirtA = skirtVertex(edge, it);
+      uint16_t const skirtB = skirtVertex(edge, next);
+      elements.insert(elements.end(), { a, b, skirtB, skirtB, skirtA, a, });
+    }
+  }
+}
+
+float chunkHeight(
+  PulcTerrainHeightfield const & heightfield,
+  TerrainChunk const & chunk, size_t const x, size_t const y
+) {
+  return pulcTerrainHeightfieldAt(
+    &heightfield,
+    std::min(chunk.sampleX + x, heightfield.width - 1),
+    std::min(chunk.sampleY + y, heightfield.height - 1)
+  );
+}
+
+// height the LOD's triangles give at a full detail vertex, split along the
+//   ul-lr diagonal like the index lists
+float lodHeight(
+  PulcTerrainHeightfield const & heightfield,
+  TerrainChunk const & chunk, size_t const step, size_t const x, size_t const y
+) {
+  size_t const x0 = std::min(x / step * step, terrainChunkQuads - step);
+  size_t const y0 = std::min(y / step * step, terrainChunkQuads - step);
+  float const u = static_cast<float>(x - x0) / step;
+  float const v = static_cast<float>(y - y0) / step;
+  float const ul = chunkHeight(heightfield, chunk, x0, y0);
+  float const ur = chunkHeight(heightfield, chunk, x0+step, y0);
+  float const ll = chunkHeight(heightfield, chunk, x0, y0+step);
+  float const lr = chunkHeight(heightfield, chunk, x0+step, y0+step);
+  if (u >= v) {
+    return ul + u*(ur - ul) + v*(lr - ur);
+  }
+  return ul + v*(ll - ul) + u*(lr - ll);
+}
+
+// grid vertex at chunk-local (x, y); clamped samples keep the last
+//   column/row's position too
+TerrainMeshAttribute chunkVertex(
+  PulcTerrainHeightfield const & heightfield,
+  TerrainChunk const & chunk, size_t const x, size_t const y
+) {
+  size_t const sx = std::min(chunk.sampleX + x, heightfield.width - 1);
+  size_t const sy = std::min(chunk.sampleY + y, heightfield.height - 1);
+  // central differences, one-sided at the map edges
+  size_t const x0 = sx > 0 ? sx-1 : sx;
+  size_t const x1 = std::min(sx+1, heightfield.width - 1);
+  size_t const y0 = sy > 0 ? sy-1 : sy;
+  size_t const y1 = std::min(sy+1, heightfield.height - 1);
+  float const gradientX = (
+    (
+        pulcTerrainHeightfieldAt(&heightfield, x1, sy)
+      - pulcTerrainHeightfieldAt(&heightfield, x0, sy)
+    ) / ((x1 - x0)*heightfield.spacing.x)
+  );
+  float const gradientY = (
+    (
+        pulcTerrainHeightfieldAt(&heightfield, sx, y1)
+      - pulcTerrainHeightfieldAt(&heightfield, sx, y0)
+    ) / ((y1 - y0)*heightfield.spacing.y)
+  );
+  float const invLength = (
+    1.0f / std::sqrt(1.0f + gradientX*gradientX + gradientY*gradientY)
+  );
+  return TerrainMeshAttribute {
+    .origin = PuleF32v3 {
+      heightfield.origin.x + sx*heightfield.spacing.x,
+      pulcTerrainHeightfieldAt(&heightfield, sx, sy),
+      heightfield.origin.y + sy*heightfield.spacing.y,
+    },
+    .normal = PuleF32v3 {
+      -gradientX*invLength, invLength, -gradientY*invLength,
+    },
+  };
+}
+
+void chunkLodErrorsUpdate(
+  TerrainChunk & chunk, PulcTerrainHeightfield const & heightfield
+) {
+  // lodError[0] is zero, every coarser level is at least as bad as the last
+  chunk.lodError[0] = 0.0f;
+  for (size_t lod = 1; lod < terrainChunkLodCount; ++ lod) {
+    size_t const step = size_t(1) << lod;
+    float error = chunk.lodError[lod-1];
+    for (size_t y = 0; y <= terrainChunkQuads; ++ y)
+    for (size_t x = 0; x <= terrainChunkQuads; ++ x) {
+      if (x % step == 0 && y % step == 0) { continue; }
+      error = std::max(
+        error,
+        std::abs(
+            lodHeight(heightfield, chunk, step, x, y)
+          - chunkHeight(heightfield, chunk, x, y)
+        )
+      );
+    }
+    chunk.lodError[lod] = error;
+  }
+}
+
+struct ChunkExtent {
+  float heightMin, heightMax;
+  float slopeSqrMax;
+};
+
+// writes the grid vertices in the inclusive chunk-local rectangle, or only
+//   measures them without vertices
+ChunkExtent chunkGridWrite(
+  TerrainChunk const & chunk, PulcTerrainHeightfield const & heightfield,
+  TerrainMeshAttribute * const vertices,
+  size_t const x0, size_t const y0, size_t const x1, size_t const y1
+) {
+  auto extent = ChunkExtent {
+    .heightMin = INFINITY, .heightMax = -INFINITY, .slopeSqrMax = 0.0f,
+  };
+  for (size_t y = y0; y <= y1; ++ y)
+  for (size_t x = x0; x <= x1; ++ x) {
+    TerrainMeshAttribute const vertex = chunkVertex(heightfield, chunk, x, y);
+    if (vertices) { vertices[gridVertex(x, y)] = vertex; }
+    extent.heightMin = std::min(extent.heightMin, vertex.origin.y);
+    extent.heightMax = std::max(extent.heightMax, vertex.origin.y);
+    // rise over run from the normal, n = (-gx, 1, -gy)/length
+    float const ny = vertex.normal.y;
+    extent.slopeSqrMax = std::max(
+      extent.slopeSqrMax,
+      (vertex.normal.x*vertex.normal.x + vertex.normal.z*vertex.normal.z)
+        / (ny*ny)
+    );
+  }
+  return extent;
+}
+
+// deep enough to cover the gap to a neighbour at any LOD
+float chunkSkirtDepth(
+  TerrainChunk const & chunk, PulcTerrainHeightfield const & heightfield
+) {
+  return std::max(
+    chunk.lodError[terrainChunkLodCount-1],
+    std::max(heightfield.spacing.x, heightfield.spacing.y)
+  );
+}
+
+// bounds and slope of the whole grid, skirts included
+void chunkExtentApply(
+  TerrainChunk & chunk, PulcTerrainHeightfield const & heightfield,
+  ChunkExtent const & extent
+) {
+  TerrainMeshAttribute const first = chunkVertex(heightfield, chunk, 0, 0);
+  TerrainMeshAttribute const last = (
+    chunkVertex(heightfield, chunk, terrainChunkQuads, terrainChunkQuads)
+  );
+  chunk.boundsMin = PuleF32v3 {
+    first.origin.x,
+    extent.heightMin - chunkSkirtDepth(chunk, heightfield),
+    first.origin.z,
+  };
+  chunk.boundsMax = PuleF32v3 {
+    last.origin.x, extent.heightMax, last.origin.z,
+  };
+  chunk.slopeMax = std::sqrt(extent.slopeSqrMax);
+}
+
+// skirts copy their edge vertex, normal included, so they shade like it
+void chunkSkirtsWrite(
+  TerrainChunk const & chunk, PulcTerrainHeightfield const & heightfield,
+  TerrainMeshAttribute * const vertices
+) {
+  float const skirtDepth = chunkSkirtDepth(chunk, heightfield);
+  for (size_t it = 0; it <= terrainChunkQuads; ++ it) {
+    size_t const edgeGrid[4][2] = {
+      { it, 0, }, { it, terrainChunkQuads, },
+      { 0, it, }, { terrainChunkQuads, it, },
+    };
+    for (size_t edge = 0; edge < 4; ++ edge) {
+      TerrainMeshAttribute vertex = chunkVertex(
+        heightfield, chunk, edgeGrid[edge][0], edgeGrid[edge][1]
+      );
+      vertex.origin.y -= skirtDepth;
+      vertices[skirtVertex(edge, it)] = vertex;
+    }
+  }
+}
+
+} // namespace
+
+void terrainChunksLayout(
+  TerrainChunks & chunks, PulcTerrainHeightfield const & heightfield
+) {
+  size_t const quadsX = heightfield.width - 1;
+  size_t const quadsY = heightfield.height - 1;
+  chunks.chunksX = (quadsX + terrainChunkQuads - 1) / terrainChunkQuads;
+  chunks.chunksY = (quadsY + terrainChunkQuads - 1) / terrainChunkQuads;
+  chunks.chunks.resize(chunks.chunksX * chunks.chunksY);
+  for (size_t cy = 0; cy < chunks.chunksY; ++ cy)
+  for (size_t cx = 0; cx < chunks.chunksX; ++ cx) {
+    TerrainChunk & chunk = chunks.chunks[cy*chunks.chunksX + cx];
+    chunk.sampleX = cx * terrainChunkQuads;
+    chunk.sampleY = cy * terrainChunkQuads;
+    chunk.lod = 0;
+    std::fill(std::begin(chunk.lodError), std::end(chunk.lodError), 0.0f);
+    chunk.slopeMax = 0.0f;
+    chunk.visible = false;
+    chunk.state = TerrainChunkState_unbuilt;
+
+    size_t const sampleX1 = (
+      std::min(chunk.sampleX + terrainChunkQuads, heightfield.width - 1)
+    );
+    size_t const sampleY1 = (
+      std::min(chunk.sampleY + terrainChunkQuads, heightfield.height - 1)
+    );
+    chunk.boundsMin = PuleF32v3 {
+      heightfield.origin.x + chunk.sampleX*heightfield.spacing.x,
+      INFINITY,
+      heightfield.origin.y + chunk.sampleY*heightfield.spacing.y,
+    };
+    chunk.boundsMax = PuleF32v3 {
+      heightfield.origin.x + sampleX1*heightfield.spacing.x,
+      -INFINITY,
+      heightfield.origin.y + sampleY1*heightfield.spacing.y,
+    };
+    size_t const shift = heightfield.tileShift;
+    for (size_t ty = chunk.sampleY >> shift; ty <= sampleY1 >> shift; ++ ty)
+    for (size_t tx = chunk.sampleX >> shift; tx <= sampleX1 >> shift; ++ tx) {
+      PulcTerrainHeightfieldTile const & tile = (
+        heightfield.tiles[ty*heightfield.tilesX + tx]
+      );
+      chunk.boundsMin.y = std::min(chunk.boundsMin.y, tile.heightMin);
+      chunk.boundsMax.y = std::max(
+        chunk.boundsMax.y, tile.heightMin + 65535.0f*tile.heightScale
+      );
+    }
+  }
+
+  chunks.elements.clear();
+  for (size_t lod = 0; lod < terrainChunkLodCount; ++ lod) {
+    size_t const offset = chunks.elements.size();
+    appendLodElements(chunks.elements, size_t(1) << lod);
+    chunks.lods[lod] = TerrainChunkLod {
+      .elementOffset = offset,
+      .elementCount = chunks.elements.size() - offset,
+    };
+  }
+}
+
+void terrainChunkBuild(
+  TerrainChunk & chunk, PulcTerrainHeightfield const & heightfield,
+  TerrainMeshAttribute * const vertices
+) {
+  chunkLodErrorsUpdate(chunk, heightfield);
+  chunkExtentApply(
+    chunk, heightfield,
+    chunkGridWrite(
+      chunk, heightfield, vertices,
+      0, 0, terrainChunkQuads, terrainChunkQuads
+    )
+  );
+  chunkSkirtsWrite(chunk, heightfield, vertices);
+}
+
+void terrainChunkUpdate(
+  TerrainChunk & chunk, PulcTerrainHeightfield const & heightfield,
+  TerrainMeshAttribute * const vertices,
+  PulcTerrainHeightfieldEdit const & edit,
+  FrameArenaVector<TerrainChunkVertexRange> & ranges
+) {
+  ranges.clear();
+  // normals read their neighbours, so one sample around the edit changed too
+  size_t const sampleX0 = std::max(edit.x0, size_t(1)) - 1;
+  size_t const sampleY0 = std::max(edit.y0, size_t(1)) - 1;
+  size_t const sampleX1 = edit.x1 + 1;
+  size_t const sampleY1 = edit.y1 + 1;
+  if (
+       sampleX1 < chunk.sampleX || sampleX0 > chunk.sampleX + terrainChunkQuads
+    || sampleY1 < chunk.sampleY || sampleY0 > chunk.sampleY + terrainChunkQuads
+  ) {
+    return;
+  }
+  size_t const x0 = std::max(sampleX0, chunk.sampleX) - chunk.sampleX;
+  size_t const y0 = std::max(sampleY0, chunk.sampleY) - chunk.sampleY;
+  size_t const x1 = (
+    std::min(sampleX1, chunk.sampleX + terrainChunkQuads) - chunk.sampleX
+  );
+  size_t const y1 = (
+    std::min(sampleY1, chunk.sampleY + terrainChunkQuads) - chunk.sampleY
+  );
+
+  chunkLodErrorsUpdate(chunk, heightfield);
+  chunkGridWrite(chunk, heightfield, vertices, x0, y0, x1, y1);
+  // bounds and slope can shrink too, so they're measured over every vertex
+  chunkExtentApply(
+    chunk, heightfield,
+    chunkGridWrite(
+      chunk, heightfield, nullptr,
+      0, 0, terrainChunkQuads, terrainChunkQuads
+    )
+  );
+  // skirt depth follows the coarsest LOD error, which any edit can move
+  chunkSkirtsWrite(chunk, heightfield, vertices);
+
+  // a row each, unless the rows are whole and so contiguous
+  for (size_t y = y0; y <= y1; ++ y) {
+    size_t const offset = gridVertex(x0, y);
+    size_t const count = x1 - x0 + 1;
+    if (
+         !ranges.empty()
+      && ranges.back().vertexOffset + ranges.back().vertexCount == offset
+    ) {
+      ranges.back().vertexCount += count;
+      continue;
+    }
+    ranges.emplace_back(TerrainChunkVertexRange {
+      .vertexOffset = offset, .vertexCount = count,
+    });
+  }
+  ranges.emplace_back(TerrainChunkVertexRange {
+    .vertexOffset = terrainChunkGridVertices,
+    .vertexCount = terrainChunkVertices - terrainChunkGridVertices,
+  });
+}
+
+TerrainFrustum terrainFrustumFromViewProjection(
+  PuleF32m44 const & view, PuleF32m44 const & proj
+) {
+  // clip = proj*view, elem[column*4 + row]
+  float clip[16];
+  for (size_t column = 0; column < 4; ++ column)
+  for (size_t row = 0; row < 4; ++ row) {
+    float sum = 0.0f;
+    for (size_t k = 0; k < 4; ++ k) {
+      sum += proj.elem[k*4 + row] * view.elem[column*4 + k];
+    }
+    clip[column*4 + row] = sum;
+  }
+
+  // -w <= x,y,z <= w, planes are the w row plus or minus each axis row
+  TerrainFrustum frustum;
+  for (size_t plane = 0; plane < 6; ++ plane) {
+    size_t const axis = plane / 2;
+    float const sign = (plane % 2 == 0) ? 1.0f : -1.0f;
+    float * const coefficients = frustum.planes[plane];
+    for (size_t column = 0; column < 4; ++ column) {
+      coefficients[column] = (
+        clip[column*4 + 3] + sign*clip[column*4 + axis]
+      );
+    }
+    float const length = std::sqrt(
+        coefficients[0]*coefficients[0]
+      + coefficients[1]*coefficients[1]
+      + coefficients[2]*coefficients[2]
+    );
+    float const invLength = length > 0.0f ? 1.0f/length : 0.0f;
+    for (size_t it = 0; it < 4; ++ it) {
+      coefficients[it] *= invLength;
+    }
+  }
+  return frustum;
+}
+
+void terrainChunksCull(
+  TerrainChunks & chunks, TerrainFrustum const & frustum
+) {
+  for (TerrainChunk & chunk : chunks.chunks) {
+    // outside once the box corner furthest along a plane's normal is behind
+    chunk.visible = true;
+    for (size_t plane = 0; plane < 6 && chunk.visible; ++ plane) {
+      float const * const p = frustum.planes[plane];
+      float const x = p[0] >= 0.0f ? chunk.boundsMax.x : chunk.boundsMin.x;
+      float const y = p[1] >= 0.0f ? chunk.boundsMax.y : chunk.boundsMin.y;
+      float const z = p[2] >= 0.0f ? chunk.boundsMax.z : chunk.boundsMin.z;
+      chunk.visible = p[0]*x + p[1]*y + p[2]*z + p[3] >= 0.0f;
+    }
+  }
+}
+
+void terrainChunksSelectLod(
+  TerrainChunks & chunks, PuleF32v3 const eye,
+  float const pixelsPerUnit, float const maxPixelError
+) {
+  for (TerrainChunk & chunk : chunks.chunks) {
+    // distance to the closest point of the chunk's bounds
+    float const dx = std::max(
+      { chunk.boundsMin.x - eye.x, 0.0f, eye.x - chunk.boundsMax.x, }
+    );
+    float const dy = std::max(
+      { chunk.boundsMin.y - eye.y, 0.0f, eye.y - chunk.boundsMax.y, }
+    );
+    float const dz = std::max(
+      { chunk.boundsMin.z - eye.z, 0.0f, eye.z - chunk.boundsMax.z, }
+    );
+    float const distance = std::sqrt(dx*dx + dy*dy + dz*dz);
+    // errors never shrink with coarser levels, so stop at the first miss
+    uint8_t lod = 0;
+    while (
+         lod + 1u < terrainChunkLodCount
+      && chunk.lodError[lod+1]*pixelsPerUnit <= maxPixelError*distance
+    ) {
+      ++ lod;
+    }
+    chunk.lod = lod;
+  }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "../terrain.h"
+
+#include "../../graph/memory/frame-arena.h"
+
+#include <pulchritude-math/math.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// the heightfield is split into square chunks of terrainChunkQuads quads.
+//   Every chunk has the same vertex layout, so all chunks share one index
+//   list per LOD level and only differ in their base vertex:
+//     (quads+1)^2 grid vertices, row-major
+//     4*(quads+1) skirt vertices, top, bottom, left then right edge
+//   Skirts hang below the chunk's edges to hide the cracks between
+//   neighbours at different LOD levels. Chunks at the far map edges repeat
+//   the last sample, which collapses their outside quads to nothing
+
+size_t constexpr terrainChunkQuads = 64;
+// LOD l skips 2^l samples, the coarsest is two triangles per chunk
+size_t constexpr terrainChunkLodCount = 7;
+size_t constexpr terrainChunkGridVertices = (
+  (terrainChunkQuads + 1) * (terrainChunkQuads + 1)
+);
+size_t constexpr terrainChunkVertices = (
+  terrainChunkGridVertices + 4*(terrainChunkQuads + 1)
+);
+
+struct TerrainMeshAttribute {
+  PuleF32v3 origin;
+  PuleF32v3 normal;
+};
+
+// vertices of a chunk, relative to its first
+struct TerrainChunkVertexRange {
+  size_t vertexOffset;
+  size_t vertexCount;
+};
+
+struct TerrainChunkLod {
+  size_t elementOffset; // in elements
+  size_t elementCount;
+};
+
+enum TerrainChunkState : uint8_t {
+  TerrainChunkState_unbuilt,
+  TerrainChunkState_building,
+  TerrainChunkState_built,
+};
+
+struct TerrainChunk {
+  size_t sampleX, sampleY; // sample at the chunk's first grid vertex
+  // until built, heights are bounded by the ranges of the tiles it covers
+  PuleF32v3 boundsMin, boundsMax;
+  // worst height difference to full detail per LOD, never decreasing
+  float lodError[terrainChunkLodCount];
+  float slopeMax; // steepest rise over run of any vertex
+  uint8_t lod;
+  bool visible;
+  // vertices are built the first time the chunk is visible, so only the
+  //   heightfield tiles the camera has seen get paged in
+  TerrainChunkState state;
+};
+
+// normalized planes, inside is a*x + b*y + c*z + d >= 0
+struct TerrainFrustum {
+  float planes[6][4];
+};
+
+struct TerrainChunks {
+  size_t chunksX, chunksY;
+  std::vector<TerrainChunk> chunks; // row-major
+  std::vector<uint16_t> elements; // every LOD's index list back to back
+  TerrainChunkLod lods[terrainChunkLodCount];
+};
+
+// sizes the chunk grid for the heightfield and builds the shared index
+//   lists; chunk vertices still have to be built. Only reads the tile
+//   directory, not samples
+void terrainChunksLayout(
+  TerrainChunks & chunks, PulcTerrainHeightfield const & heightfield
+);
+
+// writes the chunk's terrainChunkVertices vertices and refreshes its
+//   bounds, slope and LOD errors from the heightfield; touches nothing but
+//   the chunk and its vertices, so chunks can be built concurrently
+void terrainChunkBuild(
+  TerrainChunk & chunk, PulcTerrainHeightfield const & heightfield,
+  TerrainMeshAttribute * const vertices
+);
+
+// rewrites only the chunk's vertices the edited samples reach, refreshes its
+//   bounds, slope and LOD errors, and lists the vertex ranges written for
+//   flushing; ranges is left empty if the edit misses the chunk
+void terrainChunkUpdate(
+  TerrainChunk & chunk, PulcTerrainHeightfield const & heightfield,
+  TerrainMeshAttribute * const vertices,
+  PulcTerrainHeightfieldEdit const & edit,
+  FrameArenaVector<TerrainChunkVertexRange> & ranges
+);
+
+// matrices as handed to the shader, column-major with clip = proj*view
+TerrainFrustum terrainFrustumFromViewProjection(
+  PuleF32m44 const & view, PuleF32m44 const & proj
+);
+
+// sets every chunk's visible flag from its bounds
+void terrainChunksCull(
+  TerrainChunks & chunks, TerrainFrustum const & frustum
+);
+
+// picks the coarsest LOD per chunk whose error stays under maxPixelError on
+//   screen; pixelsPerUnit is the projected size of one world unit at
+//   distance one
+void terrainChunksSelectLod(
+  TerrainChunks & chunks, PuleF32v3 const eye,
+  float const pixelsPerUnit, float const maxPixelError
+);
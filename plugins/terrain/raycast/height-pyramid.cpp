@@ -0,0 +1,575 @@
+#include "height-pyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
+
+namespace {
+
+HeightPyramidNode nodeLoad(HeightPyramidNode const & node) {
+  HeightPyramidNode value;
+  __atomic_load(&node.heightMin, &value.heightMin, __ATOMIC_RELAXED);
+  __atomic_load(&node.heightMax, &value.heightMax, __ATOMIC_RELAXED);
+  return value;
+}
+
+void nodeStore(HeightPyramidNode & node, HeightPyramidNode const & value) {
+  __atomic_store(&node.heightMin, &value.heightMin, __ATOMIC_RELAXED);
+  __atomic_store(&node.heightMax, &value.heightMax, __ATOMIC_RELAXED);
+}
+
+// exact range over the inclusive sample rectangle
+HeightPyramidNode samplesRange(
+  PulcTerrainHeightfield const & heightfield,
+  size_t const x0, size_t const y0, size_t const x1, size_t const y1
+) {
+  size_t const shift = heightfield.tileShift;
+  size_t const mask = (size_t(1) << shift) - 1;
+  if ((x0 >> shift) == (x1 >> shift) && (y0 >> shift) == (y1 >> shift)) {
+    // inside one tile, straight off its heights or samples
+    PulcTerrainHeightfieldTile const & tile = (
+      *pulcTerrainHeightfieldTile(&heightfield, x0, y0)
+    );
+    float const * const heights = (
+      __atomic_load_n(&tile.heights, __ATOMIC_ACQUIRE)
+    );
+    if (heights) {
+      auto range = HeightPyramidNode { INFINITY, -INFINITY, };
+      for (size_t y = y0 & mask; y <= (y1 & mask); ++ y)
+      for (size_t x = x0 & mask; x <= (x1 & mask); ++ x) {
+        float height;
+        __atomic_load(&heights[(y << shift) + x], &height, __ATOMIC_RELAXED);
+        range.heightMin = std::min(range.heightMin, height);
+        range.heightMax = std::max(range.heightMax, height);
+      }
+      return range;
+    }
+    // quantization is monotonic, so the range of the samples will do
+    uint16_t sampleMin = UINT16_MAX, sampleMax = 0;
+    for (size_t y = y0 & mask; y <= (y1 & mask); ++ y)
+    for (size_t x = x0 & mask; x <= (x1 & mask); ++ x) {
+      uint16_t const sample = tile.samples[(y << shift) + x];
+      sampleMin = std::min(sampleMin, sample);
+      sampleMax = std::max(sampleMax, sample);
+    }
+    return HeightPyramidNode {
+      tile.heightMin + sampleMin*tile.heightScale,
+      tile.heightMin + sampleMax*tile.heightScale,
+    };
+  }
+  auto range = HeightPyramidNode { INFINITY, -INFINITY, };
+  for (size_t y = y0; y <= y1; ++ y)
+  for (size_t x = x0; x <= x1; ++ x) {
+    float const height = pulcTerrainHeightfieldAt(&heightfield, x, y);
+    range.heightMin = std::min(range.heightMin, height);
+    range.heightMax = std::max(range.heightMax, height);
+  }
+  return range;
+}
+
+// bounds the tile's heights, its samples reach its quantization range
+HeightPyramidNode tileRange(
+  PulcTerrainHeightfield const & heightfield, size_t const tx, size_t const ty
+) {
+  PulcTerrainHeightfieldTile const & tile = (
+    heightfield.tiles[ty*heightfield.tilesX + tx]
+  );
+  size_t const tileDim = size_t(1) << heightfield.tileShift;
+  if (__atomic_load_n(&tile.heights, __ATOMIC_ACQUIRE)) {
+    // edited, the range is no longer the quantization's
+    return samplesRange(
+      heightfield, tx*tileDim, ty*tileDim,
+      std::min((tx + 1)*tileDim, heightfield.width) - 1,
+      std::min((ty + 1)*tileDim, heightfield.height) - 1
+    );
+  }
+  return HeightPyramidNode {
+    tile.heightMin, tile.heightMin + 65535.0f*tile.heightScale,
+  };
+}
+
+// inclusive node ranges, leaves from samples and the rest from children
+void leavesRefresh(
+  HeightPyramid & pyramid,
+  size_t const nx0, size_t const ny0, size_t const nx1, size_t const ny1
+) {
+  HeightPyramidLevel & level = pyramid.levels[0];
+  for (size_t ny = ny0; ny <= ny1; ++ ny)
+  for (size_t nx = nx0; nx <= nx1; ++ nx) {
+    // a node's cells reach one sample past its last cell
+    nodeStore(
+      level.nodes[ny*level.nodesX + nx],
+      samplesRange(
+        pyramid.heightfield,
+        nx << level.shift, ny << level.shift,
+        std::min((nx + 1) << level.shift, pyramid.cellsX),
+        std::min((ny + 1) << level.shift, pyramid.cellsY)
+      )
+    );
+  }
+}
+
+void parentsRefresh(
+  HeightPyramid & pyramid, size_t const levelIndex,
+  size_t const nx0, size_t const ny0, size_t const nx1, size_t const ny1
+) {
+  HeightPyramidLevel & level = pyramid.levels[levelIndex];
+  HeightPyramidLevel const & child = pyramid.levels[levelIndex - 1];
+  for (size_t ny = ny0; ny <= ny1; ++ ny)
+  for (size_t nx = nx0; nx <= nx1; ++ nx) {
+    auto range = HeightPyramidNode { INFINITY, -INFINITY, };
+    for (size_t cy = 2*ny; cy <= std::min(2*ny + 1, child.nodesY - 1); ++ cy)
+    for (size_t cx = 2*nx; cx <= std::min(2*nx + 1, child.nodesX - 1); ++ cx) {
+      HeightPyramidNode const node = (
+        nodeLoad(child.nodes[cy*child.nodesX + cx])
+      );
+      range.heightMin = std::min(range.heightMin, node.heightMin);
+      range.heightMax = std::max(range.heightMax, node.heightMax);
+    }
+    nodeStore(level.nodes[ny*level.nodesX + nx], range);
+  }
+}
+
+// nodes of the block level from the ranges of the tiles under them
+void blockLevelBound(HeightPyramid & pyramid) {
+  PulcTerrainHeightfield const & heightfield = pyramid.heightfield;
+  HeightPyramidLevel & level = pyramid.levels[pyramid.blockLevel];
+  size_t const tileShift = heightfield.tileShift;
+  for (size_t ny = 0; ny < level.nodesY; ++ ny)
+  for (size_t nx = 0; nx < level.nodesX; ++ nx) {
+    // a node's cells reach one sample past its last cell
+    size_t const tx1 = (
+      std::min((nx + 1) << level.shift, pyramid.cellsX) >> tileShift
+    );
+    size_t const ty1 = (
+      std::min((ny + 1) << level.shift, pyramid.cellsY) >> tileShift
+    );
+    auto range = HeightPyramidNode { INFINITY, -INFINITY, };
+    for (size_t ty = (ny << level.shift) >> tileShift; ty <= ty1; ++ ty)
+    for (size_t tx = (nx << level.shift) >> tileShift; tx <= tx1; ++ tx) {
+      HeightPyramidNode const tile = tileRange(heightfield, tx, ty);
+      range.heightMin = std::min(range.heightMin, tile.heightMin);
+      range.heightMax = std::max(range.heightMax, tile.heightMax);
+    }
+    nodeStore(level.nodes[ny*level.nodesX + nx], range);
+  }
+}
+
+// fills in the levels under the block level's node, once; a thread reaching
+//   a block another one is building waits for it
+void blockEnsure(HeightPyramid & pyramid, size_t const bx, size_t const by) {
+  HeightPyramidLevel const & blocks = pyramid.levels[pyramid.blockLevel];
+  uint8_t & state = pyramid.blockStates[by*blocks.nodesX + bx];
+  if (
+    __atomic_load_n(&state, __ATOMIC_ACQUIRE) == HeightPyramidBlock_built
+  ) {
+    return;
+  }
+  uint8_t expected = HeightPyramidBlock_unbuilt;
+  if (
+    !__atomic_compare_exchange_n(
+      &state, &expected, HeightPyramidBlock_building, false,
+      __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE
+    )
+  ) {
+    while (
+      __atomic_load_n(&state, __ATOMIC_ACQUIRE) != HeightPyramidBlock_built
+    ) {
+      std::this_thread::yield();
+    }
+    return;
+  }
+  size_t const levelCount = pyramid.blockLevel;
+  auto const nodeRange = [&](
+    size_t const level, size_t const b, size_t const nodes
+  ) {
+    size_t const shift = levelCount - level;
+    return std::pair {
+      b << shift, std::min(((b + 1) << shift) - 1, nodes - 1),
+    };
+  };
+  for (size_t it = 0; it < levelCount; ++ it) {
+    HeightPyramidLevel const & level = pyramid.levels[it];
+    auto const [nx0, nx1] = nodeRange(it, bx, level.nodesX);
+    auto const [ny0, ny1] = nodeRange(it, by, level.nodesY);
+    if (it == 0) {
+      leavesRefresh(pyramid, nx0, ny0, nx1, ny1);
+    } else {
+      parentsRefresh(pyramid, it, nx0, ny0, nx1, ny1);
+    }
+  }
+  __atomic_store_n(&state, HeightPyramidBlock_built, __ATOMIC_RELEASE);
+}
+
+// -- trace --------------------------------------------------------------------
+
+// the ray in sample units across, world units up
+struct Ray {
+  double ox, oy, oz;
+  double dx, dy, dz;
+};
+
+void cellCorners(
+  PulcTerrainHeightfield const & heightfield,
+  int64_t const cx, int64_t const cz, float (&corners)[4]
+) {
+  corners[0] = pulcTerrainHeightfieldAt(&heightfield, cx, cz);
+  corners[1] = pulcTerrainHeightfieldAt(&heightfield, cx+1, cz);
+  corners[2] = pulcTerrainHeightfieldAt(&heightfield, cx, cz+1);
+  corners[3] = pulcTerrainHeightfieldAt(&heightfield, cx+1, cz+1);
+}
+
+// first t in [tBegin, tEnd] where the ray meets the cell's bilinear patch.
+//   Along the ray the patch height is quadratic in t, so is the ray's height
+//   above it, and the hit is that quadratic's first root
+bool cellRaycast(
+  Ray const & ray, int64_t const cx, int64_t const cz,
+  float const (&corners)[4], double const tBegin, double const tEnd,
+  double & t
+) {
+  double const a = corners[0];
+  double const b = corners[1] - corners[0];
+  double const c = corners[2] - corners[0];
+  double const d = corners[0] - corners[1] - corners[2] + corners[3];
+  double const u0 = ray.ox + ray.dx*tBegin - cx;
+  double const v0 = ray.oz + ray.dz*tBegin - cz;
+  // above(s) = q0 + q1*s + q2*s^2, s = t - tBegin
+  double const q0 = (
+    ray.oy + ray.dy*tBegin - (a + b*u0 + c*v0 + d*u0*v0)
+  );
+  double const q1 = (
+    ray.dy - (b*ray.dx + c*ray.dz + d*(u0*ray.dz + v0*ray.dx))
+  );
+  double const q2 = -d*ray.dx*ray.dz;
+  double const length = tEnd - tBegin;
+  if (q0 <= 0.0) {
+    t = tBegin;
+    return true;
+  }
+  double s = std::numeric_limits<double>::infinity();
+  if (std::abs(q2) < 1e-12) {
+    if (q1 < 0.0) { s = -q0/q1; }
+  } else {
+    double const discriminant = q1*q1 - 4.0*q2*q0;
+    if (discriminant < 0.0) { return false; }
+    // the stable pair of roots, both positive ones are candidates
+    double const q = -0.5*(q1 + std::copysign(std::sqrt(discriminant), q1));
+    double const roots[2] = { q/q2, q != 0.0 ? q0/q : -1.0, };
+    for (double const root : roots) {
+      if (root >= 0.0) { s = std::min(s, root); }
+    }
+  }
+  if (s > length) { return false; }
+  t = tBegin + s;
+  return true;
+}
+
+// node holding p along the direction of travel, so a node boundary belongs
+//   to the node the ray enters
+int64_t nodeAlong(
+  double const p, double const d, double const size, int64_t const count
+) {
+  double const q = p / size;
+  int64_t const node = static_cast<int64_t>(
+    d >= 0.0 ? std::floor(q + 1e-9) : std::ceil(q - 1e-9) - 1.0
+  );
+  return std::clamp<int64_t>(node, 0, count - 1);
+}
+
+// -- line of sight ------------------------------------------------------------
+
+// highest ground under the inclusive cell rectangle, off the finest level
+//   from the block level up that covers it with two nodes a side; those
+//   levels never wait on a block being built. levelIndex is the one used
+float groundCeiling(
+  HeightPyramid const & pyramid,
+  size_t const cx0, size_t const cz0, size_t const cx1, size_t const cz1,
+  size_t & levelIndex
+) {
+  levelIndex = pyramid.blockLevel;
+  auto const spans = [&](size_t const shift) {
+    return (cx1 >> shift) - (cx0 >> shift) > 1
+        || (cz1 >> shift) - (cz0 >> shift) > 1;
+  };
+  while (
+       levelIndex + 1 < pyramid.levels.size()
+    && spans(pyramid.levels[levelIndex].shift)
+  ) {
+    ++ levelIndex;
+  }
+  HeightPyramidLevel const & level = pyramid.levels[levelIndex];
+  float ceiling = -INFINITY;
+  for (size_t nz = cz0 >> level.shift; nz <= (cz1 >> level.shift); ++ nz)
+  for (size_t nx = cx0 >> level.shift; nx <= (cx1 >> level.shift); ++ nx) {
+    ceiling = std::max(
+      ceiling, nodeLoad(level.nodes[nz*level.nodesX + nx]).heightMax
+    );
+  }
+  return ceiling;
+}
+
+} // namespace
+
+void heightPyramidBuild(
+  HeightPyramid & pyramid, PulcTerrainHeightfield const & heightfield
+) {
+  pyramid.heightfield = heightfield;
+  pyramid.cellsX = heightfield.width - 1;
+  pyramid.cellsY = heightfield.height - 1;
+  pyramid.levels.clear();
+  for (size_t shift = heightPyramidLeafShift;; ++ shift) {
+    size_t const dim = size_t(1) << shift;
+    HeightPyramidLevel level;
+    level.shift = shift;
+    level.nodesX = (pyramid.cellsX + dim - 1) / dim;
+    level.nodesY = (pyramid.cellsY + dim - 1) / dim;
+    level.nodes.resize(level.nodesX * level.nodesY);
+    pyramid.levels.emplace_back(std::move(level));
+    if (pyramid.levels.back().nodes.size() == 1) { break; }
+  }
+
+  // blocks of at least a tile, so each reads as few tiles as it can
+  size_t const blockShift = std::max(
+    heightfield.tileShift, heightPyramidLeafShift + 1
+  );
+  pyramid.blockLevel = std::min(
+    blockShift - heightPyramidLeafShift, pyramid.levels.size() - 1
+  );
+  HeightPyramidLevel const & blocks = pyramid.levels[pyramid.blockLevel];
+  pyramid.blockStates.assign(
+    blocks.nodes.size(), HeightPyramidBlock_unbuilt
+  );
+  if (pyramid.blockLevel == 0) {
+    // a map smaller than a leaf's parent, read it all
+    leavesRefresh(pyramid, 0, 0, blocks.nodesX - 1, blocks.nodesY - 1);
+    pyramid.blockStates.assign(
+      blocks.nodes.size(), HeightPyramidBlock_built
+    );
+  } else {
+    blockLevelBound(pyramid);
+  }
+  for (size_t it = pyramid.blockLevel + 1; it < pyramid.levels.size(); ++ it) {
+    parentsRefresh(
+      pyramid, it, 0, 0,
+      pyramid.levels[it].nodesX - 1, pyramid.levels[it].nodesY - 1
+    );
+  }
+}
+
+void heightPyramidUpdate(
+  HeightPyramid & pyramid, PulcTerrainHeightfieldEdit const & edit
+) {
+  if (pyramid.levels.empty()) { return; }
+  // a sample is a corner of the cells on both sides of it
+  size_t const shift = heightPyramidLeafShift;
+  HeightPyramidLevel const & leaves = pyramid.levels[0];
+  size_t nx0 = (std::max(edit.x0, size_t(1)) - 1) >> shift;
+  size_t ny0 = (std::max(edit.y0, size_t(1)) - 1) >> shift;
+  size_t nx1 = std::min(edit.x1 >> shift, leaves.nodesX - 1);
+  size_t ny1 = std::min(edit.y1 >> shift, leaves.nodesY - 1);
+  if (nx0 > nx1 || ny0 > ny1) { return; }
+  // refreshing a block never built would leave the rest of it unset
+  size_t const blockShift = pyramid.blockLevel;
+  for (size_t by = ny0 >> blockShift; by <= (ny1 >> blockShift); ++ by)
+  for (size_t bx = nx0 >> blockShift; bx <= (nx1 >> blockShift); ++ bx) {
+    blockEnsure(pyramid, bx, by);
+  }
+  leavesRefresh(pyramid, nx0, ny0, nx1, ny1);
+  for (size_t it = 1; it < pyramid.levels.size(); ++ it) {
+    nx0 >>= 1; ny0 >>= 1;
+    nx1 >>= 1; ny1 >>= 1;
+    parentsRefresh(pyramid, it, nx0, ny0, nx1, ny1);
+  }
+}
+
+namespace {
+
+// level 0 is the cells, level l > 0 is pyramid.levels[l-1]; starting under
+//   the root the ray climbs out of its first node as needed, a start at or
+//   above the block level's parents still builds every block it descends to
+bool pyramidTrace(
+  HeightPyramid & pyramid,
+  PuleF32v3 const origin, PuleF32v3 const direction, float const tMax,
+  size_t const levelStart, float & t
+) {
+  PulcTerrainHeightfield const & heightfield = pyramid.heightfield;
+  auto const ray = Ray {
+    .ox = (double(origin.x) - heightfield.origin.x) / heightfield.spacing.x,
+    .oy = origin.y,
+    .oz = (double(origin.z) - heightfield.origin.y) / heightfield.spacing.y,
+    .dx = double(direction.x) / heightfield.spacing.x,
+    .dy = direction.y,
+    .dz = double(direction.z) / heightfield.spacing.y,
+  };
+  double const cellsX = static_cast<double>(pyramid.cellsX);
+  double const cellsZ = static_cast<double>(pyramid.cellsY);
+
+  // clipped to the map
+  double tBegin = 0.0, tEnd = tMax;
+  auto const clip = [&](double const o, double const d, double const extent) {
+    if (d == 0.0) { return o >= 0.0 && o <= extent; }
+    double const ta = (0.0 - o) / d;
+    double const tb = (extent - o) / d;
+    tBegin = std::max(tBegin, std::min(ta, tb));
+    tEnd = std::min(tEnd, std::max(ta, tb));
+    return tBegin <= tEnd;
+  };
+  if (!clip(ray.ox, ray.dx, cellsX) || !clip(ray.oz, ray.dz, cellsZ)) {
+    return false;
+  }
+
+  size_t const top = pyramid.levels.size();
+  auto const levelShift = [&](size_t const level) -> int64_t {
+    return level == 0 ? 0 : pyramid.levels[level-1].shift;
+  };
+  double const infinity = std::numeric_limits<double>::infinity();
+
+  size_t level = std::min(levelStart, top);
+  double tNode = tBegin;
+  while (true) {
+    int64_t const shift = levelShift(level);
+    double const size = static_cast<double>(int64_t(1) << shift);
+    int64_t const nodesX = (
+      level == 0 ? pyramid.cellsX : pyramid.levels[level-1].nodesX
+    );
+    int64_t const nodesZ = (
+      level == 0 ? pyramid.cellsY : pyramid.levels[level-1].nodesY
+    );
+    int64_t const nx = nodeAlong(ray.ox + ray.dx*tNode, ray.dx, size, nodesX);
+    int64_t const nz = nodeAlong(ray.oz + ray.dz*tNode, ray.dz, size, nodesZ);
+
+    double const x0 = nx*size, x1 = std::min((nx + 1)*size, cellsX);
+    double const z0 = nz*size, z1 = std::min((nz + 1)*size, cellsZ);
+    double const tExitX = (
+        ray.dx > 0.0 ? (x1 - ray.ox)/ray.dx
+      : ray.dx < 0.0 ? (x0 - ray.ox)/ray.dx
+      : infinity
+    );
+    double const tExitZ = (
+        ray.dz > 0.0 ? (z1 - ray.oz)/ray.dz
+      : ray.dz < 0.0 ? (z0 - ray.oz)/ray.dz
+      : infinity
+    );
+    double const tExit = std::min({ tExitX, tExitZ, tEnd, });
+
+    float corners[4];
+    HeightPyramidNode node;
+    if (level == 0) {
+      cellCorners(heightfield, nx, nz, corners);
+      node = HeightPyramidNode {
+        std::min({ corners[0], corners[1], corners[2], corners[3], }),
+        std::max({ corners[0], corners[1], corners[2], corners[3], }),
+      };
+    } else {
+      node = nodeLoad(
+        pyramid.levels[level-1].nodes[nz*nodesX + nx]
+      );
+    }
+    double const rayLow = (
+      std::min(ray.oy + ray.dy*tNode, ray.oy + ray.dy*tExit)
+    );
+    if (rayLow <= node.heightMax) {
+      if (level > 0) {
+        if (level == pyramid.blockLevel + 1) {
+          blockEnsure(pyramid, nx, nz);
+        }
+        -- level;
+        continue;
+      }
+      double tHit;
+      if (cellRaycast(ray, nx, nz, corners, tNode, tExit, tHit)) {
+        t = static_cast<float>(tHit);
+        return true;
+      }
+    }
+    if (tExit >= tEnd) { return false; }
+
+    // climb for as long as the next node is under another parent
+    int64_t const cellX = nx << shift, cellZ = nz << shift;
+    int64_t const nextCellX = (
+      tExitX > tExit ? cellX : ray.dx > 0.0 ? (nx + 1) << shift : cellX - 1
+    );
+    int64_t const nextCellZ = (
+      tExitZ > tExit ? cellZ : ray.dz > 0.0 ? (nz + 1) << shift : cellZ - 1
+    );
+    while (level < top) {
+      int64_t const parentShift = levelShift(level + 1);
+      if (
+           (cellX >> parentShift) == (nextCellX >> parentShift)
+        && (cellZ >> parentShift) == (nextCellZ >> parentShift)
+      ) {
+        break;
+      }
+      ++ level;
+    }
+    tNode = tExit;
+  }
+}
+
+} // namespace
+
+bool heightPyramidRaycast(
+  HeightPyramid & pyramid,
+  PuleF32v3 const origin, PuleF32v3 const direction, float const tMax,
+  float & t
+) {
+  if (pyramid.levels.empty()) { return false; }
+  return pyramidTrace(
+    pyramid, origin, direction, tMax, pyramid.levels.size(), t
+  );
+}
+
+void heightPyramidVisible(
+  HeightPyramid & pyramid,
+  PuleF32v3 const * const from, PuleF32v3 const * const to,
+  size_t const count, uint8_t * const visible
+) {
+  if (pyramid.levels.empty()) {
+    std::fill(visible, visible + count, uint8_t(1));
+    return;
+  }
+  PulcTerrainHeightfield const & heightfield = pyramid.heightfield;
+  auto const cell = [](
+    float const v, float const origin, float const spacing,
+    size_t const cells
+  ) {
+    float const f = std::floor((v - origin) / spacing);
+    return static_cast<size_t>(
+      std::clamp(f, 0.0f, static_cast<float>(cells - 1))
+    );
+  };
+  for (size_t it = 0; it < count; ++ it) {
+    PuleF32v3 const a = from[it], b = to[it];
+    size_t const cx0 = cell(
+      std::min(a.x, b.x), heightfield.origin.x, heightfield.spacing.x,
+      pyramid.cellsX
+    );
+    size_t const cx1 = cell(
+      std::max(a.x, b.x), heightfield.origin.x, heightfield.spacing.x,
+      pyramid.cellsX
+    );
+    size_t const cz0 = cell(
+      std::min(a.z, b.z), heightfield.origin.y, heightfield.spacing.y,
+      pyramid.cellsY
+    );
+    size_t const cz1 = cell(
+      std::max(a.z, b.z), heightfield.origin.y, heightfield.spacing.y,
+      pyramid.cellsY
+    );
+    size_t levelIndex;
+    float const ceiling = (
+      groundCeiling(pyramid, cx0, cz0, cx1, cz1, levelIndex)
+    );
+    if (std::min(a.y, b.y) > ceiling) {
+      visible[it] = 1;
+      continue;
+    }
+    // short segments start the trace at that level rather than the root
+    auto const direction = PuleF32v3 { b.x - a.x, b.y - a.y, b.z - a.z, };
+    float t;
+    visible[it] = !pyramidTrace(pyramid, a, direction, 1.0f, levelIndex+1, t);
+  }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../terrain.h"
+
+#include <pulchritude-math/math.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// min/max heights over power-of-two blocks of heightfield cells, so rays
+//   skip the space above the ground in as few steps as the terrain allows.
+//   The cells themselves are the bottom level and read straight from the
+//   heightfield; stored levels start at blocks of heightPyramidLeafShift
+//   cells and double up to a single root. Inside a cell the ray is tested
+//   against the exact bilinear patch, the surface PulcTerrainSampler gives.
+// Levels from blocks of a heightfield tile up are built from tile headers,
+//   the quantization range bounds a tile's heights; levels below are built a
+//   block at a time by the first trace or edit reaching into it, so only the
+//   tiles rays cross are ever read.
+// Nodes are written and read with relaxed atomics like edited heights; a
+//   trace racing an edit sees each node from before or after it
+
+size_t constexpr heightPyramidLeafShift = 3;
+
+struct HeightPyramidNode {
+  float heightMin, heightMax;
+};
+
+struct HeightPyramidLevel {
+  size_t shift; // nodes are (1 << shift) cells square
+  size_t nodesX, nodesY;
+  std::vector<HeightPyramidNode> nodes; // row-major
+};
+
+struct HeightPyramid {
+  // copy of the heightfield it was built from, its tiles stay shared
+  PulcTerrainHeightfield heightfield;
+  size_t cellsX, cellsY;
+  std::vector<HeightPyramidLevel> levels; // finest first
+  // levels below blockLevel are filled in per node of it, blockStates holds
+  //   one HeightPyramidBlock_* for each
+  size_t blockLevel;
+  std::vector<uint8_t> blockStates;
+};
+
+enum HeightPyramidBlock : uint8_t {
+  HeightPyramidBlock_unbuilt,
+  HeightPyramidBlock_building,
+  HeightPyramidBlock_built,
+};
+
+// reads tile headers only
+void heightPyramidBuild(
+  HeightPyramid & pyramid, PulcTerrainHeightfield const & heightfield
+);
+
+// refreshes the nodes whose cells touch the edit's samples, leaf to root,
+//   building the blocks they are in first
+void heightPyramidUpdate(
+  HeightPyramid & pyramid, PulcTerrainHeightfieldEdit const & edit
+);
+
+// first t in [0, tMax] where origin + t*direction meets the ground, false if
+//   the ray leaves the map or runs out first; builds the blocks it descends
+//   into, safe to call from several threads at once
+bool heightPyramidRaycast(
+  HeightPyramid & pyramid,
+  PuleF32v3 const origin, PuleF32v3 const direction, float const tMax,
+  float & t
+);
+
+// for each segment from[i] -> to[i], 1 in visible[i] if no ground is in the
+//   way and 0 otherwise, with the segment clear of the map counted as seen.
+//   Segments above the highest ground under their bounds are decided off a
+//   few of the always built nodes without tracing
+void heightPyramidVisible(
+  HeightPyramid & pyramid,
+  PuleF32v3 const * const from, PuleF32v3 const * const to,
+  size_t const count, uint8_t * const visible
+);
@@ -0,0 +1,393 @@
+#include "terrain-sample.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TERRAIN_SAMPLE_X86 1
+#include <immintrin.h>
+#else
+#define TERRAIN_SAMPLE_X86 0
+#endif
+
+namespace {
+
+// positions to continuous sample coordinates, clamped so every cell has a
+//   right and lower neighbour
+struct SampleGrid {
+  float originX, originZ;
+  float invSpacingX, invSpacingZ;
+  float sampleMaxX, sampleMaxZ; // last sample
+  float cellMaxX, cellMaxZ; // last cell's first sample
+};
+
+SampleGrid sampleGrid(PulcTerrainHeightfield const & heightfield) {
+  return SampleGrid {
+    .originX = heightfield.origin.x,
+    .originZ = heightfield.origin.y,
+    .invSpacingX = 1.0f / heightfield.spacing.x,
+    .invSpacingZ = 1.0f / heightfield.spacing.y,
+    .sampleMaxX = static_cast<float>(heightfield.width - 1),
+    .sampleMaxZ = static_cast<float>(heightfield.height - 1),
+    .cellMaxX = static_cast<float>(heightfield.width - 2),
+    .cellMaxZ = static_cast<float>(heightfield.height - 2),
+  };
+}
+
+// heights at (x, z), (x+1, z), (x, z+1), (x+1, z+1); the tile table is held
+//   apart from the heightfield so nothing the kernels store can alias it
+struct SampleTiles {
+  PulcTerrainHeightfield const * heightfield;
+  PulcTerrainHeightfieldTile const * tiles;
+  size_t tilesX;
+  size_t shift, mask;
+};
+
+SampleTiles sampleTiles(PulcTerrainHeightfield const & heightfield) {
+  return SampleTiles {
+    .heightfield = &heightfield,
+    .tiles = heightfield.tiles,
+    .tilesX = heightfield.tilesX,
+    .shift = heightfield.tileShift,
+    .mask = (size_t(1) << heightfield.tileShift) - 1,
+  };
+}
+
+// inlined into every kernel, a call from the avx2 one would cost an AVX/SSE
+//   transition per lane
+__attribute__((always_inline)) inline void cornersFetch(
+  SampleTiles const & tiles, size_t const x, size_t const z,
+  float * const corners
+) {
+  size_t const mask = tiles.mask;
+  if ((x & mask) == mask || (z & mask) == mask) {
+    // straddles tiles, rare enough to go the long way
+    PulcTerrainHeightfield const * const heightfield = tiles.heightfield;
+    corners[0] = pulcTerrainHeightfieldAt(heightfield, x, z);
+    corners[1] = pulcTerrainHeightfieldAt(heightfield, x+1, z);
+    corners[2] = pulcTerrainHeightfieldAt(heightfield, x, z+1);
+    corners[3] = pulcTerrainHeightfieldAt(heightfield, x+1, z+1);
+    return;
+  }
+  PulcTerrainHeightfieldTile const & tile = (
+    tiles.tiles[(z >> tiles.shift)*tiles.tilesX + (x >> tiles.shift)]
+  );
+  size_t const index = ((z & mask) << tiles.shift) + (x & mask);
+  size_t const below = index + mask + 1;
+  float const * const heights = (
+    __atomic_load_n(&tile.heights, __ATOMIC_ACQUIRE)
+  );
+  if (heights) {
+    __atomic_load(&heights[index], &corners[0], __ATOMIC_RELAXED);
+    __atomic_load(&heights[index + 1], &corners[1], __ATOMIC_RELAXED);
+    __atomic_load(&heights[below], &corners[2], __ATOMIC_RELAXED);
+    __atomic_load(&heights[below + 1], &corners[3], __ATOMIC_RELAXED);
+    return;
+  }
+  float const heightMin = tile.heightMin;
+  float const heightScale = tile.heightScale;
+  corners[0] = heightMin + tile.samples[index]*heightScale;
+  corners[1] = heightMin + tile.samples[index + 1]*heightScale;
+  corners[2] = heightMin + tile.samples[below]*heightScale;
+  corners[3] = heightMin + tile.samples[below + 1]*heightScale;
+}
+
+// -- scalar -------------------------------------------------------------------
+
+void sampleScalar(
+  PulcTerrainHeightfield const & heightfield,
+  float const * const positionX, float const * const positionZ,
+  size_t const begin, size_t const end,
+  float * const heights,
+  float * const normalX, float * const normalY, float * const normalZ
+) {
+  SampleGrid const grid = sampleGrid(heightfield);
+  SampleTiles const tiles = sampleTiles(heightfield);
+  for (size_t it = begin; it < end; ++ it) {
+    float const gx = std::clamp(
+      (positionX[it] - grid.originX)*grid.invSpacingX, 0.0f, grid.sampleMaxX
+    );
+    float const gz = std::clamp(
+      (positionZ[it] - grid.originZ)*grid.invSpacingZ, 0.0f, grid.sampleMaxZ
+    );
+    float const cx = std::min(std::floor(gx), grid.cellMaxX);
+    float const cz = std::min(std::floor(gz), grid.cellMaxZ);
+    float const fx = gx - cx;
+    float const fz = gz - cz;
+    float c[4];
+    cornersFetch(tiles, static_cast<size_t>(cx), static_cast<size_t>(cz), c);
+    float const top = c[0] + (c[1] - c[0])*fx;
+    float const bottom = c[2] + (c[3] - c[2])*fx;
+    heights[it] = top + (bottom - top)*fz;
+    if (!normalX) { continue; }
+    float const dx = (
+      ((c[1] - c[0])*(1.0f - fz) + (c[3] - c[2])*fz) * grid.invSpacingX
+    );
+    float const dz = (bottom - top) * grid.invSpacingZ;
+    float const invLength = 1.0f / std::sqrt(1.0f + dx*dx + dz*dz);
+    normalX[it] = -dx*invLength;
+    normalY[it] = invLength;
+    normalZ[it] = -dz*invLength;
+  }
+}
+
+#if TERRAIN_SAMPLE_X86
+
+// -- sse ----------------------------------------------------------------------
+
+void sampleSse(
+  PulcTerrainHeightfield const & heightfield,
+  float const * const positionX, float const * const positionZ,
+  size_t const begin, size_t const end,
+  float * const heights,
+  float * const normalX, float * const normalY, float * const normalZ
+) {
+  SampleGrid const grid = sampleGrid(heightfield);
+  SampleTiles const tiles = sampleTiles(heightfield);
+  __m128 const originX = _mm_set1_ps(grid.originX);
+  __m128 const originZ = _mm_set1_ps(grid.originZ);
+  __m128 const invSpacingX = _mm_set1_ps(grid.invSpacingX);
+  __m128 const invSpacingZ = _mm_set1_ps(grid.invSpacingZ);
+  __m128 const sampleMaxX = _mm_set1_ps(grid.sampleMaxX);
+  __m128 const sampleMaxZ = _mm_set1_ps(grid.sampleMaxZ);
+  __m128 const cellMaxX = _mm_set1_ps(grid.cellMaxX);
+  __m128 const cellMaxZ = _mm_set1_ps(grid.cellMaxZ);
+  __m128 const zero = _mm_setzero_ps();
+  __m128 const one = _mm_set1_ps(1.0f);
+
+  size_t it = begin;
+  for (; it + 4 <= end; it += 4) {
+    __m128 const gx = _mm_min_ps(
+      _mm_max_ps(
+        _mm_mul_ps(
+          _mm_sub_ps(_mm_loadu_ps(&positionX[it]), originX), invSpacingX
+        ),
+        zero
+      ),
+      sampleMaxX
+    );
+    __m128 const gz = _mm_min_ps(
+      _mm_max_ps(
+        _mm_mul_ps(
+          _mm_sub_ps(_mm_loadu_ps(&positionZ[it]), originZ), invSpacingZ
+        ),
+        zero
+      ),
+      sampleMaxZ
+    );
+    // non-negative, so truncation is floor
+    __m128i const cellX = _mm_cvttps_epi32(_mm_min_ps(gx, cellMaxX));
+    __m128i const cellZ = _mm_cvttps_epi32(_mm_min_ps(gz, cellMaxZ));
+    __m128 const fx = _mm_sub_ps(gx, _mm_cvtepi32_ps(cellX));
+    __m128 const fz = _mm_sub_ps(gz, _mm_cvtepi32_ps(cellZ));
+
+    alignas(16) int32_t lanesX[4], lanesZ[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanesX), cellX);
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanesZ), cellZ);
+    // lane-major and transposed in registers, wide loads over scattered
+    //   scalar stores would stall on store forwarding
+    alignas(16) float corners[4][4];
+    for (size_t lane = 0; lane < 4; ++ lane) {
+      cornersFetch(tiles, lanesX[lane], lanesZ[lane], corners[lane]);
+    }
+    __m128 c00 = _mm_load_ps(corners[0]);
+    __m128 c10 = _mm_load_ps(corners[1]);
+    __m128 c01 = _mm_load_ps(corners[2]);
+    __m128 c11 = _mm_load_ps(corners[3]);
+    _MM_TRANSPOSE4_PS(c00, c10, c01, c11);
+
+    __m128 const deltaTop = _mm_sub_ps(c10, c00);
+    __m128 const deltaBottom = _mm_sub_ps(c11, c01);
+    __m128 const top = _mm_add_ps(c00, _mm_mul_ps(deltaTop, fx));
+    __m128 const bottom = _mm_add_ps(c01, _mm_mul_ps(deltaBottom, fx));
+    __m128 const deltaZ = _mm_sub_ps(bottom, top);
+    _mm_storeu_ps(&heights[it], _mm_add_ps(top, _mm_mul_ps(deltaZ, fz)));
+    if (!normalX) { continue; }
+
+    __m128 const dx = _mm_mul_ps(
+      _mm_add_ps(
+        _mm_mul_ps(deltaTop, _mm_sub_ps(one, fz)), _mm_mul_ps(deltaBottom, fz)
+      ),
+      invSpacingX
+    );
+    __m128 const dz = _mm_mul_ps(deltaZ, invSpacingZ);
+    // full precision, normals feed orientation and shouldn't jitter
+    __m128 const invLength = _mm_div_ps(
+      one,
+      _mm_sqrt_ps(
+        _mm_add_ps(one, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)))
+      )
+    );
+    _mm_storeu_ps(&normalX[it], _mm_mul_ps(_mm_sub_ps(zero, dx), invLength));
+    _mm_storeu_ps(&normalY[it], invLength);
+    _mm_storeu_ps(&normalZ[it], _mm_mul_ps(_mm_sub_ps(zero, dz), invLength));
+  }
+  sampleScalar(
+    heightfield, positionX, positionZ, it, end,
+    heights, normalX, normalY, normalZ
+  );
+}
+
+// -- avx2 ---------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+void sampleAvx2(
+  PulcTerrainHeightfield const & heightfield,
+  float const * const positionX, float const * const positionZ,
+  size_t const begin, size_t const end,
+  float * const heights,
+  float * const normalX, float * const normalY, float * const normalZ
+) {
+  SampleGrid const grid = sampleGrid(heightfield);
+  SampleTiles const tiles = sampleTiles(heightfield);
+  __m256 const originX = _mm256_set1_ps(grid.originX);
+  __m256 const originZ = _mm256_set1_ps(grid.originZ);
+  __m256 const invSpacingX = _mm256_set1_ps(grid.invSpacingX);
+  __m256 const invSpacingZ = _mm256_set1_ps(grid.invSpacingZ);
+  __m256 const sampleMaxX = _mm256_set1_ps(grid.sampleMaxX);
+  __m256 const sampleMaxZ = _mm256_set1_ps(grid.sampleMaxZ);
+  __m256 const cellMaxX = _mm256_set1_ps(grid.cellMaxX);
+  __m256 const cellMaxZ = _mm256_set1_ps(grid.cellMaxZ);
+  __m256 const zero = _mm256_setzero_ps();
+  __m256 const one = _mm256_set1_ps(1.0f);
+
+  size_t it = begin;
+  for (; it + 8 <= end; it += 8) {
+    __m256 const gx = _mm256_min_ps(
+      _mm256_max_ps(
+        _mm256_mul_ps(
+          _mm256_sub_ps(_mm256_loadu_ps(&positionX[it]), originX),
+          invSpacingX
+        ),
+        zero
+      ),
+      sampleMaxX
+    );
+    __m256 const gz = _mm256_min_ps(
+      _mm256_max_ps(
+        _mm256_mul_ps(
+          _mm256_sub_ps(_mm256_loadu_ps(&positionZ[it]), originZ),
+          invSpacingZ
+        ),
+        zero
+      ),
+      sampleMaxZ
+    );
+    // non-negative, so truncation is floor
+    __m256i const cellX = _mm256_cvttps_epi32(_mm256_min_ps(gx, cellMaxX));
+    __m256i const cellZ = _mm256_cvttps_epi32(_mm256_min_ps(gz, cellMaxZ));
+    __m256 const fx = _mm256_sub_ps(gx, _mm256_cvtepi32_ps(cellX));
+    __m256 const fz = _mm256_sub_ps(gz, _mm256_cvtepi32_ps(cellZ));
+
+    alignas(32) int32_t lanesX[8], lanesZ[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanesX), cellX);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanesZ), cellZ);
+    // lane-major and transposed in registers, wide loads over scattered
+    //   scalar stores would stall on store forwarding
+    alignas(32) float corners[8][4];
+    for (size_t lane = 0; lane < 8; ++ lane) {
+      cornersFetch(tiles, lanesX[lane], lanesZ[lane], corners[lane]);
+    }
+    // 4x4 transposes in both halves, lanes 0-3 low and 4-7 high
+    __m256 const lanes04 = _mm256_set_m128(
+      _mm_load_ps(corners[4]), _mm_load_ps(corners[0])
+    );
+    __m256 const lanes15 = _mm256_set_m128(
+      _mm_load_ps(corners[5]), _mm_load_ps(corners[1])
+    );
+    __m256 const lanes26 = _mm256_set_m128(
+      _mm_load_ps(corners[6]), _mm_load_ps(corners[2])
+    );
+    __m256 const lanes37 = _mm256_set_m128(
+      _mm_load_ps(corners[7]), _mm_load_ps(corners[3])
+    );
+    __m256 const low01 = _mm256_unpacklo_ps(lanes04, lanes15);
+    __m256 const high01 = _mm256_unpackhi_ps(lanes04, lanes15);
+    __m256 const low23 = _mm256_unpacklo_ps(lanes26, lanes37);
+    __m256 const high23 = _mm256_unpackhi_ps(lanes26, lanes37);
+    __m256 const c00 = _mm256_shuffle_ps(low01, low23, 0x44);
+    __m256 const c10 = _mm256_shuffle_ps(low01, low23, 0xee);
+    __m256 const c01 = _mm256_shuffle_ps(high01, high23, 0x44);
+    __m256 const c11 = _mm256_shuffle_ps(high01, high23, 0xee);
+
+    __m256 const deltaTop = _mm256_sub_ps(c10, c00);
+    __m256 const deltaBottom = _mm256_sub_ps(c11, c01);
+    __m256 const top = _mm256_fmadd_ps(deltaTop, fx, c00);
+    __m256 const bottom = _mm256_fmadd_ps(deltaBottom, fx, c01);
+    __m256 const deltaZ = _mm256_sub_ps(bottom, top);
+    _mm256_storeu_ps(&heights[it], _mm256_fmadd_ps(deltaZ, fz, top));
+    if (!normalX) { continue; }
+
+    __m256 const dx = _mm256_mul_ps(
+      _mm256_fmadd_ps(
+        deltaBottom, fz, _mm256_mul_ps(deltaTop, _mm256_sub_ps(one, fz))
+      ),
+      invSpacingX
+    );
+    __m256 const dz = _mm256_mul_ps(deltaZ, invSpacingZ);
+    __m256 const invLength = _mm256_div_ps(
+      one,
+      _mm256_sqrt_ps(
+        _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dz, dz, one))
+      )
+    );
+    _mm256_storeu_ps(
+      &normalX[it], _mm256_mul_ps(_mm256_sub_ps(zero, dx), invLength)
+    );
+    _mm256_storeu_ps(&normalY[it], invLength);
+    _mm256_storeu_ps(
+      &normalZ[it], _mm256_mul_ps(_mm256_sub_ps(zero, dz), invLength)
+    );
+  }
+  sampleScalar(
+    heightfield, positionX, positionZ, it, end,
+    heights, normalX, normalY, normalZ
+  );
+}
+
+#endif // TERRAIN_SAMPLE_X86
+
+} // namespace
+
+TerrainSampleKernel terrainSampleKernelDetect() {
+  #if TERRAIN_SAMPLE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return TerrainSampleKernel_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) { return TerrainSampleKernel_sse; }
+  #endif
+  return TerrainSampleKernel_scalar;
+}
+
+void terrainSample(
+  PulcTerrainHeightfield const & heightfield,
+  TerrainSampleKernel const kernel,
+  float const * const positionX, float const * const positionZ,
+  size_t const count,
+  float * const heights,
+  float * const normalX, float * const normalY, float * const normalZ
+) {
+  switch (kernel) {
+    #if TERRAIN_SAMPLE_X86
+      case TerrainSampleKernel_avx2:
+        sampleAvx2(
+          heightfield, positionX, positionZ, 0, count,
+          heights, normalX, normalY, normalZ
+        );
+      return;
+      case TerrainSampleKernel_sse:
+        sampleSse(
+          heightfield, positionX, positionZ, 0, count,
+          heights, normalX, normalY, normalZ
+        );
+      return;
+    #endif
+    default:
+      sampleScalar(
+        heightfield, positionX, positionZ, 0, count,
+        heights, normalX, normalY, normalZ
+      );
+    return;
+  }
+}
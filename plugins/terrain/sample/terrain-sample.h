@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../terrain.h"
+
+#include <cstddef>
+
+// ground height and normal at arbitrary XZ positions, see PulcTerrainSampler.
+//   Kernels convert positions to cells and interpolate a lane group at a
+//   time; only the four corner fetches per position stay scalar, as tiles
+//   can be quantized or edited and don't share one base address
+
+enum TerrainSampleKernel {
+  TerrainSampleKernel_scalar,
+  TerrainSampleKernel_sse,
+  TerrainSampleKernel_avx2,
+};
+
+// widest kernel the running CPU supports
+TerrainSampleKernel terrainSampleKernelDetect();
+
+// normalX/Y/Z are either all NULL or all valid
+void terrainSample(
+  PulcTerrainHeightfield const & heightfield,
+  TerrainSampleKernel const kernel,
+  float const * const positionX, float const * const positionZ,
+  size_t const count,
+  float * const heights,
+  float * const normalX, float * const normalY, float * const normalZ
+);
@@ -3,88 +3,242 @@
 #include <pulchritude-plugin/engine.h>
 #include <pulchritude-gfx/gfx.h>
 
+#include "terrain.h"
+#include "cost/terrain-cost.h"
+#include "edit/terrain-edit.h"
+#include "heightmap/tiled-heightmap.h"
+#include "mesh/terrain-build.h"
+#include "mesh/terrain-chunks.h"
+#include "raycast/height-pyramid.h"
+#include "sample/terrain-sample.h"
+
+#include "../graph/memory/frame-arena.h"
+#include "../graph/profile/profiler.h"
+#include "../graph/registry/handle-registry.h"
+#include "../graph/render/command-list-cache.h"
+
+#include <algorithm>
+#include <memory>
 #include <vector>
 
 namespace {
 PuleEngineLayer pul;
+PulePluginPayload payload;
+// the graph plugin's, null while it isn't loaded
+HandleRegistry terrainHandles;
+HandlePayload<PulcProfiler const> terrainHandleProfiler;
+HandlePayload<PulcJobSystem const> terrainHandleJobs;
+HandlePayload<PulcFrameArena const> terrainHandleFrameArena;
+// heap-backed stand-in for the frame arena
+PulcFrameArena terrainFrameArenaHeap;
+
+float const terrainMapDim = 100.0f;
+char const * const terrainHeightmapPath = "puldata/terrain.pthm";
+
+TiledHeightmap terrainHeightmap;
+// replaced heightmaps stay mapped until unload, other plugins may still be
+//   reading tiles of an older revision
+std::vector<TiledHeightmap> terrainHeightmapsRetired;
+PulcTerrainHeightfield terrainHeightfield;
+TerrainEdit terrainEdit;
+// pyramid over the current heightmap, swapped atomically for tracing
+//   threads; replaced ones stay alive until unload with their heightmaps
+std::vector<std::unique_ptr<HeightPyramid>> terrainPyramids;
+HeightPyramid * terrainPyramid;
+// cost map over the current heightmap, last; replaced ones stay alive until
+//   unload for readers still holding a view of them
+std::vector<std::unique_ptr<TerrainCostMap>> terrainCostMaps;
+PulcTerrainCostMap terrainCostMap;
+
+std::vector<float> terrainDefaultHeightmap(size_t const width, size_t const height) {
+  std::vector<float> heights;
+  heights.reserve(width*height);
+  for (size_t ity = 0; ity < height; ++ ity)
+  for (size_t itx = 0; itx < width; ++ itx) {
+    heights.emplace_back(1.0f + (itx%20)*5.0f + (ity%50)*6.5f);
+  }
+  return heights;
+}
+
+PulcProfiler const * terrainProfiler() {
+  return handleFetch(terrainHandles, terrainHandleProfiler);
+}
+
+// scratch for this update only
+PulcFrameArena const & terrainFrameArena() {
+  PulcFrameArena const * const arena = (
+    handleFetch(terrainHandles, terrainHandleFrameArena)
+  );
+  return arena ? *arena : terrainFrameArenaHeap;
+}
+
+// records that heights inside the inclusive rectangle changed
+PulcTerrainHeightfieldEdit terrainHeightfieldMarkDirty(
+  size_t const x0, size_t const y0, size_t const x1, size_t const y1
+) {
+  terrainHeightfield.revision += 1;
+  auto const edit = PulcTerrainHeightfieldEdit {
+    .revision = terrainHeightfield.revision,
+    .x0 = x0, .y0 = y0,
+    .x1 = x1, .y1 = y1,
+  };
+  terrainHeightfield.edits[
+    terrainHeightfield.revision % pulcTerrainHeightfieldEditLogLength
+  ] = edit;
+  return edit;
+}
+
+void terrainHeightmapRetire() {
+  // undo steps only make sense against the heightmap they were taken on
+  terrainEditClear(terrainEdit);
+  if (terrainHeightmap.tiles.empty()) { return; }
+  terrainHeightmapsRetired.emplace_back(std::move(terrainHeightmap));
+  terrainHeightmap = TiledHeightmap {};
+}
+
+// publishes terrainHeightmap to other plugins, which invalidates anything
+//   they derived from the previous revision. Reads no samples, the pyramid
+//   starts from tile headers and a mapped heightmap carries its cost map
+void terrainHeightfieldPublish() {
+  tiledHeightmapHeightfield(terrainHeightmap, terrainHeightfield);
+  terrainHeightfieldMarkDirty(
+    0, 0, terrainHeightfield.width-1, terrainHeightfield.height-1
+  );
+  auto pyramid = std::make_unique<HeightPyramid>();
+  heightPyramidBuild(*pyramid, terrainHeightfield);
+  __atomic_store_n(&terrainPyramid, pyramid.get(), __ATOMIC_RELEASE);
+  terrainPyramids.emplace_back(std::move(pyramid));
+  // one saved with the heightmap is used in place, its pages only read in
+  //   as paths cross them
+  auto costMap = std::make_unique<TerrainCostMap>();
+  if (
+      !terrainHeightmap.costMap
+    || !terrainCostMapFromBytes(
+      *costMap, terrainHeightfield,
+      terrainHeightmap.costMap, terrainHeightmap.costMapLength
+    )
+  ) {
+    terrainCostMapBuild(*costMap, terrainHeightfield);
+  }
+  terrainCostMap = terrainCostMapShared(*costMap, terrainHeightfield.revision);
+  terrainCostMaps.emplace_back(std::move(costMap));
+}
+
+void terrainHeightfieldAssign(
+  std::vector<float> const & heights, size_t const width, size_t const height
+) {
+  terrainHeightmapRetire();
+  tiledHeightmapFromHeights(
+    terrainHeightmap, heights.data(), width, height,
+    PuleF32v2 { -terrainMapDim/2.0f, -terrainMapDim/2.0f },
+    PuleF32v2 { terrainMapDim/(float)width, terrainMapDim/(float)height, }
+  );
+  terrainHeightfieldPublish();
+}
+
+// maps the tiled heightmap, only its header and tile directory are read
+bool terrainHeightfieldLoad(char const * const path) {
+  TiledHeightmap heightmap {};
+  if (!tiledHeightmapOpen(heightmap, path)) { return false; }
+  terrainHeightmapRetire();
+  terrainHeightmap = std::move(heightmap);
+  terrainHeightfieldPublish();
+  return true;
+}
 } // namespace
 
 // -- render -------------------------------------------------------------------
 namespace {
 
 struct Context {
-  PuleGfxCommandList commandList;
   PuleGfxShaderModule shaderModule;
   PuleGfxGpuBuffer bufferAttributesStatic;
+  PuleGfxGpuBuffer bufferElements;
   PuleGfxPipeline pipeline;
 
-  size_t terrainVertices;
+  TerrainChunks chunks;
+  // persistently mapped, chunks are written in as they first become visible
+  TerrainMeshAttribute * mappedAttributes;
+  TerrainBuild build;
+  std::vector<TerrainBuildChunk> buildFinished;
+  // per chunk, edits made while it was building, which its build may have
+  //   read halfway; revision 0 if none
+  std::vector<PulcTerrainHeightfieldEdit> chunkEditsPending;
+
+  // per chunk, 1 + the LOD it's drawn at or 0 if it isn't; a recorded list
+  //   replays the same draws until the revision moves
+  std::vector<uint8_t> chunkDraws;
+  uint64_t drawRevision;
 };
 
 Context ctx;
 
-struct TerrainMeshAttribute {
-  PuleF32v3 origin;
-};
+// LOD switches once a level's error would cover more pixels than this
+float constexpr terrainMaxPixelError = 2.0f;
+float constexpr terrainViewportHeight = 600.0f;
 
-void initializeContext(
-  float const * const heights,
-  size_t const width, size_t const height,
-  bool isEditor=false
-) {
+// the GPU objects initializeContext creates; the build must not be writing
+//   into the mapped vertex buffer anymore
+void releaseContext() {
+  // initializeContext returns early if the shaders or pipeline failed
+  if (ctx.pipeline.id) { pul.gfxPipelineDestroy(ctx.pipeline); }
+  if (ctx.shaderModule.id) { pul.gfxShaderModuleDestroy(ctx.shaderModule); }
+  if (ctx.bufferElements.id) { pul.gfxGpuBufferDestroy(ctx.bufferElements); }
+  if (ctx.bufferAttributesStatic.id) {
+    pul.gfxGpuBufferUnmap(ctx.bufferAttributesStatic);
+    pul.gfxGpuBufferDestroy(ctx.bufferAttributesStatic);
+  }
+  ctx.pipeline = PuleGfxPipeline { 0 };
+  ctx.shaderModule = PuleGfxShaderModule { 0 };
+  ctx.bufferElements = PuleGfxGpuBuffer { 0 };
+  ctx.bufferAttributesStatic = PuleGfxGpuBuffer { 0 };
+  ctx.mappedAttributes = nullptr;
+}
+
+void initializeContext(PulcTerrainHeightfield const & heightfield) {
   PuleError err = puleError();
+  ctx.chunkDraws.clear();
+  ++ ctx.drawRevision;
 
-  float const mapdim = 100.0f;
-
-  std::vector<TerrainMeshAttribute> attributes;
-  { // parse heightfield to mesh
-    float originStartX = -mapdim/2.0f;
-    float originStartY = -mapdim/2.0f;
-    float originItX = mapdim/(float)width;
-    float originItY = mapdim/(float)height;
-
-    for (size_t itx = 0; itx < width-1; ++ itx)
-    for (size_t ity = 0; ity < height-1; ++ ity) {
-      auto const ul = PuleF32v3 {
-        originStartX + itx*originItX,
-        heights[ity*height + itx],
-        originStartY + ity*originItY,
-      };
-      auto const ur = PuleF32v3 {
-        originStartX + (itx+1)*originItX,
-        heights[ity*height + (itx+1)],
-        originStartY + ity*originItY,
-      };
-      auto const ll = PuleF32v3 {
-        originStartX + itx*originItX,
-        heights[(ity+1)*height + itx],
-        originStartY + (ity+1)*originItY,
-      };
-      auto const lr = PuleF32v3 {
-        originStartX + (itx+1)*originItX,
-        heights[(ity+1)*height + (itx+1)],
-        originStartY + (ity+1)*originItY,
-      };
-      attributes.emplace_back(ul);
-      attributes.emplace_back(ur);
-      attributes.emplace_back(lr);
-      attributes.emplace_back(lr);
-      attributes.emplace_back(ll);
-      attributes.emplace_back(ul);
-    }
+  // nothing may still be writing into the previous vertex buffer
+  if (ctx.build.thread.joinable()) {
+    terrainBuildDrain(ctx.build);
+  } else {
+    terrainBuildStart(ctx.build);
   }
-  ctx.terrainVertices = attributes.size();
+  releaseContext();
 
+  // chunk after chunk, each with its own terrainChunkVertices block
+  terrainChunksLayout(ctx.chunks, heightfield);
+  ctx.chunkEditsPending.assign(
+    ctx.chunks.chunks.size(), PulcTerrainHeightfieldEdit {}
+  );
+  size_t const attributesLength = (
+    sizeof(TerrainMeshAttribute)
+    * ctx.chunks.chunks.size() * terrainChunkVertices
+  );
   ctx.bufferAttributesStatic = (
     pul.gfxGpuBufferCreate(
-      attributes.data(),
-      sizeof(TerrainMeshAttribute) * attributes.size(),
+      nullptr,
+      attributesLength,
       PuleGfxGpuBufferUsage_bufferAttribute,
-      (
-        isEditor
-        ? PuleGfxGpuBufferVisibilityFlag_hostWritable
-        : PuleGfxGpuBufferVisibilityFlag_deviceOnly
-      )
+      PuleGfxGpuBufferVisibilityFlag_hostWritable
+    )
+  );
+  ctx.mappedAttributes = reinterpret_cast<TerrainMeshAttribute *>(
+    pul.gfxGpuBufferMap({
+      .buffer = ctx.bufferAttributesStatic,
+      .access = PuleGfxGpuBufferMapAccess_hostWritable,
+      .byteOffset = 0,
+      .byteLength = attributesLength,
+    })
+  );
+  ctx.bufferElements = (
+    pul.gfxGpuBufferCreate(
+      ctx.chunks.elements.data(),
+      sizeof(uint16_t) * ctx.chunks.elements.size(),
+      PuleGfxGpuBufferUsage_bufferElement,
+      PuleGfxGpuBufferVisibilityFlag_deviceOnly
     )
   );
 
@@ -100,7 +254,7 @@ void initializeContext(
       SHADER(
         in layout(location = 0) vec3 inOrigin;
         /* in layout(location = 1) vec2 inUv; */
-        /* in layout(location = 2) vec4 inNormal; */
+        in layout(location = 2) vec3 inNormal;
 
         struct Camera {
           mat4 proj;
@@ -116,7 +270,7 @@ void initializeContext(
         void main() {
           vec3 origin = inOrigin;
           const Camera cam = cameraSet.cameras[0];
-          gl_Position = vec4(origin, 1.0f);
+          gl_Position = cam.proj * cam.view * vec4(origin, 1.0f);
           int triangleID = gl_VertexID/3;
           outUv = (
             vec3(
@@ -125,6 +279,9 @@ void initializeContext(
               mod((triangleID+1), 3.3)/3.3f
             )
           );
+          // fixed sun, so the slopes read
+          float light = dot(inNormal, normalize(vec3(0.3f, 1.0f, 0.2f)));
+          outUv *= 0.4f + 0.6f*max(light, 0.0f);
         }
       ),
       // FRAGMENT
@@ -151,6 +308,14 @@ void initializeContext(
       .stridePerElement = sizeof(TerrainMeshAttribute),
       .offsetIntoBuffer = offsetof(TerrainMeshAttribute, origin),
     };
+    descriptorSetLayout.bufferAttributeBindings[2] = {
+      .buffer = ctx.bufferAttributesStatic,
+      .numComponents = 3,
+      .dataType = PuleGfxAttributeDataType_float,
+      .convertFixedDataTypeToNormalizedFloating = false,
+      .stridePerElement = sizeof(TerrainMeshAttribute),
+      .offsetIntoBuffer = offsetof(TerrainMeshAttribute, normal),
+    };
 
     auto pipelineInfo = PuleGfxPipelineCreateInfo {
       .shaderModule = ctx.shaderModule,
@@ -173,11 +338,98 @@ void initializeContext(
   }
 }
 
-void terrainRender(
+// culls, streams and picks LODs for the camera; the camera itself only
+//   reaches the GPU through its uniform buffer
+void terrainRenderPrepare(PuleF32m44 const & view, PuleF32m44 const & proj) {
+  PULC_PROFILE_ZONE(terrainProfiler(), "terrainRenderPrepare");
+  { // LOD from the camera, view is a rigid transform so eye = -R^T t
+    PuleF32v3 eye;
+    float * const eyeAxes[3] = { &eye.x, &eye.y, &eye.z, };
+    for (size_t axis = 0; axis < 3; ++ axis) {
+      *eyeAxes[axis] = -(
+          view.elem[axis*4 + 0]*view.elem[12]
+        + view.elem[axis*4 + 1]*view.elem[13]
+        + view.elem[axis*4 + 2]*view.elem[14]
+      );
+    }
+    float const pixelsPerUnit = proj.elem[5] * terrainViewportHeight/2.0f;
+
+    // finished chunks were written straight into the mapping; the GPU has
+    //   never drawn them, so only the flush is left
+    PulcFrameArena const & arena = terrainFrameArena();
+    FrameArenaVector<TerrainChunkVertexRange> updateRanges { arena };
+    terrainBuildCollect(ctx.build, ctx.buildFinished);
+    for (TerrainBuildChunk const & finished : ctx.buildFinished) {
+      TerrainChunk & chunk = ctx.chunks.chunks[finished.chunkIndex];
+      bool const visible = chunk.visible;
+      chunk = finished.chunk;
+      chunk.visible = visible;
+      PulcTerrainHeightfieldEdit & pending = (
+        ctx.chunkEditsPending[finished.chunkIndex]
+      );
+      if (pending.revision != 0) {
+        terrainChunkUpdate(
+          chunk, terrainHeightfield, finished.vertices, pending, updateRanges
+        );
+        pending = PulcTerrainHeightfieldEdit {};
+      }
+      pul.gfxGpuBufferMappedFlush({
+        .buffer = ctx.bufferAttributesStatic,
+        .byteOffset = (
+          finished.chunkIndex*terrainChunkVertices*sizeof(TerrainMeshAttribute)
+        ),
+        .byteLength = terrainChunkVertices*sizeof(TerrainMeshAttribute),
+      });
+    }
+
+    // first sight of a chunk pages in its tiles
+    terrainChunksCull(
+      ctx.chunks, terrainFrustumFromViewProjection(view, proj)
+    );
+    auto const jobs = handleFetch(terrainHandles, terrainHandleJobs);
+    FrameArenaVector<TerrainBuildChunk> buildRequests { arena };
+    for (size_t it = 0; it < ctx.chunks.chunks.size(); ++ it) {
+      TerrainChunk & chunk = ctx.chunks.chunks[it];
+      if (!chunk.visible || chunk.state != TerrainChunkState_unbuilt) {
+        continue;
+      }
+      chunk.state = TerrainChunkState_building;
+      buildRequests.emplace_back(TerrainBuildChunk {
+        .chunkIndex = it,
+        .chunk = chunk,
+        .vertices = ctx.mappedAttributes + it*terrainChunkVertices,
+      });
+    }
+    terrainBuildRequest(
+      ctx.build, terrainHeightfield, terrainHandles, jobs, buildRequests
+    );
+    terrainChunksSelectLod(
+      ctx.chunks, eye, pixelsPerUnit, terrainMaxPixelError
+    );
+  }
+
+  ctx.chunkDraws.resize(ctx.chunks.chunks.size(), 0);
+  bool drawsChanged = false;
+  for (size_t it = 0; it < ctx.chunks.chunks.size(); ++ it) {
+    TerrainChunk const & chunk = ctx.chunks.chunks[it];
+    uint8_t const draw = (
+      chunk.visible && chunk.state == TerrainChunkState_built
+      ? static_cast<uint8_t>(chunk.lod + 1) : 0
+    );
+    drawsChanged = drawsChanged || ctx.chunkDraws[it] != draw;
+    ctx.chunkDraws[it] = draw;
+  }
+  if (drawsChanged) { ++ ctx.drawRevision; }
+}
+
+// appends the chunk draws prepared last; stays valid to replay until
+//   ctx.drawRevision, the pipeline or a buffer changes
+void terrainRenderRecord(
   PuleGfxFramebuffer const framebuffer,
   PuleGfxCommandListRecorder const recorder,
   PuleGfxGpuBuffer const cameraUniformBuffer
 ) {
+  PULC_PROFILE_ZONE(terrainProfiler(), "terrainRenderRecord");
   pul.gfxCommandListAppendAction(
     recorder,
     PuleGfxCommand {
@@ -210,19 +462,258 @@ void terrainRender(
     }
   );
 
-  pul.gfxCommandListAppendAction(
-    recorder,
-    PuleGfxCommand {
-      .dispatchRender = {
-        .action = PuleGfxAction_dispatchRender,
-        .drawPrimitive = PuleGfxDrawPrimitive_triangle,
-        .vertexOffset = 0,
-        .numVertices = ctx.terrainVertices,
-      },
+  // chunks grouped by LOD, so the element buffer is rebound once per level
+  for (size_t lod = 0; lod < terrainChunkLodCount; ++ lod) {
+    bool bound = false;
+    for (size_t it = 0; it < ctx.chunks.chunks.size(); ++ it) {
+      if (ctx.chunkDraws[it] != lod + 1) { continue; }
+      if (!bound) {
+        bound = true;
+        pul.gfxCommandListAppendAction(
+          recorder,
+          PuleGfxCommand {
+            .bindElementBuffer = {
+              .action = PuleGfxAction_bindElementBuffer,
+              .buffer = ctx.bufferElements,
+              .offset = ctx.chunks.lods[lod].elementOffset*sizeof(uint16_t),
+              .elementType = PuleGfxElementType_u16,
+            },
+          }
+        );
+      }
+      pul.gfxCommandListAppendAction(
+        recorder,
+        PuleGfxCommand {
+          .dispatchRenderElements = {
+            .action = PuleGfxAction_dispatchRenderElements,
+            .drawPrimitive = PuleGfxDrawPrimitive_triangle,
+            .numElements = ctx.chunks.lods[lod].elementCount,
+            .elementType = PuleGfxElementType_u16,
+            .baseVertexOffset = it*terrainChunkVertices,
+          },
+        }
+      );
     }
+  }
+}
+
+} // namespace
+
+// -- raycast ------------------------------------------------------------------
+namespace {
+
+bool terrainRaycasterRaycast(
+  PuleF32v3 const origin, PuleF32v3 const direction, float const tMax,
+  PuleF32v3 * const hit
+) {
+  HeightPyramid * const pyramid = (
+    __atomic_load_n(&terrainPyramid, __ATOMIC_ACQUIRE)
   );
+  float t;
+  if (!pyramid || !heightPyramidRaycast(*pyramid, origin, direction, tMax, t)) {
+    return false;
+  }
+  *hit = PuleF32v3 {
+    origin.x + direction.x*t,
+    origin.y + direction.y*t,
+    origin.z + direction.z*t,
+  };
+  return true;
+}
+
+void terrainRaycasterLineOfSight(
+  PuleF32v3 const * const from, PuleF32v3 const * const to,
+  size_t const count, uint8_t * const visible
+) {
+  HeightPyramid * const pyramid = (
+    __atomic_load_n(&terrainPyramid, __ATOMIC_ACQUIRE)
+  );
+  if (!pyramid) {
+    std::fill(visible, visible + count, uint8_t(1));
+    return;
+  }
+  heightPyramidVisible(*pyramid, from, to, count, visible);
 }
 
+PulcTerrainRaycaster terrainRaycaster = {
+  .raycast = terrainRaycasterRaycast,
+  .lineOfSight = terrainRaycasterLineOfSight,
+};
+
+} // namespace
+
+// -- edit ---------------------------------------------------------------------
+namespace {
+
+// the editor camera's far plane
+float constexpr terrainCursorDepthMax = 1000.0f;
+
+// from the last frame the editor viewport was hovered
+bool terrainCursorOverGround;
+PuleF32v3 terrainCursorGround;
+
+// picks the ground through a viewport point in NDC; view is a rigid
+//   transform, so eye = -R^T t and the ray turns to world space through R^T
+void terrainCursorPick(
+  PuleF32m44 const & view, PuleF32m44 const & proj, PuleF32v2 const ndc
+) {
+  float const rayView[3] = { ndc.x/proj.elem[0], ndc.y/proj.elem[5], -1.0f, };
+  float eye[3], ray[3];
+  for (size_t axis = 0; axis < 3; ++ axis) {
+    eye[axis] = -(
+        view.elem[axis*4 + 0]*view.elem[12]
+      + view.elem[axis*4 + 1]*view.elem[13]
+      + view.elem[axis*4 + 2]*view.elem[14]
+    );
+    ray[axis] = (
+        view.elem[axis*4 + 0]*rayView[0]
+      + view.elem[axis*4 + 1]*rayView[1]
+      + view.elem[axis*4 + 2]*rayView[2]
+    );
+  }
+  terrainCursorOverGround = terrainRaycasterRaycast(
+    PuleF32v3 { eye[0], eye[1], eye[2], },
+    PuleF32v3 { ray[0], ray[1], ray[2], },
+    terrainCursorDepthMax, &terrainCursorGround
+  );
+}
+
+// brings the chunks the rectangle reaches up to date with its heights
+void terrainHeightsEdited(TerrainEditRect const & rect) {
+  if (terrainEditRectIsEmpty(rect)) { return; }
+  PulcTerrainHeightfieldEdit const edit = (
+    terrainHeightfieldMarkDirty(rect.x0, rect.y0, rect.x1, rect.y1)
+  );
+  heightPyramidUpdate(*terrainPyramid, edit);
+  terrainCostMapUpdate(*terrainCostMaps.back(), terrainHeightfield, edit);
+  terrainCostMap.revision = edit.revision;
+  FrameArenaVector<TerrainChunkVertexRange> updateRanges {
+    terrainFrameArena()
+  };
+  for (size_t it = 0; it < ctx.chunks.chunks.size(); ++ it) {
+    TerrainChunk & chunk = ctx.chunks.chunks[it];
+    switch (chunk.state) {
+      case TerrainChunkState_built: {
+        // only what the edit reaches is rewritten and flushed
+        terrainChunkUpdate(
+          chunk, terrainHeightfield,
+          ctx.mappedAttributes + it*terrainChunkVertices, edit, updateRanges
+        );
+        for (TerrainChunkVertexRange const & range : updateRanges) {
+          pul.gfxGpuBufferMappedFlush({
+            .buffer = ctx.bufferAttributesStatic,
+            .byteOffset = (
+                (it*terrainChunkVertices + range.vertexOffset)
+              * sizeof(TerrainMeshAttribute)
+            ),
+            .byteLength = range.vertexCount*sizeof(TerrainMeshAttribute),
+          });
+        }
+      } break;
+      case TerrainChunkState_building: {
+        // redone over the union of edits once the build is collected
+        PulcTerrainHeightfieldEdit & pending = ctx.chunkEditsPending[it];
+        if (pending.revision == 0) {
+          pending = edit;
+        } else {
+          pending.revision = edit.revision;
+          pending.x0 = std::min(pending.x0, edit.x0);
+          pending.y0 = std::min(pending.y0, edit.y0);
+          pending.x1 = std::max(pending.x1, edit.x1);
+          pending.y1 = std::max(pending.y1, edit.y1);
+        }
+      } break;
+      case TerrainChunkState_unbuilt: {
+        // bounds still come from the tile directory, which knows nothing of
+        //   edits; they only have to keep covering the heights for culling
+        size_t const x0 = std::max(rect.x0, chunk.sampleX);
+        size_t const y0 = std::max(rect.y0, chunk.sampleY);
+        size_t const x1 = std::min(rect.x1, chunk.sampleX + terrainChunkQuads);
+        size_t const y1 = std::min(rect.y1, chunk.sampleY + terrainChunkQuads);
+        for (size_t y = y0; y <= y1; ++ y)
+        for (size_t x = x0; x <= x1; ++ x) {
+          float const height = (
+            pulcTerrainHeightfieldAt(&terrainHeightfield, x, y)
+          );
+          chunk.boundsMin.y = std::min(chunk.boundsMin.y, height);
+          chunk.boundsMax.y = std::max(chunk.boundsMax.y, height);
+        }
+      } break;
+    }
+  }
+}
+
+void terrainEditorStrokeBegin() {
+  terrainEditStrokeBegin(terrainEdit);
+}
+
+void terrainEditorBrushApply(PulcTerrainBrush const * const brush) {
+  terrainHeightsEdited(
+    terrainEditBrushApply(
+      terrainEdit, terrainHeightmap, terrainHeightfield, *brush
+    )
+  );
+}
+
+void terrainEditorStrokeEnd() {
+  terrainEditStrokeEnd(terrainEdit, terrainHeightmap);
+}
+
+bool terrainEditorUndo() {
+  TerrainEditRect const rect = terrainEditUndo(terrainEdit, terrainHeightmap);
+  terrainHeightsEdited(rect);
+  return !terrainEditRectIsEmpty(rect);
+}
+
+bool terrainEditorRedo() {
+  TerrainEditRect const rect = terrainEditRedo(terrainEdit, terrainHeightmap);
+  terrainHeightsEdited(rect);
+  return !terrainEditRectIsEmpty(rect);
+}
+
+bool terrainEditorCursorGround(PuleF32v3 * const ground) {
+  if (!terrainCursorOverGround) { return false; }
+  *ground = terrainCursorGround;
+  return true;
+}
+
+PulcTerrainEditor terrainEditor = {
+  .strokeBegin = terrainEditorStrokeBegin,
+  .brushApply = terrainEditorBrushApply,
+  .strokeEnd = terrainEditorStrokeEnd,
+  .undo = terrainEditorUndo,
+  .redo = terrainEditorRedo,
+  .cursorGround = terrainEditorCursorGround,
+};
+
+} // namespace
+
+// -- sample -------------------------------------------------------------------
+namespace {
+
+TerrainSampleKernel terrainSampleKernel;
+
+void terrainSamplerSample(
+  PulcTerrainHeightfield const * const heightfield,
+  float const * const positionX, float const * const positionZ,
+  size_t const count,
+  float * const heights,
+  float * const normalX, float * const normalY, float * const normalZ
+) {
+  terrainSample(
+    *heightfield, terrainSampleKernel, positionX, positionZ, count,
+    heights, normalX, normalY, normalZ
+  );
+}
+
+PulcTerrainSampler terrainSampler = {
+  .sample = terrainSamplerSample,
+};
+
+} // namespace
+
+namespace {
+void guiShutdown(); // editor
 } // namespace
 
 extern "C" {
@@ -231,24 +722,74 @@ PulePluginType pulcPluginType() {
   return PulePluginType_component;
 }
 
-void pulcComponentLoad(PulePluginPayload const payload) {
+void pulcComponentLoad(PulePluginPayload const newPayload) {
+  ::payload = newPayload;
   ::pul = *reinterpret_cast<PuleEngineLayer *>(
-    pulePluginPayloadFetch(payload, puleCStr("pule-engine-layer"))
+    pulePluginPayloadFetch(::payload, puleCStr("pule-engine-layer"))
+  );
+  handleRegistryCreate(terrainHandles, pul, ::payload, PuleEcsWorld { 0 });
+  terrainHandleProfiler = (
+    handlePayload<PulcProfiler const>(terrainHandles, "pulc-profiler")
   );
+  terrainHandleJobs = (
+    handlePayload<PulcJobSystem const>(terrainHandles, "pulc-job-system")
+  );
+  terrainHandleFrameArena = (
+    handlePayload<PulcFrameArena const>(terrainHandles, "pulc-frame-arena")
+  );
+  terrainFrameArenaHeap = PulcFrameArena { .allocator = pul.allocateDefault() };
 
-  // TODO load
-  /* std::vector<float> heights = { 1.0f, 2.0f, 1.0f, 1.0f }; */
-    std::vector<float> defaultTerrainValues;
-    defaultTerrainValues.resize(100*100);
-    for (size_t itx = 0; itx < 100; ++ itx)
-    for (size_t ity = 0; ity < 100; ++ ity) {
-      defaultTerrainValues.emplace_back(1.0f + (itx%20)*5.0f + (ity%50)*6.5f);
-    }
-  initializeContext(defaultTerrainValues.data(), 100, 100, false);
+  if (!terrainHeightfieldLoad(terrainHeightmapPath)) {
+    pul.log("no terrain at '%s', using the default", terrainHeightmapPath);
+    terrainHeightfieldAssign(terrainDefaultHeightmap(100, 100), 100, 100);
+  }
+  initializeContext(terrainHeightfield);
+  terrainSampleKernel = terrainSampleKernelDetect();
+
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-terrain-heightfield"), &terrainHeightfield
+  );
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-terrain-sampler"), &terrainSampler
+  );
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-terrain-editor"), &terrainEditor
+  );
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-terrain-raycaster"), &terrainRaycaster
+  );
+  pul.pluginPayloadStore(
+    ::payload, pul.cStr("pulc-terrain-costmap"), &terrainCostMap
+  );
+
+  handleRevisionBump(pul, ::payload);
+}
+
+void pulcComponentUnload(PulePluginPayload const) {
+  pul.pluginPayloadRemove(::payload, pul.cStr("pulc-terrain-heightfield"));
+  pul.pluginPayloadRemove(::payload, pul.cStr("pulc-terrain-editor"));
+  pul.pluginPayloadRemove(::payload, pul.cStr("pulc-terrain-sampler"));
+  pul.pluginPayloadRemove(::payload, pul.cStr("pulc-terrain-raycaster"));
+  pul.pluginPayloadRemove(::payload, pul.cStr("pulc-terrain-costmap"));
+  handleRevisionBump(pul, ::payload);
+  terrainBuildStop(ctx.build);
+  guiShutdown();
+  releaseContext();
+  tiledHeightmapClose(terrainHeightmap);
+  for (auto & heightmap : terrainHeightmapsRetired) {
+    tiledHeightmapClose(heightmap);
+  }
+  terrainHeightmapsRetired.clear();
+  __atomic_store_n(&terrainPyramid, nullptr, __ATOMIC_RELEASE);
+  terrainPyramids.clear();
+  terrainCostMap = PulcTerrainCostMap {};
+  terrainCostMaps.clear();
 }
 
 void pulcComponentUpdate(PulePluginPayload const payload) {
 (void)payload;
+  handleRegistryRefresh(terrainHandles);
+  PULC_PROFILE_ZONE(terrainProfiler(), "terrain pulcComponentUpdate");
   /* auto const taskGraph = PuleTaskGraph { */
   /*   .id = pul.pluginPayloadFetchU64( */
   /*     payload, */
@@ -287,36 +828,32 @@ void pulcComponentUpdate(PulePluginPayload const payload) {
 
 namespace {
 
+bool guiInitialized = false;
 PuleGfxFramebuffer guiFramebuffer;
+PuleGfxSampler guiSampler;
 PuleGfxGpuImage guiImageColor;
 PuleGfxGpuImage guiImageDepth;
-PuleGfxCommandList guiCommandList;
+// recorded again only when the chunks drawn or what it binds change
+CommandListCache guiCommandList;
 PuleGfxCommandListRecorder guiCommandListRecorder;
+// the one camera culling, LODs, picking and the shader all read
 PuleCamera guiCamera;
 PuleCameraSet guiCameraSet;
-PuleCameraController guiCameraController;
-std::vector<float> guiHeightmap;
 void * guiMappedAttributes;
 
-void guiInitialize(PulePlatform const platform) {
-  static bool initialized = false;
-  if (initialized) { return; }
-  initialized = true;
+void guiInitialize() {
+  if (guiInitialized) { return; }
+  guiInitialized = true;
 
   guiCamera = puleCameraCreate();
-  guiCameraController = puleCameraControllerFirstPerson(platform, guiCamera);
   guiCameraSet = puleCameraSetCreate(puleCStr("gui"));
   puleCameraSetAdd(guiCameraSet, guiCamera);
 
   PuleDsValue const dsTerrain = puleDsCreateObject(puleAllocateDefault());
-  { // store default terrain
-    std::vector<float> defaultTerrainValues;
-    defaultTerrainValues.resize(100*100);
-    for (size_t itx = 0; itx < 100; ++ itx)
-    for (size_t ity = 0; ity < 100; ++ ity) {
-      defaultTerrainValues.emplace_back(1.0f + (itx%20)*5.0f + (ity%50)*6.5f);
+  { // store default terrain, unless one was loaded
+    if (terrainHeightmap.tiles.empty()) {
+      terrainHeightfieldAssign(terrainDefaultHeightmap(100, 100), 100, 100);
     }
-    guiHeightmap = defaultTerrainValues;
     (void)dsTerrain;
     /* puleDsObjectMemberAssign( */
     /*   dsTerrain, */
@@ -324,9 +861,9 @@ void guiInitialize(PulePlatform const platform) {
     /*   puleDsCreateBuffer( */
     /*     puelAllocateDefault(), */
     /*     PuleArrayView { */
-    /*       .data = defaultTerrainValues.data(), */
+    /*       .data = terrainHeightmap.data(), */
     /*       .elementStride = sizeof(float), */
-    /*       .elementCount = defaultTerrainValues.size() */
+    /*       .elementCount = terrainHeightmap.size() */
     /*     } */
     /*   ) */
     /* ); */
@@ -339,29 +876,20 @@ void guiInitialize(PulePlatform const platform) {
   }
 
   // load terrain into context
-  initializeContext(guiHeightmap.data(), 100, 100, true);
+  initializeContext(terrainHeightfield);
 
   // gui mapped pointers
-  guiMappedAttributes = (
-    pul.gfxGpuBufferMap({
-      .buffer = ctx.bufferAttributesStatic,
-      .access = PuleGfxGpuBufferMapAccess_hostWritable,
-      .byteOffset = 0,
-      .byteLength = sizeof(TerrainMeshAttribute) * 100*100,
-    })
-  );
+  guiMappedAttributes = ctx.mappedAttributes;
 
   // gui command list
 
-  guiCommandList = (
-    puleGfxCommandListCreate(puleAllocateDefault(), puleCStr("terrain-gui"))
-  );
+  commandListCacheCreate(guiCommandList, pul, "terrain-gui");
   guiCommandListRecorder = (
-    puleGfxCommandListRecorder(guiCommandList)
+    puleGfxCommandListRecorder(guiCommandList.commandList)
   );
 
   { // gui image / framebuffer
-    PuleGfxSampler sampler = (
+    guiSampler = (
       puleGfxSamplerCreate({
         .minify = PuleGfxImageMagnification_nearest,
         .magnify = PuleGfxImageMagnification_nearest,
@@ -375,7 +903,7 @@ void guiInitialize(PulePlatform const platform) {
         .height = 600,
         .target = PuleGfxImageTarget_i2D,
         .byteFormat = PuleGfxImageByteFormat_rgba8U,
-        .sampler = sampler,
+        .sampler = guiSampler,
         .optionalInitialData = nullptr,
       })
     );
@@ -385,7 +913,7 @@ void guiInitialize(PulePlatform const platform) {
         .height = 600,
         .target = PuleGfxImageTarget_i2D,
         .byteFormat = PuleGfxImageByteFormat_depth16,
-        .sampler = sampler,
+        .sampler = guiSampler,
         .optionalInitialData = nullptr,
       })
     );
@@ -403,6 +931,73 @@ void guiInitialize(PulePlatform const platform) {
   }
 }
 
+// the editor's GPU objects, the context's are released separately
+void guiShutdown() {
+  if (!guiInitialized) { return; }
+  guiInitialized = false;
+  commandListCacheDestroy(guiCommandList, pul);
+  if (guiFramebuffer.id) { puleGfxFramebufferDestroy(guiFramebuffer); }
+  if (guiImageColor.id) { puleGfxGpuImageDestroy(guiImageColor); }
+  if (guiImageDepth.id) { puleGfxGpuImageDestroy(guiImageDepth); }
+  if (guiSampler.id) { puleGfxSamplerDestroy(guiSampler); }
+  guiFramebuffer = PuleGfxFramebuffer { 0 };
+  guiImageColor = PuleGfxGpuImage { 0 };
+  guiImageDepth = PuleGfxGpuImage { 0 };
+  guiSampler = PuleGfxSampler { 0 };
+  guiMappedAttributes = nullptr;
+}
+
+#if PULC_PROFILER
+
+// chrome://tracing and ui.perfetto.dev both open it
+char const * const guiProfilerCapturePath = "profile-capture.json";
+std::vector<PulcProfilerZoneStats> guiProfilerStats;
+
+// rolling per-zone statistics of the graph plugin's profiler, heaviest first
+void guiProfilerPanel() {
+  PulcProfiler const * const profiler = terrainProfiler();
+  if (!profiler) { return; }
+  static bool open = true;
+  pul.imguiWindowBegin("profiler", &open);
+  if (!open) {
+    pul.imguiWindowEnd();
+    return;
+  }
+
+  void * const profilerPtr = profiler->profiler;
+  bool const capturing = profiler->capturing(profilerPtr);
+  if (pul.imguiButton(capturing ? "stop capture" : "start capture")) {
+    if (!capturing) {
+      profiler->captureBegin(profilerPtr);
+    } else if (profiler->captureEnd(profilerPtr, guiProfilerCapturePath)) {
+      pul.log("profile capture written to '%s'", guiProfilerCapturePath);
+    } else {
+      pul.log("couldn't write profile capture '%s'", guiProfilerCapturePath);
+    }
+  }
+
+  guiProfilerStats.resize(profiler->zoneCount(profilerPtr));
+  for (size_t it = 0; it < guiProfilerStats.size(); ++ it) {
+    guiProfilerStats[it] = profiler->zoneStats(profilerPtr, it);
+  }
+  std::sort(
+    guiProfilerStats.begin(), guiProfilerStats.end(),
+    [](PulcProfilerZoneStats const & a, PulcProfilerZoneStats const & b) {
+      return a.msPerFrame > b.msPerFrame;
+    }
+  );
+  pul.imguiText("%-32s %7s %8s %8s", "zone", "calls", "ms avg", "ms max");
+  for (PulcProfilerZoneStats const & stats : guiProfilerStats) {
+    pul.imguiText(
+      "%-32s %7.1f %8.3f %8.3f",
+      stats.label, stats.callsPerFrame, stats.msPerFrame, stats.msPerFrameMax
+    );
+  }
+  pul.imguiWindowEnd();
+}
+
+#endif // PULC_PROFILER
+
 } // namespace
 
 extern "C" {
@@ -412,62 +1007,85 @@ void puldGuiEditor(
   PuleEngineLayer const pulLayer
 ) {
   ::pul = pulLayer;
-  guiInitialize(platform);
+  handleRegistryRefresh(terrainHandles);
+  guiInitialize();
+  #if PULC_PROFILER
+    guiProfilerPanel();
+  #endif
+  PULC_PROFILE_ZONE(terrainProfiler(), "terrain editor");
   static bool open = true;
   pul.imguiWindowBegin("terrain", &open);
   if (!open) {
     return;
   }
 
-  puleCameraControllerPollEvents();
-  puleCameraSetRefresh(guiCameraSet);
-  PuleGfxGpuBuffer const cameraBuffer = (
-    puleCameraSetGfxUniformBuffer(guiCameraSet)
-  );
+  static PuleF32v2 mouseRel = puleF32v2(0.0f);
 
-  pul.gfxCommandListRecorderReset(guiCommandListRecorder);
-  pul.gfxCommandListAppendAction(
-    guiCommandListRecorder,
-    PuleGfxCommand {
-      .clearFramebufferColor = {
-        .action = PuleGfxAction_clearFramebufferColor,
-        .framebuffer = guiFramebuffer,
-        .color = PuleF32v4(0.2f, 0.3f, 0.2f, 1.0f),
-      },
-    }
+  // orbits with the cursor over the viewport
+  puleCameraLookAt(
+    guiCamera,
+    PuleF32v3{sinf(mouseRel.x/100.0f)*3.0f,
+    -2.0f + mouseRel.y/200.0f,
+    cosf(mouseRel.x/100.0f)*3.0f},
+    puleF32v3(0.0),
+    PuleF32v3{0.0f, 1.0f, 0.0f}
   );
-  pul.gfxCommandListAppendAction(
-    guiCommandListRecorder,
-    PuleGfxCommand {
-      .clearFramebufferDepth = {
-        .action = PuleGfxAction_clearFramebufferDepth,
-        .framebuffer = guiFramebuffer,
-        .depth = 1.0f,
-      },
+  puleCameraPerspectiveSet(
+    guiCamera,
+    PuleCameraPerspective {
+      .nearCutoff = 0.001f,
+      .farCutoff = terrainCursorDepthMax,
+      .aspectRatio = 800.0f/600.0f,
+      .fieldOfViewRadians = 1.5707963f, // 90 degrees
     }
   );
-
-  static PuleF32v2 mouseRel = puleF32v2(0.0f);
-
-  PuleF32m44 const view = (
-    puleViewLookAt(
-      PuleF32v3{sinf(mouseRel.x/100.0f)*3.0f,
-      -2.0f + mouseRel.y/200.0f,
-      cosf(mouseRel.x/100.0f)*3.0f},
-      puleF32v3(0.0),
-      PuleF32v3{0.0f, 1.0f, 0.0f}
-    )
-  );
-  PuleF32m44 const proj = (
-    puleProjectionPerspective(90.0f, 800.0f/600.0f, 0.001f, 1000.0f)
+  puleCameraSetRefresh(guiCameraSet);
+  PuleGfxGpuBuffer const cameraBuffer = (
+    puleCameraSetGfxUniformBuffer(guiCameraSet)
   );
+  PuleF32m44 const view = puleCameraView(guiCamera);
+  PuleF32m44 const proj = puleCameraProj(guiCamera);
 
-  ::terrainRender(guiFramebuffer, guiCommandListRecorder, cameraBuffer);
-  pul.gfxCommandListRecorderFinish(guiCommandListRecorder);
+  ::terrainRenderPrepare(view, proj);
+  if (
+    commandListCacheStale(
+      guiCommandList,
+      {
+        guiFramebuffer.id, cameraBuffer.id, ctx.pipeline.id,
+        ctx.bufferElements.id, ctx.drawRevision,
+      }
+    )
+  ) {
+    pul.gfxCommandListRecorderReset(guiCommandListRecorder);
+    pul.gfxCommandListAppendAction(
+      guiCommandListRecorder,
+      PuleGfxCommand {
+        .clearFramebufferColor = {
+          .action = PuleGfxAction_clearFramebufferColor,
+          .framebuffer = guiFramebuffer,
+          .color = PuleF32v4(0.2f, 0.3f, 0.2f, 1.0f),
+        },
+      }
+    );
+    pul.gfxCommandListAppendAction(
+      guiCommandListRecorder,
+      PuleGfxCommand {
+        .clearFramebufferDepth = {
+          .action = PuleGfxAction_clearFramebufferDepth,
+          .framebuffer = guiFramebuffer,
+          .depth = 1.0f,
+        },
+      }
+    );
+    ::terrainRenderRecord(
+      guiFramebuffer, guiCommandListRecorder, cameraBuffer
+    );
+    pul.gfxCommandListRecorderFinish(guiCommandListRecorder);
+  }
   PuleError err = pul.error();
   pul.gfxCommandListSubmit(
     PuleGfxCommandListSubmitInfo {
-      .commandList = guiCommandList,
+      .commandList = guiCommandList.commandList,
       .fenceTargetStart = nullptr,
       .fenceTargetFinish = nullptr,
     },
@@ -485,6 +1103,13 @@ void puldGuiEditor(
   if (pul.imguiLastItemHovered()) {
     mouseRel.x = mouseOrigin.x;
     mouseRel.y = mouseOrigin.y;
+    // the 800x600 image is shown squeezed into 400x400
+    terrainCursorPick(
+      view, proj,
+      PuleF32v2 {
+        mouseOrigin.x/400.0f*2.0f - 1.0f, 1.0f - mouseOrigin.y/400.0f*2.0f,
+      }
+    );
   }
 
   pul.imguiWindowEnd();
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <pulchritude-math/math.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// inclusive sample rectangle touched by a single heightfield revision
+typedef struct {
+  uint64_t revision;
+  size_t x0, y0;
+  size_t x1, y1;
+} PulcTerrainHeightfieldEdit;
+
+#define pulcTerrainHeightfieldEditLogLength 64
+
+// square block of quantized samples; samples are never written once
+//   published. The first edit to a tile gives it full precision heights,
+//   which take over from the samples and are written in place with relaxed
+//   atomics, so a reader racing an edit sees either value; the edit's
+//   revision tells it to read again
+typedef struct {
+  uint16_t const * samples; // row-major, tileDim*tileDim
+  float heightMin;
+  float heightScale; // height = heightMin + sample*heightScale
+  float const * heights; // row-major, tileDim*tileDim; NULL until edited
+} PulcTerrainHeightfieldTile;
+
+// heightfield shared by the terrain plugin through the plugin payload under
+//   "pulc-terrain-heightfield"; owned by the terrain plugin, other plugins
+//   only read it. Samples usually live in a memory-mapped file, so only the
+//   tiles something reads are ever paged in
+typedef struct {
+  size_t width;
+  size_t height;
+  PuleF32v2 origin; // world XZ of sample (0, 0)
+  PuleF32v2 spacing; // world distance between neighbouring samples
+  size_t tileShift; // tiles are (1 << tileShift) samples square
+  size_t tilesX;
+  size_t tilesY;
+  PulcTerrainHeightfieldTile const * tiles; // row-major, tilesX*tilesY
+  uint64_t revision; // bumped whenever any height changes
+  // ring of the most recent edits indexed by revision, lets consumers
+  //   rebuild only what changed since the revision they last saw
+  PulcTerrainHeightfieldEdit edits[pulcTerrainHeightfieldEditLogLength];
+} PulcTerrainHeightfield;
+
+static inline PulcTerrainHeightfieldTile const * pulcTerrainHeightfieldTile(
+  PulcTerrainHeightfield const * const heightfield,
+  size_t const x, size_t const y
+) {
+  return &heightfield->tiles[
+    (y >> heightfield->tileShift)*heightfield->tilesX
+    + (x >> heightfield->tileShift)
+  ];
+}
+
+static inline float pulcTerrainHeightfieldAt(
+  PulcTerrainHeightfield const * const heightfield,
+  size_t const x, size_t const y
+) {
+  PulcTerrainHeightfieldTile const * const tile = (
+    pulcTerrainHeightfieldTile(heightfield, x, y)
+  );
+  size_t const mask = ((size_t)1 << heightfield->tileShift) - 1;
+  size_t const index = ((y & mask) << heightfield->tileShift) + (x & mask);
+  float const * const heights = (
+    __atomic_load_n(&tile->heights, __ATOMIC_ACQUIRE)
+  );
+  if (heights) {
+    float height;
+    __atomic_load(&heights[index], &height, __ATOMIC_RELAXED);
+    return height;
+  }
+  return tile->heightMin + tile->samples[index]*tile->heightScale;
+}
+
+// edit that produced the given revision, or NULL if it already fell out of
+//   the log and the consumer has to rebuild everything
+static inline PulcTerrainHeightfieldEdit const *
+pulcTerrainHeightfieldEditFetch(
+  PulcTerrainHeightfield const * const heightfield, uint64_t const revision
+) {
+  PulcTerrainHeightfieldEdit const * const edit = (
+    &heightfield->edits[revision % pulcTerrainHeightfieldEditLogLength]
+  );
+  return edit->revision == revision ? edit : NULL;
+}
+
+typedef enum {
+  PulcTerrainBrushOp_raise,
+  PulcTerrainBrushOp_lower,
+  PulcTerrainBrushOp_smooth, // towards the 3x3 average
+  PulcTerrainBrushOp_flatten, // towards target
+} PulcTerrainBrushOp;
+
+// weight falls off smoothly from one at the center to zero at radius
+typedef struct {
+  PulcTerrainBrushOp op;
+  PuleF32v2 center; // world XZ
+  float radius; // world units
+  // height per application at the center for raise/lower, fraction of the
+  //   way to the smoothed/target height for smooth/flatten
+  float strength;
+  float target; // flatten only
+} PulcTerrainBrush;
+
+// height editing shared by the terrain plugin through the plugin payload
+//   under "pulc-terrain-editor". Every brushApply between strokeBegin and
+//   strokeEnd is one undo step; outside a stroke it's a step of its own.
+//   Each change shows up as an edit in the heightfield's log
+typedef struct {
+  void (*strokeBegin)(void);
+  void (*brushApply)(PulcTerrainBrush const * const brush);
+  void (*strokeEnd)(void);
+  // false once there's nothing left to undo/redo
+  bool (*undo)(void);
+  bool (*redo)(void);
+  // ground under the editor viewport's cursor, false if it isn't over any
+  bool (*cursorGround)(PuleF32v3 * const ground);
+} PulcTerrainEditor;
+
+// batched ground queries shared by the terrain plugin through the plugin
+//   payload under "pulc-terrain-sampler". Heights and normals are of the
+//   bilinear surface through the samples, positions outside the map clamp
+//   to its edge. Arrays are structure-of-arrays; the normal arrays may be
+//   NULL to only fetch heights. Only reads the heightfield, so any thread can
+//   sample any copy of it, with ranges split over as many jobs as it likes
+typedef struct {
+  void (*sample)(
+    PulcTerrainHeightfield const * const heightfield,
+    float const * const positionX, float const * const positionZ,
+    size_t const count,
+    float * const heights,
+    float * const normalX, float * const normalY, float * const normalZ
+  );
+} PulcTerrainSampler;
+
+// ray queries against the terrain's current heights, shared by the terrain
+//   plugin through the plugin payload under "pulc-terrain-raycaster". Rays
+//   meet the same bilinear surface the sampler interpolates. Traces skip down
+//   a min/max height pyramid that edits keep up to date in place, so any
+//   thread can trace while the main thread edits; a trace racing an edit
+//   sees either side of it
+typedef struct {
+  // first point origin + t*direction on the ground with t in [0, tMax],
+  //   false if there is none
+  bool (*raycast)(
+    PuleF32v3 const origin, PuleF32v3 const direction, float const tMax,
+    PuleF32v3 * const hit
+  );
+  // visible[i] is 1 if the segment from[i] -> to[i] clears the ground, 0 if
+  //   the ground blocks it
+  void (*lineOfSight)(
+    PuleF32v3 const * const from, PuleF32v3 const * const to,
+    size_t const count, uint8_t * const visible
+  );
+} PulcTerrainRaycaster;
+
+// movement classes differ in the steepest slope they climb; a class's bit
+//   in a cell's passable mask says whether it may enter the cell
+typedef enum {
+  PulcTerrainMovementClass_foot,
+  PulcTerrainMovementClass_tracked,
+  PulcTerrainMovementClass_wheeled,
+} PulcTerrainMovementClass;
+
+#define pulcTerrainMovementClassCount 3
+// cost of a cell no class can enter
+#define pulcTerrainCostImpassable 0xFF
+// regions are labelled per block of (1 << shift) cells square first, then
+//   the block labels are joined across block borders into map-wide ids
+#define pulcTerrainRegionBlockShift 4
+#define pulcTerrainRegionBlockLabels 128
+
+// per-cell movement data derived from the heightfield, one cell per sample,
+//   shared by the terrain plugin through the plugin payload under
+//   "pulc-terrain-costmap". The arrays stay valid until unload and are
+//   rewritten in place with relaxed atomics over the rectangles of the
+//   heightfield's edit log, so a copy of this struct is enough to keep
+//   reading them; a reader racing an edit sees either value per cell.
+// Two cells share a region id for a class exactly when that class can walk
+//   from one to the other, so comparing ids rejects unreachable goals
+//   without a search
+typedef struct {
+  size_t width;
+  size_t height;
+  // cost to enter, from 1 on flat ground up; pulcTerrainCostImpassable past
+  //   the steepest slope any class climbs
+  uint8_t const * costs;
+  uint8_t const * passable; // bit per PulcTerrainMovementClass
+  // per class, label of a cell within its block, 0 where impassable
+  uint8_t const * regionLabels[pulcTerrainMovementClassCount];
+  // per class, id of every block label, blocks row-major with
+  //   pulcTerrainRegionBlockLabels entries each
+  uint32_t const * regionIds[pulcTerrainMovementClassCount];
+  size_t blocksX;
+  uint64_t revision; // heightfield revision it's up to date with
+} PulcTerrainCostMap;
+
+static inline uint8_t pulcTerrainCostMapCost(
+  PulcTerrainCostMap const * const costMap, size_t const cell
+) {
+  return __atomic_load_n(&costMap->costs[cell], __ATOMIC_RELAXED);
+}
+
+static inline bool pulcTerrainCostMapPassable(
+  PulcTerrainCostMap const * const costMap,
+  PulcTerrainMovementClass const movementClass, size_t const cell
+) {
+  uint8_t const mask = (
+    __atomic_load_n(&costMap->passable[cell], __ATOMIC_RELAXED)
+  );
+  return (mask >> movementClass) & 1;
+}
+
+// 0 where the class can't stand
+static inline uint32_t pulcTerrainCostMapRegion(
+  PulcTerrainCostMap const * const costMap,
+  PulcTerrainMovementClass const movementClass,
+  size_t const x, size_t const y
+) {
+  uint8_t const label = __atomic_load_n(
+    &costMap->regionLabels[movementClass][y*costMap->width + x],
+    __ATOMIC_RELAXED
+  );
+  if (label == 0) { return 0; }
+  size_t const block = (
+      (y >> pulcTerrainRegionBlockShift)*costMap->blocksX
+    + (x >> pulcTerrainRegionBlockShift)
+  );
+  return __atomic_load_n(
+    &costMap->regionIds[movementClass][
+      block*pulcTerrainRegionBlockLabels + label - 1
+    ],
+    __ATOMIC_RELAXED
+  );
+}
@@ -0,0 +1,67 @@
+#include "allocation-counter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocations { 0 };
+std::atomic<uint64_t> frees { 0 };
+
+void * allocationCounted(size_t const bytes, size_t const alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  size_t const size = bytes ? bytes : 1;
+  void * const memory = (
+    alignment <= alignof(std::max_align_t)
+    ? std::malloc(size)
+    : std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1))
+  );
+  if (!memory) { throw std::bad_alloc(); }
+  return memory;
+}
+
+void freeCounted(void * const memory) {
+  if (!memory) { return; }
+  frees.fetch_add(1, std::memory_order_relaxed);
+  std::free(memory);
+}
+
+} // namespace
+
+// the array and nothrow forms forward to these
+void * operator new(size_t const bytes) {
+  return allocationCounted(bytes, alignof(std::max_align_t));
+}
+void * operator new(size_t const bytes, std::align_val_t const alignment) {
+  return allocationCounted(bytes, static_cast<size_t>(alignment));
+}
+void operator delete(void * const memory) noexcept {
+  freeCounted(memory);
+}
+void operator delete(void * const memory, std::align_val_t) noexcept {
+  freeCounted(memory);
+}
+void operator delete(void * const memory, size_t) noexcept {
+  freeCounted(memory);
+}
+void operator delete(
+  void * const memory, size_t, std::align_val_t
+) noexcept {
+  freeCounted(memory);
+}
+
+AllocationCount allocationCount() {
+  return AllocationCount {
+    .allocations = allocations.load(std::memory_order_relaxed),
+    .frees = frees.load(std::memory_order_relaxed),
+  };
+}
+
+bool allocationCounterCheck() {
+  uint64_t const before = allocations.load(std::memory_order_relaxed);
+  // operator new[] isn't replaced here, libstdc++ defines it and forwards
+  operator delete[](operator new[](1));
+  return allocations.load(std::memory_order_relaxed) != before;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// counts calls to the global operator new and delete, which this file
+//   replaces. A replacement defined in the executable is the one the dynamic
+//   linker binds every library to, however they were opened, so the plugins'
+//   allocations and those of the standard library on their behalf are
+//   counted along with the executable's. allocationCounterCheck makes sure
+//   of that on the platform at hand
+
+struct AllocationCount {
+  uint64_t allocations;
+  uint64_t frees;
+};
+
+AllocationCount allocationCount();
+
+// allocates through the standard library's operator new[], which calls the
+//   replaced operator new only if the replacement took over for shared
+//   libraries as well; false if it didn't move the count
+bool allocationCounterCheck();
@@ -0,0 +1,735 @@
+#include "allocation-counter.h"
+#include "benchmark.h"
+#include "stub-engine.h"
+
+#include <pulchritude-plugin/engine.h>
+#include <pulchritude-plugin/plugin.h>
+
+#include "../../plugins/graph/components/node-unit.h"
+#include "../../plugins/graph/profile/profiler.h"
+#include "../../plugins/graph/registry/handle-registry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dlfcn.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+float benchmarkPercentile(
+  std::vector<float> const & sorted, float const fraction
+) {
+  if (sorted.empty()) { return 0.0f; }
+  size_t const rank = static_cast<size_t>(
+    std::ceil(fraction * static_cast<float>(sorted.size()))
+  );
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+void benchmarkJsonString(FILE * const file, char const * value) {
+  std::fputc('"', file);
+  for (; *value; ++ value) {
+    if (*value == '"' || *value == '\\') { std::fputc('\\', file); }
+    if (static_cast<unsigned char>(*value) < 0x20) { continue; }
+    std::fputc(*value, file);
+  }
+  std::fputc('"', file);
+}
+
+std::vector<float> benchmarkHeights(size_t const dim, size_t const mesas) {
+  std::vector<float> heights(dim*dim);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+  for (size_t y = 0; y < dim; ++ y)
+  for (size_t x = 0; x < dim; ++ x) {
+    float const fx = static_cast<float>(x), fy = static_cast<float>(y);
+    heights[y*dim + x] = (
+        8.0f*sinf(fx*0.013f)*cosf(fy*0.011f)
+      + 3.0f*fabsf(sinf((fx + 2.0f*fy)*0.021f))
+      + noise(random)
+    );
+  }
+  std::uniform_real_distribution<float> along(0.0f, static_cast<float>(dim));
+  std::uniform_real_distribution<float> radii(
+    4.0f, std::max(8.0f, dim/32.0f)
+  );
+  for (size_t mesa = 0; mesa < mesas; ++ mesa) {
+    float const cx = along(random), cy = along(random);
+    float const radius = radii(random);
+    size_t const x0 = static_cast<size_t>(std::max(cx - radius, 0.0f));
+    size_t const y0 = static_cast<size_t>(std::max(cy - radius, 0.0f));
+    size_t const x1 = std::min(static_cast<size_t>(cx + radius), dim - 1);
+    size_t const y1 = std::min(static_cast<size_t>(cy + radius), dim - 1);
+    for (size_t y = y0; y <= y1; ++ y)
+    for (size_t x = x0; x <= x1; ++ x) {
+      float const dx = x - cx, dy = y - cy;
+      if (dx*dx + dy*dy <= radius*radius) { heights[y*dim + x] += 40.0f; }
+    }
+  }
+  return heights;
+}
+
+void benchmarkTerrainCreate(
+  BenchmarkTerrain & terrain, size_t const dim, size_t const mesas
+) {
+  std::vector<float> const heights = benchmarkHeights(dim, mesas);
+  tiledHeightmapFromHeights(
+    terrain.heightmap, heights.data(), dim, dim, PuleF32v2 { 0.0f, 0.0f },
+    PuleF32v2 { 1.0f, 1.0f }
+  );
+  terrain.heightfield = PulcTerrainHeightfield {};
+  tiledHeightmapHeightfield(terrain.heightmap, terrain.heightfield);
+  // revision 0 reads as nothing published yet
+  terrain.heightfield.revision = 1;
+  terrainCostMapBuild(terrain.costMap, terrain.heightfield);
+  terrain.costMapShared = terrainCostMapShared(terrain.costMap, 1);
+}
+
+float benchmarkPositionsExtent(size_t const count) {
+  return std::sqrt(static_cast<float>(count) / benchmarkUnitDensity);
+}
+
+std::vector<PuleF32v2> benchmarkPositions(size_t const count) {
+  std::mt19937 random(3);
+  std::uniform_real_distribution<float> along(
+    0.0f, benchmarkPositionsExtent(count)
+  );
+  std::vector<PuleF32v2> positions(count);
+  for (PuleF32v2 & position : positions) {
+    position.x = along(random);
+    position.y = along(random);
+  }
+  return positions;
+}
+
+bool benchmarkMapWrite(size_t const dim, char const * const path) {
+  std::vector<float> const heights = benchmarkHeights(dim, 0);
+  TiledHeightmap heightmap {};
+  tiledHeightmapFromHeights(
+    heightmap, heights.data(), dim, dim, PuleF32v2 { 0.0f, 0.0f },
+    PuleF32v2 { 1.0f, 1.0f }
+  );
+  // over the quantized heights, as the terrain plugin would build it
+  PulcTerrainHeightfield heightfield {};
+  tiledHeightmapHeightfield(heightmap, heightfield);
+  TerrainCostMap costMap {};
+  terrainCostMapBuild(costMap, heightfield);
+  bool const written = tiledHeightmapWrite(
+    heightmap, path, terrainCostMapBytes(costMap),
+    terrainCostMapByteLength(heightfield.width, heightfield.height)
+  );
+  tiledHeightmapClose(heightmap);
+  return written;
+}
+
+BenchmarkMemory benchmarkMemory() {
+  BenchmarkMemory memory = { 0, 0 };
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    // kilobytes on Linux
+    memory.residentPeakBytes = static_cast<uint64_t>(usage.ru_maxrss)*1024;
+  }
+  if (FILE * const statm = std::fopen("/proc/self/statm", "r")) {
+    unsigned long long pages = 0, resident = 0;
+    if (std::fscanf(statm, "%llu %llu", &pages, &resident) == 2) {
+      memory.residentBytes = resident * sysconf(_SC_PAGESIZE);
+    }
+    std::fclose(statm);
+  }
+  // the peak is only accounted now and then, it can trail the current size
+  memory.residentPeakBytes = (
+    std::max(memory.residentPeakBytes, memory.residentBytes)
+  );
+  return memory;
+}
+
+namespace {
+
+// -- setup --------------------------------------------------------------------
+
+struct BenchmarkPlugin {
+  void * library;
+  void (* load)(PulePluginPayload);
+  void (* update)(PulePluginPayload);
+  void (* unload)(PulePluginPayload);
+};
+
+bool benchmarkPluginOpen(
+  BenchmarkPlugin & plugin, std::string const & path
+) {
+  plugin.library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!plugin.library) {
+    std::fprintf(stderr, "benchmark: %s\n", dlerror());
+    return false;
+  }
+  plugin.load = reinterpret_cast<void (*)(PulePluginPayload)>(
+    dlsym(plugin.library, "pulcComponentLoad")
+  );
+  plugin.update = reinterpret_cast<void (*)(PulePluginPayload)>(
+    dlsym(plugin.library, "pulcComponentUpdate")
+  );
+  plugin.unload = reinterpret_cast<void (*)(PulePluginPayload)>(
+    dlsym(plugin.library, "pulcComponentUnload")
+  );
+  if (!plugin.load || !plugin.update || !plugin.unload) {
+    std::fprintf(stderr, "benchmark: '%s' isn't a component\n", path.c_str());
+    dlclose(plugin.library);
+    plugin.library = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool benchmarkSystemRegister(
+  BenchmarkPlugin const & plugin, PuleEcsComponent const component,
+  char const * const label, char const * const callback
+) {
+  auto const function = reinterpret_cast<void (*)(PuleEcsIterator)>(
+    dlsym(plugin.library, callback)
+  );
+  if (!function) {
+    std::fprintf(stderr, "benchmark: no system callback %s\n", callback);
+    return false;
+  }
+  stubEcsSystemRegister(label, component, function);
+  return true;
+}
+
+// same units every run, so runs compare
+void benchmarkSpawn(
+  PuleEngineLayer const & pul, size_t const units,
+  PulcTerrainHeightfield const & heightfield
+) {
+  PuleEcsWorld const world = stubEcsWorld();
+  PuleEcsComponent const nodeUnitComponent = (
+    pul.ecsComponentFetchByLabel(world, pul.cStr("PulcComponentNodeUnit"))
+  );
+  float const extentX = (heightfield.width - 1) * heightfield.spacing.x;
+  float const extentY = (heightfield.height - 1) * heightfield.spacing.y;
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> alongX(0.0f, extentX);
+  std::uniform_real_distribution<float> alongY(0.0f, extentY);
+  PuleF32v2 goals[benchmarkOrderGroups];
+  for (PuleF32v2 & goal : goals) {
+    goal = PuleF32v2 {
+      heightfield.origin.x + alongX(random),
+      heightfield.origin.y + alongY(random),
+    };
+  }
+  char label[48];
+  for (size_t it = 0; it < units; ++ it) {
+    PulcComponentNodeUnit unit = {
+      .position = PuleF32v2 {
+        heightfield.origin.x + alongX(random),
+        heightfield.origin.y + alongY(random),
+      },
+      // each group is spawned together, like a selection ordered at once
+      .goal = goals[it*benchmarkOrderGroups / std::max<size_t>(units, 1)],
+      .speed = benchmarkUnitSpeed,
+      .hasGoal = true,
+      .order = 1,
+      .team = static_cast<uint8_t>(it % benchmarkTeams),
+    };
+    std::snprintf(label, sizeof(label), "benchmark-unit-%zu", it);
+    PuleEcsEntity const entity = pul.ecsEntityCreate(world, pul.cStr(label));
+    pul.ecsEntityAttachComponent(world, entity, nodeUnitComponent, &unit);
+  }
+}
+
+// -- measuring ----------------------------------------------------------------
+
+struct BenchmarkRun {
+  PuleEngineLayer const * pul;
+  PulePluginPayload payload;
+  HandleRegistry handles;
+  HandlePayload<PulcProfiler const> profiler;
+  HandlePayload<void const> lookupPayload;
+  HandleComponent lookupComponent;
+  HandleTaskGraphNode lookupRenderGeometry;
+
+  // per profiler label, milliseconds of every measured frame it ran in
+  std::vector<std::string> labels;
+  std::vector<std::vector<float>> samples;
+  uint64_t lookupSink; // keeps the lookups from being dropped
+  // per measured frame, the process' allocations while the plugins updated;
+  //   the simulation thread's land in whichever frame they overlap
+  bool allocationsCounted;
+  std::vector<float> allocations;
+  // per measured frame, milliseconds for all systems' lookups
+  std::vector<float> lookupStrings, lookupHandles;
+  double seconds;
+  BenchmarkMemory memory;
+};
+
+// what map-movement and node-unit-render look up every frame
+void benchmarkLookups(BenchmarkRun & run) {
+  PuleEngineLayer const & pul = *run.pul;
+  PuleEcsWorld const world = stubEcsWorld();
+  uint64_t sink = 0;
+  uint64_t const stringsBeginNs = pulcProfilerNowNs();
+  for (size_t system = 0; system < benchmarkLookupSystems; ++ system) {
+    sink += reinterpret_cast<uint64_t>(
+      pul.pluginPayloadFetch(
+        run.payload, pul.cStr("pulc-terrain-heightfield")
+      )
+    );
+    sink += pul.ecsComponentFetchByLabel(
+      world, pul.cStr("PulcComponentNodeUnit")
+    ).id;
+    PuleTaskGraph const taskGraph = {
+      pul.pluginPayloadFetchU64(
+        run.payload, pul.cStr("pule-render-task-graph")
+      ),
+    };
+    if (taskGraph.id) {
+      sink += pul.taskGraphNodeAttributeFetchU64(
+        pul.taskGraphNodeFetch(taskGraph, pul.cStr("render-geometry")),
+        pul.cStr("command-list-primary-recorder")
+      );
+    }
+  }
+  uint64_t const handlesBeginNs = pulcProfilerNowNs();
+  HandleRegistry const & handles = run.handles;
+  for (size_t system = 0; system < benchmarkLookupSystems; ++ system) {
+    sink += reinterpret_cast<uint64_t>(
+      handleFetch(handles, run.lookupPayload)
+    );
+    sink += handleFetch(handles, run.lookupComponent).id;
+    PuleTaskGraphNode const node = (
+      handleFetch(handles, run.lookupRenderGeometry)
+    );
+    if (node.id) {
+      sink += pul.taskGraphNodeAttributeFetchU64(
+        node, pul.cStr("command-list-primary-recorder")
+      );
+    }
+  }
+  uint64_t const endNs = pulcProfilerNowNs();
+  run.lookupSink += sink;
+  run.lookupStrings.emplace_back(
+    static_cast<float>(handlesBeginNs - stringsBeginNs) * 1e-6f
+  );
+  run.lookupHandles.emplace_back(
+    static_cast<float>(endNs - handlesBeginNs) * 1e-6f
+  );
+}
+
+// the graph plugin closes its profiler frame at the start of its update, so
+//   this reads the frame before
+void benchmarkZones(BenchmarkRun & run, size_t const frames) {
+  PulcProfiler const * const profiler = handleFetch(run.handles, run.profiler);
+  if (!profiler) { return; }
+  size_t const count = profiler->zoneCount(profiler->profiler);
+  while (run.labels.size() < count) {
+    run.labels.emplace_back(
+      profiler->zoneStats(profiler->profiler, run.labels.size()).label
+    );
+    run.samples.emplace_back().reserve(frames);
+  }
+  for (size_t label = 0; label < count; ++ label) {
+    float ms;
+    if (profiler->zoneLastFrame(profiler->profiler, label, &ms)) {
+      run.samples[label].emplace_back(ms);
+    }
+  }
+}
+
+bool benchmarkReport(
+  BenchmarkRun & run, BenchmarkOptions const & options
+) {
+  FILE * const file = std::fopen(options.output.c_str(), "wb");
+  if (!file) { return false; }
+  std::vector<float> & lookupStrings = run.lookupStrings;
+  std::vector<float> & lookupHandles = run.lookupHandles;
+  std::sort(lookupStrings.begin(), lookupStrings.end());
+  std::sort(lookupHandles.begin(), lookupHandles.end());
+  std::sort(run.allocations.begin(), run.allocations.end());
+  std::fprintf(
+    file,
+    "{\n"
+    "  \"units\": %zu,\n"
+    "  \"frames\": %zu,\n"
+    "  \"warmupFrames\": %zu,\n"
+    "  \"mapDim\": %zu,\n"
+    "  \"seconds\": %.3f,\n"
+    "  \"memory\": {\n"
+    "    \"residentBytes\": %llu,\n"
+    "    \"residentPeakBytes\": %llu\n"
+    "  },\n"
+    "  \"allocations\": {\n"
+    "    \"counted\": %s,\n"
+    "    \"perFrameP50\": %.0f,\n"
+    "    \"perFrameMax\": %.0f\n"
+    "  },\n"
+    "  \"lookups\": {\n"
+    "    \"systems\": %zu,\n"
+    "    \"stringsP50Ms\": %.4f,\n"
+    "    \"stringsMaxMs\": %.4f,\n"
+    "    \"handlesP50Ms\": %.4f,\n"
+    "    \"handlesMaxMs\": %.4f\n"
+    "  },\n"
+    "  \"zones\": [",
+    options.units, options.frames, benchmarkWarmupFrames, options.mapDim,
+    run.seconds,
+    static_cast<unsigned long long>(run.memory.residentBytes),
+    static_cast<unsigned long long>(run.memory.residentPeakBytes),
+    run.allocationsCounted ? "true" : "false",
+    benchmarkPercentile(run.allocations, 0.5f),
+    benchmarkPercentile(run.allocations, 1.0f),
+    benchmarkLookupSystems,
+    benchmarkPercentile(lookupStrings, 0.5f),
+    benchmarkPercentile(lookupStrings, 1.0f),
+    benchmarkPercentile(lookupHandles, 0.5f),
+    benchmarkPercentile(lookupHandles, 1.0f)
+  );
+  bool first = true;
+  for (size_t label = 0; label < run.samples.size(); ++ label) {
+    std::vector<float> & samples = run.samples[label];
+    if (samples.empty()) { continue; }
+    std::sort(samples.begin(), samples.end());
+    std::fputs(first ? "\n    { \"name\": " : ",\n    { \"name\": ", file);
+    first = false;
+    benchmarkJsonString(file, run.labels[label].c_str());
+    std::fprintf(
+      file,
+      ", \"frames\": %zu, \"p50Ms\": %.4f, \"p99Ms\": %.4f, \"maxMs\": %.4f }",
+      samples.size(), benchmarkPercentile(samples, 0.5f),
+      benchmarkPercentile(samples, 0.99f), samples.back()
+    );
+  }
+  std::fputs("\n  ]\n}\n", file);
+  bool const written = std::ferror(file) == 0;
+  std::fclose(file);
+  return written;
+}
+
+// -- run ----------------------------------------------------------------------
+
+// plugins loaded, units spawned; updates both plugins through the warm-up
+//   and the measured frames
+void benchmarkFrames(
+  BenchmarkRun & run, BenchmarkOptions const & options,
+  BenchmarkPlugin const & graph, BenchmarkPlugin const & terrain
+) {
+  using Clock = std::chrono::steady_clock;
+  Clock::duration const frameTime = (
+    options.frameRate > 0.0f
+    ? std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / options.frameRate)
+      )
+    : Clock::duration::zero()
+  );
+  // measuring mustn't allocate itself
+  run.lookupStrings.reserve(options.frames);
+  run.lookupHandles.reserve(options.frames);
+  run.allocations.reserve(options.frames);
+  Clock::time_point next = Clock::now();
+  Clock::time_point measureBegin = next;
+  for (size_t frame = 0; frame < benchmarkWarmupFrames + options.frames;) {
+    if (frameTime != Clock::duration::zero()) {
+      std::this_thread::sleep_until(next);
+      next += frameTime;
+    }
+    uint64_t const allocationsBegin = allocationCount().allocations;
+    // the graph plugin updates first, it starts the frame arena's frame
+    graph.update(run.payload);
+    terrain.update(run.payload);
+    handleRegistryRefresh(run.handles);
+    uint64_t const allocationsEnd = allocationCount().allocations;
+    if (++ frame <= benchmarkWarmupFrames) {
+      measureBegin = Clock::now();
+      continue;
+    }
+    run.allocations.emplace_back(
+      static_cast<float>(allocationsEnd - allocationsBegin)
+    );
+    benchmarkLookups(run);
+    benchmarkZones(run, options.frames);
+  }
+  run.seconds = std::chrono::duration<double>(
+    Clock::now() - measureBegin
+  ).count();
+  run.memory = benchmarkMemory();
+}
+
+bool benchmarkRun(
+  BenchmarkOptions const & options, PuleEngineLayer const & pul,
+  PulePluginPayload const payload,
+  BenchmarkPlugin const & graph, BenchmarkPlugin const & terrain
+) {
+  auto const heightfield = reinterpret_cast<PulcTerrainHeightfield const *>(
+    pul.pluginPayloadFetch(payload, pul.cStr("pulc-terrain-heightfield"))
+  );
+  if (!heightfield) {
+    std::fprintf(stderr, "benchmark: the terrain plugin has no heightfield\n");
+    return false;
+  }
+  benchmarkSpawn(pul, options.units, *heightfield);
+
+  BenchmarkRun run = {};
+  run.pul = &pul;
+  run.allocationsCounted = allocationCounterCheck();
+  if (!run.allocationsCounted) {
+    pul.log("benchmark: operator new isn't replaced, allocations not counted");
+  }
+  run.payload = payload;
+  handleRegistryCreate(run.handles, pul, payload, stubEcsWorld());
+  run.profiler = (
+    handlePayload<PulcProfiler const>(run.handles, "pulc-profiler")
+  );
+  run.lookupPayload = (
+    handlePayload<void const>(run.handles, "pulc-terrain-heightfield")
+  );
+  run.lookupComponent = handleComponent(run.handles, "PulcComponentNodeUnit");
+  run.lookupRenderGeometry = handleTaskGraphNode(
+    run.handles, handlePayloadU64(run.handles, "pule-render-task-graph"),
+    "render-geometry"
+  );
+  pul.log(
+    "benchmark: %zu units, %zu frames on a %zux%zu map", options.units,
+    options.frames, options.mapDim, options.mapDim
+  );
+  benchmarkFrames(run, options, graph, terrain);
+  bool const written = benchmarkReport(run, options);
+  pul.log(
+    written ? "benchmark: report written to '%s'"
+            : "benchmark: couldn't write '%s'",
+    options.output.c_str()
+  );
+  return written;
+}
+
+// -- suites -------------------------------------------------------------------
+
+BenchmarkSuite constexpr benchmarkSuites[] = {
+  { "pathfinding", benchmarkSuitePathfinding, },
+  { "spatial-grid", benchmarkSuiteSpatialGrid, },
+  { "steering", benchmarkSuiteSteering, },
+  { "frustum-cull", benchmarkSuiteFrustumCull, },
+  { "map-open", benchmarkSuiteMapOpen, },
+  { "terrain-build", benchmarkSuiteTerrainBuild, },
+  { "raycast", benchmarkSuiteRaycast, },
+  { "fog-of-war", benchmarkSuiteFogOfWar, },
+  { "influence", benchmarkSuiteInfluence, },
+  { "avoidance", benchmarkSuiteAvoidance, },
+};
+
+bool benchmarkSuitesRun(BenchmarkOptions const & options) {
+  bool const all = options.suite == "all";
+  bool found = false;
+  for (BenchmarkSuite const & suite : benchmarkSuites) {
+    found = found || all || options.suite == suite.name;
+  }
+  if (!found) {
+    std::fprintf(
+      stderr, "benchmark: no suite '%s'\n", options.suite.c_str()
+    );
+    return false;
+  }
+  FILE * const file = std::fopen(options.output.c_str(), "wb");
+  if (!file) { return false; }
+  std::fputs("{\n  \"suites\": [", file);
+  bool firstSuite = true;
+  std::vector<BenchmarkCase> cases;
+  for (BenchmarkSuite const & suite : benchmarkSuites) {
+    if (!all && options.suite != suite.name) { continue; }
+    std::fprintf(stderr, "benchmark: suite %s\n", suite.name);
+    cases.clear();
+    suite.run(cases);
+    std::fputs(firstSuite ? "\n    { \"name\": " : ",\n    { \"name\": ", file);
+    firstSuite = false;
+    benchmarkJsonString(file, suite.name);
+    std::fputs(", \"cases\": [", file);
+    for (size_t it = 0; it < cases.size(); ++ it) {
+      std::vector<float> & samples = cases[it].samples;
+      std::sort(samples.begin(), samples.end());
+      std::fputs(it == 0 ? "\n      " : ",\n      ", file);
+      std::fputs("{ \"name\": ", file);
+      benchmarkJsonString(file, cases[it].name.c_str());
+      std::fprintf(
+        file,
+        ", \"samples\": %zu, \"p50Ms\": %.4f, \"p99Ms\": %.4f,"
+        " \"maxMs\": %.4f",
+        samples.size(), benchmarkPercentile(samples, 0.5f),
+        benchmarkPercentile(samples, 0.99f),
+        samples.empty() ? 0.0f : samples.back()
+      );
+      // throughput at the median
+      float const p50 = benchmarkPercentile(samples, 0.5f);
+      if (cases[it].items > 0 && p50 > 0.0f) {
+        std::fprintf(
+          file, ", \"itemsPerMs\": %.1f",
+          static_cast<float>(cases[it].items) / p50
+        );
+      }
+      if (cases[it].residentBytes > 0) {
+        std::fprintf(
+          file, ", \"residentBytes\": %llu",
+          static_cast<unsigned long long>(cases[it].residentBytes)
+        );
+      }
+      std::fputs(" }", file);
+    }
+    std::fputs("\n    ] }", file);
+  }
+  std::fputs("\n  ]\n}\n", file);
+  bool const written = std::ferror(file) == 0;
+  std::fclose(file);
+  std::fprintf(
+    stderr,
+    written ? "benchmark: report written to '%s'\n"
+            : "benchmark: couldn't write '%s'\n",
+    options.output.c_str()
+  );
+  return written;
+}
+
+bool benchmarkOptionsParse(
+  BenchmarkOptions & options, int const argc, char const * const * argv
+) {
+  options = BenchmarkOptions {
+    .units = benchmarkUnitsDefault,
+    .frames = benchmarkFramesDefault,
+    .mapDim = benchmarkMapDimDefault,
+    .frameRate = benchmarkFrameRateDefault,
+    .output = "benchmark.json",
+    .graphPlugin = "libgraph.so",
+    .terrainPlugin = "libterrain.so",
+    .assets = ".",
+    .suite = "",
+  };
+  for (int it = 1; it + 1 < argc; it += 2) {
+    std::string const option = argv[it];
+    char const * const value = argv[it + 1];
+    if (option == "--units") {
+      options.units = std::strtoull(value, nullptr, 10);
+    } else if (option == "--frames") {
+      options.frames = std::strtoull(value, nullptr, 10);
+    } else if (option == "--map") {
+      options.mapDim = std::strtoull(value, nullptr, 10);
+    } else if (option == "--frame-rate") {
+      options.frameRate = std::strtof(value, nullptr);
+    } else if (option == "--output") {
+      options.output = value;
+    } else if (option == "--graph") {
+      options.graphPlugin = value;
+    } else if (option == "--terrain") {
+      options.terrainPlugin = value;
+    } else if (option == "--assets") {
+      options.assets = value;
+    } else if (option == "--suite") {
+      options.suite = value;
+    } else {
+      return false;
+    }
+  }
+  return argc % 2 == 1 && options.frames > 0 && options.mapDim > 1;
+}
+
+} // namespace
+
+int main(int const argc, char const * const * const argv) {
+  BenchmarkOptions options;
+  if (!benchmarkOptionsParse(options, argc, argv)) {
+    std::fprintf(
+      stderr,
+      "usage: %s [--units n] [--frames n] [--map samples] [--frame-rate hz]\n"
+      "         [--output file] [--graph plugin] [--terrain plugin]\n"
+      "         [--assets dir]\n"
+      "       %s --suite name|all [--output file]\n",
+      argv[0], argv[0]
+    );
+    return 2;
+  }
+  if (!options.suite.empty()) {
+    return benchmarkSuitesRun(options) ? 0 : 1;
+  }
+
+  // the plugins read and write puldata/ relative to the working directory,
+  //   so they run in a scratch one with the generated map
+  namespace fs = std::filesystem;
+  std::error_code error;
+  fs::path const workingDirectory = fs::current_path();
+  options.output = fs::absolute(options.output).string();
+  options.graphPlugin = fs::absolute(options.graphPlugin).string();
+  options.terrainPlugin = fs::absolute(options.terrainPlugin).string();
+  fs::path const scratch = (
+    fs::temp_directory_path()
+    / ("pulc-benchmark-" + std::to_string(getpid()))
+  );
+  fs::create_directories(scratch / "puldata", error);
+  fs::copy_file(
+    fs::path(options.assets) / "puldata" / "ecs.pds",
+    scratch / "puldata" / "ecs.pds", fs::copy_options::overwrite_existing,
+    error
+  );
+  if (error) {
+    std::fprintf(stderr, "benchmark: %s\n", error.message().c_str());
+    return 1;
+  }
+  if (
+    !benchmarkMapWrite(
+      options.mapDim, (scratch / "puldata" / "terrain.pthm").c_str()
+    )
+  ) {
+    std::fprintf(stderr, "benchmark: couldn't write the map\n");
+    fs::remove_all(scratch, error);
+    return 1;
+  }
+  fs::current_path(scratch);
+
+  PuleEngineLayer pul;
+  stubEngineLayer(pul);
+  PulePluginPayload const payload = (
+    pulePluginPayloadCreate(puleAllocateDefault())
+  );
+  pul.pluginPayloadStore(payload, pul.cStr("pule-engine-layer"), &pul);
+  pul.pluginPayloadStoreU64(
+    payload, pul.cStr("pule-ecs-world"), stubEcsWorld().id
+  );
+  pul.pluginPayloadStoreU64(payload, pul.cStr("pule-platform"), 0);
+  pul.pluginPayloadStoreU64(
+    payload, pul.cStr("pule-render-task-graph"), stubRenderTaskGraph().id
+  );
+
+  bool succeeded = false;
+  BenchmarkPlugin graph = {}, terrain = {};
+  PuleEcsComponent const nodeUnit = stubEcsComponentRegister(
+    "PulcComponentNodeUnit", sizeof(PulcComponentNodeUnit)
+  );
+  if (
+       benchmarkPluginOpen(graph, options.graphPlugin)
+    && benchmarkPluginOpen(terrain, options.terrainPlugin)
+    && benchmarkSystemRegister(
+         graph, nodeUnit, "map-movement", "pulcSystemCallbackMapMovement"
+       )
+    && benchmarkSystemRegister(
+         graph, nodeUnit, "node-unit-render",
+         "pulcSystemCallbackNodeUnitRender"
+       )
+  ) {
+    // the terrain plugin finds the graph's job system and profiler at load
+    graph.load(payload);
+    terrain.load(payload);
+    succeeded = benchmarkRun(options, pul, payload, graph, terrain);
+    // the simulation reads the terrain's cost map until the graph stops it
+    graph.unload(payload);
+    terrain.unload(payload);
+  }
+  if (terrain.library) { dlclose(terrain.library); }
+  if (graph.library) { dlclose(graph.library); }
+  stubEngineClear();
+  pulePluginPayloadDestroy(payload);
+
+  fs::current_path(workingDirectory);
+  fs::remove_all(scratch, error);
+  return succeeded ? 0 : 1;
+}
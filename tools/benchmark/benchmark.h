@@ -0,0 +1,155 @@
+#pragma once
+
+#include "../../plugins/terrain/cost/terrain-cost.h"
+#include "../../plugins/terrain/heightmap/tiled-heightmap.h"
+#include "../../plugins/terrain/terrain.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// headless scalability benchmark: loads the graph and terrain plugins
+//   against the stub engine layer, generates a map, spawns node units spread
+//   over it with group orders across the map and updates both plugins for a
+//   fixed number of frames. Writes p50, p99 and max milliseconds of every
+//   profiler zone, memory use, allocations per frame, and what
+//   benchmarkLookupSystems systems' per frame lookups cost by string against
+//   through a handle registry, as JSON; a release compares it against a
+//   stored baseline.
+// Zones only count frames they ran in, the simulation ticks at its own rate
+
+size_t constexpr benchmarkUnitsDefault = 10'000;
+size_t constexpr benchmarkFramesDefault = 600;
+size_t constexpr benchmarkMapDimDefault = 1024;
+float constexpr benchmarkFrameRateDefault = 60.0f;
+// flow fields and the path hierarchy fill up in these, not measured
+size_t constexpr benchmarkWarmupFrames = 60;
+float constexpr benchmarkUnitSpeed = 3.0f;
+uint8_t constexpr benchmarkTeams = 4;
+// units are ordered in groups sharing a goal, as a player orders them; kept
+//   under what the flow field cache holds
+size_t constexpr benchmarkOrderGroups = 12;
+size_t constexpr benchmarkLookupSystems = 50;
+
+struct BenchmarkOptions {
+  size_t units;
+  size_t frames; // measured, after the warm-up
+  size_t mapDim; // samples along each side of the generated map
+  float frameRate; // frames are paced to it, 0 runs them back to back
+  std::string output;
+  std::string graphPlugin; // shared libraries
+  std::string terrainPlugin;
+  std::string assets; // directory holding puldata/ecs.pds
+  std::string suite; // runs it instead of the plugins if not empty
+};
+
+// nearest rank over sorted samples
+float benchmarkPercentile(
+  std::vector<float> const & sorted, float const fraction
+);
+
+void benchmarkJsonString(FILE * const file, char const * value);
+
+struct BenchmarkMemory {
+  uint64_t residentBytes;
+  uint64_t residentPeakBytes;
+};
+
+BenchmarkMemory benchmarkMemory();
+
+// the generated map as a tiled heightmap file with its cost map
+bool benchmarkMapWrite(size_t const dim, char const * const path);
+
+// -- suites -------------------------------------------------------------------
+
+// micro-benchmarks of single modules, built into the tool from the plugin
+//   sources so they run without loading either plugin; `--suite name` runs
+//   one, or "all" of them, in place of the plugin frames. A case is timed
+//   over repetitions and reported like a zone
+
+struct BenchmarkCase {
+  std::string name;
+  std::vector<float> samples; // milliseconds per repetition
+  size_t items; // processed per repetition, reported per ms if not zero
+  uint64_t residentBytes; // the case left resident, reported if not zero
+};
+
+struct BenchmarkSuite {
+  char const * name;
+  void (* run)(std::vector<BenchmarkCase> & cases);
+};
+
+// times fn(repetition) repetitions times into a new case, after an untimed
+//   prepare(repetition) each time
+template <typename Prepare, typename Fn>
+BenchmarkCase & benchmarkCaseRun(
+  std::vector<BenchmarkCase> & cases, std::string name,
+  size_t const repetitions, Prepare && prepare, Fn && fn
+) {
+  using Clock = std::chrono::steady_clock;
+  BenchmarkCase & measured = cases.emplace_back();
+  measured.name = std::move(name);
+  measured.samples.reserve(repetitions);
+  for (size_t it = 0; it < repetitions; ++ it) {
+    prepare(it);
+    Clock::time_point const begin = Clock::now();
+    fn(it);
+    measured.samples.emplace_back(
+      std::chrono::duration<float, std::milli>(Clock::now() - begin).count()
+    );
+  }
+  return measured;
+}
+
+template <typename Fn>
+BenchmarkCase & benchmarkCaseRun(
+  std::vector<BenchmarkCase> & cases, std::string name,
+  size_t const repetitions, Fn && fn
+) {
+  return (
+    benchmarkCaseRun(
+      cases, std::move(name), repetitions, [](size_t) {}, std::forward<Fn>(fn)
+    )
+  );
+}
+
+// the generated map in memory, with its cost map; mesas raise that many
+//   discs with cliffs no movement class climbs, so paths have to go round
+struct BenchmarkTerrain {
+  TiledHeightmap heightmap;
+  PulcTerrainHeightfield heightfield;
+  TerrainCostMap costMap;
+  PulcTerrainCostMap costMapShared;
+};
+
+// rolling hills with ridges across them, the same every run
+std::vector<float> benchmarkHeights(size_t const dim, size_t const mesas);
+
+void benchmarkTerrainCreate(
+  BenchmarkTerrain & terrain, size_t const dim, size_t const mesas
+);
+
+// units per square meter the unit suites spread over, about the density of
+//   a crowded battle; holding it keeps per-unit work flat as counts grow
+float constexpr benchmarkUnitDensity = 0.25f;
+
+// count positions spread uniformly over a square at benchmarkUnitDensity
+//   with its corner at the origin, the same every run
+std::vector<PuleF32v2> benchmarkPositions(size_t const count);
+float benchmarkPositionsExtent(size_t const count);
+
+// suite-*.cpp
+void benchmarkSuitePathfinding(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteSpatialGrid(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteSteering(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteFrustumCull(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteMapOpen(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteTerrainBuild(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteRaycast(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteFogOfWar(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteInfluence(std::vector<BenchmarkCase> & cases);
+void benchmarkSuiteAvoidance(std::vector<BenchmarkCase> & cases);
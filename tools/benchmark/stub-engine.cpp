@@ -0,0 +1,378 @@
+#include "stub-engine.h"
+
+#include <pulchritude-asset/pds.h>
+#include <pulchritude-data-serializer/data-serializer.h>
+#include <pulchritude-error/error.h>
+#include <pulchritude-log/log.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+// -- ecs ----------------------------------------------------------------------
+
+struct StubComponent {
+  std::string label;
+  size_t byteLength;
+  std::vector<uint8_t> data; // byteLength per row
+  std::vector<uint64_t> rowEntities;
+  std::unordered_map<uint64_t, size_t> entityRows;
+};
+
+struct StubSystem {
+  std::string label;
+  uint64_t component;
+  void (* callback)(PuleEcsIterator);
+};
+
+uint64_t constexpr stubWorldId = 1;
+uint64_t constexpr stubTaskGraphId = 1;
+uint64_t constexpr stubRenderNodeId = 1;
+
+std::vector<StubComponent> components; // id is index + 1
+std::vector<StubSystem> systems; // id is index + 1, as is its iterator
+uint64_t entityCount = 0;
+
+bool labelIs(std::string const & label, PuleStringView const view) {
+  return (
+    label.size() == view.len
+    && label.compare(0, view.len, view.contents, view.len) == 0
+  );
+}
+
+PuleEcsEntity stubEcsEntityCreate(PuleEcsWorld const, PuleStringView const) {
+  return PuleEcsEntity { ++ entityCount };
+}
+
+void stubEcsEntityAttachComponent(
+  PuleEcsWorld const, PuleEcsEntity const entity,
+  PuleEcsComponent const componentId, void const * const data
+) {
+  StubComponent & component = components[componentId.id - 1];
+  size_t const row = component.rowEntities.size();
+  component.rowEntities.emplace_back(entity.id);
+  component.entityRows.emplace(entity.id, row);
+  component.data.resize(component.data.size() + component.byteLength);
+  memcpy(
+    component.data.data() + row*component.byteLength, data,
+    component.byteLength
+  );
+}
+
+PuleEcsComponent stubEcsComponentFetchByLabel(
+  PuleEcsWorld const, PuleStringView const label
+) {
+  for (size_t it = 0; it < components.size(); ++ it) {
+    if (labelIs(components[it].label, label)) { return { it + 1 }; }
+  }
+  return { 0 };
+}
+
+void * stubEcsEntityComponentData(
+  PuleEcsWorld const, PuleEcsEntity const entity,
+  PuleEcsComponent const componentId
+) {
+  if (componentId.id == 0) { return nullptr; }
+  StubComponent & component = components[componentId.id - 1];
+  auto const row = component.entityRows.find(entity.id);
+  if (row == component.entityRows.end()) { return nullptr; }
+  return component.data.data() + row->second*component.byteLength;
+}
+
+// systems query their single component
+void * stubEcsIteratorQueryComponents(
+  PuleEcsIterator const iter, size_t const index, size_t const byteLength
+) {
+  StubComponent & component = (
+    components[systems[iter.id - 1].component - 1]
+  );
+  assert(index == 0 && byteLength == component.byteLength);
+  (void)index; (void)byteLength;
+  return component.data.data();
+}
+
+size_t stubEcsIteratorEntityCount(PuleEcsIterator const iter) {
+  return components[systems[iter.id - 1].component - 1].rowEntities.size();
+}
+
+PuleEcsSystem stubEcsSystemFetchByLabel(
+  PuleEcsWorld const, PuleStringView const label
+) {
+  for (size_t it = 0; it < systems.size(); ++ it) {
+    if (labelIs(systems[it].label, label)) { return { it + 1 }; }
+  }
+  return { 0 };
+}
+
+void stubEcsSystemAdvance(
+  PuleEcsWorld const, PuleEcsSystem const system, float const, void * const
+) {
+  if (system.id == 0) { return; }
+  systems[system.id - 1].callback(PuleEcsIterator { system.id });
+}
+
+// -- gfx ----------------------------------------------------------------------
+
+struct StubBuffer {
+  std::vector<uint8_t> bytes;
+};
+
+std::unordered_set<StubBuffer *> buffers;
+uint64_t objectIds = 0; // shaders, pipelines, command lists and fences
+size_t commandCount = 0;
+
+PuleGfxGpuBuffer stubGfxGpuBufferCreate(
+  void const * const data, size_t const byteLength,
+  PuleGfxGpuBufferUsage const, PuleGfxGpuBufferVisibilityFlag const
+) {
+  auto * const buffer = new StubBuffer { std::vector<uint8_t>(byteLength) };
+  if (data) { memcpy(buffer->bytes.data(), data, byteLength); }
+  buffers.emplace(buffer);
+  return PuleGfxGpuBuffer { reinterpret_cast<uint64_t>(buffer) };
+}
+
+void stubGfxGpuBufferDestroy(PuleGfxGpuBuffer const buffer) {
+  auto * const stub = reinterpret_cast<StubBuffer *>(buffer.id);
+  buffers.erase(stub);
+  delete stub;
+}
+
+void * stubGfxGpuBufferMap(PuleGfxGpuBufferMapRange const range) {
+  auto * const stub = reinterpret_cast<StubBuffer *>(range.buffer.id);
+  return stub->bytes.data() + range.byteOffset;
+}
+
+void stubGfxGpuBufferMappedFlush(PuleGfxGpuBufferMappedFlushRange const) {}
+void stubGfxGpuBufferUnmap(PuleGfxGpuBuffer const) {}
+
+PuleGfxShaderModule stubGfxShaderModuleCreate(
+  PuleStringView const, PuleStringView const, PuleError * const
+) {
+  return { ++ objectIds };
+}
+void stubGfxShaderModuleDestroy(PuleGfxShaderModule const) {}
+
+PuleGfxPipelineDescriptorSetLayout stubGfxPipelineDescriptorSetLayout() {
+  return PuleGfxPipelineDescriptorSetLayout {};
+}
+
+PuleGfxPipeline stubGfxPipelineCreate(
+  PuleGfxPipelineCreateInfo const * const, PuleError * const
+) {
+  return { ++ objectIds };
+}
+void stubGfxPipelineDestroy(PuleGfxPipeline const) {}
+void stubGfxPipelineUpdate(
+  PuleGfxPipeline const, PuleGfxPipelineCreateInfo const * const,
+  PuleError * const
+) {}
+
+PuleGfxFence stubGfxFenceCreate(PuleGfxFenceConditionFlag const) {
+  return { ++ objectIds };
+}
+void stubGfxFenceDestroy(PuleGfxFence const) {}
+bool stubGfxFenceCheckSignal(PuleGfxFence const, PuleNanosecond const) {
+  return true;
+}
+
+// the submission is done the moment it's made
+void stubGfxSubmitFences(PuleGfxCommandListSubmitInfo const & info) {
+  for (PuleGfxFence * const fence : {
+    info.fenceTargetStart, info.fenceTargetFinish,
+  }) {
+    if (fence) { *fence = stubGfxFenceCreate(PuleGfxFenceConditionFlag_all); }
+  }
+}
+
+PuleGfxCommandList stubGfxCommandListCreate(
+  PuleAllocator const, PuleStringView const
+) {
+  return { ++ objectIds };
+}
+void stubGfxCommandListDestroy(PuleGfxCommandList const) {}
+
+PuleGfxCommandListRecorder stubGfxCommandListRecorder(
+  PuleGfxCommandList const commandList
+) {
+  return { commandList.id };
+}
+void stubGfxCommandListRecorderFinish(PuleGfxCommandListRecorder const) {}
+void stubGfxCommandListRecorderReset(PuleGfxCommandListRecorder const) {}
+
+void stubGfxCommandListAppendAction(
+  PuleGfxCommandListRecorder const, PuleGfxCommand const command
+) {
+  ++ commandCount;
+  auto const & dispatch = command.dispatchCommandList;
+  if (dispatch.action == PuleGfxAction_dispatchCommandList) {
+    stubGfxSubmitFences(dispatch.submitInfo);
+  }
+}
+
+void stubGfxCommandListSubmit(
+  PuleGfxCommandListSubmitInfo const info, PuleError * const
+) {
+  stubGfxSubmitFences(info);
+}
+
+// -- render task graph --------------------------------------------------------
+
+// every node has the same primary recorder, which is never finished
+uint64_t constexpr stubPrimaryRecorderId = UINT64_MAX;
+
+PuleTaskGraphNode stubTaskGraphNodeFetch(
+  PuleTaskGraph const graph, PuleStringView const
+) {
+  return { graph.id == stubTaskGraphId ? stubRenderNodeId : 0 };
+}
+
+uint64_t stubTaskGraphNodeAttributeFetchU64(
+  PuleTaskGraphNode const node, PuleStringView const
+) {
+  return node.id == stubRenderNodeId ? stubPrimaryRecorderId : 0;
+}
+
+// -- imgui --------------------------------------------------------------------
+
+bool stubImguiWindowBegin(char const * const, bool * const) { return false; }
+void stubImguiWindowEnd() {}
+void stubImguiImage(
+  PuleGfxGpuImage const, PuleF32v2 const, PuleF32v2 const, PuleF32v2 const,
+  PuleF32v4 const
+) {}
+bool stubImguiLastItemHovered() { return false; }
+void stubImguiText(char const * const, ...) {}
+bool stubImguiSliderF32(char const *, float *, float, float) { return false; }
+bool stubImguiSliderZu(char const *, size_t *, size_t, size_t) {
+  return false;
+}
+bool stubImguiToggle(char const * const, bool * const) { return false; }
+bool stubImguiButton(char const * const) { return false; }
+void stubImguiSameLine() {}
+
+} // namespace
+
+void stubEngineLayer(PuleEngineLayer & layer) {
+  layer = PuleEngineLayer {};
+  layer.log = puleLog;
+  layer.cStr = puleCStr;
+  layer.error = puleError;
+  layer.errorConsume = puleErrorConsume;
+  layer.allocateDefault = puleAllocateDefault;
+  layer.f32v2 = puleF32v2;
+  layer.f32v4 = puleF32v4;
+  layer.f32m44 = puleF32m44;
+  layer.i32v2Sub = puleI32v2Sub;
+
+  layer.ecsEntityCreate = stubEcsEntityCreate;
+  layer.ecsEntityAttachComponent = stubEcsEntityAttachComponent;
+  layer.ecsComponentFetchByLabel = stubEcsComponentFetchByLabel;
+  layer.ecsEntityComponentData = stubEcsEntityComponentData;
+  layer.ecsIteratorQueryComponents = stubEcsIteratorQueryComponents;
+  layer.ecsIteratorEntityCount = stubEcsIteratorEntityCount;
+  layer.ecsSystemFetchByLabel = stubEcsSystemFetchByLabel;
+  layer.ecsSystemAdvance = stubEcsSystemAdvance;
+
+  layer.assetPdsLoadFromFile = puleAssetPdsLoadFromFile;
+  layer.dsObjectMember = puleDsObjectMember;
+  layer.dsAsArray = puleDsAsArray;
+  layer.dsAsString = puleDsAsString;
+  layer.dsIsArray = puleDsIsArray;
+  layer.dsIsString = puleDsIsString;
+  layer.dsDestroy = puleDsDestroy;
+
+  layer.pluginPayloadStoreU64 = pulePluginPayloadStoreU64;
+  layer.pluginPayloadFetchU64 = pulePluginPayloadFetchU64;
+  layer.pluginPayloadStore = pulePluginPayloadStore;
+  layer.pluginPayloadFetch = pulePluginPayloadFetch;
+  layer.pluginPayloadRemove = pulePluginPayloadRemove;
+
+  layer.gfxGpuBufferCreate = stubGfxGpuBufferCreate;
+  layer.gfxGpuBufferDestroy = stubGfxGpuBufferDestroy;
+  layer.gfxGpuBufferMap = stubGfxGpuBufferMap;
+  layer.gfxGpuBufferMappedFlush = stubGfxGpuBufferMappedFlush;
+  layer.gfxGpuBufferUnmap = stubGfxGpuBufferUnmap;
+  layer.gfxShaderModuleCreate = stubGfxShaderModuleCreate;
+  layer.gfxShaderModuleDestroy = stubGfxShaderModuleDestroy;
+  layer.gfxPipelineDescriptorSetLayout = stubGfxPipelineDescriptorSetLayout;
+  layer.gfxPipelineCreate = stubGfxPipelineCreate;
+  layer.gfxPipelineDestroy = stubGfxPipelineDestroy;
+  layer.gfxPipelineUpdate = stubGfxPipelineUpdate;
+  layer.gfxCommandListCreate = stubGfxCommandListCreate;
+  layer.gfxCommandListDestroy = stubGfxCommandListDestroy;
+  layer.gfxCommandListRecorder = stubGfxCommandListRecorder;
+  layer.gfxCommandListRecorderFinish = stubGfxCommandListRecorderFinish;
+  layer.gfxCommandListRecorderReset = stubGfxCommandListRecorderReset;
+  layer.gfxCommandListAppendAction = stubGfxCommandListAppendAction;
+  layer.gfxCommandListSubmit = stubGfxCommandListSubmit;
+  layer.gfxFenceCreate = stubGfxFenceCreate;
+  layer.gfxFenceDestroy = stubGfxFenceDestroy;
+  layer.gfxFenceCheckSignal = stubGfxFenceCheckSignal;
+
+  layer.taskGraphNodeFetch = stubTaskGraphNodeFetch;
+  layer.taskGraphNodeAttributeFetchU64 = stubTaskGraphNodeAttributeFetchU64;
+
+  layer.imguiWindowBegin = stubImguiWindowBegin;
+  layer.imguiWindowEnd = stubImguiWindowEnd;
+  layer.imguiImage = stubImguiImage;
+  layer.imguiLastItemHovered = stubImguiLastItemHovered;
+  layer.imguiText = stubImguiText;
+  layer.imguiSliderF32 = stubImguiSliderF32;
+  layer.imguiSliderZu = stubImguiSliderZu;
+  layer.imguiToggle = stubImguiToggle;
+  layer.imguiButton = stubImguiButton;
+  layer.imguiSameLine = stubImguiSameLine;
+}
+
+PuleEcsWorld stubEcsWorld() {
+  return PuleEcsWorld { stubWorldId };
+}
+
+PuleTaskGraph stubRenderTaskGraph() {
+  return PuleTaskGraph { stubTaskGraphId };
+}
+
+PuleEcsComponent stubEcsComponentRegister(
+  char const * const label, size_t const byteLength
+) {
+  components.emplace_back(
+    StubComponent { .label = label, .byteLength = byteLength, }
+  );
+  return PuleEcsComponent { components.size() };
+}
+
+void stubEcsSystemRegister(
+  char const * const label, PuleEcsComponent const component,
+  void (* const callback)(PuleEcsIterator)
+) {
+  systems.emplace_back(
+    StubSystem {
+      .label = label, .component = component.id, .callback = callback,
+    }
+  );
+}
+
+size_t stubEcsEntityCount() {
+  return entityCount;
+}
+
+size_t stubGfxCommandCount() {
+  return commandCount;
+}
+
+void stubEngineClear() {
+  components.clear();
+  systems.clear();
+  entityCount = 0;
+  for (StubBuffer * const buffer : buffers) { delete buffer; }
+  buffers.clear();
+  objectIds = 0;
+  commandCount = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <pulchritude-plugin/engine.h>
+
+#include <cstddef>
+
+// engine layer for running the plugins without a window or GPU. Payloads,
+//   data files, logging and math go to the engine libraries, which need
+//   neither; the ECS, gfx, the render task graph and imgui are stubbed.
+// The ECS world keeps each component's data in one array, and a system runs
+//   its callback once over every entity with its component. gfx buffers are
+//   host memory, command lists record nothing and fences signal at once.
+//   Engine layer entries can't carry state, so there is one stub engine per
+//   process
+
+void stubEngineLayer(PuleEngineLayer & layer);
+
+PuleEcsWorld stubEcsWorld();
+PuleTaskGraph stubRenderTaskGraph();
+
+// components and systems have to be registered before a plugin looks them
+//   up by label
+PuleEcsComponent stubEcsComponentRegister(
+  char const * const label, size_t const byteLength
+);
+void stubEcsSystemRegister(
+  char const * const label, PuleEcsComponent const component,
+  void (* const callback)(PuleEcsIterator)
+);
+
+size_t stubEcsEntityCount();
+
+// gfx commands recorded into the render task graph's recorder so far
+size_t stubGfxCommandCount();
+
+// drops the world and whatever gfx objects are still alive, after the
+//   plugins unloaded
+void stubEngineClear();
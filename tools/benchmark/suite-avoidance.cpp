@@ -0,0 +1,72 @@
+#include "benchmark.h"
+
+#include "../../plugins/graph/jobs/job-system.h"
+#include "../../plugins/graph/movement/avoidance.h"
+#include "../../plugins/graph/spatial/unit-grid.h"
+
+#include <cmath>
+#include <random>
+
+namespace {
+
+size_t constexpr avoidanceCounts[] = { 1'000, 10'000, 50'000, };
+size_t constexpr avoidanceRepetitions = 20;
+// as the simulation splits and steps it
+size_t constexpr avoidanceGrain = 256;
+float constexpr avoidanceCellDim = 2.0f;
+float constexpr avoidanceTimestep = 1.0f/20.0f;
+float constexpr avoidanceSpeed = 3.0f;
+
+} // namespace
+
+// an ORCA solve of every unit in a crowded field heading every which way,
+//   split over the job pool as the simulation does, in both modes; reported
+//   as units per millisecond
+void benchmarkSuiteAvoidance(std::vector<BenchmarkCase> & cases) {
+  JobPool * const jobs = jobPoolCreate(0);
+  AvoidanceBatch batch {};
+  for (size_t const count : avoidanceCounts) {
+    std::vector<PuleF32v2> const positions = benchmarkPositions(count);
+    float const extent = benchmarkPositionsExtent(count);
+    std::string const suffix = "-" + std::to_string(count/1000) + "k";
+
+    UnitGrid grid {};
+    unitGridConfigure(
+      grid, PuleF32v2 { 0.0f, 0.0f }, PuleF32v2 { extent, extent },
+      avoidanceCellDim
+    );
+    unitGridRebuild(grid, positions.data(), sizeof(PuleF32v2), count);
+
+    avoidanceBatchResize(batch, count);
+    std::mt19937 random(8);
+    std::uniform_real_distribution<float> angles(0.0f, 6.2831853f);
+    for (size_t it = 0; it < count; ++ it) {
+      float const angle = angles(random);
+      batch.positionX[it] = positions[it].x;
+      batch.positionY[it] = positions[it].y;
+      batch.preferredX[it] = batch.velocityX[it] = (
+        avoidanceSpeed*std::cos(angle)
+      );
+      batch.preferredY[it] = batch.velocityY[it] = (
+        avoidanceSpeed*std::sin(angle)
+      );
+      batch.maxSpeed[it] = avoidanceSpeed;
+    }
+
+    for (
+      auto const & [label, mode] : {
+        std::pair { "deterministic", AvoidanceMode_deterministic },
+        std::pair { "fast", AvoidanceMode_fast },
+      }
+    ) {
+      auto const solve = [&](size_t const begin, size_t const end) {
+        avoidanceSolve(batch, grid, avoidanceTimestep, mode, begin, end);
+      };
+      benchmarkCaseRun(
+        cases, label + suffix, avoidanceRepetitions,
+        [&](size_t) { jobParallelFor(*jobs, count, avoidanceGrain, solve); }
+      ).items = count;
+    }
+  }
+  jobPoolDestroy(jobs);
+}
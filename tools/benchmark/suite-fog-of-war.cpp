@@ -0,0 +1,83 @@
+#include "benchmark.h"
+
+#include "../../plugins/graph/jobs/job-system.h"
+#include "../../plugins/graph/visibility/fog-of-war.h"
+
+#include <cmath>
+#include <random>
+
+namespace {
+
+size_t constexpr fogMapDim = 1024;
+size_t constexpr fogMesas = 96;
+size_t constexpr fogCounts[] = { 1'000, 5'000, 10'000, };
+uint8_t constexpr fogTeams = 4;
+// settle in before measuring, so the ticks measured restamp only movers
+size_t constexpr fogWarmupTicks = 20;
+size_t constexpr fogTicks = 100;
+float constexpr fogUnitSpeed = 3.0f;
+float constexpr fogTimestep = 1.0f/20.0f; // the simulation's tick
+
+} // namespace
+
+// a tick of fog of war with every unit walking across a crowded field, as
+//   the simulation runs it: sync with the terrain, place every unit, update.
+//   The first tick lays the grid and stamps every unit, later ones restamp
+//   those that changed cell
+void benchmarkSuiteFogOfWar(std::vector<BenchmarkCase> & cases) {
+  BenchmarkTerrain terrain {};
+  benchmarkTerrainCreate(terrain, fogMapDim, fogMesas);
+  JobPool * const jobs = jobPoolCreate(0);
+
+  for (size_t const count : fogCounts) {
+    std::vector<PuleF32v2> positions = benchmarkPositions(count);
+    float const extent = benchmarkPositionsExtent(count);
+    std::vector<PuleF32v2> velocities(count);
+    std::mt19937 random(6);
+    std::uniform_real_distribution<float> angles(0.0f, 6.2831853f);
+    for (PuleF32v2 & velocity : velocities) {
+      float const angle = angles(random);
+      velocity = PuleF32v2 {
+        fogUnitSpeed*std::cos(angle), fogUnitSpeed*std::sin(angle),
+      };
+    }
+    std::string const suffix = "-" + std::to_string(count/1000) + "k";
+
+    FogOfWar fog {};
+    uint64_t tick = 0;
+    auto const fogTick = [&](size_t) {
+      ++ tick;
+      fogOfWarSync(fog, terrain.heightfield);
+      for (size_t it = 0; it < count; ++ it) {
+        fogOfWarUnit(
+          fog, static_cast<uint32_t>(it), tick, it % fogTeams, 0.0f,
+          positions[it]
+        );
+      }
+      fogOfWarUpdate(fog, *jobs, tick);
+    };
+    // walks on between ticks, turning back at the field's edge
+    auto const walk = [&](size_t) {
+      for (size_t it = 0; it < count; ++ it) {
+        PuleF32v2 & position = positions[it];
+        PuleF32v2 & velocity = velocities[it];
+        position.x += velocity.x*fogTimestep;
+        position.y += velocity.y*fogTimestep;
+        if (position.x < 0.0f || position.x > extent) { velocity.x *= -1.0f; }
+        if (position.y < 0.0f || position.y > extent) { velocity.y *= -1.0f; }
+      }
+    };
+
+    benchmarkCaseRun(cases, "first-tick" + suffix, 1, fogTick).items = count;
+    for (size_t it = 0; it < fogWarmupTicks; ++ it) {
+      walk(it);
+      fogTick(it);
+    }
+    benchmarkCaseRun(
+      cases, "tick" + suffix, fogTicks, walk, fogTick
+    ).items = count;
+  }
+
+  jobPoolDestroy(jobs);
+  tiledHeightmapClose(terrain.heightmap);
+}
@@ -0,0 +1,67 @@
+#include "benchmark.h"
+
+#include "../../plugins/graph/render/frustum-cull.h"
+
+namespace {
+
+size_t constexpr frustumCullCounts[] = { 10'000, 100'000, 1'000'000, };
+size_t constexpr frustumCullRepetitions = 20;
+float constexpr frustumCullRadius = 0.5f;
+
+char const * const frustumCullKernelLabels[] = { "scalar", "sse", "avx2", };
+
+} // namespace
+
+// every sphere of a unit field tested against a strategy camera looking
+//   down on its middle, with every kernel the running CPU has; reported as
+//   spheres per millisecond
+void benchmarkSuiteFrustumCull(std::vector<BenchmarkCase> & cases) {
+  FrustumCullSpheres spheres {};
+  for (size_t const count : frustumCullCounts) {
+    std::vector<PuleF32v2> const positions = benchmarkPositions(count);
+    float const middle = benchmarkPositionsExtent(count) * 0.5f;
+    std::string const suffix = (
+        count < 1'000'000
+      ? "-" + std::to_string(count/1000) + "k"
+      : "-" + std::to_string(count/1'000'000) + "m"
+    );
+
+    frustumCullSpheresResize(spheres, count);
+    for (size_t it = 0; it < count; ++ it) {
+      spheres.centerX[it] = positions[it].x;
+      spheres.centerY[it] = 0.0f;
+      spheres.centerZ[it] = positions[it].y;
+      spheres.radius[it] = frustumCullRadius;
+    }
+    PuleF32m44 const view = (
+      puleViewLookAt(
+        PuleF32v3{middle, 60.0f, middle + 60.0f},
+        PuleF32v3{middle, 0.0f, middle},
+        PuleF32v3{0.0f, 1.0f, 0.0f}
+      )
+    );
+    PuleF32m44 const proj = (
+      puleProjectionPerspective(60.0f, 16.0f/9.0f, 0.1f, 1000.0f)
+    );
+    FrustumPlanes const planes = frustumPlanesFromViewProjection(view, proj);
+    // padding lanes are culled along with the last whole lane
+    size_t const end = spheres.radius.size();
+
+    for (
+      int kernel = FrustumCullKernel_scalar;
+      kernel <= frustumCullKernelDetect();
+      ++ kernel
+    ) {
+      benchmarkCaseRun(
+        cases,
+        std::string(frustumCullKernelLabels[kernel]) + suffix,
+        frustumCullRepetitions,
+        [&](size_t) {
+          frustumCull(
+            planes, spheres, static_cast<FrustumCullKernel>(kernel), 0, end
+          );
+        }
+      ).items = count;
+    }
+  }
+}
@@ -0,0 +1,86 @@
+#include "benchmark.h"
+
+#include "../../plugins/graph/influence/influence-map.h"
+#include "../../plugins/graph/jobs/job-system.h"
+
+#include <random>
+
+namespace {
+
+// world units a side, 256 and 1024 cells at the default cell
+float constexpr influenceExtents[] = { 1024.0f, 4096.0f, };
+size_t constexpr influenceUnits = 10'000;
+uint8_t constexpr influenceTeams = 8;
+size_t constexpr influenceTicks = 100;
+
+} // namespace
+
+// influence map steps, a band of rows each tick, over every kernel the
+//   running CPU has, plus a whole update and the combine an AI threat query
+//   runs, those two in cells per millisecond; units are spread over the map
+//   in every team
+void benchmarkSuiteInfluence(std::vector<BenchmarkCase> & cases) {
+  JobPool * const jobs = jobPoolCreate(0);
+  std::vector<float> positionX(influenceUnits), positionY(influenceUnits);
+  std::vector<uint8_t> teams(influenceUnits);
+  std::vector<float> combined;
+
+  for (float const extent : influenceExtents) {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> along(0.0f, extent);
+    for (size_t it = 0; it < influenceUnits; ++ it) {
+      positionX[it] = along(random);
+      positionY[it] = along(random);
+      teams[it] = it % influenceTeams;
+    }
+    auto const step = [&](InfluenceMaps & maps) {
+      influenceMapsStep(
+        maps, *jobs, positionX.data(), positionY.data(), teams.data(),
+        influenceUnits
+      );
+    };
+
+    for (
+      int kernel = InfluenceKernel_scalar;
+      kernel <= influenceKernelDetect();
+      ++ kernel
+    ) {
+      InfluenceMaps maps {};
+      influenceMapsConfigure(
+        maps, PuleF32v2 { 0.0f, 0.0f }, PuleF32v2 { extent, extent },
+        influenceCellDimDefault
+      );
+      maps.kernel = static_cast<InfluenceKernel>(kernel);
+      std::string const suffix = (
+          std::string("-") + influenceKernelLabel(maps.kernel)
+        + "-" + std::to_string(maps.width)
+      );
+      // every team seen before measuring
+      for (uint32_t it = 0; it < influenceUpdateTicks; ++ it) { step(maps); }
+
+      benchmarkCaseRun(cases, "step" + suffix, influenceTicks, [&](size_t) {
+        step(maps);
+      });
+      benchmarkCaseRun(
+        cases, "update" + suffix, influenceTicks/influenceUpdateTicks,
+        [&](size_t) {
+          for (uint32_t it = 0; it < influenceUpdateTicks; ++ it) {
+            step(maps);
+          }
+        }
+      ).items = maps.width*maps.height;
+
+      // a team's threat, every other team weighted 1
+      float weights[influenceLayerCount] = {};
+      for (uint32_t layer = 1; layer < influenceLayerCount; ++ layer) {
+        weights[layer] = 1.0f;
+      }
+      benchmarkCaseRun(
+        cases, "combine" + suffix, influenceTicks,
+        [&](size_t) { influenceMapsCombine(maps, weights, combined); }
+      ).items = maps.width*maps.height;
+    }
+  }
+
+  jobPoolDestroy(jobs);
+}
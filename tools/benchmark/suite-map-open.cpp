@@ -0,0 +1,75 @@
+#include "benchmark.h"
+
+#include "../../plugins/terrain/raycast/height-pyramid.h"
+
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+size_t constexpr mapOpenDims[] = { 1024, 2048, 4096, };
+size_t constexpr mapOpenRepetitions = 5;
+
+// written back and dropped from the page cache, so the open reads the disk
+//   as it would on a first launch
+void mapOpenEvict(char const * const path) {
+  int const fd = open(path, O_RDONLY);
+  if (fd < 0) { return; }
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+} // namespace
+
+// opening a saved map the way the terrain plugin publishes one: map the
+//   file, set up the heightfield, the pyramid from tile headers and the
+//   cost map in place. Both the time and what it leaves resident should stay
+//   flat as the map grows
+void benchmarkSuiteMapOpen(std::vector<BenchmarkCase> & cases) {
+  namespace fs = std::filesystem;
+  for (size_t const dim : mapOpenDims) {
+    fs::path const path = (
+      fs::temp_directory_path()
+      / ("pulc-benchmark-map-" + std::to_string(getpid()) + ".pthm")
+    );
+    if (!benchmarkMapWrite(dim, path.c_str())) {
+      std::fprintf(stderr, "benchmark: couldn't write '%s'\n", path.c_str());
+      return;
+    }
+
+    TiledHeightmap heightmap {};
+    PulcTerrainHeightfield heightfield {};
+    HeightPyramid pyramid {};
+    TerrainCostMap costMap {};
+    uint64_t residentBefore = 0, residentAfter = 0;
+    BenchmarkCase & measured = benchmarkCaseRun(
+      cases, "cold-open-" + std::to_string(dim), mapOpenRepetitions,
+      [&](size_t) {
+        tiledHeightmapClose(heightmap);
+        pyramid = HeightPyramid {};
+        costMap = TerrainCostMap {};
+        mapOpenEvict(path.c_str());
+        residentBefore = benchmarkMemory().residentBytes;
+      },
+      [&](size_t) {
+        if (!tiledHeightmapOpen(heightmap, path.c_str())) { return; }
+        tiledHeightmapHeightfield(heightmap, heightfield);
+        heightfield.revision = 1;
+        heightPyramidBuild(pyramid, heightfield);
+        terrainCostMapFromBytes(
+          costMap, heightfield, heightmap.costMap, heightmap.costMapLength
+        );
+        residentAfter = benchmarkMemory().residentBytes;
+      }
+    );
+    measured.residentBytes = (
+      residentAfter > residentBefore ? residentAfter - residentBefore : 0
+    );
+    tiledHeightmapClose(heightmap);
+    std::error_code error;
+    fs::remove(path, error);
+  }
+}
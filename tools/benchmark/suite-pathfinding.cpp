@@ -0,0 +1,104 @@
+#include "benchmark.h"
+
+#include "../../plugins/graph/pathfinding/grid-search.h"
+#include "../../plugins/graph/pathfinding/grid.h"
+#include "../../plugins/graph/pathfinding/hierarchy.h"
+
+#include <random>
+
+namespace {
+
+size_t constexpr pathfindingMapDim = 1024;
+size_t constexpr pathfindingMesas = 96;
+size_t constexpr pathfindingQueries = 100;
+size_t constexpr pathfindingClusterDim = 16;
+// edits that each repaint a patch of this many samples
+size_t constexpr pathfindingRepairs = 20;
+size_t constexpr pathfindingRepairDim = 8;
+
+} // namespace
+
+// long-distance queries between the same connected cell pairs, flat A* over
+//   the whole grid against the cluster hierarchy, plus building the hierarchy
+//   and repairing it after a small edit
+void benchmarkSuitePathfinding(std::vector<BenchmarkCase> & cases) {
+  BenchmarkTerrain terrain {};
+  benchmarkTerrainCreate(terrain, pathfindingMapDim, pathfindingMesas);
+  PathGrid grid {};
+  grid.movementClass = PulcTerrainMovementClass_foot;
+  pathGridSync(grid, terrain.heightfield, terrain.costMapShared);
+
+  PathHierarchy hierarchy = pathHierarchyCreate(pathfindingClusterDim);
+  benchmarkCaseRun(cases, "hierarchy-build", 1, [&](size_t) {
+    pathHierarchySync(hierarchy, grid);
+  });
+
+  // far apart, so both searches have the map to cross
+  std::mt19937 random(2);
+  std::uniform_int_distribution<size_t> cells(0, grid.width*grid.height - 1);
+  std::vector<std::pair<size_t, size_t>> queries;
+  while (queries.size() < pathfindingQueries) {
+    size_t const start = cells(random), goal = cells(random);
+    int64_t const dx = int64_t(start % grid.width) - int64_t(goal % grid.width);
+    int64_t const dy = int64_t(start / grid.width) - int64_t(goal / grid.width);
+    if (
+         std::abs(dx) + std::abs(dy) < int64_t(pathfindingMapDim/2)
+      || !pathGridConnected(grid, start, goal)
+    ) {
+      continue;
+    }
+    queries.emplace_back(start, goal);
+  }
+
+  std::vector<size_t> path;
+  GridSearchScratch scratch {};
+  benchmarkCaseRun(cases, "flat-astar", queries.size(), [&](size_t it) {
+    gridSearchPath(
+      scratch, grid, pathGridBounds(grid),
+      queries[it].first, queries[it].second, path
+    );
+  });
+  benchmarkCaseRun(cases, "hierarchical", queries.size(), [&](size_t it) {
+    pathHierarchyFind(
+      hierarchy, grid, queries[it].first, queries[it].second, path
+    );
+  });
+
+  // an edit raises a patch into a wall, the grid only reports its rectangle
+  //   and only the clusters touching it are rebuilt
+  std::uniform_int_distribution<size_t> corners(
+    0, pathfindingMapDim - pathfindingRepairDim - 1
+  );
+  benchmarkCaseRun(cases, "hierarchy-repair", pathfindingRepairs, [&](size_t) {
+    size_t const x0 = corners(random), y0 = corners(random);
+    for (size_t y = y0; y < y0 + pathfindingRepairDim; ++ y)
+    for (size_t x = x0; x < x0 + pathfindingRepairDim; ++ x) {
+      size_t const tileShift = terrain.heightfield.tileShift;
+      size_t const tile = (
+        (y >> tileShift)*terrain.heightfield.tilesX + (x >> tileShift)
+      );
+      size_t const mask = (size_t(1) << tileShift) - 1;
+      tiledHeightmapHeightStore(
+        tiledHeightmapTileEdit(terrain.heightmap, tile),
+        ((y & mask) << tileShift) + (x & mask),
+        pulcTerrainHeightfieldAt(&terrain.heightfield, x, y) + 40.0f
+      );
+    }
+    PulcTerrainHeightfield & heightfield = terrain.heightfield;
+    heightfield.revision += 1;
+    auto const edit = PulcTerrainHeightfieldEdit {
+      .revision = heightfield.revision,
+      .x0 = x0, .y0 = y0,
+      .x1 = x0 + pathfindingRepairDim - 1, .y1 = y0 + pathfindingRepairDim - 1,
+    };
+    heightfield.edits[
+      heightfield.revision % pulcTerrainHeightfieldEditLogLength
+    ] = edit;
+    terrainCostMapUpdate(terrain.costMap, heightfield, edit);
+    terrain.costMapShared.revision = heightfield.revision;
+    pathGridSync(grid, heightfield, terrain.costMapShared);
+    pathHierarchySync(hierarchy, grid);
+  });
+
+  tiledHeightmapClose(terrain.heightmap);
+}
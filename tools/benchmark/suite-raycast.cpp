@@ -0,0 +1,228 @@
+#include "benchmark.h"
+
+#include "../../plugins/terrain/raycast/height-pyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+size_t constexpr raycastMapDim = 2048;
+size_t constexpr raycastMesas = 256;
+size_t constexpr raycastRays = 1000;
+// unit to unit sight lines, as many as target acquisition traces in a tick
+//   of a few thousand units
+size_t constexpr raycastSightLines = 10'000;
+float constexpr raycastSightRange = 32.0f;
+float constexpr raycastEyeHeight = 1.5f;
+float constexpr raycastTargetHeight = 0.5f;
+size_t constexpr raycastRepetitions = 10;
+// a fraction of a sample per step still misses slivers, it's what a
+//   marcher without a pyramid gets away with
+float constexpr raycastMarchStep = 0.5f;
+size_t constexpr raycastMarchBisections = 12;
+
+struct RaycastRay {
+  PuleF32v3 origin, direction;
+  float tMax;
+};
+
+// bilinear over the cell, the surface the pyramid intersects
+float raycastHeight(
+  PulcTerrainHeightfield const & heightfield, float const x, float const z
+) {
+  float const fx = (x - heightfield.origin.x) / heightfield.spacing.x;
+  float const fz = (z - heightfield.origin.y) / heightfield.spacing.y;
+  size_t const x0 = std::min(static_cast<size_t>(fx), heightfield.width - 2);
+  size_t const z0 = std::min(static_cast<size_t>(fz), heightfield.height - 2);
+  float const u = fx - x0, v = fz - z0;
+  float const h00 = pulcTerrainHeightfieldAt(&heightfield, x0, z0);
+  float const h10 = pulcTerrainHeightfieldAt(&heightfield, x0+1, z0);
+  float const h01 = pulcTerrainHeightfieldAt(&heightfield, x0, z0+1);
+  float const h11 = pulcTerrainHeightfieldAt(&heightfield, x0+1, z0+1);
+  return (
+      (h00*(1.0f - u) + h10*u)*(1.0f - v)
+    + (h01*(1.0f - u) + h11*u)*v
+  );
+}
+
+// fixed steps until under the ground, then bisects the last one
+bool raycastMarch(
+  PulcTerrainHeightfield const & heightfield, RaycastRay const & ray,
+  float & t
+) {
+  float const extentX = (heightfield.width - 1) * heightfield.spacing.x;
+  float const extentZ = (heightfield.height - 1) * heightfield.spacing.y;
+  float const step = (
+    raycastMarchStep
+    * std::min(heightfield.spacing.x, heightfield.spacing.y)
+  );
+  auto const below = [&](float const at) {
+    float const x = ray.origin.x + at*ray.direction.x;
+    float const z = ray.origin.z + at*ray.direction.z;
+    return (
+      ray.origin.y + at*ray.direction.y
+      <= raycastHeight(heightfield, x, z)
+    );
+  };
+  for (float at = 0.0f; at <= ray.tMax; at += step) {
+    float const x = ray.origin.x + at*ray.direction.x - heightfield.origin.x;
+    float const z = ray.origin.z + at*ray.direction.z - heightfield.origin.y;
+    if (x < 0.0f || z < 0.0f || x > extentX || z > extentZ) { return false; }
+    if (!below(at)) { continue; }
+    float above = std::max(0.0f, at - step);
+    float under = at;
+    for (size_t it = 0; it < raycastMarchBisections; ++ it) {
+      float const middle = 0.5f*(above + under);
+      (below(middle) ? under : above) = middle;
+    }
+    t = under;
+    return true;
+  }
+  return false;
+}
+
+PuleF32v3 raycastNormalize(PuleF32v3 const v) {
+  float const length = std::sqrt(v.x*v.x + v.y*v.y + v.z*v.z);
+  return PuleF32v3 { v.x/length, v.y/length, v.z/length };
+}
+
+} // namespace
+
+// the same rays through the height pyramid and through a fixed step marcher.
+//   Picking rays come down steeply from a strategy camera, grazing rays run
+//   just over the ground as line of sight does, which is where marching
+//   hurts most. Sight lines run eye to target between units on the ground,
+//   as a batch through heightPyramidVisible against marching each one. The
+//   pyramid builds its blocks on first touch, the first repetition pays for
+//   that
+void benchmarkSuiteRaycast(std::vector<BenchmarkCase> & cases) {
+  BenchmarkTerrain terrain {};
+  benchmarkTerrainCreate(terrain, raycastMapDim, raycastMesas);
+  PulcTerrainHeightfield const & heightfield = terrain.heightfield;
+  HeightPyramid pyramid {};
+  heightPyramidBuild(pyramid, heightfield);
+
+  std::mt19937 random(5);
+  float const extent = static_cast<float>(raycastMapDim - 1);
+  std::uniform_real_distribution<float> along(0.0f, extent);
+  std::uniform_real_distribution<float> angles(0.0f, 6.2831853f);
+  std::vector<RaycastRay> picking, grazing;
+  for (size_t it = 0; it < raycastRays; ++ it) {
+    float const x = along(random), z = along(random);
+    float const cameraZ = std::max(0.0f, z - 150.0f);
+    auto const target = PuleF32v3 {
+      x, raycastHeight(heightfield, x, z), z,
+    };
+    auto const origin = PuleF32v3 { x, target.y + 150.0f, cameraZ };
+    picking.emplace_back(RaycastRay {
+      .origin = origin,
+      .direction = raycastNormalize(PuleF32v3 {
+        target.x - origin.x, target.y - origin.y, target.z - origin.z,
+      }),
+      .tMax = 1000.0f,
+    });
+    float const angle = angles(random);
+    grazing.emplace_back(RaycastRay {
+      .origin = PuleF32v3 { x, target.y + 2.0f, z, },
+      .direction = raycastNormalize(PuleF32v3 {
+        std::cos(angle), -0.002f, std::sin(angle),
+      }),
+      .tMax = 500.0f,
+    });
+  }
+
+  std::vector<PuleF32v3> sightFrom, sightTo;
+  std::uniform_real_distribution<float> ranges(1.0f, raycastSightRange);
+  for (size_t it = 0; it < raycastSightLines; ++ it) {
+    float const x = along(random), z = along(random);
+    float const angle = angles(random), range = ranges(random);
+    float const toX = std::clamp(x + range*std::cos(angle), 0.0f, extent);
+    float const toZ = std::clamp(z + range*std::sin(angle), 0.0f, extent);
+    sightFrom.emplace_back(PuleF32v3 {
+      x, raycastHeight(heightfield, x, z) + raycastEyeHeight, z,
+    });
+    sightTo.emplace_back(PuleF32v3 {
+      toX, raycastHeight(heightfield, toX, toZ) + raycastTargetHeight, toZ,
+    });
+  }
+
+  for (
+    auto const & [label, rays] : {
+      std::pair { "picking", &picking },
+      std::pair { "grazing", &grazing },
+    }
+  ) {
+    std::vector<float> pyramidTs(rays->size(), -1.0f);
+    std::vector<float> marchTs(rays->size(), -1.0f);
+    benchmarkCaseRun(
+      cases, std::string("pyramid-") + label, raycastRepetitions,
+      [&](size_t) {
+        for (size_t it = 0; it < rays->size(); ++ it) {
+          RaycastRay const & ray = (*rays)[it];
+          heightPyramidRaycast(
+            pyramid, ray.origin, ray.direction, ray.tMax, pyramidTs[it]
+          );
+        }
+      }
+    ).items = rays->size();
+    benchmarkCaseRun(
+      cases, std::string("march-") + label, raycastRepetitions,
+      [&](size_t) {
+        for (size_t it = 0; it < rays->size(); ++ it) {
+          raycastMarch(heightfield, (*rays)[it], marchTs[it]);
+        }
+      }
+    ).items = rays->size();
+
+    // the marcher steps over thin features, so only a few may disagree
+    size_t disagreeing = 0;
+    for (size_t it = 0; it < rays->size(); ++ it) {
+      disagreeing += std::fabs(pyramidTs[it] - marchTs[it]) > 0.1f;
+    }
+    std::fprintf(
+      stderr, "benchmark: %zu of %zu %s rays disagree\n",
+      disagreeing, rays->size(), label
+    );
+  }
+
+  std::vector<uint8_t> pyramidVisible(raycastSightLines);
+  std::vector<uint8_t> marchVisible(raycastSightLines);
+  benchmarkCaseRun(
+    cases, "pyramid-sight", raycastRepetitions, [&](size_t) {
+      heightPyramidVisible(
+        pyramid, sightFrom.data(), sightTo.data(), raycastSightLines,
+        pyramidVisible.data()
+      );
+    }
+  ).items = raycastSightLines;
+  benchmarkCaseRun(
+    cases, "march-sight", raycastRepetitions, [&](size_t) {
+      for (size_t it = 0; it < raycastSightLines; ++ it) {
+        PuleF32v3 const from = sightFrom[it], to = sightTo[it];
+        auto const delta = PuleF32v3 {
+          to.x - from.x, to.y - from.y, to.z - from.z,
+        };
+        float const length = std::sqrt(
+          delta.x*delta.x + delta.y*delta.y + delta.z*delta.z
+        );
+        auto const ray = RaycastRay {
+          .origin = from, .direction = raycastNormalize(delta), .tMax = length,
+        };
+        float t;
+        marchVisible[it] = !raycastMarch(heightfield, ray, t);
+      }
+    }
+  ).items = raycastSightLines;
+  size_t disagreeing = 0;
+  for (size_t it = 0; it < raycastSightLines; ++ it) {
+    disagreeing += pyramidVisible[it] != marchVisible[it];
+  }
+  std::fprintf(
+    stderr, "benchmark: %zu of %zu sight lines disagree\n",
+    disagreeing, raycastSightLines
+  );
+
+  tiledHeightmapClose(terrain.heightmap);
+}
@@ -0,0 +1,72 @@
+#include "benchmark.h"
+
+#include "../../plugins/graph/spatial/unit-grid.h"
+
+namespace {
+
+size_t constexpr spatialGridCounts[] = { 10'000, 25'000, 50'000, 100'000, };
+size_t constexpr spatialGridRepetitions = 10;
+// the simulation's cell, separation-sized queries, target acquisition's
+//   nearest few and a box selection a little wider than a squad
+float constexpr spatialGridCellDim = 2.0f;
+float constexpr spatialGridRadius = 4.0f;
+size_t constexpr spatialGridNearest = 8;
+float constexpr spatialGridNearestRadius = 16.0f;
+float constexpr spatialGridBoxHalf = 8.0f;
+
+} // namespace
+
+// rebuild and query at fixed density over growing unit counts; every unit
+//   queries once, so each case should grow linearly with the count
+void benchmarkSuiteSpatialGrid(std::vector<BenchmarkCase> & cases) {
+  std::vector<uint32_t> found;
+  for (size_t const count : spatialGridCounts) {
+    std::vector<PuleF32v2> const positions = benchmarkPositions(count);
+    float const extent = benchmarkPositionsExtent(count);
+    std::string const suffix = "-" + std::to_string(count/1000) + "k";
+
+    UnitGrid grid {};
+    unitGridConfigure(
+      grid, PuleF32v2 { 0.0f, 0.0f }, PuleF32v2 { extent, extent },
+      spatialGridCellDim
+    );
+    benchmarkCaseRun(cases, "rebuild" + suffix, spatialGridRepetitions,
+      [&](size_t) {
+        unitGridRebuild(grid, positions.data(), sizeof(PuleF32v2), count);
+      }
+    );
+    benchmarkCaseRun(cases, "radius" + suffix, spatialGridRepetitions,
+      [&](size_t) {
+        for (PuleF32v2 const & position : positions) {
+          unitGridQueryRadius(grid, position, spatialGridRadius, found);
+        }
+      }
+    );
+    benchmarkCaseRun(cases, "aabb" + suffix, spatialGridRepetitions,
+      [&](size_t) {
+        for (PuleF32v2 const & position : positions) {
+          unitGridQueryAabb(
+            grid,
+            PuleF32v2 {
+              position.x - spatialGridBoxHalf, position.y - spatialGridBoxHalf
+            },
+            PuleF32v2 {
+              position.x + spatialGridBoxHalf, position.y + spatialGridBoxHalf
+            },
+            found
+          );
+        }
+      }
+    );
+    benchmarkCaseRun(cases, "nearest" + suffix, spatialGridRepetitions,
+      [&](size_t) {
+        for (PuleF32v2 const & position : positions) {
+          unitGridQueryNearest(
+            grid, position, spatialGridNearest, spatialGridNearestRadius,
+            found
+          );
+        }
+      }
+    );
+  }
+}
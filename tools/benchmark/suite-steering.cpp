@@ -0,0 +1,82 @@
+#include "benchmark.h"
+
+#include "../../plugins/graph/movement/steering.h"
+#include "../../plugins/graph/spatial/unit-grid.h"
+
+#include <random>
+
+namespace {
+
+size_t constexpr steeringCounts[] = { 10'000, 100'000, };
+size_t constexpr steeringRepetitions = 20;
+// as the simulation steers, a tick at 20Hz
+float constexpr steeringCellDim = 2.0f;
+float constexpr steeringRadius = 1.0f;
+float constexpr steeringStrength = 2.0f;
+float constexpr steeringResponsiveness = 8.0f;
+float constexpr steeringTimestep = 1.0f/20.0f;
+
+void steeringBatchFill(
+  SteeringBatch & batch, std::vector<PuleF32v2> const & positions
+) {
+  std::mt19937 random(4);
+  std::uniform_real_distribution<float> heading(-1.0f, 1.0f);
+  steeringBatchResize(batch, positions.size());
+  for (size_t it = 0; it < positions.size(); ++ it) {
+    batch.positionX[it] = positions[it].x;
+    batch.positionY[it] = positions[it].y;
+    batch.velocityX[it] = batch.velocityY[it] = 0.0f;
+    batch.desiredX[it] = 3.0f*heading(random);
+    batch.desiredY[it] = 3.0f*heading(random);
+    batch.maxSpeed[it] = 3.0f;
+  }
+}
+
+} // namespace
+
+// separation and integration over the whole batch with every kernel the
+//   running CPU has, reported as units per millisecond; the batch is refilled
+//   for each kernel so they all start from the same state
+void benchmarkSuiteSteering(std::vector<BenchmarkCase> & cases) {
+  SteeringBatch batch {};
+  for (size_t const count : steeringCounts) {
+    std::vector<PuleF32v2> const positions = benchmarkPositions(count);
+    float const extent = benchmarkPositionsExtent(count);
+    std::string const suffix = "-" + std::to_string(count/1000) + "k";
+
+    UnitGrid grid {};
+    unitGridConfigure(
+      grid, PuleF32v2 { 0.0f, 0.0f }, PuleF32v2 { extent, extent },
+      steeringCellDim
+    );
+    unitGridRebuild(grid, positions.data(), sizeof(PuleF32v2), count);
+
+    for (
+      int kernel = SteeringKernel_scalar;
+      kernel <= steeringKernelDetect();
+      ++ kernel
+    ) {
+      auto const steeringKernel = static_cast<SteeringKernel>(kernel);
+      std::string const label = steeringKernelLabel(steeringKernel);
+      steeringBatchFill(batch, positions);
+      benchmarkCaseRun(
+        cases, "separation-" + label + suffix, steeringRepetitions,
+        [&](size_t) {
+          steeringSeparation(
+            batch, grid, steeringRadius, steeringStrength, steeringKernel,
+            0, count
+          );
+        }
+      ).items = count;
+      benchmarkCaseRun(
+        cases, "integrate-" + label + suffix, steeringRepetitions,
+        [&](size_t) {
+          steeringIntegrate(
+            batch, steeringTimestep, steeringResponsiveness, steeringKernel,
+            0, count
+          );
+        }
+      ).items = count;
+    }
+  }
+}
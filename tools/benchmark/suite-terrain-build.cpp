@@ -0,0 +1,58 @@
+#include "benchmark.h"
+
+#include "../../plugins/graph/jobs/job-system.h"
+#include "../../plugins/terrain/mesh/terrain-chunks.h"
+
+#include <thread>
+
+namespace {
+
+size_t constexpr terrainBuildMapDim = 2048;
+size_t constexpr terrainBuildThreadCounts[] = { 1, 2, 4, 8, 16, 32, };
+size_t constexpr terrainBuildRepetitions = 3;
+
+} // namespace
+
+// every chunk of a map built into a pre-sized vertex buffer, one chunk per
+//   job as the builder splits a batch, over growing thread counts up to the
+//   hardware's; one thread builds serially as the builder does without a
+//   job system
+void benchmarkSuiteTerrainBuild(std::vector<BenchmarkCase> & cases) {
+  BenchmarkTerrain terrain {};
+  benchmarkTerrainCreate(terrain, terrainBuildMapDim, 0);
+  TerrainChunks chunks {};
+  terrainChunksLayout(chunks, terrain.heightfield);
+  std::vector<TerrainMeshAttribute> vertices(
+    chunks.chunks.size() * terrainChunkVertices
+  );
+  auto const buildRange = [&](size_t const begin, size_t const end) {
+    for (size_t it = begin; it < end; ++ it) {
+      terrainChunkBuild(
+        chunks.chunks[it], terrain.heightfield,
+        vertices.data() + it*terrainChunkVertices
+      );
+    }
+  };
+
+  size_t const hardwareThreads = std::max(
+    1u, std::thread::hardware_concurrency()
+  );
+  for (size_t const threads : terrainBuildThreadCounts) {
+    if (threads > hardwareThreads) { break; }
+    std::string const name = "threads-" + std::to_string(threads);
+    if (threads == 1) {
+      benchmarkCaseRun(cases, name, terrainBuildRepetitions, [&](size_t) {
+        buildRange(0, chunks.chunks.size());
+      }).items = chunks.chunks.size();
+      continue;
+    }
+    // the caller takes part, so one worker fewer
+    JobPool * const pool = jobPoolCreate(threads - 1);
+    benchmarkCaseRun(cases, name, terrainBuildRepetitions, [&](size_t) {
+      jobParallelFor(*pool, chunks.chunks.size(), 1, buildRange);
+    }).items = chunks.chunks.size();
+    jobPoolDestroy(pool);
+  }
+
+  tiledHeightmapClose(terrain.heightmap);
+}